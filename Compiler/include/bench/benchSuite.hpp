@@ -0,0 +1,148 @@
+/*
+ File: benchSuite.hpp
+ Project: Épée Database Query Language
+ Description: Benchmark suite behind epee_bench: deterministic data generators,
+              a TPC-H-inspired workload and JSON reports
+*/
+
+#ifndef EPEE_BENCH_SUITE_H
+#define EPEE_BENCH_SUITE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "../database/executor.hpp"
+
+namespace epee {
+
+// splitmix64: the same seed always yields the same data set, on every
+// platform, so runs at one scale factor are comparable
+class BenchRandom {
+public:
+    explicit BenchRandom(uint64_t seed) : state_(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+    // Uniform in [lo, hi]
+    int64_t range(int64_t lo, int64_t hi) {
+        return lo + static_cast<int64_t>(next() % static_cast<uint64_t>(hi - lo + 1));
+    }
+    // Uniform in [lo, hi), rounded to cents
+    double money(double lo, double hi) {
+        const double x = lo + (hi - lo) * (static_cast<double>(next() >> 11) / 9007199254740992.0);
+        return static_cast<double>(static_cast<int64_t>(x * 100.0)) / 100.0;
+    }
+
+private:
+    uint64_t state_;
+};
+
+// One generated table: the statement that creates it and the CSV file
+// (with a header line) holding its rows
+struct BenchTable {
+    std::string name;
+    std::string create;
+    std::string path;
+    size_t rows = 0;
+};
+
+// A TPC-H-shaped schema scaled by a factor N: region (5) and nation (25)
+// are fixed, and at N = 1 there are 100 suppliers, 1,500 customers, 2,000
+// parts, 15,000 orders and about 60,000 line items.  Dates are yyyymmdd
+// ints.
+class BenchDataGenerator {
+public:
+    explicit BenchDataGenerator(double scale, uint64_t seed = 42)
+        : scale_(scale), seed_(seed) {}
+
+    // Write every table's CSV file under `dir` (which must exist)
+    std::vector<BenchTable> generate(const std::string& dir) const;
+
+private:
+    double scale_;
+    uint64_t seed_;
+
+    size_t scaled(size_t rowsAtOne) const;
+};
+
+// A timed unit of work.  `setup` runs untimed before every repetition
+// (DML cases use it to put the table back in the same state); `source` is
+// lexed, parsed and executed inside the timer.
+struct BenchQuery {
+    std::string name;
+    std::string category;  // scan, filter, group, join, topn, lookup, dml
+    std::string source;
+    std::string setup;
+    std::string driver;    // table whose size measures rows/s
+};
+
+// The workload over the generated schema; DML batch sizes follow `scale`
+std::vector<BenchQuery> benchWorkload(double scale);
+
+struct LatencySummary {
+    size_t samples = 0;
+    double minMs = 0, meanMs = 0, p50Ms = 0, p95Ms = 0, p99Ms = 0, maxMs = 0;
+
+    // Percentiles use the nearest-rank method
+    static LatencySummary of(std::vector<double> ms);
+};
+
+struct BenchResult {
+    std::string name;
+    std::string category;
+    size_t rowsOut = 0;      // rows returned (or affected) by the last repetition
+    size_t rowsScanned = 0;  // rows in the driving table
+    LatencySummary latency;
+    double queriesPerSec = 0;
+    double rowsPerSec = 0;   // rowsScanned over the median latency
+};
+
+struct BenchReport {
+    double scale = 1;
+    int repetitions = 0;
+    int warmup = 0;
+    size_t loadRows = 0;
+    double loadSeconds = 0;
+    std::vector<BenchResult> results;
+    long peakRssKb = 0;
+
+    // One JSON object; each result sits on a line of its own
+    std::string toJson() const;
+
+    // Median latency per query name from a report written by toJson()
+    static std::map<std::string, double> readBaseline(const std::string& json);
+};
+
+// Runs the workload against an in-memory database
+class BenchRunner {
+public:
+    BenchRunner(int repetitions, int warmup);
+
+    // Create and COPY every table, returning the load's wall time in
+    // seconds; then index the key columns and analyze (untimed)
+    double load(const std::vector<BenchTable>& tables);
+
+    BenchResult run(const BenchQuery& query);
+
+private:
+    Executor executor_;
+    int repetitions_;
+    int warmup_;
+
+    // Lex, parse and execute `source`; throws std::runtime_error on a parse
+    // or execution error
+    QueryResult execute(const std::string& source);
+};
+
+// The process's peak resident set size in kilobytes (0 where unknown)
+long peakRssKb();
+
+} // namespace epee
+
+#endif /* EPEE_BENCH_SUITE_H */
@@ -0,0 +1,96 @@
+/*
+ File: microBench.hpp
+ Project: Épée Database Query Language
+ Description: Micro-benchmark harness for engine primitives: calibrated
+              batches, warm-up, repeated samples, summary statistics and
+              optional hardware counters
+*/
+
+#ifndef EPEE_MICRO_BENCH_H
+#define EPEE_MICRO_BENCH_H
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../database/perfCounters.hpp"
+
+namespace epee {
+
+// Makes `value` look used so the compiler cannot drop the work behind it
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// One primitive to measure.  `run(n)` performs the operation n times; the
+// harness picks n so that a sample lasts long enough to time reliably.
+// `setup`, if set, runs untimed before every sample (and before each
+// calibration attempt) for cases that consume or grow their state.
+struct MicroCase {
+    std::string name;
+    std::function<void(size_t)> run;
+    std::function<void()> setup;
+    double bytesPerOp = 0;  // input size of one operation, for MB/s
+};
+
+struct MicroOptions {
+    int warmup = 2;             // untimed samples
+    int samples = 15;           // timed samples
+    double minSampleMs = 20;    // calibration target for one sample
+    bool counters = false;      // read hardware counters around each sample
+    std::string filter;         // only cases whose name contains this
+};
+
+// Nanoseconds per operation over the timed samples
+struct MicroStats {
+    double mean = 0, median = 0, stddev = 0, min = 0, max = 0;
+    double mad = 0;  // median absolute deviation
+
+    static MicroStats of(std::vector<double> values);
+    double cv() const { return mean > 0 ? stddev / mean : 0; }  // relative spread
+};
+
+struct MicroResult {
+    std::string name;
+    size_t opsPerSample = 0;
+    int samples = 0;
+    MicroStats nsPerOp;
+    double mbPerSec = 0;       // from the median, when the case has bytesPerOp
+    // Per operation, summed over all timed samples; only when counters were
+    // requested and available
+    bool hasCounters = false;
+    double cycles = 0, instructions = 0, cacheMisses = 0, branchMisses = 0;
+};
+
+class MicroBench {
+public:
+    explicit MicroBench(const MicroOptions& options) : options_(options) {}
+
+    void add(std::string name, std::function<void(size_t)> run,
+             std::function<void()> setup = nullptr, double bytesPerOp = 0) {
+        cases_.push_back({std::move(name), std::move(run), std::move(setup), bytesPerOp});
+    }
+
+    // Run every selected case in order, printing a line for each to `out`
+    std::vector<MicroResult> runAll(std::ostream& out);
+
+    // Whether hardware counters could be opened on this machine
+    bool countersAvailable() const { return counters_.available(); }
+
+    static std::string toJson(const std::vector<MicroResult>& results, const MicroOptions& options);
+
+private:
+    MicroOptions options_;
+    std::vector<MicroCase> cases_;
+    PerfCounters counters_;
+
+    size_t calibrate(const MicroCase& c) const;
+    MicroResult run(const MicroCase& c);
+};
+
+} // namespace epee
+
+#endif /* EPEE_MICRO_BENCH_H */
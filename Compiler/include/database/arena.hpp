@@ -0,0 +1,117 @@
+/*
+ File: arena.hpp
+ Project: Épée Database Query Language
+ Description: Bump allocator for parse-time data: AST nodes and token text
+*/
+
+#ifndef EPEE_ARENA_H
+#define EPEE_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace epee {
+
+// Hands out memory from large blocks by bumping a pointer; nothing is freed
+// until the arena itself goes away.  Allocating is not thread-safe (one
+// parse fills an arena), but the reference count is: the arena is deleted
+// when its owner and every allocation made through an ArenaAllocator have
+// released it, on whichever thread that happens.
+class Arena {
+public:
+    static constexpr size_t kBlockSize = 4096;
+
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void retain() { refs_.fetch_add(1, std::memory_order_relaxed); }
+    void release() {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    void* allocate(size_t size, size_t align) {
+        size_t pad = (align - reinterpret_cast<uintptr_t>(next_) % align) % align;
+        if (pad + size > left_) {
+            grow(size + align);
+            pad = (align - reinterpret_cast<uintptr_t>(next_) % align) % align;
+        }
+        char* p = next_ + pad;
+        next_ = p + size;
+        left_ -= pad + size;
+        return p;
+    }
+
+    // A copy of `text` that lives as long as the arena
+    std::string_view copy(std::string_view text) {
+        if (text.empty()) return {};
+        char* p = static_cast<char*>(allocate(text.size(), 1));
+        std::memcpy(p, text.data(), text.size());
+        return {p, text.size()};
+    }
+
+    size_t bytes() const { return bytes_; }
+
+private:
+    std::atomic<size_t> refs_{1};  // the creator's reference
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* next_ = nullptr;
+    size_t left_ = 0;
+    size_t bytes_ = 0;
+
+    ~Arena() = default;
+
+    void grow(size_t atLeast) {
+        const size_t size = atLeast > kBlockSize ? atLeast : kBlockSize;
+        blocks_.emplace_back(new char[size]);
+        next_ = blocks_.back().get();
+        left_ = size;
+        bytes_ += size;
+    }
+};
+
+// Owning handle to a new arena (the creator's reference)
+struct ArenaRelease {
+    void operator()(Arena* arena) const { arena->release(); }
+};
+using ArenaPtr = std::unique_ptr<Arena, ArenaRelease>;
+
+// Allocator for std::allocate_shared that places the object and its
+// reference counts in an arena.  Every allocation holds a reference to the
+// arena until it is deallocated, so a node may outlive the parse that made
+// it; the arena's blocks are released together once its last node is gone.
+// Copies of the allocator are free.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena* arena) : arena_(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+    T* allocate(size_t n) {
+        arena_->retain();
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t) { arena_->release(); }
+
+    Arena* arena() const { return arena_; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena_ == other.arena(); }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena_ != other.arena(); }
+
+private:
+    Arena* arena_;
+};
+
+} // namespace epee
+
+#endif /* EPEE_ARENA_H */
@@ -10,6 +10,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "value.hpp"
 
@@ -32,14 +33,20 @@ public:
 
     // Mutators
     void insert(const Value& key, size_t rowIndex);
+    // Add many entries at once, sorted by key so each lands next to the
+    // previous one; unique keys must already have been checked
+    void insertBatch(std::vector<std::pair<Value, size_t>> entries);
     void remove(const Value& key, size_t rowIndex);
     void clear();
 
     // Queries
+    bool contains(const Value& key) const { return index_.count(key) > 0; }
     std::set<size_t> find(const Value& key) const;
     std::set<size_t> findRange(const Value& low, const Value& high) const;
     std::set<size_t> findGreaterThan(const Value& key) const;
     std::set<size_t> findLessThan(const Value& key) const;
+    // Rows whose key is a string starting with `prefix` (byte-wise)
+    std::set<size_t> findPrefix(std::string_view prefix) const;
 
     // Rebuild from scratch
     void rebuild(const std::vector<std::vector<Value>>& rows);
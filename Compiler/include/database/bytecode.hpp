@@ -0,0 +1,120 @@
+/*
+ File: bytecode.hpp
+ Project: Épée Database Query Language
+ Description: Stack bytecode for the imperative layer (variables, if, while,
+              function bodies) and the compiler that produces it
+*/
+
+#ifndef EPEE_BYTECODE_H
+#define EPEE_BYTECODE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "dbParser.hpp"
+#include "value.hpp"
+
+namespace epee {
+
+struct CompiledFunction;
+
+// Operands a and b of each opcode; "name" operands index Chunk::names
+#define EPEE_OPCODES(X)                                                          \
+    X(CONST)          /* push constants[a] */                                    \
+    X(LOAD_LOCAL)     /* push slot a, or global name b while a is unassigned */  \
+    X(LOAD_GLOBAL)    /* push global name a */                                   \
+    X(STORE_LOCAL)    /* pop into slot a (variable name b) */                    \
+    X(STORE_GLOBAL)   /* pop into global name a */                               \
+    X(DECLARE_LOCAL)  /* pop into slot a */                                      \
+    X(DECLARE_GLOBAL) /* pop into global name a */                               \
+    X(ADD) X(SUB) X(MUL) X(DIV) X(MOD)                                           \
+    X(EQ) X(NE) X(LT) X(GT) X(LE) X(GE)                                          \
+    X(NEG) X(NOT)                                                                \
+    X(TRUTH)          /* replace the top with its truth value */                 \
+    X(JUMP)           /* continue at a */                                        \
+    X(JUMP_IF_FALSE)  /* pop; continue at a when false */                        \
+    X(JUMP_IF_TRUE)   /* pop; continue at a when true */                         \
+    X(CALL)           /* pop b arguments, push the result of callSites[a] */     \
+    X(EVAL)           /* push the tree-walking evaluation of exprs[a] */         \
+    X(EXEC)           /* run stmts[a] through the executor */                    \
+    X(PRINT)          /* pop and print */                                        \
+    X(RETURN)         /* pop the return value and leave the function */          \
+    X(RESULT)         /* the block's result so far is BlockResult a */           \
+    X(HALT)
+
+enum class OpCode : uint8_t {
+#define EPEE_OPCODE_ENUM(name) name,
+    EPEE_OPCODES(EPEE_OPCODE_ENUM)
+#undef EPEE_OPCODE_ENUM
+};
+
+struct Instruction {
+    OpCode op;
+    int32_t a = 0;
+    int32_t b = 0;
+};
+
+// What a statement leaves as the result of the block it ends, built into a
+// QueryResult only when somebody asks for it
+enum class BlockResult : int32_t { EMPTY, OK, DECLARED, ASSIGNED, PRINTED, EXECUTED };
+
+// A call to a user-defined or built-in function.  Which one the name means
+// is looked up when the call runs and kept until a function is (re)defined.
+struct CallSite {
+    std::string name;
+    std::string lowerName;  // for built-ins
+    uint64_t generation = UINT64_MAX;
+    std::shared_ptr<CompiledFunction> function;  // null while the name is a built-in
+};
+
+// Compiled code with its operand pools.  The caches (resolved globals,
+// call sites) belong to one executor's session, so a chunk only ever runs
+// on the executor that compiled it.
+struct Chunk {
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    std::vector<std::string> names;
+    std::vector<ExprPtr> exprs;
+    std::vector<StmtPtr> stmts;
+    size_t maxStack = 0;
+
+    mutable std::vector<Value*> globals;  // per name, once looked up (variables are never erased)
+    mutable std::vector<CallSite> callSites;
+};
+
+// Compiles imperative statements to a Chunk.  Assignments, declarations,
+// PRINT, IF, WHILE and RETURN become bytecode, as do the arithmetic,
+// comparisons, logic, variable reads and function calls in their
+// expressions; any other statement (queries, pipelines, DML, definitions)
+// runs through the executor from an EXEC instruction, and any other
+// expression through EVAL.  With `locals`, the slot annotations the
+// executor puts on a function body address the running frame.
+class BytecodeCompiler {
+public:
+    explicit BytecodeCompiler(bool locals) : locals_(locals) {}
+
+    void block(const std::vector<StmtPtr>& stmts);
+    void ifStatement(const IfStmt& stmt);
+    void whileStatement(const WhileStmt& stmt);
+
+    Chunk finish();
+
+private:
+    bool locals_;
+    Chunk chunk_;
+    size_t depth_ = 0;
+
+    void statement(const StmtPtr& stmt);
+    void expression(const ExprPtr& expr);
+    // Appends an instruction, tracking the stack depth it leaves
+    size_t emit(OpCode op, int32_t a = 0, int32_t b = 0);
+    // Points the jump at `jump` to the next instruction
+    void patch(size_t jump) { chunk_.code[jump].a = static_cast<int32_t>(chunk_.code.size()); }
+    int32_t constant(const Value& value);
+    int32_t name(const std::string& name);
+};
+
+} // namespace epee
+
+#endif /* EPEE_BYTECODE_H */
@@ -7,13 +7,17 @@
 #ifndef EPEE_DB_LEXER_H
 #define EPEE_DB_LEXER_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include <cctype>
 #include <stdexcept>
 #include <algorithm>
+#include "arena.hpp"
 
 namespace epee {
 
@@ -21,6 +25,8 @@ enum class DbTokenType {
     // Literals
     INT_LIT, DOUBLE_LIT, STRING_LIT, BOOL_LIT, NULL_LIT,
 
+    PARAM,  // $1, $2, ... in prepared statements
+
     // Identifier
     IDENTIFIER,
 
@@ -80,6 +86,10 @@ enum class DbTokenType {
     // Keywords - Operational
     EXPLAIN,
 
+    PREPARE, EXECUTE, DEALLOCATE,
+
+    COPY,
+
     // Keywords - Pipeline aliases
     TAKE, SKIP_KW, MAP,
 
@@ -95,16 +105,21 @@ enum class DbTokenType {
     EOF_TOKEN, ERROR_TOKEN
 };
 
+// Token text is a view into the lexer's copy of the source (or, for string
+// literals with escapes, into its arena), so tokens are only valid until the
+// lexer is given new source or destroyed.
 struct DbToken {
     DbTokenType type;
-    std::string value;
+    std::string_view value;
     int line;
     int col;
 
     DbToken() : type(DbTokenType::EOF_TOKEN), line(0), col(0) {}
-    DbToken(DbTokenType t, const std::string& v, int l, int c)
+    DbToken(DbTokenType t, std::string_view v, int l, int c)
         : type(t), value(v), line(l), col(c) {}
 
+    std::string text() const { return std::string(value); }
+
     bool is(DbTokenType t) const { return type == t; }
     bool isKeyword() const {
         return type >= DbTokenType::CREATE && type <= DbTokenType::REPLACE;
@@ -126,8 +141,8 @@ private:
     size_t pos_;
     int line_;
     int col_;
+    ArenaPtr text_;  // unescaped string literals
 
-    void initKeywords();
     char peek() const;
     char peekNext() const;
     char advance();
@@ -135,15 +150,18 @@ private:
     void skipWhitespace();
     void skipLineComment();
     void skipBlockComment();
+    void skipWhile(uint8_t cls);
 
     DbToken scanToken();
     DbToken scanNumber();
     DbToken scanString();
     DbToken scanIdentifierOrKeyword();
 
-    DbToken makeToken(DbTokenType type, const std::string& value);
-
-    std::unordered_map<std::string, DbTokenType> keywords_;
+    DbToken makeToken(DbTokenType type, std::string_view value);
+    // The source text from `start` up to the current position
+    std::string_view lexeme(size_t start) const {
+        return std::string_view(source_).substr(start, pos_ - start);
+    }
 };
 
 } // namespace epee
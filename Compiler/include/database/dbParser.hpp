@@ -12,6 +12,7 @@
 #include <memory>
 #include <functional>
 #include <variant>
+#include "arena.hpp"
 #include "dbLexer.hpp"
 #include "value.hpp"
 
@@ -31,9 +32,20 @@ struct LiteralExpr : Expression {
     explicit LiteralExpr(const Value& v) : value(v) {}
 };
 
+// Bind parameter $n of a prepared statement.  It is a literal whose value is
+// set each time the statement executes, so the executor treats it exactly
+// like a constant (index lookups, dictionary comparisons, estimates).
+struct ParamExpr : LiteralExpr {
+    size_t index;  // 1-based
+    explicit ParamExpr(size_t i) : LiteralExpr(Value::null()), index(i) {}
+};
+
 struct ColumnExpr : Expression {
     std::string tableName;  // optional: table.column
     std::string columnName;
+    // Frame slot when this names a local of the user-defined function it
+    // appears in (set by the executor when the function is defined)
+    int slot = -1;
     ColumnExpr(const std::string& col) : columnName(col) {}
     ColumnExpr(const std::string& tbl, const std::string& col) : tableName(tbl), columnName(col) {}
 
@@ -78,10 +90,29 @@ struct BetweenExpr : Expression {
         : expr(e), low(l), high(h), negated(neg) {}
 };
 
+// The values of an IN list that holds only constants, evaluated once per
+// execution.  Short lists are scanned; longer ones are probed in a hash set.
+struct InValues {
+    static constexpr size_t kScanLimit = 8;
+    std::vector<Value> values;
+    ValueSet set;  // empty while values.size() <= kScanLimit
+
+    explicit InValues(std::vector<Value> v) : values(std::move(v)) {
+        if (values.size() > kScanLimit) set.insert(values.begin(), values.end());
+    }
+    bool contains(const Value& v) const {
+        if (values.size() > kScanLimit) return set.count(v) > 0;
+        for (const auto& value : values)
+            if (v == value) return true;
+        return false;
+    }
+};
+
 struct InExpr : Expression {
     ExprPtr expr;
     std::vector<ExprPtr> values;
     bool negated;
+    std::shared_ptr<const InValues> constants;  // set by the executor on its rewritten copies
     InExpr(ExprPtr e, std::vector<ExprPtr> v, bool neg = false)
         : expr(e), values(std::move(v)), negated(neg) {}
 };
@@ -90,7 +121,11 @@ struct LikeExpr : Expression {
     ExprPtr expr;
     std::string pattern;
     bool negated;
-    LikeExpr(ExprPtr e, const std::string& p, bool neg = false) : expr(e), pattern(p), negated(neg) {}
+    std::shared_ptr<const LikeMatcher> matcher;  // compiled once, shared by rewritten copies
+    LikeExpr(ExprPtr e, const std::string& p, bool neg = false)
+        : expr(e), pattern(p), negated(neg), matcher(std::make_shared<const LikeMatcher>(p)) {}
+    LikeExpr(ExprPtr e, const LikeExpr& like, bool neg)
+        : expr(e), pattern(like.pattern), negated(neg), matcher(like.matcher) {}
 };
 
 struct IsNullExpr : Expression {
@@ -123,6 +158,7 @@ struct CreateTableStmt : Statement {
         bool primaryKey = false;
         bool unique = false;
         bool nullable = true;
+        bool dictionary = false;
     };
     std::vector<ColumnDef> columns;
 };
@@ -173,7 +209,7 @@ struct PipelineStage {
     enum class Type {
         WHERE, SELECT, ORDERBY, LIMIT, OFFSET, GROUPBY, HAVING,
         JOIN, UPDATE, DELETE_STAGE, PRINT, DISTINCT, COUNT_STAGE,
-        MAP, TAKE, SKIP_STAGE
+        MAP, TAKE, SKIP_STAGE, EXPORT
     };
     Type type;
 
@@ -183,6 +219,7 @@ struct PipelineStage {
     // SELECT
     std::vector<ExprPtr> columns;
     bool selectDistinct = false;
+    bool pruning = false;  // column pruning inserted by the pipeline rewriter
 
     // ORDERBY
     std::vector<std::pair<ExprPtr, bool>> orderCols;  // expr, ascending
@@ -201,11 +238,20 @@ struct PipelineStage {
 
     // UPDATE
     std::vector<std::pair<std::string, ExprPtr>> assignments;
+
+    // EXPORT: format name, empty to go by the file extension
+    std::string exportPath;
+    std::string exportFormat;
 };
 
 struct PipelineStmt : Statement {
     std::string tableName;
     std::vector<PipelineStage> stages;
+
+    // Rewritten stages, kept by the executor while the catalog version they
+    // were planned against is current
+    mutable std::shared_ptr<const std::vector<PipelineStage>> plan;
+    mutable uint64_t planVersion = 0;
 };
 
 struct BeginStmt : Statement {};
@@ -225,11 +271,13 @@ struct PrintStmt : Statement {
 struct VarDeclStmt : Statement {
     ValueType type;
     std::vector<std::string> names;
+    std::vector<int> slots;  // per name, inside a function body
 };
 
 struct AssignStmt : Statement {
     std::string varName;
     ExprPtr value;
+    int slot = -1;  // inside a function body
 };
 
 // Control flow
@@ -320,6 +368,47 @@ struct ShowGrantsStmt : Statement {
 // Operational
 struct ExplainStmt : Statement {
     StmtPtr innerStmt;
+    bool analyze = false;  // EXPLAIN ANALYZE: run the statement and report actuals
+    bool json = false;     // EXPLAIN ANALYZE JSON
+};
+
+struct AnalyzeStmt : Statement {
+    std::string tableName;  // empty = every table
+};
+
+struct ShowStatsStmt : Statement {
+    std::string tableName;  // empty = every analyzed table
+};
+
+// Prepared statements
+struct PrepareStmt : Statement {
+    std::string name;
+    StmtPtr statement;
+    std::vector<std::shared_ptr<ParamExpr>> params;  // every $n in the statement
+};
+
+struct ExecuteStmt : Statement {
+    std::string name;
+    std::vector<ExprPtr> args;
+};
+
+struct DeallocateStmt : Statement {
+    std::string name;
+};
+
+// COPY <table> FROM "<file>" [DELIMITER "<c>"] [HEADER]
+struct CopyStmt : Statement {
+    std::string tableName;
+    std::string path;
+    char delimiter = '\0';  // '\0': chosen from the file extension
+    bool header = false;
+};
+
+// SET <option> = <value>, e.g. SET trace = on;
+struct SetOptionStmt : Statement {
+    std::string option;
+    std::string value;
+    bool quoted = false;  // value was a string literal
 };
 
 // The Parser
@@ -333,10 +422,30 @@ public:
     bool hasErrors() const { return !errors_.empty(); }
     const std::vector<std::string>& getErrors() const { return errors_; }
 
+    // Literal node built from each token (null where none was), so cached
+    // statements can be rebound to new literal values
+    const std::vector<std::shared_ptr<LiteralExpr>>& literalNodes() const { return literalNodes_; }
+
+    // Accept $n parameters outside PREPARE (for Executor::prepare); the
+    // nodes made for them are collected in parameters()
+    void allowParameters(bool allow) { allowParams_ = allow; }
+    const std::vector<std::shared_ptr<ParamExpr>>& parameters() const { return params_; }
+
 private:
     std::vector<DbToken> tokens_;
     size_t pos_;
     std::vector<std::string> errors_;
+    std::vector<std::shared_ptr<LiteralExpr>> literalNodes_;
+    std::vector<std::shared_ptr<ParamExpr>> params_;
+    bool allowParams_ = false;
+    // The nodes of one parse share an arena; each keeps it alive, so the
+    // blocks are released together when the last node of the parse goes
+    ArenaPtr arena_;
+
+    template <typename T, typename... Args>
+    std::shared_ptr<T> node(Args&&... args) {
+        return std::allocate_shared<T>(ArenaAllocator<T>(arena_.get()), std::forward<Args>(args)...);
+    }
 
     // Token navigation
     const DbToken& peek() const;
@@ -344,7 +453,12 @@ private:
     const DbToken& advance();
     bool check(DbTokenType type) const;
     bool match(DbTokenType type);
-    const DbToken& expect(DbTokenType type, const std::string& msg);
+    // An identifier spelled `word` in any case, for words that are only
+    // keywords in one position (ANALYZE), so tables and columns may use them
+    bool checkWord(const char* word) const;
+    bool atAnalyze() const;
+    // `msg` is only turned into a string when the token is missing
+    const DbToken& expect(DbTokenType type, const char* msg);
     bool isAtEnd() const;
 
     void error(const std::string& msg);
@@ -362,6 +476,12 @@ private:
     StmtPtr parseCommit();
     StmtPtr parseRollback();
     StmtPtr parseShowTables();
+    StmtPtr parseAnalyze();
+    StmtPtr parsePrepare();
+    StmtPtr parseExecute();
+    StmtPtr parseDeallocate();
+    StmtPtr parseCopy();
+    StmtPtr parseSetOption();
     StmtPtr parseDescribe();
     StmtPtr parseVarDecl(ValueType type);
     StmtPtr parseAssignOrPipeline();
@@ -393,6 +513,7 @@ private:
     ExprPtr parseMulExpr();
     ExprPtr parseUnaryExpr();
     ExprPtr parsePrimaryExpr();
+    ExprPtr makeLiteral(const Value& value);  // for the token just consumed
     ExprPtr parseColumnOrFunction();
 
     std::vector<ExprPtr> parseExpressionList();
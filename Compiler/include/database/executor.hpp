@@ -16,34 +16,186 @@
 #include <numeric>
 #include <cmath>
 #include <set>
+#include <ostream>
 #include "table.hpp"
 #include "dbParser.hpp"
 #include "value.hpp"
 #include "storage.hpp"
 #include "security.hpp"
+#include "optimizer.hpp"
+#include "resultWriter.hpp"
+#include "lockManager.hpp"
+#include "bytecode.hpp"
+#include "tracer.hpp"
 
 namespace epee {
 
+// One input of a chain of inner joins
+struct JoinInput {
+    std::vector<std::string> columns;
+    const std::vector<Row>* rows = nullptr;
+    const Table* table = nullptr;  // base table behind `rows` (statistics, indexes), if any
+};
+
+// A chain of inner joins planned by the JoinOptimizer.  Every ON conjunct
+// becomes one graph predicate; predicates[i] describes conjuncts[i].
+struct JoinChainPlan {
+    JoinGraph graph;
+    JoinPlan plan;
+    std::vector<ExprPtr> conjuncts;
+};
+
+// Actuals for one operator, collected while EXPLAIN ANALYZE runs a statement
+struct OperatorProfile {
+    std::string operation;
+    std::string detail;
+    std::string access;      // how rows were matched: hash table, index, nested loop
+    size_t rowsIn = 0;
+    size_t rowsOut = 0;
+    double wallMs = 0.0;
+    double cpuMs = 0.0;      // process CPU time, so parallel workers add up
+    int64_t peakBytes = 0;   // peak allocation above the level at operator start
+};
+
+// A statement parsed once and run many times with different $n values.
+// Executing binds the values into the statement's parameter nodes, so one
+// handle must not be executed from two threads at once.
+struct PreparedStatement {
+    StmtPtr statement;
+    std::vector<std::shared_ptr<ParamExpr>> params;
+    size_t paramCount = 0;  // highest $n
+};
+
+using PreparedHandle = std::shared_ptr<PreparedStatement>;
+
+// A user-defined function with its locals resolved to frame slots:
+// parameters first, then every variable its body declares or assigns.
+// Anything else the body names is read from the session's globals.  The
+// body runs as bytecode.
+struct CompiledFunction {
+    std::shared_ptr<FuncDefStmt> def;
+    std::unordered_map<std::string, int> slots;
+    size_t slotCount = 0;
+    Chunk code;
+};
+
+// Nested user-defined function calls allowed before a call fails
+constexpr size_t kMaxCallDepth = 1000;
+
 class Executor {
 public:
     Executor();
     explicit Executor(Database& db);
+    // A session over a shared database and user registry; logins, variables,
+    // functions and prepared statements stay with this executor
+    Executor(Database& db, SecurityManager& security);
+    ~Executor();
 
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    // Locks what the statement reads and writes through the database's
+    // LockManager first, so executors on different threads may share a
+    // Database.  A statement that would deadlock fails (rolling back the
+    // open transaction) instead of waiting.
     QueryResult execute(const StmtPtr& stmt);
     QueryResult executeAll(const std::vector<StmtPtr>& stmts);
 
+    // Parse a single query or DML statement containing $1, $2, ...
+    // Throws std::runtime_error if it does not parse.
+    PreparedHandle prepare(const std::string& source);
+    QueryResult execute(const PreparedHandle& handle, const std::vector<Value>& params);
+
     Database& getDatabase() { return *db_; }
-    SecurityManager& getSecurity() { return security_; }
+    SecurityManager& getSecurity() { return *security_; }
+
+    // Stream the print statement and print stage write to (std::cout)
+    void setOutput(std::ostream& out) { out_ = &out; }
+
+    // Format used by the print stage
+    void setOutputFormat(OutputFormat format) { outputFormat_ = format; }
+    OutputFormat getOutputFormat() const { return outputFormat_; }
+
+    // Whether this session records trace spans (SET trace, --trace)
+    bool tracing() const { return tracing_; }
+
+    // Server sessions may not name a trace file: clients must not choose
+    // files the server writes.  The server's own --trace picks it.
+    void setRemote(bool remote) { remote_ = remote; }
 
 private:
     Database* db_;
     Database ownedDb_;
-    SecurityManager security_;
+    SecurityManager* security_;
+    SecurityManager ownedSecurity_;
+    std::string currentUser_;  // logged-in user for this executor's session
+    std::ostream* out_;
 
     // Variable storage for imperative code
     std::unordered_map<std::string, Value> variables_;
     // Function storage
-    std::unordered_map<std::string, std::shared_ptr<FuncDefStmt>> functions_;
+    std::unordered_map<std::string, std::shared_ptr<CompiledFunction>> functions_;
+    uint64_t functionDefinitions_ = 0;
+
+    // Active user-defined function calls.  Each frame owns slotCount
+    // entries of locals_ starting at `base`; a local not yet assigned
+    // (assigned_ is 0) reads the global of the same name.
+    struct CallFrame {
+        const CompiledFunction* function;
+        size_t base;
+    };
+    std::vector<CallFrame> frames_;
+    std::vector<Value> locals_;
+    std::vector<uint8_t> assigned_;
+    // Set by RETURN; blocks stop running statements until the call ends
+    bool returning_ = false;
+    Value returnValue_;
+    // Operand stacks of the running chunks, innermost last
+    std::vector<Value> vmStack_;
+    // Statements registered with PREPARE
+    std::unordered_map<std::string, PreparedHandle> prepared_;
+
+    // Set while EXPLAIN ANALYZE runs a statement: operators append their
+    // actuals, and the one being measured names its access method
+    std::vector<OperatorProfile>* profile_ = nullptr;
+    mutable std::string operatorAccess_;
+
+    OutputFormat outputFormat_ = OutputFormat::PRETTY;
+    bool tracing_ = Tracer::global().traceAllSessions();
+    bool remote_ = false;
+
+    // Concurrency control: each top-level statement takes its locks up
+    // front (released after it, or at the end of a transaction)
+    LockManager::Owner lockOwner_;
+    int depth_ = 0;  // execute() nesting: function bodies, if/while blocks
+    bool inTransaction_ = false;
+    // Tables the open transaction wrote, as they were before its first write
+    std::unordered_map<std::string, std::vector<Row>> snapshots_;
+
+    void collectLocks(const StmtPtr& stmt, LockSet& locks,
+                      std::vector<const FuncDefStmt*>& visited, bool nested) const;
+    void collectLocks(const ExprPtr& expr, LockSet& locks,
+                      std::vector<const FuncDefStmt*>& visited) const;
+    void acquireLocks(const LockSet& locks);
+    void rollbackTransaction();
+
+    QueryResult executeStatement(const StmtPtr& stmt);
+
+    // User-defined functions: slot assignment and bytecode at definition,
+    // and a call in a new frame, taking its arguments by move.
+    // callFunction returns the RETURN value (NULL if none); `last` receives
+    // it as a one-row result, or without a RETURN the result of the last
+    // statement the body ran.
+    std::shared_ptr<CompiledFunction> compileFunction(const FuncDefStmt& stmt) const;
+    Value callFunction(const CompiledFunction& function, Value* args, size_t argCount,
+                       QueryResult* last = nullptr);
+
+    // Run a chunk in the current frame (or on globals outside a function).
+    // Returns the result of the last statement it ran, the failed result
+    // of a statement run through the executor, or after a RETURN an empty
+    // result with returning_ set.  Without `wantResult` a successful run
+    // returns an empty result instead of building the last statement's.
+    QueryResult run(const Chunk& chunk, bool wantResult = true);
 
     // Statement executors
     QueryResult executeCreateTable(const CreateTableStmt& stmt);
@@ -79,6 +231,14 @@ private:
     QueryResult executeShowUsers();
     QueryResult executeShowGrants(const ShowGrantsStmt& stmt);
     QueryResult executeExplain(const ExplainStmt& stmt);
+    QueryResult executeExplainAnalyze(const ExplainStmt& stmt);
+    QueryResult executeAnalyze(const AnalyzeStmt& stmt);
+    QueryResult executeShowStats(const ShowStatsStmt& stmt);
+    QueryResult executePrepare(const PrepareStmt& stmt);
+    QueryResult executeExecute(const ExecuteStmt& stmt);
+    QueryResult executeDeallocate(const DeallocateStmt& stmt);
+    QueryResult executeCopy(const CopyStmt& stmt);
+    QueryResult executeSetOption(const SetOptionStmt& stmt);
 
     // Permission check helper
     void checkPermission(Permission perm, const std::string& tableName) const;
@@ -100,9 +260,22 @@ private:
     Value evaluateStringFunc(const std::string& name,
                             const std::vector<Value>& args) const;
 
-    // Build predicate from WHERE clause
+    // Build predicate from WHERE clause (simplified first)
     std::function<bool(const Row&)> buildPredicate(
-        const ExprPtr& expr, const std::vector<std::string>& colNames) const;
+        const ExprPtr& condition, const std::vector<std::string>& colNames) const;
+
+    // Simplify an expression about to be evaluated against every row with
+    // columns `colNames`: constant subexpressions fold, names that are not
+    // columns become the current value of the variable they name, boolean
+    // logic simplifies (x and true, not not x), NOT is pushed into
+    // comparisons, BETWEEN, IN, LIKE and IS NULL, a one-value IN becomes an
+    // equality and comparisons put a lone literal on the right.  Done per
+    // execution on a copy: the parsed tree is returned as is when nothing
+    // changes and is never modified, since cached and prepared statements
+    // rebind its literals.
+    ExprPtr simplifyExpr(const ExprPtr& expr, const std::vector<std::string>& colNames) const;
+    std::vector<ExprPtr> simplifyExprs(const std::vector<ExprPtr>& exprs,
+                                       const std::vector<std::string>& colNames) const;
 
     // Helper for column resolution
     int resolveColumn(const std::string& name,
@@ -116,6 +289,54 @@ private:
                                    QueryResult& current,
                                    const std::string& originalTable);
 
+    // WHERE and SELECT stages over any row source, so the first stage of a
+    // pipeline can read the table's rows without copying the table first
+    QueryResult filterRows(const ExprPtr& condition, const std::vector<std::string>& colNames,
+                           const std::vector<Row>& rows) const;
+    QueryResult projectRows(const PipelineStage& stage, const std::vector<std::string>& colNames,
+                            const std::vector<Row>& rows) const;
+
+    // How a WHERE on a base table can read the table through an index: one
+    // of its conjuncts is `column == constant`, `column in (constants...)`
+    // or `column like 'abc%'` on an indexed column.  The whole condition
+    // still runs on the rows the index returns.
+    struct IndexAccess {
+        const BTreeIndex* index = nullptr;
+        std::vector<Value> keys;  // point lookups; empty for a LIKE prefix
+        std::string prefix;       // lowercased
+        std::string describe() const;
+    };
+    bool indexAccess(const ExprPtr& condition, const Table& table,
+                     const std::vector<std::string>& colNames, IndexAccess& access) const;
+    // The rows the access selects, in table order
+    std::vector<Row> indexScan(const Table& table, const IndexAccess& access) const;
+
+    // EXPORT: write rows to the stage's file.  streamExport handles
+    // pipelines whose stages before EXPORT all work row by row, passing each
+    // table row through them into the writer without materializing
+    // anything; it returns false when the pipeline needs the general path.
+    QueryResult exportRows(const PipelineStage& stage, const QueryResult& current) const;
+    bool streamExport(const std::string& tableName, const std::vector<PipelineStage>& stages,
+                      QueryResult& result) const;
+
+    // Logical rewrite of a pipeline's stages: WHERE conjuncts are pushed
+    // below ORDERBY, DISTINCT, MAP and JOIN (into the ON condition of inner
+    // joins), adjacent WHEREs merge, redundant SELECTs are dropped or merged
+    // and columns nothing downstream reads are pruned.  `notes` receives a
+    // line per rule applied.
+    std::vector<PipelineStage> rewritePipeline(const PipelineStmt& stmt,
+                                               std::vector<std::string>* notes = nullptr) const;
+
+    // rewritePipeline's result, cached on the statement until the schema or
+    // the set of user-defined functions changes
+    std::shared_ptr<const std::vector<PipelineStage>> pipelinePlan(const PipelineStmt& stmt);
+
+    // Column names entering each stage (schemas[i]) and leaving the last
+    // one; returns how many stages have a known output
+    size_t pipelineSchemas(const std::string& tableName,
+                           const std::vector<PipelineStage>& stages,
+                           std::vector<std::vector<std::string>>& schemas) const;
+
     // Sorting helper
     void sortResult(QueryResult& result,
                     const std::vector<std::pair<ExprPtr, bool>>& orderCols);
@@ -126,9 +347,99 @@ private:
                                   const std::vector<ExprPtr>& selectCols,
                                   const ExprPtr& havingClause);
 
+    // Parallel hash aggregation: workers fold their morsels into thread-local
+    // partial states, then merge them partition by partition.  Returns false
+    // (leaving `out` untouched) when the select list needs the serial path.
+    bool partialAggregate(const QueryResult& input,
+                          const std::vector<ExprPtr>& groupCols,
+                          const std::vector<ExprPtr>& selectCols,
+                          QueryResult& out) const;
+
+    // True if evaluating expr never touches interpreter state (UDF calls,
+    // random()), so worker threads may evaluate it concurrently.
+    bool isParallelSafe(const ExprPtr& expr) const;
+
     // Join helper
     QueryResult performJoin(const Table& leftTable, const Table& rightTable,
                            const ExprPtr& onCondition, const std::string& joinType);
+
+    // Join two row sets (output columns: leftCols then rightCols).  ON
+    // conditions with equality keys run as a radix-partitioned parallel hash
+    // join; everything else falls back to a nested loop.
+    // When `sources` is given it receives, per output row, the indexes of
+    // the left and right rows it was built from (UINT32_MAX for the padded
+    // side of an outer-join row).
+    using JoinSources = std::vector<std::pair<uint32_t, uint32_t>>;
+    QueryResult joinRows(const std::vector<std::string>& leftCols,
+                         const std::vector<Row>& leftRows,
+                         const std::vector<std::string>& rightCols,
+                         const std::vector<Row>& rightRows,
+                         const ExprPtr& onCondition,
+                         const std::string& joinType,
+                         JoinSources* sources = nullptr) const;
+
+    void hashJoin(const std::vector<std::string>& leftCols,
+                  const std::vector<Row>& leftRows,
+                  const std::vector<std::string>& rightCols,
+                  const std::vector<Row>& rightRows,
+                  const std::vector<ExprPtr>& leftKeys,
+                  const std::vector<ExprPtr>& rightKeys,
+                  const std::vector<ExprPtr>& residual,
+                  const std::string& joinType,
+                  QueryResult& result,
+                  JoinSources* sources) const;
+
+    // Inner join probing a B-tree index on the right input's key column
+    void indexJoin(const std::vector<std::string>& leftCols,
+                   const std::vector<Row>& leftRows,
+                   const std::vector<std::string>& rightCols,
+                   const std::vector<Row>& rightRows,
+                   const BTreeIndex& index,
+                   const ExprPtr& leftKey,
+                   const std::vector<ExprPtr>& residual,
+                   QueryResult& result,
+                   JoinSources* sources) const;
+
+    // Join inputs[0] with inputs[1..] in turn (conditions[i - 1] / joinTypes[i - 1]
+    // join inputs[i]; every join is inner or cross).  The optimizer may pick
+    // another order and other join algorithms; output columns and rows still
+    // come out exactly as the written order would produce them.
+    QueryResult joinChain(const std::vector<JoinInput>& inputs,
+                          const std::vector<ExprPtr>& conditions,
+                          const std::vector<std::string>& joinTypes) const;
+
+    // Build the join graph for a chain and choose a plan.  Returns false
+    // when an ON condition cannot be attributed to specific inputs (unknown
+    // or ambiguous columns, non-deterministic calls); the chain then runs in
+    // written order.
+    bool planJoinChain(const std::vector<JoinInput>& inputs,
+                       const std::vector<ExprPtr>& conditions,
+                       const std::vector<std::string>& joinTypes,
+                       JoinChainPlan& out) const;
+
+    // Join inputs for the leading inner/cross joins of a SELECT (the FROM
+    // table plus joins[0, count)), or nothing if the chain is shorter than
+    // one join
+    size_t selectJoinChain(const SelectStmt& stmt, std::vector<JoinInput>& inputs,
+                           std::vector<ExprPtr>& conditions,
+                           std::vector<std::string>& joinTypes) const;
+
+    // Estimated fraction of rows an ON conjunct keeps, from table statistics
+    // when the inputs have been analyzed
+    double estimateSelectivity(const ExprPtr& expr, const std::vector<JoinInput>& inputs) const;
+    double estimateDistinct(const JoinInput& input, int column) const;
+
+    // Drop repeated rows, keeping first occurrences (DISTINCT); columns that
+    // are dictionary-encoded compare by code
+    static void distinctRows(std::vector<Row>& rows);
+
+    // Flatten a tree of AND operators into its conjuncts
+    static void splitConjuncts(const ExprPtr& expr, std::vector<ExprPtr>& out);
+
+    // Which join input an expression reads: 1 = left only, 2 = right only,
+    // 0 = neither, both, or not safe to evaluate on one side
+    int joinKeySide(const ExprPtr& expr, const std::vector<std::string>& joinedCols,
+                    size_t leftCount) const;
 };
 
 } // namespace epee
@@ -0,0 +1,61 @@
+/*
+ File: likeMatcher.hpp
+ Project: Épée Database Query Language
+ Description: LIKE patterns compiled once into a matcher with literal fast
+              paths and a backtracking-free general case
+*/
+
+#ifndef EPEE_LIKE_MATCHER_H
+#define EPEE_LIKE_MATCHER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace epee {
+
+// A compiled LIKE pattern: `%` matches any run of characters, `_` exactly
+// one, and letters match case-insensitively.  The pattern is split at its
+// `%` wildcards into segments of fixed length; the first segment is
+// anchored at the start unless the pattern begins with `%`, the last at
+// the end unless it ends with `%`, and the ones in between are found
+// leftmost-first.  Because every segment has a fixed length, taking the
+// earliest match of each one never loses a match a later position would
+// find, so no backtracking is needed and `%a%a%a%b` costs one pass per
+// segment instead of exponential time.
+class LikeMatcher {
+public:
+    enum class Kind { EXACT, PREFIX, SUFFIX, CONTAINS, GENERAL, ANY };
+
+    explicit LikeMatcher(const std::string& pattern);
+
+    bool matches(std::string_view text) const;
+
+    Kind kind() const { return kind_; }
+    // The lowercased characters every match starts with (up to the first
+    // wildcard); empty when the pattern begins with `%` or `_`
+    const std::string& literalPrefix() const { return prefix_; }
+
+private:
+    struct Segment {
+        std::string text;       // lowercased; `_` is a wildcard
+        bool wildcards = false; // contains `_`
+        size_t firstLiteral = 0;  // offset of the first non-`_` character
+    };
+
+    Kind kind_ = Kind::EXACT;
+    std::vector<Segment> segments_;
+    bool anchoredStart_ = true;
+    bool anchoredEnd_ = true;
+    bool folds_ = false;    // the pattern has letters, so the text is lowercased first
+    size_t minLength_ = 0;  // total length of the segments
+    std::string prefix_;
+
+    static bool matchAt(std::string_view text, size_t pos, const Segment& segment);
+    // Leftmost position >= pos where `segment` matches, or npos
+    static size_t find(std::string_view text, size_t pos, const Segment& segment);
+};
+
+} // namespace epee
+
+#endif /* EPEE_LIKE_MATCHER_H */
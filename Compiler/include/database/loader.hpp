@@ -0,0 +1,37 @@
+/*
+ File: loader.hpp
+ Project: Épée Database Query Language
+ Description: Bulk loading of CSV/TSV files into tables (COPY)
+*/
+
+#ifndef EPEE_LOADER_H
+#define EPEE_LOADER_H
+
+#include <cstddef>
+#include <string>
+#include "table.hpp"
+
+namespace epee {
+
+struct CopyOptions {
+    char delimiter = '\0';  // '\0': tab for .tsv/.tab files, otherwise comma
+    bool header = false;    // skip the first line
+};
+
+// File format: one record per line, fields split on the delimiter.  A field
+// in double quotes may contain the delimiter, newlines and "" for a quote;
+// an empty unquoted field is NULL.
+class BulkLoader {
+public:
+    // Append every record of the delimited file at `path` to `table` and
+    // return how many were loaded.  The file is memory-mapped and parsed in
+    // parallel chunks straight into typed values; NOT NULL and unique
+    // constraints are checked for the whole batch and indexes are rebuilt
+    // once.  Any error (naming the file line) leaves the table unchanged.
+    // Callers refresh the table's statistics afterwards.
+    static size_t load(Table& table, const std::string& path, const CopyOptions& options = {});
+};
+
+} // namespace epee
+
+#endif /* EPEE_LOADER_H */
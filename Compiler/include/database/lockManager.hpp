@@ -0,0 +1,108 @@
+/*
+ File: lockManager.hpp
+ Project: Épée Database Query Language
+ Description: Hierarchical reader-writer locks over the database and its
+              tables, with intention modes and deadlock detection
+*/
+
+#ifndef EPEE_LOCK_MANAGER_H
+#define EPEE_LOCK_MANAGER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace epee {
+
+// IS and IX are taken on the database before S or X on one of its tables;
+// S and X on the database itself cover every table (catalog changes, saving
+// the whole database).  SIX is what S plus IX combine to.
+enum class LockMode { IS, IX, S, SIX, X };
+
+const char* lockModeName(LockMode mode);
+bool lockModesCompatible(LockMode a, LockMode b);
+// The weakest mode granting both
+LockMode combineLockModes(LockMode a, LockMode b);
+
+// Thrown to the request that would complete a cycle of waits.  The locks
+// its owner already holds are kept; the caller decides what to release.
+class DeadlockError : public std::runtime_error {
+public:
+    explicit DeadlockError(const std::string& what) : std::runtime_error(what) {}
+};
+
+// What one statement needs: a mode on the database and one per table,
+// ordered by name so that owners acquiring whole sets never deadlock
+struct LockSet {
+    bool database = false;  // whether anything is needed at all
+    LockMode databaseMode = LockMode::IS;
+    std::map<std::string, LockMode> tables;
+
+    void lockDatabase(LockMode mode);
+    void lockTable(const std::string& name, LockMode mode);
+};
+
+// Owners are sessions (executors).  A lock is granted when it is
+// compatible with every other owner's lock on the resource and with every
+// request queued before it, so a stream of readers cannot starve a writer;
+// an owner converting a lock it already holds skips the queue.  Locks are
+// held until releaseAll.
+class LockManager {
+public:
+    using Owner = uint64_t;
+
+    LockManager() = default;
+    LockManager(const LockManager&) = delete;
+    LockManager& operator=(const LockManager&) = delete;
+
+    Owner newOwner();
+
+    // Block until `owner` holds `mode` (or a stronger mode) on `table`, the
+    // empty name meaning the database.  Throws DeadlockError instead of
+    // waiting when the wait could never end.
+    void acquire(Owner owner, const std::string& table, LockMode mode);
+    // The database lock, then each table lock in name order
+    void acquire(Owner owner, const LockSet& locks);
+
+    void releaseAll(Owner owner);
+
+    bool holds(Owner owner, const std::string& table, LockMode mode) const;
+    bool holdsAny(Owner owner) const;
+
+    uint64_t waits() const;
+    uint64_t deadlocks() const;
+
+private:
+    struct Waiter {
+        Owner owner;
+        LockMode mode;
+    };
+
+    struct Resource {
+        std::unordered_map<Owner, LockMode> holders;
+        std::deque<Waiter> queue;
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::unordered_map<std::string, Resource> resources_;
+    std::unordered_map<Owner, std::vector<std::string>> held_;
+    std::unordered_map<Owner, std::string> waitingFor_;
+    Owner nextOwner_ = 1;
+    uint64_t waits_ = 0;
+    uint64_t deadlocks_ = 0;
+
+    bool grantable(const Resource& res, Owner owner, LockMode mode) const;
+    void blockers(const Resource& res, Owner owner, LockMode mode, std::vector<Owner>& out) const;
+    bool waitsOn(Owner from, Owner target, std::vector<Owner>& visited) const;
+};
+
+} // namespace epee
+
+#endif /* EPEE_LOCK_MANAGER_H */
@@ -0,0 +1,70 @@
+/*
+ File: memory.hpp
+ Project: Épée Database Query Language
+ Description: Allocation accounting, used by EXPLAIN ANALYZE to report peak
+              memory per operator
+*/
+
+#ifndef EPEE_MEMORY_H
+#define EPEE_MEMORY_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace epee {
+
+// Net bytes obtained through the global operator new / delete by the
+// threads counting into it (frees of older blocks can make it negative).
+// Everything counted is also counted into `parent`, so an operator's
+// counters nest inside its statement's.
+class AllocationCounters {
+public:
+    explicit AllocationCounters(AllocationCounters* parent = nullptr) : parent_(parent) {}
+
+    AllocationCounters(const AllocationCounters&) = delete;
+    AllocationCounters& operator=(const AllocationCounters&) = delete;
+
+    int64_t current() const { return current_.load(std::memory_order_relaxed); }
+
+    // Highest current() so far
+    int64_t peak() const { return peak_.load(std::memory_order_relaxed); }
+
+    void allocated(int64_t bytes);
+    void freed(int64_t bytes);
+
+private:
+    AllocationCounters* parent_;
+    std::atomic<int64_t> current_{0};
+    std::atomic<int64_t> peak_{0};
+};
+
+// Allocations are counted per thread: each thread counts into the
+// AllocationCounters of the innermost Scope it runs in, or nowhere.  Pool
+// workers run a parallel operator's morsels in the caller's scope, so one
+// statement's counters see its parallel work and nothing of other sessions.
+// Outside a scope each allocation pays one thread-local load.
+class AllocationTracker {
+public:
+    // False on platforms where block sizes cannot be queried; the counters
+    // then stay at zero
+    static bool supported();
+
+    // The calling thread's counters, or nullptr
+    static AllocationCounters* active();
+
+    class Scope {
+    public:
+        explicit Scope(AllocationCounters* counters);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        AllocationCounters* previous_;
+    };
+};
+
+} // namespace epee
+
+#endif /* EPEE_MEMORY_H */
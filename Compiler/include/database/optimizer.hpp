@@ -0,0 +1,80 @@
+/*
+ File: optimizer.hpp
+ Project: Épée Database Query Language
+ Description: Cost-based join ordering and join algorithm selection
+*/
+
+#ifndef EPEE_OPTIMIZER_H
+#define EPEE_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace epee {
+
+enum class JoinMethod { NESTED_LOOP, HASH, INDEX_NESTED_LOOP };
+
+// A multi-way inner join reduced to what the optimizer needs: relation
+// cardinalities and the predicates connecting them
+struct JoinGraph {
+    struct Predicate {
+        uint64_t relations = 0;    // bitmask of the relations the predicate reads
+        double selectivity = 1.0;  // estimated fraction of candidate pairs kept
+
+        // Set for `a == b` with each side reading a single relation
+        int left = -1, right = -1;
+        bool leftIndexed = false, rightIndexed = false;  // side is an indexed column
+    };
+
+    std::vector<double> rows;  // estimated rows per relation
+    std::vector<Predicate> predicates;
+};
+
+// Left-deep plan: steps[0] is the starting relation, every later step joins
+// the next relation onto the result so far
+struct JoinStep {
+    size_t relation = 0;
+    JoinMethod method = JoinMethod::NESTED_LOOP;
+    int indexPredicate = -1;  // predicate probed by INDEX_NESTED_LOOP
+    double rows = 0.0;        // estimated rows after this step
+};
+
+struct JoinPlan {
+    std::vector<JoinStep> steps;
+    double cost = 0.0;
+
+    // True when relations are joined in the order they were written
+    bool inWrittenOrder() const {
+        for (size_t i = 0; i < steps.size(); i++)
+            if (steps[i].relation != i) return false;
+        return true;
+    }
+};
+
+class JoinOptimizer {
+public:
+    // Relations up to which every left-deep order is considered (dynamic
+    // programming over subsets); larger joins are ordered greedily
+    static constexpr size_t kExhaustiveLimit = 10;
+    static constexpr size_t kMaxRelations = 64;
+
+    // Cheapest left-deep plan.  Cross products are only used when no
+    // predicate connects the remaining relations, and the written order is
+    // kept unless reordering saves more than restoring its row order costs.
+    static JoinPlan plan(const JoinGraph& graph);
+
+    static std::string methodName(JoinMethod method);
+
+private:
+    static JoinStep extend(const JoinGraph& graph, uint64_t placed, double leftRows,
+                           size_t relation, double& cost);
+    static JoinPlan writtenOrder(const JoinGraph& graph);
+    static JoinPlan exhaustive(const JoinGraph& graph);
+    static JoinPlan greedy(const JoinGraph& graph);
+};
+
+} // namespace epee
+
+#endif /* EPEE_OPTIMIZER_H */
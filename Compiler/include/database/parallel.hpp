@@ -0,0 +1,44 @@
+/*
+ File: parallel.hpp
+ Project: Épée Database Query Language
+ Description: Shared worker pool and morsel-driven parallel loop used by the
+              parallel query operators
+*/
+
+#ifndef EPEE_PARALLEL_H
+#define EPEE_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+namespace epee {
+
+// Default number of rows handed to a worker at a time.  Small enough that
+// workers stay balanced, large enough that dispatch overhead is negligible.
+constexpr size_t kDefaultMorselSize = 16384;
+
+// Number of threads parallel operators may use (including the caller).
+// Defaults to std::thread::hardware_concurrency(); the EPEE_THREADS
+// environment variable overrides it (EPEE_THREADS=1 disables parallelism).
+size_t workerCount();
+
+// Number of workers worth using for `items` units of work split into morsels
+// of `morselSize`: never more than workerCount(), never less than 1.
+size_t workersFor(size_t items, size_t morselSize = kDefaultMorselSize);
+
+// Split [0, items) into morsels of at most `morselSize` and run
+// fn(worker, begin, end) for each of them on up to `workers` threads.
+// Morsels are claimed dynamically, so a worker may process several.  `worker`
+// is a dense id in [0, workers) that callers use to index thread-local state.
+// The first exception thrown by any morsel is rethrown on the calling thread
+// after all workers have stopped.
+void parallelFor(size_t items, size_t morselSize, size_t workers,
+                 const std::function<void(size_t worker, size_t begin, size_t end)>& fn);
+
+// Run fn(task) for every task in [0, tasks) on up to `workers` threads.
+void parallelTasks(size_t tasks, size_t workers,
+                   const std::function<void(size_t task)>& fn);
+
+} // namespace epee
+
+#endif /* EPEE_PARALLEL_H */
@@ -0,0 +1,61 @@
+/*
+ File: perfCounters.hpp
+ Project: Épée Database Query Language
+ Description: Hardware performance counters read through perf_event_open
+*/
+
+#ifndef EPEE_PERF_COUNTERS_H
+#define EPEE_PERF_COUNTERS_H
+
+#include <cstdint>
+
+namespace epee {
+
+// Counter totals.  `valid` is false when no counters could be opened.
+struct PerfSample {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cacheMisses = 0;   // last-level cache misses
+    uint64_t branchMisses = 0;
+    bool valid = false;
+
+    PerfSample operator-(const PerfSample& earlier) const {
+        PerfSample d;
+        d.cycles = cycles - earlier.cycles;
+        d.instructions = instructions - earlier.instructions;
+        d.cacheMisses = cacheMisses - earlier.cacheMisses;
+        d.branchMisses = branchMisses - earlier.branchMisses;
+        d.valid = valid && earlier.valid;
+        return d;
+    }
+
+    double ipc() const { return cycles ? static_cast<double>(instructions) / cycles : 0.0; }
+};
+
+// Cycles, instructions, LLC misses and branch misses for the thread that
+// constructed the object, user space only, counted from construction on.
+// The events are opened as one group so they are scheduled together; if
+// the kernel multiplexes them, read() scales the totals by the fraction of
+// time they ran.  Work done on other threads (the parallel worker pool) is
+// not included.  Where perf_event_open is unavailable (not Linux, no PMU,
+// or perf_event_paranoid forbids it) available() is false and read()
+// returns an invalid sample.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return fds_[0] >= 0; }
+    PerfSample read() const;
+
+private:
+    static constexpr int kEvents = 4;
+    int fds_[kEvents];
+};
+
+} // namespace epee
+
+#endif /* EPEE_PERF_COUNTERS_H */
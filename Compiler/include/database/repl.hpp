@@ -19,6 +19,7 @@
 #include "storage.hpp"
 #include "wal.hpp"
 #include "logger.hpp"
+#include "statementCache.hpp"
 
 namespace epee {
 
@@ -37,6 +38,7 @@ private:
     Database db_;
     Executor executor_;
     DbLexer lexer_;
+    StatementCache cache_;
     std::unique_ptr<WriteAheadLog> wal_;
     std::unique_ptr<Logger> logger_;
     std::string dbPath_;
@@ -0,0 +1,60 @@
+/*
+ File: resultWriter.hpp
+ Project: Épée Database Query Language
+ Description: Result sinks that write rows as they are produced: pretty table,
+              CSV/TSV, JSON lines and a length-prefixed binary format
+*/
+
+#ifndef EPEE_RESULT_WRITER_H
+#define EPEE_RESULT_WRITER_H
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "table.hpp"
+
+namespace epee {
+
+enum class OutputFormat { PRETTY, CSV, TSV, JSONL, BINARY };
+
+// Accepts pretty (or table), csv, tsv, jsonl (or json) and binary (or bin)
+bool parseOutputFormat(const std::string& name, OutputFormat& format);
+// Format implied by a file's extension, CSV when it names none
+OutputFormat formatForPath(const std::string& path);
+const char* formatName(OutputFormat format);
+
+// A sink for one result: begin() once, write() per row, end() once.  Only
+// the pretty table holds rows back (its column widths depend on all of
+// them); the other formats write each row straight through.
+class ResultWriter {
+public:
+    virtual ~ResultWriter() = default;
+
+    virtual void begin(const std::vector<std::string>& columns) = 0;
+    virtual void write(const Row& row) = 0;
+    virtual void end() = 0;
+
+    size_t rowsWritten() const { return rows_; }
+
+protected:
+    size_t rows_ = 0;
+};
+
+// CSV/TSV output follows the COPY input rules, so exported files load back
+// unchanged: NULL is an empty field and an empty string is written "".
+// Binary output, in host byte order:
+//   "EPEB" u32 version=1  u32 columns  { u32 length, name bytes } per column
+//   per row: u32 payload length, then per cell a type byte (0 null, 1 int,
+//            2 double, 3 string, 4 bool) and its value (i32, f64,
+//            u32 length + bytes, u8)
+//   u32 0 after the last row
+std::unique_ptr<ResultWriter> makeResultWriter(OutputFormat format, std::ostream& out);
+
+// Write a complete result.  The pretty format matches toPrettyTable,
+// including the trailing message; the others write only the rows.
+void writeResult(const QueryResult& result, OutputFormat format, std::ostream& out);
+
+} // namespace epee
+
+#endif /* EPEE_RESULT_WRITER_H */
@@ -0,0 +1,130 @@
+/*
+ File: server.hpp
+ Project: Épée Database Query Language
+ Description: Server mode: concurrent client sessions over a Unix domain socket
+              or localhost TCP port sharing one database, and a matching client
+*/
+
+#ifndef EPEE_SERVER_H
+#define EPEE_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "executor.hpp"
+#include "security.hpp"
+#include "table.hpp"
+
+namespace epee {
+
+// Wire format, both directions: a 4-byte big-endian payload length, then the
+// payload.  A request is query text holding any number of statements.  A
+// response is a status byte ('O' when every statement succeeded, 'E'
+// otherwise) followed by the output the REPL would have printed for it.
+constexpr size_t kMaxFrameBytes = 64 * 1024 * 1024;
+
+struct ServerOptions {
+    std::string address;  // a port number listens on 127.0.0.1, anything else is a socket path
+    size_t workers = 0;   // threads started up front, 0 for one per core
+    // A request waiting for locks holds its worker, so while every worker is
+    // busy the pool grows, up to this many threads
+    size_t maxWorkers = 256;
+};
+
+// Each connection is a session with its own Executor (variables, functions,
+// prepared statements, login) and statement cache over the shared tables and
+// user accounts.  An event loop (epoll, or poll where epoll is unavailable)
+// does all socket I/O and hands complete requests to a worker pool; a
+// session runs one request at a time, in the order they arrived.  Sessions
+// run concurrently under the database's table locks (see lockManager.hpp).
+class Server {
+public:
+    explicit Server(const ServerOptions& options);
+    ~Server();
+
+    // Listen and serve until stop().  Throws std::runtime_error when the
+    // address cannot be bound.
+    void run();
+
+    // Safe to call from any thread and from signal handlers
+    void stop();
+
+    Database& getDatabase() { return db_; }
+
+private:
+    struct Session;
+
+    struct Connection {
+        int fd = -1;
+        std::string input;     // received bytes not yet consumed as requests
+        std::string output;    // response bytes not yet sent
+        size_t written = 0;    // of output
+        bool busy = false;     // a worker is running this session's request
+        bool closed = false;   // the peer left while a request was running
+        bool wantWrite = false;
+        std::unique_ptr<Session> session;
+
+        Connection();
+        ~Connection();
+    };
+
+    struct Request {
+        Connection* connection;
+        std::string source;
+    };
+
+    ServerOptions options_;
+    Database db_;
+    SecurityManager security_;
+
+    int listenFd_ = -1;
+    int pollFd_ = -1;
+    int wakeFds_[2] = {-1, -1};  // workers and stop() wake the event loop
+    std::atomic<bool> stopping_{false};
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+
+    std::vector<std::thread> workers_;
+    std::mutex queueMutex_;
+    std::condition_variable queueReady_;
+    std::deque<Request> queue_;
+    size_t idleWorkers_ = 0;
+    std::mutex doneMutex_;
+    std::vector<std::pair<Connection*, std::string>> done_;  // finished responses
+
+    void acceptConnections();
+    void readConnection(Connection& conn);
+    void flushConnection(Connection& conn);
+    void dispatch(Connection& conn);
+    void collectResponses();
+    void closeConnection(int fd);
+    void workerLoop();
+    void shutdown();
+};
+
+// Blocking client for a server started with the same address
+class Client {
+public:
+    // Connects, retrying for up to `timeoutMs` while the server starts
+    explicit Client(const std::string& address, int timeoutMs = 2000);
+    ~Client();
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    // Send one request and wait for its output; returns false when any
+    // statement failed.  Throws std::runtime_error if the connection fails.
+    bool query(const std::string& source, std::string& output);
+
+private:
+    int fd_ = -1;
+};
+
+} // namespace epee
+
+#endif /* EPEE_SERVER_H */
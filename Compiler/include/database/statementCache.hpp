@@ -0,0 +1,75 @@
+/*
+ File: statementCache.hpp
+ Project: Épée Database Query Language
+ Description: LRU cache of parsed statements keyed by normalized query text,
+              with literals lifted out so one entry serves every value
+*/
+
+#ifndef EPEE_STATEMENT_CACHE_H
+#define EPEE_STATEMENT_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "dbLexer.hpp"
+#include "dbParser.hpp"
+
+namespace epee {
+
+class StatementCache {
+public:
+    static constexpr size_t kDefaultCapacity = 1024;
+
+    explicit StatementCache(size_t capacity = kDefaultCapacity) : capacity_(capacity) {}
+
+    // Reduce source to its cache key: whitespace and comments collapse to a
+    // single space and every number or string literal becomes a typed
+    // placeholder (?i, ?d, ?s) whose value is appended to `literals`.
+    // Returns false for text that must not be cached.
+    static bool normalize(const std::string& source, std::string& key, std::vector<Value>& literals);
+
+    // Statements cached under `key`, with their literals rebound to
+    // `literals`, or nullptr on a miss.  Entries made before the last
+    // schema change are dropped.
+    const std::vector<StmtPtr>* lookup(const std::string& key, const std::vector<Value>& literals,
+                                       uint64_t schemaVersion);
+
+    // Cache freshly parsed statements.  Only plain queries and DML are kept,
+    // and only when every literal token can be matched to what the parser
+    // made of it.
+    void insert(const std::string& key, const std::vector<Value>& literals,
+                const std::vector<StmtPtr>& statements, const std::vector<DbToken>& tokens,
+                const DbParser& parser, uint64_t schemaVersion);
+
+    void clear();
+    size_t size() const { return entries_.size(); }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    struct Entry {
+        std::string key;
+        std::vector<StmtPtr> statements;
+        // slots[i] is the node built from literal i; literals the parser
+        // consumed directly (LIMIT counts, LIKE patterns) have no slot and
+        // must match `literals[i]` exactly
+        std::vector<std::shared_ptr<LiteralExpr>> slots;
+        std::vector<Value> literals;
+        uint64_t schemaVersion = 0;
+    };
+
+    size_t capacity_;
+    std::list<Entry> entries_;  // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+
+    void erase(std::list<Entry>::iterator it);
+};
+
+} // namespace epee
+
+#endif /* EPEE_STATEMENT_CACHE_H */
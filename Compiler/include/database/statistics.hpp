@@ -0,0 +1,83 @@
+/*
+ File: statistics.hpp
+ Project: Épée Database Query Language
+ Description: Per-column table statistics (ANALYZE) and selectivity estimates
+              for the planner
+*/
+
+#ifndef EPEE_STATISTICS_H
+#define EPEE_STATISTICS_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "value.hpp"
+
+namespace epee {
+
+class Table;
+
+struct ColumnStats {
+    uint64_t nullCount = 0;
+    double distinctCount = 0.0;      // estimated distinct non-null values
+    Value minValue;                  // NULL if the column has no non-null values
+    Value maxValue;
+    std::vector<Value> histogram;    // equi-depth bucket bounds, ascending
+    std::vector<std::pair<Value, double>> mostCommon;  // value, fraction of rows
+    std::vector<uint8_t> sketch;     // HyperLogLog registers behind distinctCount
+};
+
+struct TableStats {
+    uint64_t rowCount = 0;
+    uint64_t sampledRows = 0;
+    std::vector<ColumnStats> columns;  // in table column order
+
+    // Table::modificationCount() / insertCount() when the statistics were
+    // last brought up to date, and modificationCount() at the last full
+    // ANALYZE.  Used to fold in appended rows and to decide when to
+    // re-analyze.
+    uint64_t modificationsSeen = 0;
+    uint64_t insertsSeen = 0;
+    uint64_t modificationsAtAnalyze = 0;
+
+    double nullFraction(size_t col) const {
+        return rowCount == 0 ? 0.0 : static_cast<double>(columns[col].nullCount) / rowCount;
+    }
+};
+
+class Statistics {
+public:
+    static constexpr size_t kSampleRows = 30000;       // rows sampled for histograms/MCVs
+    static constexpr size_t kHistogramBuckets = 10;
+    static constexpr size_t kMostCommonValues = 5;
+    static constexpr size_t kSketchBits = 12;          // 4096 HyperLogLog registers
+
+    // Re-analyze once this many rows (plus kAutoAnalyzeFraction of the table)
+    // changed since the last full ANALYZE
+    static constexpr uint64_t kAutoAnalyzeBase = 50;
+    static constexpr double kAutoAnalyzeFraction = 0.1;
+
+    // Full pass: exact null counts and min/max, distinct estimate over every
+    // row, histogram and most-common values from a systematic sample
+    static TableStats analyze(const Table& table);
+
+    // Bring statistics up to date after DML: appended rows are folded in
+    // incrementally (counts, min/max, distinct sketch); a full ANALYZE runs
+    // once enough of the table changed
+    static void refresh(TableStats& stats, const Table& table);
+
+    // Estimated fraction of rows with column == v
+    static double equalitySelectivity(const TableStats& stats, size_t col, const Value& v);
+
+    // Estimated fraction of rows with column < v (or <= v when inclusive)
+    static double lessThanSelectivity(const TableStats& stats, size_t col,
+                                      const Value& v, bool inclusive);
+
+    // Total order used for min/max and histograms: NULL < numbers < strings < bools
+    static bool less(const Value& a, const Value& b);
+};
+
+} // namespace epee
+
+#endif /* EPEE_STATISTICS_H */
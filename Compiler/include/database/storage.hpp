@@ -22,13 +22,16 @@ public:
 
 private:
     static constexpr const char* MAGIC = "EPED";  // Épée PErsistence Data
-    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t VERSION = 3;       // v2 adds column dictionaries, v3 statistics
+    static constexpr uint32_t MIN_VERSION = 1;   // oldest version still readable
     static constexpr uint32_t MAX_STRING_LENGTH = 10 * 1024 * 1024;  // 10MB
 
     static void writeString(std::ofstream& out, const std::string& s);
     static std::string readString(std::ifstream& in);
     static void writeValue(std::ofstream& out, const Value& v);
-    static Value readValue(std::ifstream& in);
+    static Value readValue(std::ifstream& in, const DictionaryRef& dict = DictionaryRef());
+    static void writeStats(std::ofstream& out, const TableStats& stats, const Table& table);
+    static TableStats readStats(std::ifstream& in, const Table& table);
 
     static bool validatePath(const std::string& filepath);
 };
@@ -17,8 +17,12 @@
 #include <numeric>
 #include <functional>
 #include <set>
+#include <unordered_set>
+#include <atomic>
 #include "value.hpp"
+#include "lockManager.hpp"
 #include "btree.hpp"
+#include "statistics.hpp"
 
 namespace epee {
 
@@ -28,6 +32,7 @@ struct Column {
     bool nullable = true;
     bool unique = false;
     bool primaryKey = false;
+    bool dictionary = false;  // string cells stored as codes into a per-column dictionary
     Value defaultValue;
 
     Column() = default;
@@ -48,74 +53,19 @@ struct QueryResult {
     QueryResult(const std::string& msg, bool ok = true)
         : message(msg), success(ok) {}
 
-    std::string toPrettyTable() const {
-        if (rows.empty() && columnNames.empty()) {
-            return message.empty() ? "(empty result)" : message;
-        }
-        if (columnNames.empty()) return message;
-
-        // Calculate column widths
-        std::vector<size_t> widths(columnNames.size());
-        for (size_t i = 0; i < columnNames.size(); i++)
-            widths[i] = columnNames[i].size();
-
-        for (const auto& row : rows) {
-            for (size_t i = 0; i < row.size() && i < widths.size(); i++) {
-                size_t len = row[i].asString().size();
-                if (len > widths[i]) widths[i] = len;
-            }
-        }
-
-        // Build the table
-        std::ostringstream oss;
-        auto printSeparator = [&]() {
-            oss << "+";
-            for (size_t w : widths)
-                oss << std::string(w + 2, '-') << "+";
-            oss << "\n";
-        };
-
-        // Header
-        printSeparator();
-        oss << "|";
-        for (size_t i = 0; i < columnNames.size(); i++)
-            oss << " " << std::left << std::setw(static_cast<int>(widths[i]))
-                << columnNames[i] << " |";
-        oss << "\n";
-        printSeparator();
-
-        // Data rows
-        for (const auto& row : rows) {
-            oss << "|";
-            for (size_t i = 0; i < columnNames.size(); i++) {
-                std::string val = (i < row.size()) ? row[i].asString() : "NULL";
-                bool isNum = (i < row.size()) && row[i].isNumeric();
-                if (isNum)
-                    oss << " " << std::right << std::setw(static_cast<int>(widths[i]))
-                        << val << " |";
-                else
-                    oss << " " << std::left << std::setw(static_cast<int>(widths[i]))
-                        << val << " |";
-            }
-            oss << "\n";
-        }
-        printSeparator();
-        oss << rows.size() << " row(s)\n";
-
-        if (!message.empty())
-            oss << message << "\n";
-
-        return oss.str();
-    }
+    // Boxed text table with a row count, then the message if any
+    std::string toPrettyTable() const;
 };
 
 class Table {
 public:
     Table() = default;
     Table(const std::string& name, const std::vector<Column>& cols)
-        : name_(name), columns_(cols) {
-        for (size_t i = 0; i < cols.size(); i++)
+        : name_(name), columns_(cols), dictionaries_(cols.size()) {
+        for (size_t i = 0; i < cols.size(); i++) {
             columnIndex_[cols[i].name] = i;
+            if (cols[i].dictionary) dictionaries_[i] = DictionaryRef::create();
+        }
     }
 
     const std::string& getName() const { return name_; }
@@ -150,40 +100,96 @@ public:
     }
 
     void insertRow(const Row& row) {
-        if (row.size() != columns_.size())
-            throw std::runtime_error("Row size (" + std::to_string(row.size()) +
-                ") doesn't match column count (" + std::to_string(columns_.size()) + ")");
-
-        // Type validation
-        for (size_t i = 0; i < row.size(); i++) {
-            if (row[i].isNull()) {
-                if (!columns_[i].nullable)
-                    throw std::runtime_error("Column '" + columns_[i].name + "' cannot be null");
-                continue;
+        std::vector<Row> batch{row};
+        insertRows(std::move(batch));
+    }
+
+    // Insert a batch of rows: every row is validated and checked against the
+    // unique columns and unique indexes before any is stored, so a failing
+    // batch leaves the table unchanged.  Index entries are added in key order.
+    void insertRows(std::vector<Row>&& rows) {
+        if (rows.empty()) return;
+
+        // Type and NULL validation
+        for (const auto& row : rows) {
+            if (row.size() != columns_.size())
+                throw std::runtime_error("Row size (" + std::to_string(row.size()) +
+                    ") doesn't match column count (" + std::to_string(columns_.size()) + ")");
+            for (size_t i = 0; i < row.size(); i++) {
+                if (row[i].isNull()) {
+                    if (!columns_[i].nullable)
+                        throw std::runtime_error("Column '" + columns_[i].name + "' cannot be null");
+                    continue;
+                }
+                validateType(row[i], columns_[i]);
             }
-            validateType(row[i], columns_[i]);
         }
 
-        // Unique constraint checking
+        // Unique constraint checking against the existing keys and the
+        // rest of the batch
+        buildUniqueKeys();
+        std::vector<ValueSet> batchKeys(columns_.size());
         for (size_t i = 0; i < columns_.size(); i++) {
-            if (columns_[i].unique || columns_[i].primaryKey) {
-                for (const auto& existingRow : rows_) {
-                    if (existingRow[i] == row[i])
-                        throw std::runtime_error("Duplicate value for unique column '" +
-                            columns_[i].name + "'");
-                }
+            if (!columns_[i].unique && !columns_[i].primaryKey) continue;
+            for (const auto& row : rows) {
+                if (uniqueKeys_[i].count(row[i]) || !batchKeys[i].insert(row[i]).second)
+                    throw std::runtime_error("Duplicate value for unique column '" +
+                        columns_[i].name + "'");
+            }
+        }
+        for (const auto& [name, idx] : indexes_) {
+            int ci = idx.getColumnIndex();
+            if (!idx.isUnique() || ci < 0 || ci >= static_cast<int>(columns_.size())) continue;
+            ValueSet seen;
+            for (const auto& row : rows) {
+                const Value& key = row[static_cast<size_t>(ci)];
+                if (key.isNull()) continue;
+                if (idx.contains(key) || !seen.insert(key).second)
+                    throw std::runtime_error("Duplicate key in unique index '" + name +
+                        "' for value " + key.asString());
             }
         }
 
-        rows_.push_back(row);
+        const size_t first = rows_.size();
+        if (rows_.capacity() < first + rows.size())
+            rows_.reserve(std::max(first + rows.size(), rows_.capacity() * 2));
+        for (auto& row : rows) {
+            rows_.push_back(std::move(row));
+            compactStrings(rows_.back());
+        }
+        for (size_t i = 0; i < columns_.size(); i++) {
+            if (!columns_[i].unique && !columns_[i].primaryKey) continue;
+            for (size_t r = first; r < rows_.size(); r++) uniqueKeys_[i].insert(rows_[r][i]);
+        }
+        modifications_ += rows.size();
+        inserts_ += rows.size();
+        if (rows_.size() >= nextDictionaryCheck_) chooseDictionaryColumns();
 
         // Maintain indexes
-        size_t rowIdx = rows_.size() - 1;
         for (auto& [name, idx] : indexes_) {
             int ci = idx.getColumnIndex();
-            if (ci >= 0 && ci < static_cast<int>(row.size()))
-                idx.insert(row[static_cast<size_t>(ci)], rowIdx);
+            if (ci < 0 || ci >= static_cast<int>(columns_.size())) continue;
+            std::vector<std::pair<Value, size_t>> entries;
+            entries.reserve(rows_.size() - first);
+            for (size_t r = first; r < rows_.size(); r++)
+                entries.emplace_back(rows_[r][static_cast<size_t>(ci)], r);
+            idx.insertBatch(std::move(entries));
+        }
+    }
+
+    // Bulk append for loaders that have already checked types, NULLs and
+    // unique constraints for the batch; indexes are rebuilt once at the end
+    void appendRows(std::vector<Row>&& rows) {
+        rows_.reserve(rows_.size() + rows.size());
+        for (auto& row : rows) {
+            rows_.push_back(std::move(row));
+            compactStrings(rows_.back());
         }
+        modifications_ += rows.size();
+        inserts_ += rows.size();
+        if (rows_.size() >= nextDictionaryCheck_) chooseDictionaryColumns();
+        if (!rows.empty()) rebuildAllIndexes();
+        dropUniqueKeys();
     }
 
     int deleteRows(const std::function<bool(const Row&)>& predicate) {
@@ -197,23 +203,36 @@ public:
                 ++it;
             }
         }
-        if (count > 0) rebuildAllIndexes();
+        if (count > 0) {
+            modifications_ += static_cast<uint64_t>(count);
+            strings_.prune();
+            rebuildAllIndexes();
+            dropUniqueKeys();
+        }
         return count;
     }
 
-    int updateRows(const std::function<bool(const Row&)>& predicate,
-                   const std::vector<std::pair<int, Value>>& updates) {
+    // Sets `columns[i]` of each matching row to `value(i, row)`, in order,
+    // so later assignments see the earlier ones
+    int updateRows(const std::function<bool(const Row&)>& predicate, const std::vector<size_t>& columns,
+                   const std::function<Value(size_t, const Row&)>& value) {
         int count = 0;
         for (auto& row : rows_) {
             if (predicate(row)) {
-                for (const auto& [colIdx, newVal] : updates) {
-                    if (colIdx >= 0 && colIdx < static_cast<int>(row.size()))
-                        row[colIdx] = newVal;
+                for (size_t i = 0; i < columns.size(); i++) {
+                    Value& cell = row[columns[i]];
+                    cell = value(i, row);
+                    compactString(cell, columns[i]);
                 }
                 count++;
             }
         }
-        if (count > 0) rebuildAllIndexes();
+        if (count > 0) {
+            modifications_ += static_cast<uint64_t>(count);
+            strings_.prune();
+            rebuildAllIndexes();
+            dropUniqueKeys();
+        }
         return count;
     }
 
@@ -227,7 +246,7 @@ public:
 
     QueryResult describe() const {
         QueryResult result;
-        result.columnNames = {"Column", "Type", "Nullable", "Primary Key", "Unique"};
+        result.columnNames = {"Column", "Type", "Nullable", "Primary Key", "Unique", "Dictionary"};
         for (const auto& col : columns_) {
             Row row;
             row.push_back(Value(col.name));
@@ -235,6 +254,7 @@ public:
             row.push_back(Value(col.nullable ? std::string("YES") : std::string("NO")));
             row.push_back(Value(col.primaryKey ? std::string("YES") : std::string("NO")));
             row.push_back(Value(col.unique ? std::string("YES") : std::string("NO")));
+            row.push_back(Value(col.dictionary ? std::string("YES") : std::string("NO")));
             result.rows.push_back(row);
         }
         return result;
@@ -243,8 +263,11 @@ public:
     // For transaction support - snapshot and restore
     std::vector<Row> snapshot() const { return rows_; }
     void restore(const std::vector<Row>& snap) {
+        modifications_ += rows_.size() + snap.size();
         rows_ = snap;
+        strings_.prune();
         rebuildAllIndexes();
+        dropUniqueKeys();
     }
 
     // Index management
@@ -279,17 +302,74 @@ public:
 
     const std::unordered_map<std::string, BTreeIndex>& getIndexes() const { return indexes_; }
 
+    // Change counters read by the statistics catalog: every inserted,
+    // updated or deleted row counts as one modification.  noteModified is
+    // also how callers that edit rows in place report it.
+    uint64_t modificationCount() const { return modifications_; }
+    uint64_t insertCount() const { return inserts_; }
+    void noteModified(size_t rows) {
+        modifications_ += rows;
+        if (rows > 0) dropUniqueKeys();
+    }
+
     void rebuildAllIndexes() {
         for (auto& [name, idx] : indexes_)
             idx.rebuild(rows_);
     }
 
+    // Dictionary encoding.  Declared `dictionary` columns are encoded from
+    // the start; other string columns are sampled as the table grows and
+    // switched over when they turn out to hold few distinct values.
+    static constexpr size_t kDictionarySampleRows = 1024;
+    static constexpr size_t kDictionaryMaxRatio = 8;  // at least 8 rows per distinct value
+
+    const DictionaryRef& getDictionary(size_t col) const { return dictionaries_[col]; }
+
+    // Store column `col` dictionary-encoded, using `dict` if given (the
+    // loader passes a dictionary read from disk so stored codes stay valid)
+    void encodeColumn(size_t col, DictionaryRef dict = DictionaryRef()) {
+        if (col >= columns_.size() || columns_[col].type != ValueType::STRING)
+            throw std::runtime_error("Only string columns can be dictionary-encoded");
+        dictionaries_[col] = dict ? std::move(dict) : DictionaryRef::create();
+        columns_[col].dictionary = true;
+        for (auto& row : rows_)
+            row[col] = dictionaries_[col].encode(row[col]);
+        strings_.prune();
+    }
+
 private:
     std::string name_;
     std::vector<Column> columns_;
     std::vector<Row> rows_;
     std::unordered_map<std::string, size_t> columnIndex_;
     std::unordered_map<std::string, BTreeIndex> indexes_;
+    StringPool strings_;  // shared buffers for this table's long strings
+    std::vector<DictionaryRef> dictionaries_;  // per column, empty unless encoded
+    size_t nextDictionaryCheck_ = kDictionarySampleRows;
+    uint64_t modifications_ = 0;
+    uint64_t inserts_ = 0;
+
+    // Values held by each unique column, so inserts check uniqueness without
+    // scanning the table.  Built on the first insert after any update,
+    // delete or restore; empty for other columns.
+    std::vector<ValueSet> uniqueKeys_;
+    bool uniqueKeysBuilt_ = false;
+
+    void buildUniqueKeys() {
+        if (uniqueKeysBuilt_) return;
+        uniqueKeys_.assign(columns_.size(), ValueSet());
+        for (size_t i = 0; i < columns_.size(); i++) {
+            if (!columns_[i].unique && !columns_[i].primaryKey) continue;
+            uniqueKeys_[i].reserve(rows_.size());
+            for (const auto& row : rows_) uniqueKeys_[i].insert(row[i]);
+        }
+        uniqueKeysBuilt_ = true;
+    }
+
+    void dropUniqueKeys() {
+        uniqueKeys_.clear();
+        uniqueKeysBuilt_ = false;
+    }
 
     static std::string typeToString(ValueType t) {
         switch (t) {
@@ -302,6 +382,32 @@ private:
         return "unknown";
     }
 
+    void compactString(Value& v, size_t col) {
+        if (dictionaries_[col]) v = dictionaries_[col].encode(v);
+        else strings_.intern(v);
+    }
+
+    void compactStrings(Row& row) {
+        for (size_t i = 0; i < row.size(); i++) compactString(row[i], i);
+    }
+
+    // Encode every string column whose sample shows low cardinality
+    void chooseDictionaryColumns() {
+        nextDictionaryCheck_ = rows_.size() * 2;
+        for (size_t c = 0; c < columns_.size(); c++) {
+            if (dictionaries_[c] || columns_[c].type != ValueType::STRING) continue;
+            std::unordered_set<std::string_view> distinct;
+            size_t limit = rows_.size() / kDictionaryMaxRatio;
+            bool lowCardinality = true;
+            for (const auto& row : rows_) {
+                if (!row[c].isString()) continue;
+                distinct.insert(row[c].stringView());
+                if (distinct.size() > limit) { lowCardinality = false; break; }
+            }
+            if (lowCardinality && !distinct.empty()) encodeColumn(c);
+        }
+    }
+
     void validateType(const Value& val, const Column& col) const {
         bool valid = false;
         switch (col.type) {
@@ -333,6 +439,7 @@ public:
         if (tables_.find(name) != tables_.end())
             throw std::runtime_error("Table '" + name + "' already exists");
         tables_[name] = Table(name, columns);
+        schemaVersion_++;
     }
 
     void dropTable(const std::string& name) {
@@ -340,6 +447,8 @@ public:
         if (it == tables_.end())
             throw std::runtime_error("Table '" + name + "' does not exist");
         tables_.erase(it);
+        stats_.erase(name);
+        schemaVersion_++;
     }
 
     Table& getTable(const std::string& name) {
@@ -360,6 +469,11 @@ public:
         return tables_.find(name) != tables_.end();
     }
 
+    // Bumped by every schema change (tables created or dropped, indexes
+    // added or removed); cached statements and plans compare against it
+    uint64_t schemaVersion() const { return schemaVersion_; }
+    void noteSchemaChange() { schemaVersion_++; }
+
     QueryResult showTables() const {
         QueryResult result;
         result.columnNames = {"Table Name", "Columns", "Rows"};
@@ -373,43 +487,39 @@ public:
         return result;
     }
 
-    // Transaction support
-    void beginTransaction() {
-        if (inTransaction_)
-            throw std::runtime_error("Nested transactions not supported");
-        inTransaction_ = true;
-        snapshots_.clear();
-        for (const auto& [name, table] : tables_)
-            snapshots_[name] = table.snapshot();
+    const std::unordered_map<std::string, Table>& getAllTables() const { return tables_; }
+
+    // Statistics catalog: populated by ANALYZE, kept current as DML runs
+    const TableStats& analyzeTable(const std::string& name) {
+        return stats_[name] = Statistics::analyze(getTable(name));
     }
 
-    void commitTransaction() {
-        if (!inTransaction_)
-            throw std::runtime_error("No active transaction");
-        inTransaction_ = false;
-        snapshots_.clear();
+    const TableStats* getStatistics(const std::string& name) const {
+        auto it = stats_.find(name);
+        return it == stats_.end() ? nullptr : &it->second;
     }
 
-    void rollbackTransaction() {
-        if (!inTransaction_)
-            throw std::runtime_error("No active transaction");
-        for (auto& [name, table] : tables_) {
-            auto it = snapshots_.find(name);
-            if (it != snapshots_.end())
-                table.restore(it->second);
-        }
-        inTransaction_ = false;
-        snapshots_.clear();
+    void setStatistics(const std::string& name, TableStats stats) {
+        stats_[name] = std::move(stats);
     }
 
-    bool inTransaction() const { return inTransaction_; }
+    void refreshStatistics(const std::string& name) {
+        auto it = stats_.find(name);
+        auto table = tables_.find(name);
+        if (it != stats_.end() && table != tables_.end())
+            Statistics::refresh(it->second, table->second);
+    }
 
-    const std::unordered_map<std::string, Table>& getAllTables() const { return tables_; }
+    const std::unordered_map<std::string, TableStats>& getAllStatistics() const { return stats_; }
+
+    // Executors sharing this database lock it and its tables through here
+    LockManager& locks() { return locks_; }
 
 private:
     std::unordered_map<std::string, Table> tables_;
-    bool inTransaction_ = false;
-    std::unordered_map<std::string, std::vector<Row>> snapshots_;
+    std::unordered_map<std::string, TableStats> stats_;
+    std::atomic<uint64_t> schemaVersion_{0};
+    LockManager locks_;
 };
 
 } // namespace epee
@@ -0,0 +1,119 @@
+/*
+ File: tracer.hpp
+ Project: Épée Database Query Language
+ Description: Opt-in query tracing: Chrome trace-event spans for lexing,
+              parsing, planning and each operator, with hardware counters
+*/
+
+#ifndef EPEE_TRACER_H
+#define EPEE_TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include "perfCounters.hpp"
+
+namespace epee {
+
+// The process's trace file in the Chrome trace-event format that
+// chrome://tracing and Perfetto load: a JSON array of complete ("X")
+// events, one per line.  The array is closed when the trace is closed or
+// the process exits; both viewers also accept a file cut off mid-run.
+// Sessions on different threads record into the same file, each thread
+// on a track of its own.
+class Tracer {
+public:
+    static constexpr const char* kDefaultPath = "epee_trace.json";
+
+    static Tracer& global();
+
+    ~Tracer();
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Start a trace at `path`, closing one open elsewhere; a trace already
+    // open at `path` is kept.  Throws std::runtime_error if the file cannot
+    // be created.
+    void open(const std::string& path);
+    void close();
+    bool isOpen() const { return open_.load(std::memory_order_acquire); }
+    std::string path() const;
+
+    // Executors created while this is set trace every statement (--trace)
+    void setTraceAllSessions(bool all) { traceAll_.store(all); }
+    bool traceAllSessions() const { return traceAll_.load(); }
+
+    // Microseconds since the process started tracing
+    double now() const;
+
+    // A complete event on the calling thread's track.  `args` is the
+    // inside of a JSON object, possibly empty.
+    void record(const std::string& name, const char* category, double startUs,
+                double durationUs, const std::string& args);
+
+private:
+    Tracer();
+
+    mutable std::mutex mutex_;
+    std::FILE* file_ = nullptr;
+    std::string path_;
+    bool empty_ = true;  // nothing written after the opening '['
+    std::atomic<bool> open_{false};
+    std::atomic<bool> traceAll_{false};
+    const std::chrono::steady_clock::time_point epoch_;
+
+    void closeLocked();
+};
+
+// Turns tracing on or off for the calling thread while it lives and
+// restores the previous state afterwards.  Spans are only recorded on a
+// thread where tracing is on, and only while the tracer is open.
+class TraceActivation {
+public:
+    explicit TraceActivation(bool on);
+    ~TraceActivation();
+
+    TraceActivation(const TraceActivation&) = delete;
+    TraceActivation& operator=(const TraceActivation&) = delete;
+
+private:
+    bool previous_;
+};
+
+// One span: wall time from construction to finish() (or destruction), and
+// the thread's cycles, instructions, LLC misses and branch misses over it
+// where perf_event_open is available.  When tracing is off it records
+// nothing and costs a thread-local check.
+class TraceSpan {
+public:
+    TraceSpan(const char* category, const std::string& name);
+    ~TraceSpan() { finish(); }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // Whether spans started now on this thread are recorded
+    static bool active();
+    bool recording() const { return recording_; }
+
+    // Arguments shown with the span; ignored unless recording
+    void arg(const char* key, const std::string& value);
+    void count(const char* key, uint64_t value);
+
+    void finish();
+
+private:
+    bool recording_ = false;
+    const char* category_ = nullptr;
+    std::string name_;
+    std::string args_;
+    double startUs_ = 0;
+    PerfSample counters_;
+};
+
+} // namespace epee
+
+#endif /* EPEE_TRACER_H */
@@ -1,7 +1,7 @@
 /*
  File: value.hpp
  Project: Épée Database Query Language
- Description: Variant value type supporting int, double, string, bool, and null
+ Description: Compact tagged value type supporting int, double, string, bool, and null
 */
 
 #ifndef EPEE_VALUE_H
@@ -9,79 +9,290 @@
 
 #include <iostream>
 #include <string>
-#include <variant>
+#include <string_view>
 #include <stdexcept>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <new>
 #include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <memory>
+#include <vector>
 #include <sstream>
 #include <iomanip>
+#include "likeMatcher.hpp"
 
 namespace epee {
 
 enum class ValueType { INT, DOUBLE, STRING, BOOL, NULL_TYPE };
 
+namespace detail {
+
+// Heap buffer for strings too long to store inline.  Immutable once built and
+// shared between copies of a Value through an intrusive reference count.
+struct StringRep {
+    std::atomic<uint32_t> refs;
+    uint32_t size;
+
+    const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+
+    static StringRep* create(std::string_view s) {
+        if (s.size() > UINT32_MAX)
+            throw std::runtime_error("String value too long");
+        void* mem = ::operator new(sizeof(StringRep) + s.size());
+        StringRep* rep = new (mem) StringRep{{1}, static_cast<uint32_t>(s.size())};
+        std::memcpy(static_cast<char*>(mem) + sizeof(StringRep), s.data(), s.size());
+        return rep;
+    }
+
+    void retain() { refs.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->~StringRep();
+            ::operator delete(this);
+        }
+    }
+};
+
+// Per-column dictionary for low-cardinality strings.  Each distinct string is
+// stored once and cells refer to it by a dense 32-bit code, so equality,
+// hashing and grouping on encoded cells never touch the characters.  Entries
+// are append-only: codes stay valid for the dictionary's whole lifetime.
+// Shared by the owning table and every Value encoded against it.
+//
+// encode() runs under the owning table's write lock, but cells outlive the
+// statement's locks (results are written out after they are released), so
+// text() and hash() may run while another session appends.  Entries live in
+// fixed-size chunks reached through a directory; growth allocates new chunks
+// and, when the directory is full, a larger copy of it, leaving everything a
+// reader may hold in place until the dictionary is destroyed.
+class StringDictionary {
+public:
+    mutable std::atomic<uint32_t> refs{1};
+
+    StringDictionary() = default;
+    StringDictionary(const StringDictionary&) = delete;
+    StringDictionary& operator=(const StringDictionary&) = delete;
+
+    // Code for s, adding it if it is not present yet
+    uint32_t encode(std::string_view s) {
+        auto it = codes_.find(s);
+        if (it != codes_.end()) return it->second;
+        const size_t n = size_.load(std::memory_order_relaxed);
+        if (n >= UINT32_MAX)
+            throw std::runtime_error("Dictionary is full");
+        if ((n & kChunkMask) == 0) addChunk(n >> kChunkBits);
+        Entry& slot = entry(static_cast<uint32_t>(n));
+        slot.text.assign(s);
+        slot.hash = std::hash<std::string_view>{}(slot.text);
+        codes_.emplace(slot.text, static_cast<uint32_t>(n));
+        size_.store(n + 1, std::memory_order_release);
+        return static_cast<uint32_t>(n);
+    }
+
+    // Code for s, or -1 if it is not in the dictionary
+    int64_t find(std::string_view s) const {
+        auto it = codes_.find(s);
+        return it == codes_.end() ? -1 : static_cast<int64_t>(it->second);
+    }
+
+    std::string_view text(uint32_t code) const { return entry(code).text; }
+    size_t hash(uint32_t code) const { return entry(code).hash; }
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+
+    void retain() const { refs.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() const {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+private:
+    struct Entry {
+        std::string text;
+        size_t hash = 0;
+    };
+
+    static constexpr uint32_t kChunkBits = 8;
+    static constexpr uint32_t kChunkMask = (1u << kChunkBits) - 1;
+
+    Entry& entry(uint32_t code) const {
+        return directory_.load(std::memory_order_acquire)[code >> kChunkBits][code & kChunkMask];
+    }
+
+    void addChunk(size_t index) {
+        if (index >= directorySize_) {
+            const size_t grown = std::max<size_t>(16, directorySize_ * 2);
+            auto directory = std::make_unique<Entry*[]>(grown);
+            for (size_t i = 0; i < directorySize_; i++) directory[i] = directories_.back()[i];
+            directory_.store(directory.get(), std::memory_order_release);
+            directories_.push_back(std::move(directory));
+            directorySize_ = grown;
+        }
+        chunks_.push_back(std::make_unique<Entry[]>(size_t(1) << kChunkBits));
+        directories_.back()[index] = chunks_.back().get();
+    }
+
+    std::atomic<Entry**> directory_{nullptr};
+    std::atomic<size_t> size_{0};
+    // Written by encode() only; older directories are kept for readers
+    size_t directorySize_ = 0;
+    std::vector<std::unique_ptr<Entry*[]>> directories_;
+    std::vector<std::unique_ptr<Entry[]>> chunks_;
+    std::unordered_map<std::string_view, uint32_t> codes_;
+};
+
+} // namespace detail
+
+// A single cell: 16 bytes holding a tagged int, double, bool, string or null.
+// The last byte is the tag.  Strings of up to 15 bytes live inline in the
+// other fifteen (the tag also records their length); longer strings point to
+// a shared, reference-counted StringRep; dictionary-encoded strings hold a
+// StringDictionary pointer and a code.
 class Value {
 public:
-    using VariantType = std::variant<std::monostate, int, double, std::string, bool>;
+    static constexpr size_t kInlineCapacity = 15;
+
+    Value() { tag() = TAG_NULL; }
+    explicit Value(int v) { store(v); tag() = TAG_INT; }
+    explicit Value(double v) { store(v); tag() = TAG_DOUBLE; }
+    explicit Value(const std::string& v) { setString(v); }
+    explicit Value(std::string_view v) { setString(v); }
+    explicit Value(const char* v) { setString(std::string_view(v)); }
+    explicit Value(bool v) { store(v); tag() = TAG_BOOL; }
+
+    Value(const Value& other) {
+        std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+        if (tag() == TAG_LONG_STRING) rep()->retain();
+        else if (tag() == TAG_DICT_STRING) dict()->retain();
+    }
+
+    // String cell encoded as `code` in `dict`
+    static Value encoded(const detail::StringDictionary* dict, uint32_t code) {
+        Value v;
+        dict->retain();
+        v.store(dict);
+        std::memcpy(v.bytes_ + sizeof(dict), &code, sizeof(code));
+        v.tag() = TAG_DICT_STRING;
+        return v;
+    }
+
+    Value(Value&& other) noexcept {
+        std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+        other.tag() = TAG_NULL;
+    }
+
+    Value& operator=(const Value& other) {
+        if (this != &other) {
+            Value copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            reset();
+            std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+            other.tag() = TAG_NULL;
+        }
+        return *this;
+    }
 
-    Value() : data_(std::monostate{}), type_(ValueType::NULL_TYPE) {}
-    explicit Value(int v) : data_(v), type_(ValueType::INT) {}
-    explicit Value(double v) : data_(v), type_(ValueType::DOUBLE) {}
-    explicit Value(const std::string& v) : data_(v), type_(ValueType::STRING) {}
-    explicit Value(const char* v) : data_(std::string(v)), type_(ValueType::STRING) {}
-    explicit Value(bool v) : data_(v), type_(ValueType::BOOL) {}
+    ~Value() { reset(); }
+
+    void swap(Value& other) noexcept {
+        unsigned char tmp[sizeof(bytes_)];
+        std::memcpy(tmp, bytes_, sizeof(bytes_));
+        std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+        std::memcpy(other.bytes_, tmp, sizeof(bytes_));
+    }
 
     static Value null() { return Value(); }
 
-    ValueType getType() const { return type_; }
-    bool isNull() const { return type_ == ValueType::NULL_TYPE; }
-    bool isInt() const { return type_ == ValueType::INT; }
-    bool isDouble() const { return type_ == ValueType::DOUBLE; }
-    bool isString() const { return type_ == ValueType::STRING; }
-    bool isBool() const { return type_ == ValueType::BOOL; }
+    ValueType getType() const {
+        switch (tag()) {
+            case TAG_NULL: return ValueType::NULL_TYPE;
+            case TAG_INT: return ValueType::INT;
+            case TAG_DOUBLE: return ValueType::DOUBLE;
+            case TAG_BOOL: return ValueType::BOOL;
+            default: return ValueType::STRING;
+        }
+    }
+    bool isNull() const { return tag() == TAG_NULL; }
+    bool isInt() const { return tag() == TAG_INT; }
+    bool isDouble() const { return tag() == TAG_DOUBLE; }
+    bool isString() const { return tag() >= TAG_LONG_STRING; }
+    bool isBool() const { return tag() == TAG_BOOL; }
     bool isNumeric() const { return isInt() || isDouble(); }
 
+    // True for strings kept in a shared heap buffer rather than inline
+    bool isLongString() const { return tag() == TAG_LONG_STRING; }
+
+    // Dictionary-encoded strings: the dictionary (nullptr for every other
+    // value) and the cell's code in it
+    const detail::StringDictionary* dictionary() const {
+        return tag() == TAG_DICT_STRING ? dict() : nullptr;
+    }
+    uint32_t dictionaryCode() const {
+        uint32_t code;
+        std::memcpy(&code, bytes_ + sizeof(void*), sizeof(code));
+        return code;
+    }
+
     int asInt() const {
-        if (isInt()) return std::get<int>(data_);
-        if (isDouble()) return static_cast<int>(std::get<double>(data_));
-        if (isBool()) return std::get<bool>(data_) ? 1 : 0;
+        if (isInt()) return load<int>();
+        if (isDouble()) return static_cast<int>(load<double>());
+        if (isBool()) return load<bool>() ? 1 : 0;
         throw std::runtime_error("Cannot convert to int");
     }
 
     double asDouble() const {
-        if (isDouble()) return std::get<double>(data_);
-        if (isInt()) return static_cast<double>(std::get<int>(data_));
-        if (isBool()) return std::get<bool>(data_) ? 1.0 : 0.0;
+        if (isDouble()) return load<double>();
+        if (isInt()) return static_cast<double>(load<int>());
+        if (isBool()) return load<bool>() ? 1.0 : 0.0;
         throw std::runtime_error("Cannot convert to double");
     }
 
+    // Characters of a string value without copying; only valid for strings
+    // and only while this Value is alive
+    std::string_view stringView() const {
+        if (tag() == TAG_LONG_STRING) return std::string_view(rep()->data(), rep()->size);
+        if (tag() == TAG_DICT_STRING) return dict()->text(dictionaryCode());
+        return std::string_view(reinterpret_cast<const char*>(bytes_), tag() - TAG_SMALL_STRING);
+    }
+
     std::string asString() const {
-        if (isString()) return std::get<std::string>(data_);
+        if (isString()) return std::string(stringView());
         if (isNull()) return "NULL";
-        if (isInt()) return std::to_string(std::get<int>(data_));
+        if (isInt()) return std::to_string(load<int>());
         if (isDouble()) {
             std::ostringstream oss;
-            double d = std::get<double>(data_);
+            double d = load<double>();
             if (d == std::floor(d) && std::abs(d) < 1e15)
                 oss << std::fixed << std::setprecision(1) << d;
             else
                 oss << d;
             return oss.str();
         }
-        if (isBool()) return std::get<bool>(data_) ? "true" : "false";
+        if (isBool()) return load<bool>() ? "true" : "false";
         return "NULL";
     }
 
     bool asBool() const {
-        if (isBool()) return std::get<bool>(data_);
-        if (isInt()) return std::get<int>(data_) != 0;
-        if (isDouble()) return std::get<double>(data_) != 0.0;
-        if (isString()) return !std::get<std::string>(data_).empty();
+        if (isBool()) return load<bool>();
+        if (isInt()) return load<int>() != 0;
+        if (isDouble()) return load<double>() != 0.0;
+        if (isString()) return !stringView().empty();
         return false;
     }
 
     std::string typeToString() const {
-        switch (type_) {
+        switch (getType()) {
             case ValueType::INT: return "int";
             case ValueType::DOUBLE: return "double";
             case ValueType::STRING: return "string";
@@ -148,10 +359,14 @@ public:
     bool operator==(const Value& other) const {
         if (isNull() && other.isNull()) return true;
         if (isNull() || other.isNull()) return false;
-        if (isString() && other.isString())
-            return std::get<std::string>(data_) == std::get<std::string>(other.data_);
+        if (isString() && other.isString()) {
+            if (tag() == TAG_DICT_STRING && other.tag() == TAG_DICT_STRING &&
+                dict() == other.dict())
+                return dictionaryCode() == other.dictionaryCode();
+            return stringView() == other.stringView();
+        }
         if (isBool() && other.isBool())
-            return std::get<bool>(data_) == std::get<bool>(other.data_);
+            return load<bool>() == other.load<bool>();
         if (isNumeric() && other.isNumeric())
             return asDouble() == other.asDouble();
         return false;
@@ -162,7 +377,7 @@ public:
     bool operator<(const Value& other) const {
         if (isNull() || other.isNull()) return false;
         if (isString() && other.isString())
-            return std::get<std::string>(data_) < std::get<std::string>(other.data_);
+            return stringView() < other.stringView();
         if (isNumeric() && other.isNumeric())
             return asDouble() < other.asDouble();
         throw std::runtime_error("Incompatible types for comparison");
@@ -172,12 +387,11 @@ public:
     bool operator<=(const Value& other) const { return !(other < *this); }
     bool operator>=(const Value& other) const { return !(*this < other); }
 
-    // LIKE pattern matching (SQL-style with % and _ wildcards)
-    // Uses simple recursive matching instead of regex to avoid DoS
+    // LIKE pattern matching (SQL-style with % and _ wildcards).  Compiles
+    // the pattern each call; LikeExpr keeps a compiled LikeMatcher instead.
     bool like(const std::string& pattern) const {
         if (!isString()) return false;
-        const std::string& str = std::get<std::string>(data_);
-        return likeMatch(str, 0, pattern, 0);
+        return LikeMatcher(pattern).matches(stringView());
     }
 
     // BETWEEN check
@@ -191,36 +405,164 @@ public:
     }
 
 private:
-    VariantType data_;
-    ValueType type_;
-
-    // Simple recursive LIKE pattern matching (case-insensitive)
-    static bool likeMatch(const std::string& str, size_t si,
-                          const std::string& pat, size_t pi) {
-        while (pi < pat.size()) {
-            char p = pat[pi];
-            if (p == '%') {
-                // Skip consecutive % characters
-                while (pi < pat.size() && pat[pi] == '%') pi++;
-                if (pi == pat.size()) return true;
-                // Try matching remaining pattern at every position
-                for (size_t i = si; i <= str.size(); i++) {
-                    if (likeMatch(str, i, pat, pi)) return true;
-                }
-                return false;
-            } else if (p == '_') {
-                if (si >= str.size()) return false;
-                si++; pi++;
-            } else {
-                if (si >= str.size()) return false;
-                if (std::tolower(static_cast<unsigned char>(str[si])) !=
-                    std::tolower(static_cast<unsigned char>(p)))
-                    return false;
-                si++; pi++;
-            }
+    friend class StringPool;
+
+    // Tag byte values.  Inline strings use TAG_SMALL_STRING + length.
+    enum : unsigned char {
+        TAG_NULL = 0,
+        TAG_INT = 1,
+        TAG_DOUBLE = 2,
+        TAG_BOOL = 3,
+        TAG_LONG_STRING = 4,
+        TAG_DICT_STRING = 5,
+        TAG_SMALL_STRING = 6
+    };
+
+    alignas(8) unsigned char bytes_[16];
+
+    unsigned char& tag() { return bytes_[15]; }
+    unsigned char tag() const { return bytes_[15]; }
+
+    template <typename T> void store(T v) { std::memcpy(bytes_, &v, sizeof(T)); }
+    template <typename T> T load() const {
+        T v;
+        std::memcpy(&v, bytes_, sizeof(T));
+        return v;
+    }
+
+    detail::StringRep* rep() const { return load<detail::StringRep*>(); }
+    const detail::StringDictionary* dict() const { return load<const detail::StringDictionary*>(); }
+
+    void setString(std::string_view s) {
+        if (s.size() <= kInlineCapacity) {
+            std::memcpy(bytes_, s.data(), s.size());
+            tag() = static_cast<unsigned char>(TAG_SMALL_STRING + s.size());
+        } else {
+            store(detail::StringRep::create(s));
+            tag() = TAG_LONG_STRING;
+        }
+    }
+
+    void reset() {
+        if (tag() == TAG_LONG_STRING) rep()->release();
+        else if (tag() == TAG_DICT_STRING) dict()->release();
+        tag() = TAG_NULL;
+    }
+};
+
+static_assert(sizeof(Value) == 16, "Value must stay 16 bytes");
+
+// splitmix64 finalizer: every input bit affects every output bit
+inline uint64_t mixHash(uint64_t h) {
+    h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+// Hash consistent with Value::operator== (1 and 1.0 hash alike, NULL
+// matches NULL).  The bits are mixed, so callers may take any of them for
+// partitions or sketch registers.
+struct ValueHash {
+    size_t operator()(const Value& v) const { return static_cast<size_t>(hash(v)); }
+
+    static uint64_t hash(const Value& v) {
+        if (v.isNumeric()) {
+            double d = v.asDouble();
+            if (d == 0.0) d = 0.0;  // fold -0.0
+            uint64_t bits;
+            std::memcpy(&bits, &d, sizeof(bits));
+            return mixHash(bits);
+        }
+        if (v.isString()) return mixHash(std::hash<std::string_view>{}(v.stringView()));
+        if (v.isBool()) return v.asBool() ? 0x51ed2701a3c6d0b5ULL : 0x2545f4914f6cdd1dULL;
+        return 0x9e3779b97f4a7c15ULL;
+    }
+};
+
+using ValueSet = std::unordered_set<Value, ValueHash>;
+
+// Interning pool for long strings.  Equal strings passed through intern()
+// share one heap buffer, so a column repeating the same long values stores
+// each distinct value once.  Short strings are inline and never pooled.
+class StringPool {
+public:
+    StringPool() = default;
+    StringPool(const StringPool& other) { copyFrom(other); }
+    StringPool& operator=(const StringPool& other) {
+        if (this != &other) { entries_.clear(); copyFrom(other); }
+        return *this;
+    }
+    StringPool(StringPool&&) = default;
+    StringPool& operator=(StringPool&&) = default;
+
+    // Replace v's buffer with the pooled buffer for the same text
+    void intern(Value& v) {
+        if (!v.isLongString()) return;
+        std::string_view text = v.stringView();
+        auto it = entries_.find(text);
+        if (it == entries_.end())
+            entries_.emplace(text, v);
+        else if (it->second.rep() != v.rep())
+            v = it->second;
+    }
+
+    // Drop strings no longer referenced outside the pool
+    void prune() {
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            if (it->second.rep()->refs.load(std::memory_order_acquire) == 1)
+                it = entries_.erase(it);
+            else
+                ++it;
         }
-        return si == str.size();
     }
+
+    size_t size() const { return entries_.size(); }
+
+private:
+    // Keys view the characters of the Value they map to
+    std::unordered_map<std::string_view, Value> entries_;
+
+    void copyFrom(const StringPool& other) {
+        entries_.reserve(other.entries_.size());
+        for (const auto& [text, v] : other.entries_)
+            entries_.emplace(v.stringView(), v);
+    }
+};
+
+// Owning reference to a StringDictionary (the dictionary itself is also kept
+// alive by every Value encoded against it)
+class DictionaryRef {
+public:
+    DictionaryRef() = default;
+    static DictionaryRef create() {
+        DictionaryRef ref;
+        ref.dict_ = new detail::StringDictionary();
+        return ref;
+    }
+    DictionaryRef(const DictionaryRef& other) : dict_(other.dict_) {
+        if (dict_) dict_->retain();
+    }
+    DictionaryRef(DictionaryRef&& other) noexcept : dict_(other.dict_) { other.dict_ = nullptr; }
+    DictionaryRef& operator=(DictionaryRef other) noexcept {
+        std::swap(dict_, other.dict_);
+        return *this;
+    }
+    ~DictionaryRef() { if (dict_) dict_->release(); }
+
+    explicit operator bool() const { return dict_ != nullptr; }
+    detail::StringDictionary* get() const { return dict_; }
+    detail::StringDictionary* operator->() const { return dict_; }
+
+    // Encode a string value (already-encoded cells of this dictionary are
+    // returned unchanged; anything that is not a string passes through)
+    Value encode(const Value& v) const {
+        if (!v.isString() || v.dictionary() == dict_) return v;
+        return Value::encoded(dict_, dict_->encode(v.stringView()));
+    }
+
+private:
+    detail::StringDictionary* dict_ = nullptr;
 };
 
 } // namespace epee
@@ -231,7 +573,9 @@ namespace std {
             switch (v.getType()) {
                 case epee::ValueType::INT: return hash<int>{}(v.asInt());
                 case epee::ValueType::DOUBLE: return hash<double>{}(v.asDouble());
-                case epee::ValueType::STRING: return hash<string>{}(v.asString());
+                case epee::ValueType::STRING:
+                    if (auto dict = v.dictionary()) return dict->hash(v.dictionaryCode());
+                    return hash<string_view>{}(v.stringView());
                 case epee::ValueType::BOOL: return hash<bool>{}(v.asBool());
                 case epee::ValueType::NULL_TYPE: return 0;
             }
@@ -0,0 +1,161 @@
+/*
+ File: benchMain.cpp
+ Project: Épée Database Query Language
+ Description: Entry point for epee_bench, the workload benchmark
+
+ Usage:
+   ./epee_bench [--scale N] [--reps R] [--warmup W] [--data DIR]
+                [--filter TEXT] [--out FILE] [--baseline FILE] [--threshold PCT]
+
+ Generates the data set for scale factor N under DIR, loads it, runs every
+ workload query W times untimed and R times timed, prints a summary and
+ writes it as JSON to FILE.  With --baseline, each query's median latency
+ is compared with the one in an earlier report, and the exit status is 1
+ if any got slower by more than PCT percent.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+
+#include "../../include/bench/benchSuite.hpp"
+
+using namespace std;
+using namespace epee;
+
+namespace {
+
+struct Options {
+    double scale = 1.0;
+    int repetitions = 5;
+    int warmup = 1;
+    string dataDir = "/tmp/epee_bench";
+    string filter;
+    string out = "bench.json";
+    string baseline;
+    double threshold = 10.0;
+};
+
+void printUsage(const char* programName) {
+    cout << "Usage: " << programName << " [options]" << endl;
+    cout << "  --scale N        data set scale factor (default 1)" << endl;
+    cout << "  --reps R         timed repetitions per query (default 5)" << endl;
+    cout << "  --warmup W       untimed repetitions per query (default 1)" << endl;
+    cout << "  --data DIR       where the generated CSV files go (default /tmp/epee_bench)" << endl;
+    cout << "  --filter TEXT    only run queries whose name contains TEXT" << endl;
+    cout << "  --out FILE       JSON report (default bench.json)" << endl;
+    cout << "  --baseline FILE  compare with an earlier report" << endl;
+    cout << "  --threshold PCT  slowdown that counts as a regression (default 10)" << endl;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        if (arg == "--help" || arg == "-h") return false;
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << endl;
+            return false;
+        }
+        const string value = argv[++i];
+        if (arg == "--scale") options.scale = atof(value.c_str());
+        else if (arg == "--reps") options.repetitions = atoi(value.c_str());
+        else if (arg == "--warmup") options.warmup = atoi(value.c_str());
+        else if (arg == "--data") options.dataDir = value;
+        else if (arg == "--filter") options.filter = value;
+        else if (arg == "--out") options.out = value;
+        else if (arg == "--baseline") options.baseline = value;
+        else if (arg == "--threshold") options.threshold = atof(value.c_str());
+        else {
+            cerr << "Unknown option " << arg << endl;
+            return false;
+        }
+    }
+    if (options.scale <= 0) {
+        cerr << "--scale must be positive" << endl;
+        return false;
+    }
+    return true;
+}
+
+string readFile(const string& path) {
+    ifstream in(path);
+    if (!in) throw runtime_error("Cannot read '" + path + "'");
+    stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    try {
+        map<string, double> baseline;
+        if (!options.baseline.empty()) baseline = BenchReport::readBaseline(readFile(options.baseline));
+
+        mkdir(options.dataDir.c_str(), 0755);
+        const vector<BenchTable> tables = BenchDataGenerator(options.scale).generate(options.dataDir);
+
+        BenchReport report;
+        report.scale = options.scale;
+        report.repetitions = options.repetitions;
+        report.warmup = options.warmup;
+        for (const BenchTable& table : tables) report.loadRows += table.rows;
+
+        BenchRunner runner(options.repetitions, options.warmup);
+        report.loadSeconds = runner.load(tables);
+        printf("Loaded %zu rows in %.3f s (%.0f rows/s)\n\n", report.loadRows, report.loadSeconds,
+               report.loadSeconds > 0 ? report.loadRows / report.loadSeconds : 0.0);
+
+        printf("%-26s %10s %10s %10s %10s %14s %10s\n", "query", "p50 ms", "p95 ms", "p99 ms",
+               "qps", "rows/s", "vs base");
+        bool regressed = false;
+        for (const BenchQuery& query : benchWorkload(options.scale)) {
+            if (!options.filter.empty() && query.name.find(options.filter) == string::npos) continue;
+            const BenchResult result = runner.run(query);
+            report.results.push_back(result);
+
+            string change = "";
+            auto base = baseline.find(result.name);
+            if (base != baseline.end() && base->second > 0) {
+                const double pct = (result.latency.p50Ms / base->second - 1.0) * 100.0;
+                char buffer[32];
+                snprintf(buffer, sizeof(buffer), "%+.1f%%", pct);
+                change = buffer;
+                if (pct > options.threshold) {
+                    change += " !";
+                    regressed = true;
+                }
+            }
+            printf("%-26s %10.3f %10.3f %10.3f %10.1f %14.0f %10s\n", result.name.c_str(),
+                   result.latency.p50Ms, result.latency.p95Ms, result.latency.p99Ms,
+                   result.queriesPerSec, result.rowsPerSec, change.c_str());
+        }
+
+        report.peakRssKb = peakRssKb();
+        printf("\nPeak RSS: %ld KB\n", report.peakRssKb);
+
+        ofstream out(options.out);
+        out << report.toJson();
+        if (!out) throw runtime_error("Cannot write '" + options.out + "'");
+        printf("Report written to %s\n", options.out.c_str());
+
+        if (regressed) {
+            printf("Median latency regressed by more than %.1f%% (marked !)\n", options.threshold);
+            return 1;
+        }
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,440 @@
+/*
+ File: benchSuite.cpp
+ Project: Épée Database Query Language
+ Description: Data generators, workload, runner and reports for epee_bench
+*/
+
+#include "../../include/bench/benchSuite.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/resource.h>
+
+namespace epee {
+
+namespace {
+
+const char* const regionNames[] = {"AFRICA", "AMERICA", "ASIA", "EUROPE", "MIDDLE EAST"};
+
+struct Nation {
+    const char* name;
+    int region;
+};
+
+const Nation nations[] = {
+    {"ALGERIA", 0}, {"ARGENTINA", 1}, {"BRAZIL", 1}, {"CANADA", 1}, {"EGYPT", 4},
+    {"ETHIOPIA", 0}, {"FRANCE", 3}, {"GERMANY", 3}, {"INDIA", 2}, {"INDONESIA", 2},
+    {"IRAN", 4}, {"IRAQ", 4}, {"JAPAN", 2}, {"JORDAN", 4}, {"KENYA", 0},
+    {"MOROCCO", 0}, {"MOZAMBIQUE", 0}, {"PERU", 1}, {"CHINA", 2}, {"ROMANIA", 3},
+    {"SAUDI ARABIA", 4}, {"VIETNAM", 2}, {"RUSSIA", 3}, {"UNITED KINGDOM", 3}, {"UNITED STATES", 1},
+};
+
+const char* const segments[] = {"AUTOMOBILE", "BUILDING", "FURNITURE", "HOUSEHOLD", "MACHINERY"};
+const char* const priorities[] = {"1-URGENT", "2-HIGH", "3-MEDIUM", "4-NOT SPECIFIED", "5-LOW"};
+const char* const typeSizes[] = {"STANDARD", "SMALL", "MEDIUM", "LARGE", "ECONOMY", "PROMO"};
+const char* const typeFinishes[] = {"ANODIZED", "BURNISHED", "PLATED", "POLISHED", "BRUSHED"};
+const char* const typeMetals[] = {"TIN", "NICKEL", "BRASS", "STEEL", "COPPER"};
+const char* const colors[] = {
+    "almond", "azure", "blush", "chiffon", "coral", "cyan", "forest", "ivory",
+    "khaki", "lavender", "linen", "maroon", "navy", "olive", "peach", "salmon",
+};
+
+template <typename T, size_t N>
+const T& pick(BenchRandom& random, const T (&choices)[N]) {
+    return choices[random.next() % N];
+}
+
+// Day `day` counted from 1992-01-01 in 365-day years, as yyyymmdd
+int toDate(int day) {
+    static const int monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    const int year = 1992 + day / 365;
+    day %= 365;
+    int month = 0;
+    while (day >= monthDays[month]) day -= monthDays[month++];
+    return year * 10000 + (month + 1) * 100 + day + 1;
+}
+
+std::string money(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.2f", value);
+    return buffer;
+}
+
+// A CSV file being written for one table
+class CsvTable {
+public:
+    CsvTable(const std::string& dir, const std::string& name, const std::string& create,
+             const std::string& header)
+        : out_(dir + "/" + name + ".csv") {
+        table_.name = name;
+        table_.create = create;
+        table_.path = dir + "/" + name + ".csv";
+        if (!out_) throw std::runtime_error("Cannot write '" + table_.path + "'");
+        out_ << header << '\n';
+    }
+
+    std::ostream& row() {
+        table_.rows++;
+        return out_;
+    }
+
+    BenchTable finish() {
+        out_.close();
+        if (!out_) throw std::runtime_error("Error writing '" + table_.path + "'");
+        return table_;
+    }
+
+private:
+    std::ofstream out_;
+    BenchTable table_;
+};
+
+double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string number(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.4f", value);
+    return buffer;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Data generation
+// ---------------------------------------------------------------------------
+
+size_t BenchDataGenerator::scaled(size_t rowsAtOne) const {
+    return std::max<size_t>(1, static_cast<size_t>(std::llround(rowsAtOne * scale_)));
+}
+
+std::vector<BenchTable> BenchDataGenerator::generate(const std::string& dir) const {
+    BenchRandom random(seed_);
+    std::vector<BenchTable> tables;
+
+    CsvTable region(dir, "region", "create table region (r_id int, r_name string);", "r_id,r_name");
+    for (int i = 0; i < 5; i++) region.row() << i << ',' << regionNames[i] << '\n';
+    tables.push_back(region.finish());
+
+    CsvTable nation(dir, "nation", "create table nation (n_id int, n_name string, n_region int);",
+                    "n_id,n_name,n_region");
+    for (int i = 0; i < 25; i++)
+        nation.row() << i << ',' << nations[i].name << ',' << nations[i].region << '\n';
+    tables.push_back(nation.finish());
+
+    const size_t supplierCount = scaled(100);
+    CsvTable supplier(dir, "supplier",
+                      "create table supplier (s_id int, s_name string, s_nation int, s_balance double);",
+                      "s_id,s_name,s_nation,s_balance");
+    for (size_t i = 1; i <= supplierCount; i++)
+        supplier.row() << i << ",Supplier#" << i << ',' << random.range(0, 24) << ','
+                       << money(random.money(-999.99, 9999.99)) << '\n';
+    tables.push_back(supplier.finish());
+
+    const size_t customerCount = scaled(1500);
+    CsvTable customer(dir, "customer",
+                      "create table customer (c_id int, c_name string, c_nation int, "
+                      "c_segment string, c_balance double);",
+                      "c_id,c_name,c_nation,c_segment,c_balance");
+    for (size_t i = 1; i <= customerCount; i++)
+        customer.row() << i << ",Customer#" << i << ',' << random.range(0, 24) << ','
+                       << pick(random, segments) << ',' << money(random.money(-999.99, 9999.99)) << '\n';
+    tables.push_back(customer.finish());
+
+    const size_t partCount = scaled(2000);
+    std::vector<double> partPrices(partCount + 1);
+    CsvTable part(dir, "part",
+                  "create table part (p_id int, p_name string, p_brand string, p_type string, "
+                  "p_size int, p_price double);",
+                  "p_id,p_name,p_brand,p_type,p_size,p_price");
+    for (size_t i = 1; i <= partCount; i++) {
+        partPrices[i] = 900.0 + static_cast<double>(i % 20001) / 10.0;
+        part.row() << i << ',' << pick(random, colors) << ' ' << pick(random, colors) << ",Brand#"
+                   << random.range(1, 5) << random.range(1, 5) << ',' << pick(random, typeSizes) << ' '
+                   << pick(random, typeFinishes) << ' ' << pick(random, typeMetals) << ','
+                   << random.range(1, 50) << ',' << money(partPrices[i]) << '\n';
+    }
+    tables.push_back(part.finish());
+
+    // Orders and their line items are generated together so each order's
+    // total is the sum of its lines
+    const size_t orderCount = scaled(15000);
+    CsvTable orders(dir, "orders",
+                    "create table orders (o_id int, o_cust int, o_status string, o_total double, "
+                    "o_date int, o_priority string);",
+                    "o_id,o_cust,o_status,o_total,o_date,o_priority");
+    CsvTable lineitem(dir, "lineitem",
+                      "create table lineitem (l_order int, l_line int, l_part int, l_supp int, "
+                      "l_qty int, l_price double, l_discount double, l_tax double, "
+                      "l_returnflag string, l_status string, l_shipdate int);",
+                      "l_order,l_line,l_part,l_supp,l_qty,l_price,l_discount,l_tax,"
+                      "l_returnflag,l_status,l_shipdate");
+    const int lastOrderDay = 7 * 365 - 151;
+    const int cutoff = 19950617;  // lines shipped after it are still open
+    for (size_t o = 1; o <= orderCount; o++) {
+        const int orderDay = static_cast<int>(random.range(0, lastOrderDay));
+        const int lines = static_cast<int>(random.range(1, 7));
+        double total = 0;
+        int shipped = 0;
+        for (int l = 1; l <= lines; l++) {
+            const size_t p = static_cast<size_t>(random.range(1, static_cast<int64_t>(partCount)));
+            const int64_t qty = random.range(1, 50);
+            const double price = static_cast<double>(qty) * partPrices[p];
+            const double discount = static_cast<double>(random.range(0, 10)) / 100.0;
+            const double tax = static_cast<double>(random.range(0, 8)) / 100.0;
+            const int shipDate = toDate(orderDay + static_cast<int>(random.range(1, 121)));
+            const bool open = shipDate > cutoff;
+            const char* flag = open ? "N" : (random.range(0, 1) ? "R" : "A");
+            shipped += open ? 0 : 1;
+            total += price * (1 - discount) * (1 + tax);
+            lineitem.row() << o << ',' << l << ',' << p << ','
+                           << random.range(1, static_cast<int64_t>(supplierCount)) << ',' << qty << ','
+                           << money(price) << ',' << money(discount) << ',' << money(tax) << ','
+                           << flag << ',' << (open ? "O" : "F") << ',' << shipDate << '\n';
+        }
+        const char* status = shipped == lines ? "F" : (shipped == 0 ? "O" : "P");
+        orders.row() << o << ',' << random.range(1, static_cast<int64_t>(customerCount)) << ','
+                     << status << ',' << money(total) << ',' << toDate(orderDay) << ','
+                     << pick(random, priorities) << '\n';
+    }
+    tables.push_back(orders.finish());
+    tables.push_back(lineitem.finish());
+
+    return tables;
+}
+
+// ---------------------------------------------------------------------------
+// Workload
+// ---------------------------------------------------------------------------
+
+std::vector<BenchQuery> benchWorkload(double scale) {
+    std::vector<BenchQuery> workload = {
+        {"scan_count", "scan",
+         "lineitem |> count;", "", "lineitem"},
+        {"q1_pricing_summary", "group",
+         "lineitem\n"
+         "    |> where(l_shipdate <= 19980902)\n"
+         "    |> groupby(l_returnflag, l_status)\n"
+         "    |> select(l_returnflag, l_status, sum(l_qty) as sum_qty, sum(l_price) as sum_price,\n"
+         "              avg(l_discount) as avg_disc, count(*) as count_order)\n"
+         "    |> orderby(l_returnflag, l_status);",
+         "", "lineitem"},
+        {"q6_forecast_revenue", "filter",
+         "lineitem\n"
+         "    |> where(l_shipdate >= 19940101 and l_shipdate < 19950101\n"
+         "             and l_discount between 0.05 and 0.07 and l_qty < 24)\n"
+         "    |> map(l_price * l_discount as rev)\n"
+         "    |> select(sum(rev) as revenue);",
+         "", "lineitem"},
+        {"filter_like", "filter",
+         "part |> where(p_type like \"%BRASS\") |> count;", "", "part"},
+        {"filter_in", "filter",
+         "customer |> where(c_segment in (\"BUILDING\", \"MACHINERY\")) |> count;", "", "customer"},
+        {"q3_shipping_priority", "join",
+         "customer\n"
+         "    |> join(orders on customer.c_id == orders.o_cust)\n"
+         "    |> join(lineitem on orders.o_id == lineitem.l_order)\n"
+         "    |> where(customer.c_segment == \"BUILDING\" and orders.o_date < 19950315\n"
+         "             and lineitem.l_shipdate > 19950315)\n"
+         "    |> groupby(orders.o_id, orders.o_date)\n"
+         "    |> select(orders.o_id, orders.o_date, sum(lineitem.l_price) as revenue)\n"
+         "    |> orderby(revenue desc)\n"
+         "    |> take(10);",
+         "", "lineitem"},
+        {"q5_local_supplier_volume", "join",
+         "select nation.n_name, sum(orders.o_total) as revenue\n"
+         "    from orders\n"
+         "    inner join customer on orders.o_cust == customer.c_id\n"
+         "    inner join nation on customer.c_nation == nation.n_id\n"
+         "    inner join region on nation.n_region == region.r_id\n"
+         "    where region.r_name == \"ASIA\" and orders.o_date >= 19940101 and orders.o_date < 19950101\n"
+         "    groupby nation.n_name;",
+         "", "orders"},
+        {"group_priority_sql", "group",
+         "select o_priority, count(*) as orders, avg(o_total) as avg_total\n"
+         "    from orders where o_status == \"O\" groupby o_priority;",
+         "", "orders"},
+        {"topn_orders", "topn",
+         "orders |> orderby(o_total desc) |> take(10);", "", "orders"},
+        {"distinct_priority", "topn",
+         "orders |> select(o_priority) |> distinct;", "", "orders"},
+        {"point_lookup", "lookup",
+         "orders |> where(o_id == 4242);", "", "orders"},
+        // The setup takes back what the update adds, so every repetition
+        // starts from the same rows and the table ends as it was generated
+        {"dml_update", "dml",
+         "orders |> where(o_status == \"P\") |> update(o_total = o_total + 1.0);",
+         "orders |> where(o_status == \"P\") |> update(o_total = o_total - 1.0);", "orders"},
+    };
+
+    // Inserts go one statement at a time into a scratch table that the
+    // setup empties; the delete case removes half of a freshly filled one
+    const size_t batch = std::max<size_t>(100, static_cast<size_t>(1000 * scale));
+    std::string inserts;
+    for (size_t i = 0; i < batch; i++)
+        inserts += "insert into bench_scratch values (" + std::to_string(i) + ", \"row " +
+                   std::to_string(i) + "\", " + std::to_string(i % 97) + ".5);\n";
+    workload.push_back({"dml_insert", "dml", inserts, "bench_scratch |> delete;", "bench_scratch"});
+    workload.push_back({"dml_delete", "dml", "bench_scratch |> where(k % 2 == 0) |> delete;",
+                        "bench_scratch |> delete;\n" + inserts, "bench_scratch"});
+    return workload;
+}
+
+// ---------------------------------------------------------------------------
+// Measurement
+// ---------------------------------------------------------------------------
+
+LatencySummary LatencySummary::of(std::vector<double> ms) {
+    LatencySummary summary;
+    summary.samples = ms.size();
+    if (ms.empty()) return summary;
+    std::sort(ms.begin(), ms.end());
+    auto rank = [&](double p) {
+        const size_t r = static_cast<size_t>(std::ceil(p * static_cast<double>(ms.size())));
+        return ms[std::min(ms.size(), std::max<size_t>(r, 1)) - 1];
+    };
+    double total = 0;
+    for (double x : ms) total += x;
+    summary.minMs = ms.front();
+    summary.maxMs = ms.back();
+    summary.meanMs = total / static_cast<double>(ms.size());
+    summary.p50Ms = rank(0.50);
+    summary.p95Ms = rank(0.95);
+    summary.p99Ms = rank(0.99);
+    return summary;
+}
+
+BenchRunner::BenchRunner(int repetitions, int warmup)
+    : repetitions_(std::max(1, repetitions)), warmup_(std::max(0, warmup)) {}
+
+QueryResult BenchRunner::execute(const std::string& source) {
+    DbLexer lexer(source);
+    DbParser parser(lexer.tokenize());
+    const std::vector<StmtPtr> statements = parser.parse();
+    if (parser.hasErrors()) throw std::runtime_error("Parse error: " + parser.getErrors().front());
+    QueryResult result = executor_.executeAll(statements);
+    if (!result.success) throw std::runtime_error(result.message);
+    return result;
+}
+
+double BenchRunner::load(const std::vector<BenchTable>& tables) {
+    for (const BenchTable& table : tables) execute(table.create);
+    execute("create table bench_scratch (k int, label string, amount double);");
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const BenchTable& table : tables)
+        execute("copy " + table.name + " from " + jsonString(table.path) + " header;");
+    const double elapsed = seconds(start);
+
+    execute("create unique index bench_orders_id on orders(o_id);\n"
+            "create unique index bench_customer_id on customer(c_id);\n"
+            "create index bench_lineitem_order on lineitem(l_order);\n"
+            "analyze;");
+    return elapsed;
+}
+
+BenchResult BenchRunner::run(const BenchQuery& query) {
+    BenchResult result;
+    result.name = query.name;
+    result.category = query.category;
+
+    const Table& driver = executor_.getDatabase().getTable(query.driver);
+    std::vector<double> samples;
+    for (int i = 0; i < warmup_ + repetitions_; i++) {
+        if (!query.setup.empty()) execute(query.setup);
+        const size_t before = driver.rowCount();
+        const auto start = std::chrono::steady_clock::now();
+        const QueryResult out = execute(query.source);
+        const double ms = seconds(start) * 1000.0;
+        if (i < warmup_) continue;
+        samples.push_back(ms);
+        result.rowsOut = out.rows.empty() ? static_cast<size_t>(out.affectedRows) : out.rows.size();
+        // The larger of the sizes before and after, so inserts count the
+        // rows they added and deletes the rows they examined
+        result.rowsScanned = std::max(before, driver.rowCount());
+    }
+
+    result.latency = LatencySummary::of(samples);
+    if (result.latency.meanMs > 0) result.queriesPerSec = 1000.0 / result.latency.meanMs;
+    if (result.latency.p50Ms > 0)
+        result.rowsPerSec = static_cast<double>(result.rowsScanned) * 1000.0 / result.latency.p50Ms;
+    return result;
+}
+
+long peakRssKb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Reports
+// ---------------------------------------------------------------------------
+
+std::string BenchReport::toJson() const {
+    std::ostringstream out;
+    out << "{\n";
+    out << "  \"benchmark\": \"epee_bench\",\n";
+    out << "  \"scale\": " << number(scale) << ",\n";
+    out << "  \"repetitions\": " << repetitions << ",\n";
+    out << "  \"warmup\": " << warmup << ",\n";
+    out << "  \"load\": {\"rows\": " << loadRows << ", \"seconds\": " << number(loadSeconds)
+        << ", \"rows_per_sec\": " << number(loadSeconds > 0 ? loadRows / loadSeconds : 0) << "},\n";
+    out << "  \"peak_rss_kb\": " << peakRssKb << ",\n";
+    out << "  \"queries\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << "    {\"name\": " << jsonString(r.name) << ", \"category\": " << jsonString(r.category)
+            << ", \"rows_out\": " << r.rowsOut << ", \"rows_scanned\": " << r.rowsScanned
+            << ", \"samples\": " << r.latency.samples
+            << ", \"min_ms\": " << number(r.latency.minMs) << ", \"mean_ms\": " << number(r.latency.meanMs)
+            << ", \"p50_ms\": " << number(r.latency.p50Ms) << ", \"p95_ms\": " << number(r.latency.p95Ms)
+            << ", \"p99_ms\": " << number(r.latency.p99Ms) << ", \"max_ms\": " << number(r.latency.maxMs)
+            << ", \"qps\": " << number(r.queriesPerSec) << ", \"rows_per_sec\": " << number(r.rowsPerSec)
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+    return out.str();
+}
+
+std::map<std::string, double> BenchReport::readBaseline(const std::string& json) {
+    // Only the query lines are read: each holds "name" and "p50_ms"
+    std::map<std::string, double> medians;
+    std::istringstream in(json);
+    std::string line;
+    const std::string nameKey = "\"name\": \"";
+    const std::string p50Key = "\"p50_ms\": ";
+    while (std::getline(in, line)) {
+        const size_t name = line.find(nameKey);
+        const size_t p50 = line.find(p50Key);
+        if (name == std::string::npos || p50 == std::string::npos) continue;
+        const size_t start = name + nameKey.size();
+        const size_t end = line.find('"', start);
+        if (end == std::string::npos) continue;
+        medians[line.substr(start, end - start)] = std::strtod(line.c_str() + p50 + p50Key.size(), nullptr);
+    }
+    return medians;
+}
+
+} // namespace epee
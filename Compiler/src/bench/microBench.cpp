@@ -0,0 +1,169 @@
+/*
+ File: microBench.cpp
+ Project: Épée Database Query Language
+ Description: MicroBench implementation
+*/
+
+#include "../../include/bench/microBench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+namespace epee {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+double medianOf(std::vector<double>& sorted) {
+    const size_t n = sorted.size();
+    return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+}
+
+std::string number(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return buffer;
+}
+
+} // namespace
+
+MicroStats MicroStats::of(std::vector<double> values) {
+    MicroStats stats;
+    if (values.empty()) return stats;
+    std::sort(values.begin(), values.end());
+    double sum = 0;
+    for (double v : values) sum += v;
+    stats.mean = sum / values.size();
+    double squares = 0;
+    for (double v : values) squares += (v - stats.mean) * (v - stats.mean);
+    stats.stddev = values.size() > 1 ? std::sqrt(squares / (values.size() - 1)) : 0;
+    stats.min = values.front();
+    stats.max = values.back();
+    stats.median = medianOf(values);
+    for (double& v : values) v = std::fabs(v - stats.median);
+    std::sort(values.begin(), values.end());
+    stats.mad = medianOf(values);
+    return stats;
+}
+
+// Doubles the batch size until one batch takes minSampleMs, then sizes
+// the batch to hit the target
+size_t MicroBench::calibrate(const MicroCase& c) const {
+    const double targetNs = options_.minSampleMs * 1e6;
+    size_t ops = 1;
+    for (;;) {
+        if (c.setup) c.setup();
+        const auto start = Clock::now();
+        c.run(ops);
+        const double ns = elapsedNs(start);
+        if (ns >= targetNs / 2 || ops >= (size_t(1) << 40)) {
+            const double perOp = std::max(ns / ops, 1e-3);
+            return std::max<size_t>(1, static_cast<size_t>(targetNs / perOp));
+        }
+        ops *= ns < targetNs / 64 ? 8 : 2;
+    }
+}
+
+MicroResult MicroBench::run(const MicroCase& c) {
+    MicroResult result;
+    result.name = c.name;
+    result.opsPerSample = calibrate(c);
+    result.samples = options_.samples;
+
+    const bool counting = options_.counters && counters_.available();
+    PerfSample counted;
+    std::vector<double> nsPerOp;
+    for (int i = 0; i < options_.warmup + options_.samples; i++) {
+        if (c.setup) c.setup();
+        const PerfSample before = counting ? counters_.read() : PerfSample();
+        const auto start = Clock::now();
+        c.run(result.opsPerSample);
+        const double ns = elapsedNs(start);
+        if (i < options_.warmup) continue;
+        nsPerOp.push_back(ns / result.opsPerSample);
+        if (counting) {
+            const PerfSample d = counters_.read() - before;
+            counted.cycles += d.cycles;
+            counted.instructions += d.instructions;
+            counted.cacheMisses += d.cacheMisses;
+            counted.branchMisses += d.branchMisses;
+        }
+    }
+
+    result.nsPerOp = MicroStats::of(nsPerOp);
+    if (c.bytesPerOp > 0 && result.nsPerOp.median > 0)
+        result.mbPerSec = c.bytesPerOp / result.nsPerOp.median * 1e3;
+    if (counting) {
+        const double ops = static_cast<double>(result.opsPerSample) * options_.samples;
+        result.hasCounters = true;
+        result.cycles = counted.cycles / ops;
+        result.instructions = counted.instructions / ops;
+        result.cacheMisses = counted.cacheMisses / ops;
+        result.branchMisses = counted.branchMisses / ops;
+    }
+    return result;
+}
+
+std::vector<MicroResult> MicroBench::runAll(std::ostream& out) {
+    std::vector<MicroResult> results;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-28s %12s %12s %8s %10s", "case", "median ns", "mean ns", "cv %",
+                  "MB/s");
+    out << line;
+    if (options_.counters) out << (counters_.available() ? "   cycles    instr   IPC  LLC-miss  br-miss"
+                                                         : "   (hardware counters unavailable)");
+    out << std::endl;
+
+    for (const MicroCase& c : cases_) {
+        if (!options_.filter.empty() && c.name.find(options_.filter) == std::string::npos) continue;
+        const MicroResult r = run(c);
+        results.push_back(r);
+        std::snprintf(line, sizeof(line), "%-28s %12.2f %12.2f %8.2f %10s", r.name.c_str(),
+                      r.nsPerOp.median, r.nsPerOp.mean, r.nsPerOp.cv() * 100,
+                      r.mbPerSec > 0 ? number(r.mbPerSec).c_str() : "-");
+        out << line;
+        if (r.hasCounters) {
+            std::snprintf(line, sizeof(line), " %8.0f %8.0f %5.2f %9.2f %8.2f", r.cycles, r.instructions,
+                          r.cycles > 0 ? r.instructions / r.cycles : 0.0, r.cacheMisses, r.branchMisses);
+            out << line;
+        }
+        out << std::endl;
+    }
+    return results;
+}
+
+std::string MicroBench::toJson(const std::vector<MicroResult>& results, const MicroOptions& options) {
+    std::ostringstream out;
+    out << "{\n";
+    out << "  \"benchmark\": \"epee_microbench\",\n";
+    out << "  \"warmup\": " << options.warmup << ",\n";
+    out << "  \"samples\": " << options.samples << ",\n";
+    out << "  \"min_sample_ms\": " << number(options.minSampleMs) << ",\n";
+    out << "  \"cases\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const MicroResult& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"ops_per_sample\": " << r.opsPerSample
+            << ", \"median_ns\": " << number(r.nsPerOp.median) << ", \"mean_ns\": " << number(r.nsPerOp.mean)
+            << ", \"stddev_ns\": " << number(r.nsPerOp.stddev) << ", \"mad_ns\": " << number(r.nsPerOp.mad)
+            << ", \"min_ns\": " << number(r.nsPerOp.min) << ", \"max_ns\": " << number(r.nsPerOp.max);
+        if (r.mbPerSec > 0) out << ", \"mb_per_sec\": " << number(r.mbPerSec);
+        if (r.hasCounters)
+            out << ", \"cycles\": " << number(r.cycles) << ", \"instructions\": " << number(r.instructions)
+                << ", \"llc_misses\": " << number(r.cacheMisses)
+                << ", \"branch_misses\": " << number(r.branchMisses);
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+    return out.str();
+}
+
+} // namespace epee
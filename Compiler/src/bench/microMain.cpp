@@ -0,0 +1,265 @@
+/*
+ File: microMain.cpp
+ Project: Épée Database Query Language
+ Description: Entry point for epee_microbench: cases for the engine's core primitives
+
+ Usage:
+   ./epee_microbench [--filter TEXT] [--samples N] [--warmup N]
+                     [--min-ms MS] [--counters] [--json FILE]
+
+ Each case reports nanoseconds per operation (median, mean and relative
+ standard deviation over the samples), MB/s for the lexer cases and, with
+ --counters, cycles, instructions, LLC misses and branch misses per
+ operation where the kernel allows perf_event_open.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../../include/bench/microBench.hpp"
+#include "../../include/database/btree.hpp"
+#include "../../include/database/dbLexer.hpp"
+#include "../../include/database/dbParser.hpp"
+#include "../../include/database/likeMatcher.hpp"
+#include "../../include/database/storage.hpp"
+#include "../../include/database/table.hpp"
+#include "../../include/database/value.hpp"
+
+using namespace std;
+using namespace epee;
+
+namespace {
+
+const char* const kSelect =
+    "employees |> where(salary > 50000.0 and dept in (\"eng\", \"ops\")) "
+    "|> groupby(dept) |> select(dept, count(*) as n, avg(salary) as pay) "
+    "|> orderby(pay desc) |> take(5);";
+
+const char* const kStoragePath = "/tmp/epee_microbench.epd";
+
+// Distinct pseudo-random keys in [0, 2^31)
+vector<int> shuffledKeys(size_t count) {
+    vector<int> keys(count);
+    uint32_t x = 2463534242u;
+    for (size_t i = 0; i < count; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        keys[i] = static_cast<int>(((static_cast<uint64_t>(i) << 20) ^ (x & 0xfffff)) & 0x7fffffff);
+    }
+    return keys;
+}
+
+string insertScript(size_t rows) {
+    string script;
+    for (size_t i = 0; i < rows; i++)
+        script += "insert into people values (" + to_string(i) + ", \"Person " + to_string(i) +
+                  "\", " + to_string(20 + i % 50) + ", " + to_string(i % 1000) + ".25, \"City\"); // row\n";
+    return script;
+}
+
+vector<Column> peopleColumns() {
+    return {Column("id", ValueType::INT), Column("name", ValueType::STRING),
+            Column("age", ValueType::INT), Column("score", ValueType::DOUBLE),
+            Column("city", ValueType::STRING)};
+}
+
+Row personRow(size_t i) {
+    return {Value(static_cast<int>(i)), Value("Person " + to_string(i)), Value(static_cast<int>(20 + i % 50)),
+            Value(static_cast<double>(i % 1000) + 0.25), Value("City")};
+}
+
+void addValueCases(MicroBench& bench) {
+    bench.add("value_add_int", [](size_t n) {
+        Value sum(0);
+        const Value one(1);
+        for (size_t i = 0; i < n; i++) {
+            sum = sum + one;
+            keep(sum);
+        }
+    });
+    bench.add("value_mul_double", [](size_t n) {
+        Value product(1.0);
+        const Value factor(1.0000001);
+        for (size_t i = 0; i < n; i++) {
+            product = product * factor;
+            keep(product);
+        }
+    });
+    bench.add("value_compare_int", [](size_t n) {
+        const Value a(41), b(42);
+        size_t less = 0;
+        for (size_t i = 0; i < n; i++) {
+            keep(a);
+            less += a < b;
+        }
+        keep(less);
+    });
+    bench.add("value_compare_string", [](size_t n) {
+        // A shared 20-byte prefix, so the comparison reads past it
+        const Value a("customer-segment-0001-alpha"), b("customer-segment-0001-beta");
+        size_t less = 0;
+        for (size_t i = 0; i < n; i++) {
+            keep(a);
+            less += a < b;
+        }
+        keep(less);
+    });
+    bench.add("value_like", [](size_t n) {
+        // Value::like compiles the pattern on every call
+        const Value text("Customer#000123456");
+        const string pattern = "%mer#%56";
+        size_t hits = 0;
+        for (size_t i = 0; i < n; i++) {
+            keep(text);
+            hits += text.like(pattern);
+        }
+        keep(hits);
+    });
+    bench.add("like_matcher_compiled", [](size_t n) {
+        const LikeMatcher matcher("%mer#%56");
+        const string text = "Customer#000123456";
+        size_t hits = 0;
+        for (size_t i = 0; i < n; i++) {
+            keep(text);
+            hits += matcher.matches(text);
+        }
+        keep(hits);
+    });
+}
+
+void addLanguageCases(MicroBench& bench) {
+    const string statement = kSelect;
+    bench.add("lexer_tokenize_statement", [statement](size_t n) {
+        DbLexer lexer;
+        for (size_t i = 0; i < n; i++) {
+            lexer.setSource(statement);
+            keep(lexer.tokenize());
+        }
+    }, nullptr, static_cast<double>(statement.size()));
+
+    // A 1 MB data script of the kind COPY replaces
+    auto script = make_shared<string>(insertScript(12000));
+    bench.add("lexer_tokenize_script", [script](size_t n) {
+        DbLexer lexer;
+        for (size_t i = 0; i < n; i++) {
+            lexer.setSource(*script);
+            keep(lexer.tokenize());
+        }
+    }, nullptr, static_cast<double>(script->size()));
+
+    // Tokens are lexed once; the case measures the parser alone
+    auto lexer = make_shared<DbLexer>(statement);
+    auto tokens = make_shared<vector<DbToken>>(lexer->tokenize());
+    bench.add("parser_parse_statement", [lexer, tokens](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            DbParser parser(*tokens);
+            keep(parser.parse());
+        }
+    });
+}
+
+void addStorageCases(MicroBench& bench) {
+    // Inserting n keys into an empty index, so the cost per key includes
+    // the tree growing to n entries
+    auto keys = make_shared<vector<int>>(shuffledKeys(1 << 20));
+    auto index = make_shared<BTreeIndex>();
+    bench.add("btree_insert", [keys, index](size_t n) {
+        for (size_t i = 0; i < n; i++)
+            index->insert(Value((*keys)[i % keys->size()]), i);
+    }, [index]() { *index = BTreeIndex("bench_idx", "bench", "k", 0); });
+
+    auto filled = make_shared<BTreeIndex>("bench_idx", "bench", "k", 0);
+    for (size_t i = 0; i < 100000; i++) filled->insert(Value((*keys)[i]), i);
+    bench.add("btree_find", [keys, filled](size_t n) {
+        for (size_t i = 0; i < n; i++)
+            keep(filled->find(Value((*keys)[(i * 7919) % 100000])));
+    });
+
+    auto table = make_shared<Table>();
+    bench.add("table_insert_row", [table](size_t n) {
+        for (size_t i = 0; i < n; i++) table->insertRow(personRow(i));
+    }, [table]() { *table = Table("people", peopleColumns()); });
+
+    // A 10,000-row table, saved and loaded as a whole database
+    auto db = make_shared<Database>();
+    db->createTable("people", peopleColumns());
+    vector<Row> rows;
+    for (size_t i = 0; i < 10000; i++) rows.push_back(personRow(i));
+    db->getTable("people").insertRows(move(rows));
+    bench.add("storage_save_10k_rows", [db](size_t n) {
+        for (size_t i = 0; i < n; i++) Storage::saveDatabase(*db, kStoragePath);
+    });
+    bench.add("storage_load_10k_rows", [](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            Database loaded;
+            Storage::loadDatabase(loaded, kStoragePath);
+            keep(loaded);
+        }
+    }, [db]() { Storage::saveDatabase(*db, kStoragePath); });
+}
+
+void printUsage(const char* programName) {
+    cout << "Usage: " << programName << " [options]" << endl;
+    cout << "  --filter TEXT   only run cases whose name contains TEXT" << endl;
+    cout << "  --samples N     timed samples per case (default 15)" << endl;
+    cout << "  --warmup N      untimed samples per case (default 2)" << endl;
+    cout << "  --min-ms MS     target length of one sample (default 20)" << endl;
+    cout << "  --counters      read cycles, instructions, LLC and branch misses" << endl;
+    cout << "  --json FILE     also write the results as JSON" << endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    MicroOptions options;
+    string jsonPath;
+    for (int i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        if (arg == "--counters") {
+            options.counters = true;
+            continue;
+        }
+        if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+            printUsage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 2;
+        }
+        const string value = argv[++i];
+        if (arg == "--filter") options.filter = value;
+        else if (arg == "--samples") options.samples = max(1, atoi(value.c_str()));
+        else if (arg == "--warmup") options.warmup = max(0, atoi(value.c_str()));
+        else if (arg == "--min-ms") options.minSampleMs = max(0.1, atof(value.c_str()));
+        else if (arg == "--json") jsonPath = value;
+        else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    try {
+        MicroBench bench(options);
+        addValueCases(bench);
+        addLanguageCases(bench);
+        addStorageCases(bench);
+        const vector<MicroResult> results = bench.runAll(cout);
+        remove(kStoragePath);
+
+        if (!jsonPath.empty()) {
+            ofstream out(jsonPath);
+            out << MicroBench::toJson(results, options);
+            if (!out) {
+                cerr << "Error: cannot write '" << jsonPath << "'" << endl;
+                return 1;
+            }
+        }
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -5,6 +5,8 @@
 */
 
 #include "../../include/database/btree.hpp"
+#include <algorithm>
+#include <iterator>
 #include <stdexcept>
 
 namespace epee {
@@ -24,6 +26,18 @@ void BTreeIndex::insert(const Value& key, size_t rowIndex) {
     index_[key].insert(rowIndex);
 }
 
+void BTreeIndex::insertBatch(std::vector<std::pair<Value, size_t>> entries) {
+    ValueCompare cmp;
+    std::stable_sort(entries.begin(), entries.end(),
+                     [&](const auto& a, const auto& b) { return cmp(a.first, b.first); });
+    auto hint = index_.end();
+    for (auto& [key, rowIndex] : entries) {
+        auto it = index_.try_emplace(hint, std::move(key));
+        it->second.insert(it->second.end(), rowIndex);
+        hint = std::next(it);
+    }
+}
+
 void BTreeIndex::remove(const Value& key, size_t rowIndex) {
     auto it = index_.find(key);
     if (it != index_.end()) {
@@ -73,6 +87,16 @@ std::set<size_t> BTreeIndex::findLessThan(const Value& key) const {
     return result;
 }
 
+std::set<size_t> BTreeIndex::findPrefix(std::string_view prefix) const {
+    std::set<size_t> result;
+    // Strings with the prefix sort together, starting at the prefix itself
+    for (auto it = index_.lower_bound(Value(std::string(prefix))); it != index_.end(); ++it) {
+        if (!it->first.isString() || it->first.stringView().substr(0, prefix.size()) != prefix) break;
+        result.insert(it->second.begin(), it->second.end());
+    }
+    return result;
+}
+
 void BTreeIndex::rebuild(const std::vector<std::vector<Value>>& rows) {
     index_.clear();
     for (size_t i = 0; i < rows.size(); i++) {
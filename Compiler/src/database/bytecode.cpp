@@ -0,0 +1,231 @@
+/*
+ File: bytecode.cpp
+ Project: Épée Database Query Language
+ Description: Stack bytecode for the imperative layer (variables, if, while,
+              function bodies) and the compiler that produces it
+*/
+
+#include "../../include/database/bytecode.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace epee {
+
+namespace {
+
+OpCode binaryOpCode(const std::string& op, bool& known) {
+    known = true;
+    if (op == "+") return OpCode::ADD;
+    if (op == "-") return OpCode::SUB;
+    if (op == "*") return OpCode::MUL;
+    if (op == "/") return OpCode::DIV;
+    if (op == "%") return OpCode::MOD;
+    if (op == "==" || op == "=") return OpCode::EQ;
+    if (op == "!=" || op == "<>") return OpCode::NE;
+    if (op == "<") return OpCode::LT;
+    if (op == ">") return OpCode::GT;
+    if (op == "<=") return OpCode::LE;
+    if (op == ">=") return OpCode::GE;
+    known = false;
+    return OpCode::HALT;
+}
+
+// Aggregates outside a query keep their special per-row meaning, which the
+// tree-walking evaluator implements
+bool isAggregateName(const std::string& lowerName) {
+    return lowerName == "count" || lowerName == "sum" || lowerName == "avg" ||
+           lowerName == "min" || lowerName == "max";
+}
+
+Value initialValue(ValueType type) {
+    switch (type) {
+        case ValueType::INT:    return Value(0);
+        case ValueType::DOUBLE: return Value(0.0);
+        case ValueType::STRING: return Value(std::string(""));
+        case ValueType::BOOL:   return Value(false);
+        default:                return Value();
+    }
+}
+
+} // namespace
+
+// ── Emission ─────────────────────────────────────────────────────────
+
+size_t BytecodeCompiler::emit(OpCode op, int32_t a, int32_t b) {
+    switch (op) {
+        case OpCode::CONST:
+        case OpCode::LOAD_LOCAL:
+        case OpCode::LOAD_GLOBAL:
+        case OpCode::EVAL:
+            depth_++;
+            break;
+        case OpCode::STORE_LOCAL:
+        case OpCode::STORE_GLOBAL:
+        case OpCode::DECLARE_LOCAL:
+        case OpCode::DECLARE_GLOBAL:
+        case OpCode::ADD: case OpCode::SUB: case OpCode::MUL: case OpCode::DIV: case OpCode::MOD:
+        case OpCode::EQ: case OpCode::NE: case OpCode::LT: case OpCode::GT: case OpCode::LE: case OpCode::GE:
+        case OpCode::JUMP_IF_FALSE:
+        case OpCode::JUMP_IF_TRUE:
+        case OpCode::PRINT:
+        case OpCode::RETURN:
+            depth_--;
+            break;
+        case OpCode::CALL:
+            depth_ = depth_ - static_cast<size_t>(b) + 1;
+            break;
+        default:
+            break;
+    }
+    chunk_.maxStack = std::max(chunk_.maxStack, depth_);
+    chunk_.code.push_back({op, a, b});
+    return chunk_.code.size() - 1;
+}
+
+int32_t BytecodeCompiler::constant(const Value& value) {
+    chunk_.constants.push_back(value);
+    return static_cast<int32_t>(chunk_.constants.size() - 1);
+}
+
+int32_t BytecodeCompiler::name(const std::string& name) {
+    auto it = std::find(chunk_.names.begin(), chunk_.names.end(), name);
+    if (it != chunk_.names.end()) return static_cast<int32_t>(it - chunk_.names.begin());
+    chunk_.names.push_back(name);
+    return static_cast<int32_t>(chunk_.names.size() - 1);
+}
+
+Chunk BytecodeCompiler::finish() {
+    emit(OpCode::HALT);
+    chunk_.globals.assign(chunk_.names.size(), nullptr);
+    return std::move(chunk_);
+}
+
+// ── Statements ───────────────────────────────────────────────────────
+
+void BytecodeCompiler::block(const std::vector<StmtPtr>& stmts) {
+    if (stmts.empty()) emit(OpCode::RESULT, static_cast<int32_t>(BlockResult::EMPTY));
+    for (const auto& stmt : stmts) statement(stmt);
+}
+
+void BytecodeCompiler::ifStatement(const IfStmt& stmt) {
+    expression(stmt.condition);
+    const size_t toElse = emit(OpCode::JUMP_IF_FALSE);
+    block(stmt.thenBody);
+    const size_t toEnd = emit(OpCode::JUMP);
+    patch(toElse);
+    if (stmt.elseBody.empty()) emit(OpCode::RESULT, static_cast<int32_t>(BlockResult::OK));
+    else block(stmt.elseBody);
+    patch(toEnd);
+}
+
+void BytecodeCompiler::whileStatement(const WhileStmt& stmt) {
+    emit(OpCode::RESULT, static_cast<int32_t>(BlockResult::OK));
+    const auto top = static_cast<int32_t>(chunk_.code.size());
+    expression(stmt.condition);
+    const size_t toEnd = emit(OpCode::JUMP_IF_FALSE);
+    block(stmt.body);
+    emit(OpCode::JUMP, top);
+    patch(toEnd);
+}
+
+void BytecodeCompiler::statement(const StmtPtr& stmt) {
+    if (auto decl = std::dynamic_pointer_cast<VarDeclStmt>(stmt)) {
+        for (size_t i = 0; i < decl->names.size(); i++) {
+            emit(OpCode::CONST, constant(initialValue(decl->type)));
+            if (locals_ && i < decl->slots.size()) emit(OpCode::DECLARE_LOCAL, decl->slots[i]);
+            else emit(OpCode::DECLARE_GLOBAL, name(decl->names[i]));
+        }
+    } else if (auto assign = std::dynamic_pointer_cast<AssignStmt>(stmt)) {
+        expression(assign->value);
+        if (locals_ && assign->slot >= 0) emit(OpCode::STORE_LOCAL, assign->slot, name(assign->varName));
+        else emit(OpCode::STORE_GLOBAL, name(assign->varName));
+    } else if (auto print = std::dynamic_pointer_cast<PrintStmt>(stmt)) {
+        expression(print->expr);
+        emit(OpCode::PRINT);
+    } else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+        ifStatement(*ifStmt);
+    } else if (auto loop = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
+        whileStatement(*loop);
+    } else if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(stmt); ret && locals_) {
+        expression(ret->value);
+        emit(OpCode::RETURN);
+    } else {
+        // Outside a function, RETURN runs through the executor to fail there
+        chunk_.stmts.push_back(stmt);
+        emit(OpCode::EXEC, static_cast<int32_t>(chunk_.stmts.size() - 1));
+    }
+}
+
+// ── Expressions ──────────────────────────────────────────────────────
+
+void BytecodeCompiler::expression(const ExprPtr& expr) {
+    if (!expr || std::dynamic_pointer_cast<StarExpr>(expr)) {
+        emit(OpCode::CONST, constant(Value()));
+        return;
+    }
+    // Parameters change value between executions; they are evaluated
+    if (auto lit = std::dynamic_pointer_cast<LiteralExpr>(expr);
+        lit && !std::dynamic_pointer_cast<ParamExpr>(expr)) {
+        emit(OpCode::CONST, constant(lit->value));
+        return;
+    }
+    if (auto col = std::dynamic_pointer_cast<ColumnExpr>(expr); col && col->tableName.empty()) {
+        if (locals_ && col->slot >= 0) emit(OpCode::LOAD_LOCAL, col->slot, name(col->columnName));
+        else emit(OpCode::LOAD_GLOBAL, name(col->columnName));
+        return;
+    }
+    if (auto alias = std::dynamic_pointer_cast<AliasExpr>(expr)) {
+        expression(alias->expr);
+        return;
+    }
+    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+        // a and b: a ? truth(b) : false; a or b: a ? true : truth(b)
+        if (bin->op == "and" || bin->op == "or") {
+            const bool isAnd = bin->op == "and";
+            expression(bin->left);
+            const size_t shortCircuit = emit(isAnd ? OpCode::JUMP_IF_FALSE : OpCode::JUMP_IF_TRUE);
+            expression(bin->right);
+            emit(OpCode::TRUTH);
+            const size_t toEnd = emit(OpCode::JUMP);
+            patch(shortCircuit);
+            depth_--;  // only one of the two branches pushes
+            emit(OpCode::CONST, constant(Value(!isAnd)));
+            patch(toEnd);
+            return;
+        }
+        bool known;
+        const OpCode op = binaryOpCode(bin->op, known);
+        if (known) {
+            expression(bin->left);
+            expression(bin->right);
+            emit(op);
+            return;
+        }
+    }
+    if (auto un = std::dynamic_pointer_cast<UnaryExpr>(expr)) {
+        if (un->op == "-" || un->op == "not" || un->op == "!") {
+            expression(un->operand);
+            emit(un->op == "-" ? OpCode::NEG : OpCode::NOT);
+            return;
+        }
+    }
+    if (auto call = std::dynamic_pointer_cast<FunctionCallExpr>(expr)) {
+        std::string lowerName = call->name;
+        std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), ::tolower);
+        if (!isAggregateName(lowerName)) {
+            for (const auto& arg : call->args) expression(arg);
+            CallSite site;
+            site.name = call->name;
+            site.lowerName = std::move(lowerName);
+            chunk_.callSites.push_back(std::move(site));
+            emit(OpCode::CALL, static_cast<int32_t>(chunk_.callSites.size() - 1),
+                 static_cast<int32_t>(call->args.size()));
+            return;
+        }
+    }
+    chunk_.exprs.push_back(expr);
+    emit(OpCode::EVAL, static_cast<int32_t>(chunk_.exprs.size() - 1));
+}
+
+} // namespace epee
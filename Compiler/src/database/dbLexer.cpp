@@ -6,8 +6,270 @@
 
 #include "../../include/database/dbLexer.hpp"
 
+#include <cstdint>
+
 namespace epee {
 
+namespace {
+
+// Character classes for the scanner, indexed by unsigned char.  ASCII only,
+// matching the <cctype> predicates in the C locale.
+enum CharClass : uint8_t {
+    DIGIT = 1,
+    IDENT_START = 2,  // letter or '_'
+    IDENT = 4,        // letter, digit or '_'
+    UPPER = 8,
+    SPACE = 16
+};
+
+struct CharTable {
+    uint8_t cls[256] = {};
+    constexpr CharTable() {
+        for (int c = 0; c < 256; c++) {
+            const bool digit = c >= '0' && c <= '9';
+            const bool upper = c >= 'A' && c <= 'Z';
+            const bool alpha = upper || (c >= 'a' && c <= 'z');
+            cls[c] = static_cast<uint8_t>((digit ? DIGIT | IDENT : 0) |
+                                          (alpha || c == '_' ? IDENT_START | IDENT : 0) |
+                                          (upper ? UPPER : 0) |
+                                          (c == ' ' || c == '\t' || c == '\r' || c == '\n' ? SPACE : 0));
+        }
+    }
+};
+
+constexpr CharTable charTable;
+
+inline bool is(char c, CharClass cls) {
+    return charTable.cls[static_cast<unsigned char>(c)] & cls;
+}
+
+struct Keyword {
+    std::string_view name;  // lowercase; also the token's text
+    DbTokenType type;
+};
+
+constexpr Keyword keywords[] = {
+    // DDL
+    {"create", DbTokenType::CREATE},
+    {"table", DbTokenType::TABLE},
+    {"drop", DbTokenType::DROP},
+    {"describe", DbTokenType::DESCRIBE},
+    {"show", DbTokenType::SHOW},
+    {"tables", DbTokenType::TABLES},
+    {"index", DbTokenType::INDEX},
+    {"unique", DbTokenType::UNIQUE},
+
+    // DML
+    {"select", DbTokenType::SELECT},
+    {"insert", DbTokenType::INSERT},
+    {"into", DbTokenType::INTO},
+    {"values", DbTokenType::VALUES},
+    {"update", DbTokenType::UPDATE},
+    {"set", DbTokenType::SET},
+    {"delete", DbTokenType::DELETE_KW},
+    {"from", DbTokenType::FROM},
+    {"where", DbTokenType::WHERE},
+
+    // Joins
+    {"join", DbTokenType::JOIN},
+    {"inner", DbTokenType::INNER},
+    {"left", DbTokenType::LEFT},
+    {"right", DbTokenType::RIGHT},
+    {"outer", DbTokenType::OUTER},
+    {"cross", DbTokenType::CROSS},
+    {"on", DbTokenType::ON},
+
+    // Clauses
+    {"groupby", DbTokenType::GROUPBY},
+    {"orderby", DbTokenType::ORDERBY},
+    {"having", DbTokenType::HAVING},
+    {"limit", DbTokenType::LIMIT},
+    {"offset", DbTokenType::OFFSET},
+    {"as", DbTokenType::AS},
+    {"asc", DbTokenType::ASC},
+    {"desc", DbTokenType::DESC},
+    {"distinct", DbTokenType::DISTINCT},
+
+    // Logical
+    {"and", DbTokenType::AND},
+    {"or", DbTokenType::OR},
+    {"not", DbTokenType::NOT},
+
+    // Predicates
+    {"between", DbTokenType::BETWEEN},
+    {"in", DbTokenType::IN},
+    {"like", DbTokenType::LIKE},
+    {"exists", DbTokenType::EXISTS},
+    {"is", DbTokenType::IS},
+
+    // Set operations
+    {"union", DbTokenType::UNION},
+    {"intersect", DbTokenType::INTERSECT},
+    {"except", DbTokenType::EXCEPT},
+
+    // Transaction
+    {"begin", DbTokenType::BEGIN_KW},
+    {"commit", DbTokenType::COMMIT},
+    {"rollback", DbTokenType::ROLLBACK},
+
+    // Types
+    {"int", DbTokenType::INT_TYPE},
+    {"double", DbTokenType::DOUBLE_TYPE},
+    {"string", DbTokenType::STRING_TYPE},
+    {"bool", DbTokenType::BOOL_TYPE},
+
+    // Aggregates
+    {"count", DbTokenType::COUNT},
+    {"sum", DbTokenType::SUM},
+    {"avg", DbTokenType::AVG},
+    {"min", DbTokenType::MIN_FN},
+    {"max", DbTokenType::MAX_FN},
+
+    // Boolean literals
+    {"true", DbTokenType::BOOL_LIT},
+    {"false", DbTokenType::BOOL_LIT},
+    {"null", DbTokenType::NULL_LIT},
+
+    // Control flow (from original language)
+    {"if", DbTokenType::IF},
+    {"then", DbTokenType::THEN},
+    {"else", DbTokenType::ELSE},
+    {"fi", DbTokenType::FI},
+    {"while", DbTokenType::WHILE},
+    {"do", DbTokenType::DO},
+    {"od", DbTokenType::OD},
+    {"def", DbTokenType::DEF},
+    {"fed", DbTokenType::FED},
+    {"return", DbTokenType::RETURN},
+    {"print", DbTokenType::PRINT},
+
+    // String functions
+    {"upper", DbTokenType::UPPER},
+    {"lower", DbTokenType::LOWER},
+    {"length", DbTokenType::LENGTH},
+    {"substr", DbTokenType::SUBSTR},
+    {"concat", DbTokenType::CONCAT},
+    {"trim", DbTokenType::TRIM},
+    {"replace", DbTokenType::REPLACE},
+
+    // Utility functions
+    {"coalesce", DbTokenType::COALESCE},
+    {"nullif", DbTokenType::NULLIF},
+    {"typeof", DbTokenType::TYPEOF},
+    {"cast", DbTokenType::CAST},
+    {"lpad", DbTokenType::LPAD},
+    {"rpad", DbTokenType::RPAD},
+    {"reverse", DbTokenType::REVERSE},
+    {"repeat", DbTokenType::REPEAT_FN},
+    {"power", DbTokenType::POWER},
+    {"sqrt", DbTokenType::SQRT},
+    {"log", DbTokenType::LOG_FN},
+    {"pi", DbTokenType::PI_FN},
+    {"random", DbTokenType::RANDOM},
+    {"now", DbTokenType::NOW},
+    {"iif", DbTokenType::IIF},
+
+    // CASE expression
+    {"case", DbTokenType::CASE},
+    {"when", DbTokenType::WHEN},
+    {"end", DbTokenType::END_KW},
+
+    // Pipeline aliases
+    {"take", DbTokenType::TAKE},
+    {"skip", DbTokenType::SKIP_KW},
+    {"map", DbTokenType::MAP},
+
+    // Persistence
+    {"save", DbTokenType::SAVE},
+    {"load", DbTokenType::LOAD},
+    {"database", DbTokenType::DATABASE},
+
+    // Security
+    {"user", DbTokenType::USER},
+    {"password", DbTokenType::PASSWORD},
+    {"grant", DbTokenType::GRANT_KW},
+    {"revoke", DbTokenType::REVOKE_KW},
+    {"login", DbTokenType::LOGIN},
+    {"logout", DbTokenType::LOGOUT},
+    {"to", DbTokenType::TO},
+    {"privileges", DbTokenType::PRIVILEGES},
+
+    // Operational
+    {"explain", DbTokenType::EXPLAIN},
+
+    // Prepared statements
+    {"prepare", DbTokenType::PREPARE},
+    {"execute", DbTokenType::EXECUTE},
+    {"deallocate", DbTokenType::DEALLOCATE},
+
+    // Bulk loading
+    {"copy", DbTokenType::COPY},
+};
+
+constexpr size_t kKeywordCount = sizeof(keywords) / sizeof(keywords[0]);
+
+constexpr size_t maxKeywordLength() {
+    size_t n = 0;
+    for (const Keyword& k : keywords) n = k.name.size() > n ? k.name.size() : n;
+    return n;
+}
+
+// Keywords are looked up through a perfect hash computed at compile time:
+// a seeded FNV-1a hash of the lowercased spelling, with the seed chosen so
+// that no two keywords share a slot.  A lookup is one hash of the
+// identifier (folding case as it goes) and one comparison.
+constexpr size_t kKeywordSlots = 2048;
+
+constexpr uint32_t keywordHash(const char* text, size_t length, uint32_t seed) {
+    uint32_t h = seed;
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return (h ^ (h >> 15)) & (kKeywordSlots - 1);
+}
+
+struct KeywordTable {
+    uint32_t seed = 0;
+    uint8_t slot[kKeywordSlots] = {};  // index into `keywords` plus one; 0 is empty
+};
+
+constexpr KeywordTable buildKeywordTable() {
+    for (uint32_t seed = 2166136261u;; seed++) {
+        KeywordTable table;
+        table.seed = seed;
+        bool collision = false;
+        for (size_t i = 0; i < kKeywordCount && !collision; i++) {
+            uint8_t& slot = table.slot[keywordHash(keywords[i].name.data(), keywords[i].name.size(), seed)];
+            collision = slot != 0;
+            slot = static_cast<uint8_t>(i + 1);
+        }
+        if (!collision) return table;
+    }
+}
+
+static_assert(kKeywordCount < 255, "keyword slots hold a uint8_t index");
+constexpr KeywordTable keywordTable = buildKeywordTable();
+constexpr size_t kMaxKeywordLength = maxKeywordLength();
+
+// The keyword spelled `text` in any case, or nullptr
+const Keyword* findKeyword(std::string_view text) {
+    if (text.size() > kMaxKeywordLength) return nullptr;
+    const uint8_t slot = keywordTable.slot[keywordHash(text.data(), text.size(), keywordTable.seed)];
+    if (slot == 0) return nullptr;
+    const Keyword& keyword = keywords[slot - 1];
+    if (keyword.name.size() != text.size()) return nullptr;
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        if (c != keyword.name[i]) return nullptr;
+    }
+    return &keyword;
+}
+
+} // namespace
+
 std::string DbToken::typeToString() const {
     switch (type) {
         case DbTokenType::INT_LIT: return "INT_LIT";
@@ -15,6 +277,7 @@ std::string DbToken::typeToString() const {
         case DbTokenType::STRING_LIT: return "STRING_LIT";
         case DbTokenType::BOOL_LIT: return "BOOL_LIT";
         case DbTokenType::NULL_LIT: return "NULL_LIT";
+        case DbTokenType::PARAM: return "PARAM";
         case DbTokenType::IDENTIFIER: return "IDENTIFIER";
         case DbTokenType::CREATE: return "CREATE";
         case DbTokenType::TABLE: return "TABLE";
@@ -126,6 +389,10 @@ std::string DbToken::typeToString() const {
         case DbTokenType::TO: return "TO";
         case DbTokenType::PRIVILEGES: return "PRIVILEGES";
         case DbTokenType::EXPLAIN: return "EXPLAIN";
+        case DbTokenType::PREPARE: return "PREPARE";
+        case DbTokenType::EXECUTE: return "EXECUTE";
+        case DbTokenType::DEALLOCATE: return "DEALLOCATE";
+        case DbTokenType::COPY: return "COPY";
         case DbTokenType::PLUS: return "PLUS";
         case DbTokenType::MINUS: return "MINUS";
         case DbTokenType::STAR: return "STAR";
@@ -151,169 +418,16 @@ std::string DbToken::typeToString() const {
     return "UNKNOWN";
 }
 
-DbLexer::DbLexer() : pos_(0), line_(1), col_(1) {
-    initKeywords();
-}
+DbLexer::DbLexer() : pos_(0), line_(1), col_(1) {}
 
-DbLexer::DbLexer(const std::string& source) : source_(source), pos_(0), line_(1), col_(1) {
-    initKeywords();
-}
+DbLexer::DbLexer(const std::string& source) : source_(source), pos_(0), line_(1), col_(1) {}
 
 void DbLexer::setSource(const std::string& source) {
     source_ = source;
     pos_ = 0;
     line_ = 1;
     col_ = 1;
-}
-
-void DbLexer::initKeywords() {
-    // DDL
-    keywords_["create"] = DbTokenType::CREATE;
-    keywords_["table"] = DbTokenType::TABLE;
-    keywords_["drop"] = DbTokenType::DROP;
-    keywords_["describe"] = DbTokenType::DESCRIBE;
-    keywords_["show"] = DbTokenType::SHOW;
-    keywords_["tables"] = DbTokenType::TABLES;
-    keywords_["index"] = DbTokenType::INDEX;
-    keywords_["unique"] = DbTokenType::UNIQUE;
-
-    // DML
-    keywords_["select"] = DbTokenType::SELECT;
-    keywords_["insert"] = DbTokenType::INSERT;
-    keywords_["into"] = DbTokenType::INTO;
-    keywords_["values"] = DbTokenType::VALUES;
-    keywords_["update"] = DbTokenType::UPDATE;
-    keywords_["set"] = DbTokenType::SET;
-    keywords_["delete"] = DbTokenType::DELETE_KW;
-    keywords_["from"] = DbTokenType::FROM;
-    keywords_["where"] = DbTokenType::WHERE;
-
-    // Joins
-    keywords_["join"] = DbTokenType::JOIN;
-    keywords_["inner"] = DbTokenType::INNER;
-    keywords_["left"] = DbTokenType::LEFT;
-    keywords_["right"] = DbTokenType::RIGHT;
-    keywords_["outer"] = DbTokenType::OUTER;
-    keywords_["cross"] = DbTokenType::CROSS;
-    keywords_["on"] = DbTokenType::ON;
-
-    // Clauses
-    keywords_["groupby"] = DbTokenType::GROUPBY;
-    keywords_["orderby"] = DbTokenType::ORDERBY;
-    keywords_["having"] = DbTokenType::HAVING;
-    keywords_["limit"] = DbTokenType::LIMIT;
-    keywords_["offset"] = DbTokenType::OFFSET;
-    keywords_["as"] = DbTokenType::AS;
-    keywords_["asc"] = DbTokenType::ASC;
-    keywords_["desc"] = DbTokenType::DESC;
-    keywords_["distinct"] = DbTokenType::DISTINCT;
-
-    // Logical
-    keywords_["and"] = DbTokenType::AND;
-    keywords_["or"] = DbTokenType::OR;
-    keywords_["not"] = DbTokenType::NOT;
-
-    // Predicates
-    keywords_["between"] = DbTokenType::BETWEEN;
-    keywords_["in"] = DbTokenType::IN;
-    keywords_["like"] = DbTokenType::LIKE;
-    keywords_["exists"] = DbTokenType::EXISTS;
-    keywords_["is"] = DbTokenType::IS;
-
-    // Set operations
-    keywords_["union"] = DbTokenType::UNION;
-    keywords_["intersect"] = DbTokenType::INTERSECT;
-    keywords_["except"] = DbTokenType::EXCEPT;
-
-    // Transaction
-    keywords_["begin"] = DbTokenType::BEGIN_KW;
-    keywords_["commit"] = DbTokenType::COMMIT;
-    keywords_["rollback"] = DbTokenType::ROLLBACK;
-
-    // Types
-    keywords_["int"] = DbTokenType::INT_TYPE;
-    keywords_["double"] = DbTokenType::DOUBLE_TYPE;
-    keywords_["string"] = DbTokenType::STRING_TYPE;
-    keywords_["bool"] = DbTokenType::BOOL_TYPE;
-
-    // Aggregates
-    keywords_["count"] = DbTokenType::COUNT;
-    keywords_["sum"] = DbTokenType::SUM;
-    keywords_["avg"] = DbTokenType::AVG;
-    keywords_["min"] = DbTokenType::MIN_FN;
-    keywords_["max"] = DbTokenType::MAX_FN;
-
-    // Boolean literals
-    keywords_["true"] = DbTokenType::BOOL_LIT;
-    keywords_["false"] = DbTokenType::BOOL_LIT;
-    keywords_["null"] = DbTokenType::NULL_LIT;
-
-    // Control flow (from original language)
-    keywords_["if"] = DbTokenType::IF;
-    keywords_["then"] = DbTokenType::THEN;
-    keywords_["else"] = DbTokenType::ELSE;
-    keywords_["fi"] = DbTokenType::FI;
-    keywords_["while"] = DbTokenType::WHILE;
-    keywords_["do"] = DbTokenType::DO;
-    keywords_["od"] = DbTokenType::OD;
-    keywords_["def"] = DbTokenType::DEF;
-    keywords_["fed"] = DbTokenType::FED;
-    keywords_["return"] = DbTokenType::RETURN;
-    keywords_["print"] = DbTokenType::PRINT;
-
-    // String functions
-    keywords_["upper"] = DbTokenType::UPPER;
-    keywords_["lower"] = DbTokenType::LOWER;
-    keywords_["length"] = DbTokenType::LENGTH;
-    keywords_["substr"] = DbTokenType::SUBSTR;
-    keywords_["concat"] = DbTokenType::CONCAT;
-    keywords_["trim"] = DbTokenType::TRIM;
-    keywords_["replace"] = DbTokenType::REPLACE;
-
-    // Utility functions
-    keywords_["coalesce"] = DbTokenType::COALESCE;
-    keywords_["nullif"] = DbTokenType::NULLIF;
-    keywords_["typeof"] = DbTokenType::TYPEOF;
-    keywords_["cast"] = DbTokenType::CAST;
-    keywords_["lpad"] = DbTokenType::LPAD;
-    keywords_["rpad"] = DbTokenType::RPAD;
-    keywords_["reverse"] = DbTokenType::REVERSE;
-    keywords_["repeat"] = DbTokenType::REPEAT_FN;
-    keywords_["power"] = DbTokenType::POWER;
-    keywords_["sqrt"] = DbTokenType::SQRT;
-    keywords_["log"] = DbTokenType::LOG_FN;
-    keywords_["pi"] = DbTokenType::PI_FN;
-    keywords_["random"] = DbTokenType::RANDOM;
-    keywords_["now"] = DbTokenType::NOW;
-    keywords_["iif"] = DbTokenType::IIF;
-
-    // CASE expression
-    keywords_["case"] = DbTokenType::CASE;
-    keywords_["when"] = DbTokenType::WHEN;
-    keywords_["end"] = DbTokenType::END_KW;
-
-    // Pipeline aliases
-    keywords_["take"] = DbTokenType::TAKE;
-    keywords_["skip"] = DbTokenType::SKIP_KW;
-    keywords_["map"] = DbTokenType::MAP;
-
-    // Persistence
-    keywords_["save"] = DbTokenType::SAVE;
-    keywords_["load"] = DbTokenType::LOAD;
-    keywords_["database"] = DbTokenType::DATABASE;
-
-    // Security
-    keywords_["user"] = DbTokenType::USER;
-    keywords_["password"] = DbTokenType::PASSWORD;
-    keywords_["grant"] = DbTokenType::GRANT_KW;
-    keywords_["revoke"] = DbTokenType::REVOKE_KW;
-    keywords_["login"] = DbTokenType::LOGIN;
-    keywords_["logout"] = DbTokenType::LOGOUT;
-    keywords_["to"] = DbTokenType::TO;
-    keywords_["privileges"] = DbTokenType::PRIVILEGES;
-
-    // Operational
-    keywords_["explain"] = DbTokenType::EXPLAIN;
+    text_.reset();
 }
 
 char DbLexer::peek() const {
@@ -340,7 +454,7 @@ bool DbLexer::isAtEnd() const {
 void DbLexer::skipWhitespace() {
     while (!isAtEnd()) {
         char c = peek();
-        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+        if (is(c, SPACE)) {
             advance();
         } else if (c == '/' && peekNext() == '/') {
             skipLineComment();
@@ -370,12 +484,14 @@ void DbLexer::skipBlockComment() {
     }
 }
 
-DbToken DbLexer::makeToken(DbTokenType type, const std::string& value) {
+DbToken DbLexer::makeToken(DbTokenType type, std::string_view value) {
     return DbToken(type, value, line_, col_);
 }
 
 std::vector<DbToken> DbLexer::tokenize() {
     std::vector<DbToken> tokens;
+    // Statements average well over four bytes per token
+    tokens.reserve(source_.size() / 4 + 1);
     while (!isAtEnd()) {
         skipWhitespace();
         if (isAtEnd()) break;
@@ -391,13 +507,13 @@ DbToken DbLexer::scanToken() {
     char c = peek();
 
     // Numbers
-    if (std::isdigit(c)) return scanNumber();
+    if (is(c, DIGIT)) return scanNumber();
 
     // Strings
     if (c == '"') return scanString();
 
     // Identifiers and keywords
-    if (std::isalpha(c) || c == '_') return scanIdentifierOrKeyword();
+    if (is(c, IDENT_START)) return scanIdentifierOrKeyword();
 
     // Pipeline operator |>
     if (c == '|' && peekNext() == '>') {
@@ -427,6 +543,14 @@ DbToken DbLexer::scanToken() {
         return makeToken(DbTokenType::NEQ, "!=");
     }
 
+    // Bind parameter $n
+    if (c == '$' && is(peekNext(), DIGIT)) {
+        advance(); // $
+        const size_t start = pos_;
+        skipWhile(DIGIT);
+        return makeToken(DbTokenType::PARAM, lexeme(start));
+    }
+
     // Single-character tokens
     advance();
     switch (c) {
@@ -443,41 +567,48 @@ DbToken DbLexer::scanToken() {
         case '[': return makeToken(DbTokenType::LBRACKET, "[");
         case ']': return makeToken(DbTokenType::RBRACKET, "]");
         default:
-            return makeToken(DbTokenType::ERROR_TOKEN, std::string(1, c));
+            return makeToken(DbTokenType::ERROR_TOKEN, lexeme(pos_ - 1));
     }
 }
 
 DbToken DbLexer::scanNumber() {
-    std::string num;
-    while (!isAtEnd() && std::isdigit(peek()))
-        num += advance();
+    const size_t start = pos_;
+    skipWhile(DIGIT);
 
     bool isDouble = false;
 
     // Decimal part
-    if (!isAtEnd() && peek() == '.' && std::isdigit(peekNext())) {
+    if (peek() == '.' && is(peekNext(), DIGIT)) {
         isDouble = true;
-        num += advance(); // .
-        while (!isAtEnd() && std::isdigit(peek()))
-            num += advance();
+        advance(); // .
+        skipWhile(DIGIT);
     }
 
     // Scientific notation
-    if (!isAtEnd() && (peek() == 'e' || peek() == 'E')) {
+    if (peek() == 'e' || peek() == 'E') {
         isDouble = true;
-        num += advance();
-        if (!isAtEnd() && (peek() == '+' || peek() == '-'))
-            num += advance();
-        while (!isAtEnd() && std::isdigit(peek()))
-            num += advance();
+        advance();
+        if (peek() == '+' || peek() == '-')
+            advance();
+        skipWhile(DIGIT);
     }
 
-    return makeToken(isDouble ? DbTokenType::DOUBLE_LIT : DbTokenType::INT_LIT, num);
+    return makeToken(isDouble ? DbTokenType::DOUBLE_LIT : DbTokenType::INT_LIT, lexeme(start));
 }
 
 DbToken DbLexer::scanString() {
     advance(); // opening "
-    std::string str;
+    const size_t start = pos_;
+    while (!isAtEnd() && peek() != '"' && peek() != '\\')
+        advance();
+    // Without escapes the text is a view of the source
+    if (isAtEnd() || peek() == '"') {
+        std::string_view text = lexeme(start);
+        if (!isAtEnd()) advance(); // closing "
+        return makeToken(DbTokenType::STRING_LIT, text);
+    }
+
+    std::string str(lexeme(start));
     while (!isAtEnd() && peek() != '"') {
         if (peek() == '\\') {
             advance();
@@ -495,29 +626,31 @@ DbToken DbLexer::scanString() {
         }
     }
     if (!isAtEnd()) advance(); // closing "
-    return makeToken(DbTokenType::STRING_LIT, str);
+    if (!text_) text_.reset(new Arena);
+    return makeToken(DbTokenType::STRING_LIT, text_->copy(str));
 }
 
 DbToken DbLexer::scanIdentifierOrKeyword() {
-    std::string id;
-    while (!isAtEnd() && (std::isalnum(peek()) || peek() == '_'))
-        id += advance();
-
-    // Check for keywords (case-insensitive)
-    std::string lower = id;
-    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-
-    auto it = keywords_.find(lower);
-    if (it != keywords_.end()) {
-        // Special handling for boolean and null literals
-        if (it->second == DbTokenType::BOOL_LIT)
-            return makeToken(DbTokenType::BOOL_LIT, lower);
-        if (it->second == DbTokenType::NULL_LIT)
-            return makeToken(DbTokenType::NULL_LIT, lower);
-        return makeToken(it->second, lower);
-    }
+    const size_t start = pos_;
+    skipWhile(IDENT);
+    const std::string_view id = lexeme(start);
+
+    // Keywords are case-insensitive; their tokens carry the lowercase
+    // spelling, which for true/false/null is the literal's text
+    if (const Keyword* keyword = findKeyword(id))
+        return makeToken(keyword->type, keyword->name);
 
     return makeToken(DbTokenType::IDENTIFIER, id);
 }
 
+// Skips a run of characters of class `cls`.  None of the classes scanned
+// this way include a newline, so the column advances by the run's length.
+void DbLexer::skipWhile(uint8_t cls) {
+    size_t end = pos_;
+    while (end < source_.size() && is(source_[end], static_cast<CharClass>(cls)))
+        end++;
+    col_ += static_cast<int>(end - pos_);
+    pos_ = end;
+}
+
 } // namespace epee
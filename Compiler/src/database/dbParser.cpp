@@ -6,20 +6,27 @@
 */
 
 #include "../../include/database/dbParser.hpp"
+#include "../../include/database/resultWriter.hpp"
+
+#include <cctype>
+#include <cstring>
 
 namespace epee {
 
 // ── Constructors & Setup ─────────────────────────────────────────────
 
-DbParser::DbParser() : pos_(0) {}
+DbParser::DbParser() : pos_(0), arena_(new Arena) {}
 
 DbParser::DbParser(const std::vector<DbToken>& tokens)
-    : tokens_(tokens), pos_(0) {}
+    : tokens_(tokens), pos_(0), arena_(new Arena) {}
 
 void DbParser::setTokens(const std::vector<DbToken>& tokens) {
     tokens_ = tokens;
     pos_ = 0;
+    arena_.reset(new Arena);
     errors_.clear();
+    literalNodes_.clear();
+    params_.clear();
 }
 
 // ── Token Navigation ─────────────────────────────────────────────────
@@ -45,14 +52,33 @@ bool DbParser::check(DbTokenType type) const {
     return peek().type == type;
 }
 
+bool DbParser::checkWord(const char* word) const {
+    if (!check(DbTokenType::IDENTIFIER)) return false;
+    const std::string_view text = peek().value;
+    const size_t n = std::strlen(word);
+    if (text.size() != n) return false;
+    for (size_t i = 0; i < n; i++)
+        if (std::tolower(static_cast<unsigned char>(text[i])) != word[i]) return false;
+    return true;
+}
+
+// ANALYZE [table];  -- anything else starting with the word is a statement
+// on a table or variable named `analyze`
+bool DbParser::atAnalyze() const {
+    return checkWord("analyze") &&
+           (peekNext().is(DbTokenType::SEMICOLON) ||
+            (peekNext().is(DbTokenType::IDENTIFIER) && pos_ + 2 < tokens_.size() &&
+             tokens_[pos_ + 2].is(DbTokenType::SEMICOLON)));
+}
+
 bool DbParser::match(DbTokenType type) {
     if (check(type)) { advance(); return true; }
     return false;
 }
 
-const DbToken& DbParser::expect(DbTokenType type, const std::string& msg) {
+const DbToken& DbParser::expect(DbTokenType type, const char* msg) {
     if (check(type)) return advance();
-    error(msg + " (got '" + peek().value + "' at line " +
+    error(std::string(msg) + " (got '" + peek().text() + "' at line " +
           std::to_string(peek().line) + ", col " +
           std::to_string(peek().col) + ")");
     // Return current token to allow continued parsing
@@ -123,11 +149,31 @@ StmtPtr DbParser::parseStatement() {
         case DbTokenType::LOGOUT:    return parseLogout();
         case DbTokenType::EXPLAIN: {
             advance(); // EXPLAIN
-            auto inner = parseStatement();
-            auto stmt = std::make_shared<ExplainStmt>();
-            stmt->innerStmt = inner;
+            auto stmt = node<ExplainStmt>();
+            // EXPLAIN ANALYZE [JSON] <statement>; `explain analyze t;` still
+            // explains the ANALYZE statement itself, and `explain analyze |> ...`
+            // a pipeline on a table named analyze
+            if (checkWord("analyze") && !peekNext().is(DbTokenType::PIPE)) {
+                if (!atAnalyze()) {
+                    advance(); // ANALYZE
+                    stmt->analyze = true;
+                    std::string word = peek().text();
+                    std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+                    if (check(DbTokenType::IDENTIFIER) && word == "json" &&
+                        !peekNext().is(DbTokenType::PIPE)) {
+                        advance(); // JSON
+                        stmt->json = true;
+                    }
+                }
+            }
+            stmt->innerStmt = parseStatement();
             return stmt;
         }
+        case DbTokenType::PREPARE:   return parsePrepare();
+        case DbTokenType::EXECUTE:   return parseExecute();
+        case DbTokenType::DEALLOCATE: return parseDeallocate();
+        case DbTokenType::COPY:      return parseCopy();
+        case DbTokenType::SET:       return parseSetOption();
         case DbTokenType::IF:        return parseIf();
         case DbTokenType::WHILE:     return parseWhile();
         case DbTokenType::DEF:       return parseFuncDef();
@@ -139,14 +185,16 @@ StmtPtr DbParser::parseStatement() {
         case DbTokenType::STRING_TYPE: return parseVarDecl(ValueType::STRING);
         case DbTokenType::BOOL_TYPE:   return parseVarDecl(ValueType::BOOL);
 
-        case DbTokenType::IDENTIFIER:  return parseAssignOrPipeline();
+        case DbTokenType::IDENTIFIER:
+            if (atAnalyze()) return parseAnalyze();
+            return parseAssignOrPipeline();
 
         case DbTokenType::SEMICOLON:
             advance(); // skip stray semicolons
             return parseStatement();
 
         default:
-            error("Unexpected token '" + peek().value + "' at line " +
+            error("Unexpected token '" + peek().text() + "' at line " +
                   std::to_string(peek().line));
             return nullptr;
     }
@@ -158,7 +206,7 @@ StmtPtr DbParser::parseCreateTable() {
     advance(); // CREATE
     expect(DbTokenType::TABLE, "Expected 'TABLE' after 'CREATE'");
 
-    auto stmt = std::make_shared<CreateTableStmt>();
+    auto stmt = node<CreateTableStmt>();
     stmt->tableName = expect(DbTokenType::IDENTIFIER, "Expected table name").value;
 
     expect(DbTokenType::LPAREN, "Expected '(' after table name");
@@ -188,6 +236,13 @@ StmtPtr DbParser::parseCreateTable() {
                 col.unique = true;
                 continue;
             }
+            if (check(DbTokenType::IDENTIFIER) && peek().value == "dictionary") {
+                advance();
+                if (col.type != ValueType::STRING)
+                    error("'dictionary' applies only to string columns");
+                col.dictionary = true;
+                continue;
+            }
             if (check(DbTokenType::NOT)) {
                 advance();
                 if (check(DbTokenType::NULL_LIT)) {
@@ -215,7 +270,7 @@ StmtPtr DbParser::parseDropTable() {
     advance(); // DROP
     expect(DbTokenType::TABLE, "Expected 'TABLE' after 'DROP'");
 
-    auto stmt = std::make_shared<DropTableStmt>();
+    auto stmt = node<DropTableStmt>();
     stmt->tableName = expect(DbTokenType::IDENTIFIER, "Expected table name").value;
     expect(DbTokenType::SEMICOLON, "Expected ';' after DROP TABLE");
     return stmt;
@@ -227,7 +282,7 @@ StmtPtr DbParser::parseInsert() {
     advance(); // INSERT
     expect(DbTokenType::INTO, "Expected 'INTO' after 'INSERT'");
 
-    auto stmt = std::make_shared<InsertStmt>();
+    auto stmt = node<InsertStmt>();
     stmt->tableName = expect(DbTokenType::IDENTIFIER, "Expected table name").value;
 
     // Optional column list: INSERT INTO t (c1, c2)
@@ -235,7 +290,7 @@ StmtPtr DbParser::parseInsert() {
         advance();
         do {
             stmt->columns.push_back(
-                expect(DbTokenType::IDENTIFIER, "Expected column name").value);
+                expect(DbTokenType::IDENTIFIER, "Expected column name").text());
         } while (match(DbTokenType::COMMA));
         expect(DbTokenType::RPAREN, "Expected ')' after column list");
     }
@@ -261,7 +316,7 @@ StmtPtr DbParser::parseInsert() {
 
 StmtPtr DbParser::parseSelect() {
     advance(); // SELECT
-    auto stmt = std::make_shared<SelectStmt>();
+    auto stmt = node<SelectStmt>();
 
     // DISTINCT
     if (check(DbTokenType::DISTINCT)) {
@@ -340,7 +395,7 @@ StmtPtr DbParser::parseSelect() {
     if (check(DbTokenType::LIMIT)) {
         advance();
         const auto& tok = expect(DbTokenType::INT_LIT, "Expected integer after LIMIT");
-        try { stmt->limit = std::stoi(tok.value); }
+        try { stmt->limit = std::stoi(tok.text()); }
         catch (...) { error("Invalid LIMIT value"); }
     }
 
@@ -348,7 +403,7 @@ StmtPtr DbParser::parseSelect() {
     if (check(DbTokenType::OFFSET)) {
         advance();
         const auto& tok = expect(DbTokenType::INT_LIT, "Expected integer after OFFSET");
-        try { stmt->offset = std::stoi(tok.value); }
+        try { stmt->offset = std::stoi(tok.text()); }
         catch (...) { error("Invalid OFFSET value"); }
     }
 
@@ -360,13 +415,13 @@ StmtPtr DbParser::parseSelect() {
 
 StmtPtr DbParser::parseUpdate() {
     advance(); // UPDATE
-    auto stmt = std::make_shared<UpdateStmt>();
+    auto stmt = node<UpdateStmt>();
     stmt->tableName = expect(DbTokenType::IDENTIFIER, "Expected table name").value;
 
     expect(DbTokenType::SET, "Expected 'SET'");
 
     do {
-        std::string col = expect(DbTokenType::IDENTIFIER, "Expected column name").value;
+        std::string col = expect(DbTokenType::IDENTIFIER, "Expected column name").text();
         expect(DbTokenType::EQ, "Expected '=' in SET clause");
         auto val = parseExpression();
         stmt->assignments.push_back({col, val});
@@ -387,7 +442,7 @@ StmtPtr DbParser::parseDelete() {
     advance(); // DELETE
     expect(DbTokenType::FROM, "Expected 'FROM' after 'DELETE'");
 
-    auto stmt = std::make_shared<DeleteStmt>();
+    auto stmt = node<DeleteStmt>();
     stmt->tableName = expect(DbTokenType::IDENTIFIER, "Expected table name").value;
 
     if (check(DbTokenType::WHERE)) {
@@ -402,11 +457,13 @@ StmtPtr DbParser::parseDelete() {
 // ── Pipeline ─────────────────────────────────────────────────────────
 
 StmtPtr DbParser::parsePipeline(const std::string& tableName) {
-    auto stmt = std::make_shared<PipelineStmt>();
+    auto stmt = node<PipelineStmt>();
     stmt->tableName = tableName;
 
     while (check(DbTokenType::PIPE)) {
         advance(); // |>
+        if (!stmt->stages.empty() && stmt->stages.back().type == PipelineStage::Type::EXPORT)
+            error("export must be the last pipeline stage");
         stmt->stages.push_back(parsePipelineStage());
     }
 
@@ -417,6 +474,8 @@ StmtPtr DbParser::parsePipeline(const std::string& tableName) {
 PipelineStage DbParser::parsePipelineStage() {
     PipelineStage stage;
     const auto& tok = peek();
+    std::string word = tok.text();
+    std::transform(word.begin(), word.end(), word.begin(), ::tolower);
 
     if (tok.type == DbTokenType::WHERE) {
         advance();
@@ -450,7 +509,7 @@ PipelineStage DbParser::parsePipelineStage() {
         expect(DbTokenType::LPAREN, "Expected '(' after 'limit'");
         stage.type = PipelineStage::Type::LIMIT;
         const auto& val = expect(DbTokenType::INT_LIT, "Expected integer for limit");
-        try { stage.limitCount = std::stoi(val.value); }
+        try { stage.limitCount = std::stoi(val.text()); }
         catch (...) { error("Invalid limit value"); }
         expect(DbTokenType::RPAREN, "Expected ')' after limit value");
     }
@@ -459,7 +518,7 @@ PipelineStage DbParser::parsePipelineStage() {
         expect(DbTokenType::LPAREN, "Expected '(' after 'offset'");
         stage.type = PipelineStage::Type::OFFSET;
         const auto& val = expect(DbTokenType::INT_LIT, "Expected integer for offset");
-        try { stage.offsetCount = std::stoi(val.value); }
+        try { stage.offsetCount = std::stoi(val.text()); }
         catch (...) { error("Invalid offset value"); }
         expect(DbTokenType::RPAREN, "Expected ')' after offset value");
     }
@@ -495,7 +554,7 @@ PipelineStage DbParser::parsePipelineStage() {
         expect(DbTokenType::LPAREN, "Expected '(' after 'update'");
         stage.type = PipelineStage::Type::UPDATE;
         do {
-            std::string col = expect(DbTokenType::IDENTIFIER, "Expected column name").value;
+            std::string col = expect(DbTokenType::IDENTIFIER, "Expected column name").text();
             expect(DbTokenType::EQ, "Expected '=' in update");
             auto val = parseExpression();
             stage.assignments.push_back({col, val});
@@ -523,7 +582,7 @@ PipelineStage DbParser::parsePipelineStage() {
         expect(DbTokenType::LPAREN, "Expected '(' after 'take'");
         stage.type = PipelineStage::Type::TAKE;
         const auto& val = expect(DbTokenType::INT_LIT, "Expected integer for take");
-        try { stage.limitCount = std::stoi(val.value); }
+        try { stage.limitCount = std::stoi(val.text()); }
         catch (...) { error("Invalid take value"); }
         expect(DbTokenType::RPAREN, "Expected ')' after take value");
     }
@@ -532,10 +591,25 @@ PipelineStage DbParser::parsePipelineStage() {
         expect(DbTokenType::LPAREN, "Expected '(' after 'skip'");
         stage.type = PipelineStage::Type::SKIP_STAGE;
         const auto& val = expect(DbTokenType::INT_LIT, "Expected integer for skip");
-        try { stage.offsetCount = std::stoi(val.value); }
+        try { stage.offsetCount = std::stoi(val.text()); }
         catch (...) { error("Invalid skip value"); }
         expect(DbTokenType::RPAREN, "Expected ')' after skip value");
     }
+    else if (tok.type == DbTokenType::IDENTIFIER && word == "export") {
+        // export("file" [, format]) -- not a reserved word outside pipelines
+        advance();
+        expect(DbTokenType::LPAREN, "Expected '(' after 'export'");
+        stage.type = PipelineStage::Type::EXPORT;
+        stage.exportPath = expect(DbTokenType::STRING_LIT, "Expected file path string").value;
+        if (match(DbTokenType::COMMA)) {
+            if (check(DbTokenType::IDENTIFIER) || check(DbTokenType::STRING_LIT))
+                stage.exportFormat = advance().value;
+            OutputFormat format;
+            if (!parseOutputFormat(stage.exportFormat, format) || format == OutputFormat::PRETTY)
+                error("Unknown export format '" + stage.exportFormat + "'");
+        }
+        expect(DbTokenType::RPAREN, "Expected ')' after export");
+    }
     else if (tok.type == DbTokenType::MAP) {
         advance();
         expect(DbTokenType::LPAREN, "Expected '(' after 'map'");
@@ -544,7 +618,7 @@ PipelineStage DbParser::parsePipelineStage() {
         expect(DbTokenType::RPAREN, "Expected ')' after map columns");
     }
     else {
-        error("Unknown pipeline stage '" + tok.value + "'");
+        error("Unknown pipeline stage '" + tok.text() + "'");
         advance();
         stage.type = PipelineStage::Type::PRINT;  // fallback
     }
@@ -557,19 +631,19 @@ PipelineStage DbParser::parsePipelineStage() {
 StmtPtr DbParser::parseBegin() {
     advance(); // BEGIN
     expect(DbTokenType::SEMICOLON, "Expected ';' after BEGIN");
-    return std::make_shared<BeginStmt>();
+    return node<BeginStmt>();
 }
 
 StmtPtr DbParser::parseCommit() {
     advance(); // COMMIT
     expect(DbTokenType::SEMICOLON, "Expected ';' after COMMIT");
-    return std::make_shared<CommitStmt>();
+    return node<CommitStmt>();
 }
 
 StmtPtr DbParser::parseRollback() {
     advance(); // ROLLBACK
     expect(DbTokenType::SEMICOLON, "Expected ';' after ROLLBACK");
-    return std::make_shared<RollbackStmt>();
+    return node<RollbackStmt>();
 }
 
 // ── SHOW TABLES / DESCRIBE ───────────────────────────────────────────
@@ -580,7 +654,7 @@ StmtPtr DbParser::parseShowTables() {
         advance(); // USER (SHOW USERS)
         // Accept optional 's' by checking if next is IDENTIFIER "s" -- skip it
         expect(DbTokenType::SEMICOLON, "Expected ';' after SHOW USERS");
-        return std::make_shared<ShowUsersStmt>();
+        return node<ShowUsersStmt>();
     }
     if (check(DbTokenType::GRANT_KW)) {
         advance(); // GRANT (SHOW GRANTS)
@@ -589,23 +663,130 @@ StmtPtr DbParser::parseShowTables() {
         // "for" is not a keyword, accept any identifier
         auto& tok = peek();
         if (tok.type == DbTokenType::IDENTIFIER) {
-            std::string val = tok.value;
+            std::string val = tok.text();
             std::transform(val.begin(), val.end(), val.begin(), ::tolower);
             if (val == "for") advance(); // skip FOR
         }
-        auto stmt = std::make_shared<ShowGrantsStmt>();
+        auto stmt = node<ShowGrantsStmt>();
         stmt->userName = expect(DbTokenType::IDENTIFIER, "Expected username").value;
         expect(DbTokenType::SEMICOLON, "Expected ';' after SHOW GRANTS");
         return stmt;
     }
-    expect(DbTokenType::TABLES, "Expected 'TABLES', 'USERS', or 'GRANTS' after 'SHOW'");
+    if (check(DbTokenType::IDENTIFIER)) {
+        // "stats" is not a keyword either
+        std::string val = peek().text();
+        std::transform(val.begin(), val.end(), val.begin(), ::tolower);
+        if (val == "stats") {
+            advance(); // STATS
+            auto stmt = node<ShowStatsStmt>();
+            if (check(DbTokenType::IDENTIFIER)) stmt->tableName = advance().value;
+            expect(DbTokenType::SEMICOLON, "Expected ';' after SHOW STATS");
+            return stmt;
+        }
+    }
+    expect(DbTokenType::TABLES, "Expected 'TABLES', 'USERS', 'GRANTS', or 'STATS' after 'SHOW'");
     expect(DbTokenType::SEMICOLON, "Expected ';' after SHOW TABLES");
-    return std::make_shared<ShowTablesStmt>();
+    return node<ShowTablesStmt>();
+}
+
+StmtPtr DbParser::parseAnalyze() {
+    advance(); // ANALYZE
+    auto stmt = node<AnalyzeStmt>();
+    if (check(DbTokenType::IDENTIFIER)) stmt->tableName = advance().value;
+    expect(DbTokenType::SEMICOLON, "Expected ';' after ANALYZE");
+    return stmt;
+}
+
+StmtPtr DbParser::parsePrepare() {
+    advance(); // PREPARE
+    auto stmt = node<PrepareStmt>();
+    stmt->name = expect(DbTokenType::IDENTIFIER, "Expected statement name after PREPARE").value;
+    expect(DbTokenType::AS, "Expected AS after prepared statement name");
+    if (allowParams_) {
+        error("PREPARE cannot be nested");
+        return stmt;
+    }
+
+    allowParams_ = true;
+    params_.clear();
+    stmt->statement = parseStatement();
+    stmt->params = std::move(params_);
+    params_.clear();
+    allowParams_ = false;
+    return stmt;
+}
+
+StmtPtr DbParser::parseExecute() {
+    advance(); // EXECUTE
+    auto stmt = node<ExecuteStmt>();
+    stmt->name = expect(DbTokenType::IDENTIFIER, "Expected statement name after EXECUTE").value;
+    if (match(DbTokenType::LPAREN)) {
+        if (!check(DbTokenType::RPAREN)) stmt->args = parseExpressionList();
+        expect(DbTokenType::RPAREN, "Expected ')' after EXECUTE arguments");
+    }
+    expect(DbTokenType::SEMICOLON, "Expected ';' after EXECUTE");
+    return stmt;
+}
+
+StmtPtr DbParser::parseDeallocate() {
+    advance(); // DEALLOCATE
+    auto stmt = node<DeallocateStmt>();
+    stmt->name = expect(DbTokenType::IDENTIFIER, "Expected statement name after DEALLOCATE").value;
+    expect(DbTokenType::SEMICOLON, "Expected ';' after DEALLOCATE");
+    return stmt;
+}
+
+StmtPtr DbParser::parseCopy() {
+    advance(); // COPY
+    auto stmt = node<CopyStmt>();
+    stmt->tableName = expect(DbTokenType::IDENTIFIER, "Expected table name after COPY").value;
+    expect(DbTokenType::FROM, "Expected FROM after COPY table name");
+    stmt->path = expect(DbTokenType::STRING_LIT, "Expected file path string").value;
+
+    // DELIMITER and HEADER are options only here, not reserved words
+    while (check(DbTokenType::IDENTIFIER)) {
+        std::string option = peek().text();
+        std::transform(option.begin(), option.end(), option.begin(), ::tolower);
+        if (option == "header") {
+            advance();
+            stmt->header = true;
+        } else if (option == "delimiter") {
+            advance();
+            std::string delim = expect(DbTokenType::STRING_LIT, "Expected delimiter string").text();
+            if (delim.size() != 1) error("Delimiter must be a single character");
+            else stmt->delimiter = delim[0];
+        } else {
+            break;
+        }
+    }
+    expect(DbTokenType::SEMICOLON, "Expected ';' after COPY");
+    return stmt;
+}
+
+// The value is a word (on, off, true, ...) or a string; the executor
+// decides what each option accepts
+StmtPtr DbParser::parseSetOption() {
+    advance(); // SET
+    auto stmt = node<SetOptionStmt>();
+    stmt->option = expect(DbTokenType::IDENTIFIER, "Expected option name after SET").text();
+    std::transform(stmt->option.begin(), stmt->option.end(), stmt->option.begin(), ::tolower);
+    expect(DbTokenType::EQ, "Expected '=' after option name");
+    if (check(DbTokenType::STRING_LIT)) {
+        stmt->value = advance().text();
+        stmt->quoted = true;
+    } else if (check(DbTokenType::IDENTIFIER) || check(DbTokenType::BOOL_LIT) || check(DbTokenType::ON)) {
+        stmt->value = advance().text();
+        std::transform(stmt->value.begin(), stmt->value.end(), stmt->value.begin(), ::tolower);
+    } else {
+        error("Expected a value for option '" + stmt->option + "'");
+    }
+    expect(DbTokenType::SEMICOLON, "Expected ';' after SET");
+    return stmt;
 }
 
 StmtPtr DbParser::parseDescribe() {
     advance(); // DESCRIBE
-    auto stmt = std::make_shared<DescribeStmt>();
+    auto stmt = node<DescribeStmt>();
     stmt->tableName = expect(DbTokenType::IDENTIFIER, "Expected table name").value;
     expect(DbTokenType::SEMICOLON, "Expected ';' after DESCRIBE");
     return stmt;
@@ -615,7 +796,7 @@ StmtPtr DbParser::parseDescribe() {
 
 StmtPtr DbParser::parsePrint() {
     advance(); // PRINT
-    auto stmt = std::make_shared<PrintStmt>();
+    auto stmt = node<PrintStmt>();
     stmt->expr = parseExpression();
     expect(DbTokenType::SEMICOLON, "Expected ';' after PRINT");
     return stmt;
@@ -624,7 +805,7 @@ StmtPtr DbParser::parsePrint() {
 StmtPtr DbParser::parseSaveDatabase() {
     advance(); // SAVE
     expect(DbTokenType::DATABASE, "Expected 'DATABASE' after 'SAVE'");
-    auto stmt = std::make_shared<SaveDatabaseStmt>();
+    auto stmt = node<SaveDatabaseStmt>();
     stmt->filepath = expect(DbTokenType::STRING_LIT, "Expected file path string").value;
     expect(DbTokenType::SEMICOLON, "Expected ';' after SAVE DATABASE");
     return stmt;
@@ -633,7 +814,7 @@ StmtPtr DbParser::parseSaveDatabase() {
 StmtPtr DbParser::parseLoadDatabase() {
     advance(); // LOAD
     expect(DbTokenType::DATABASE, "Expected 'DATABASE' after 'LOAD'");
-    auto stmt = std::make_shared<LoadDatabaseStmt>();
+    auto stmt = node<LoadDatabaseStmt>();
     stmt->filepath = expect(DbTokenType::STRING_LIT, "Expected file path string").value;
     expect(DbTokenType::SEMICOLON, "Expected ';' after LOAD DATABASE");
     return stmt;
@@ -643,12 +824,12 @@ StmtPtr DbParser::parseLoadDatabase() {
 
 StmtPtr DbParser::parseVarDecl(ValueType type) {
     advance(); // type keyword
-    auto stmt = std::make_shared<VarDeclStmt>();
+    auto stmt = node<VarDeclStmt>();
     stmt->type = type;
 
     do {
         stmt->names.push_back(
-            expect(DbTokenType::IDENTIFIER, "Expected variable name").value);
+            expect(DbTokenType::IDENTIFIER, "Expected variable name").text());
     } while (match(DbTokenType::COMMA));
 
     expect(DbTokenType::SEMICOLON, "Expected ';' after variable declaration");
@@ -658,13 +839,13 @@ StmtPtr DbParser::parseVarDecl(ValueType type) {
 // ── Assignment or Pipeline ───────────────────────────────────────────
 
 StmtPtr DbParser::parseAssignOrPipeline() {
-    std::string name = peek().value;
+    std::string name = peek().text();
     advance(); // identifier
 
     // Assignment: x = expr;
     if (check(DbTokenType::EQ)) {
         advance(); // =
-        auto stmt = std::make_shared<AssignStmt>();
+        auto stmt = node<AssignStmt>();
         stmt->varName = name;
         stmt->value = parseExpression();
         expect(DbTokenType::SEMICOLON, "Expected ';' after assignment");
@@ -679,7 +860,7 @@ StmtPtr DbParser::parseAssignOrPipeline() {
     // Function call: name(args);
     if (check(DbTokenType::LPAREN)) {
         advance(); // (
-        auto stmt = std::make_shared<FuncCallStmt>();
+        auto stmt = node<FuncCallStmt>();
         stmt->name = name;
         if (!check(DbTokenType::RPAREN)) {
             do {
@@ -699,7 +880,7 @@ StmtPtr DbParser::parseAssignOrPipeline() {
 
 StmtPtr DbParser::parseIf() {
     advance(); // IF
-    auto stmt = std::make_shared<IfStmt>();
+    auto stmt = node<IfStmt>();
 
     expect(DbTokenType::LPAREN, "Expected '(' after 'if'");
     stmt->condition = parseExpression();
@@ -723,7 +904,7 @@ StmtPtr DbParser::parseIf() {
 
 StmtPtr DbParser::parseWhile() {
     advance(); // WHILE
-    auto stmt = std::make_shared<WhileStmt>();
+    auto stmt = node<WhileStmt>();
 
     expect(DbTokenType::LPAREN, "Expected '(' after 'while'");
     stmt->condition = parseExpression();
@@ -741,7 +922,7 @@ StmtPtr DbParser::parseWhile() {
 
 StmtPtr DbParser::parseFuncDef() {
     advance(); // DEF
-    auto stmt = std::make_shared<FuncDefStmt>();
+    auto stmt = node<FuncDefStmt>();
 
     stmt->returnType = parseType();
     stmt->name = expect(DbTokenType::IDENTIFIER, "Expected function name").value;
@@ -750,7 +931,7 @@ StmtPtr DbParser::parseFuncDef() {
     if (!check(DbTokenType::RPAREN)) {
         do {
             ValueType ptype = parseType();
-            std::string pname = expect(DbTokenType::IDENTIFIER, "Expected parameter name").value;
+            std::string pname = expect(DbTokenType::IDENTIFIER, "Expected parameter name").text();
             stmt->params.push_back({ptype, pname});
         } while (match(DbTokenType::COMMA));
     }
@@ -767,7 +948,7 @@ StmtPtr DbParser::parseFuncDef() {
 
 StmtPtr DbParser::parseReturn() {
     advance(); // RETURN
-    auto stmt = std::make_shared<ReturnStmt>();
+    auto stmt = node<ReturnStmt>();
 
     expect(DbTokenType::LPAREN, "Expected '(' after 'return'");
     stmt->value = parseExpression();
@@ -824,8 +1005,8 @@ ExprPtr DbParser::parseExpression() {
     // Handle alias: expr AS name
     if (check(DbTokenType::AS)) {
         advance();
-        std::string alias = expect(DbTokenType::IDENTIFIER, "Expected alias name").value;
-        return std::make_shared<AliasExpr>(expr, alias);
+        std::string alias = expect(DbTokenType::IDENTIFIER, "Expected alias name").text();
+        return node<AliasExpr>(expr, alias);
     }
 
     return expr;
@@ -838,7 +1019,7 @@ ExprPtr DbParser::parseOrExpr() {
     while (check(DbTokenType::OR)) {
         advance();
         auto right = parseAndExpr();
-        left = std::make_shared<BinaryExpr>(left, "or", right);
+        left = node<BinaryExpr>(left, "or", right);
     }
     return left;
 }
@@ -850,7 +1031,7 @@ ExprPtr DbParser::parseAndExpr() {
     while (check(DbTokenType::AND)) {
         advance();
         auto right = parseNotExpr();
-        left = std::make_shared<BinaryExpr>(left, "and", right);
+        left = node<BinaryExpr>(left, "and", right);
     }
     return left;
 }
@@ -861,7 +1042,7 @@ ExprPtr DbParser::parseNotExpr() {
     if (check(DbTokenType::NOT)) {
         advance();
         auto operand = parseNotExpr();
-        return std::make_shared<UnaryExpr>("not", operand);
+        return node<UnaryExpr>("not", operand);
     }
     return parseComparisonExpr();
 }
@@ -877,7 +1058,7 @@ ExprPtr DbParser::parseComparisonExpr() {
         auto low = parseAddExpr();
         expect(DbTokenType::AND, "Expected 'AND' in BETWEEN");
         auto high = parseAddExpr();
-        return std::make_shared<BetweenExpr>(left, low, high, false);
+        return node<BetweenExpr>(left, low, high, false);
     }
 
     // NOT BETWEEN / NOT IN / NOT LIKE
@@ -890,7 +1071,7 @@ ExprPtr DbParser::parseComparisonExpr() {
             auto low = parseAddExpr();
             expect(DbTokenType::AND, "Expected 'AND' in NOT BETWEEN");
             auto high = parseAddExpr();
-            return std::make_shared<BetweenExpr>(left, low, high, true);
+            return node<BetweenExpr>(left, low, high, true);
         }
         if (check(DbTokenType::IN)) {
             advance();
@@ -900,12 +1081,12 @@ ExprPtr DbParser::parseComparisonExpr() {
                 vals.push_back(parseExpression());
             } while (match(DbTokenType::COMMA));
             expect(DbTokenType::RPAREN, "Expected ')' after NOT IN list");
-            return std::make_shared<InExpr>(left, std::move(vals), true);
+            return node<InExpr>(left, std::move(vals), true);
         }
         if (check(DbTokenType::LIKE)) {
             advance();
-            std::string pattern = expect(DbTokenType::STRING_LIT, "Expected pattern string").value;
-            return std::make_shared<LikeExpr>(left, pattern, true);
+            std::string pattern = expect(DbTokenType::STRING_LIT, "Expected pattern string").text();
+            return node<LikeExpr>(left, pattern, true);
         }
 
         // Not a postfix NOT — backtrack
@@ -921,14 +1102,14 @@ ExprPtr DbParser::parseComparisonExpr() {
             vals.push_back(parseExpression());
         } while (match(DbTokenType::COMMA));
         expect(DbTokenType::RPAREN, "Expected ')' after IN list");
-        return std::make_shared<InExpr>(left, std::move(vals), false);
+        return node<InExpr>(left, std::move(vals), false);
     }
 
     // LIKE
     if (check(DbTokenType::LIKE)) {
         advance();
-        std::string pattern = expect(DbTokenType::STRING_LIT, "Expected pattern string").value;
-        return std::make_shared<LikeExpr>(left, pattern, false);
+        std::string pattern = expect(DbTokenType::STRING_LIT, "Expected pattern string").text();
+        return node<LikeExpr>(left, pattern, false);
     }
 
     // IS [NOT] NULL
@@ -940,7 +1121,7 @@ ExprPtr DbParser::parseComparisonExpr() {
             isNot = true;
         }
         expect(DbTokenType::NULL_LIT, "Expected 'null' after IS");
-        return std::make_shared<IsNullExpr>(left, isNot);
+        return node<IsNullExpr>(left, isNot);
     }
 
     // Standard comparison operators
@@ -955,7 +1136,7 @@ ExprPtr DbParser::parseComparisonExpr() {
         else break;
 
         auto right = parseAddExpr();
-        left = std::make_shared<BinaryExpr>(left, op, right);
+        left = node<BinaryExpr>(left, op, right);
     }
 
     return left;
@@ -969,7 +1150,7 @@ ExprPtr DbParser::parseAddExpr() {
         std::string op = check(DbTokenType::PLUS) ? "+" : "-";
         advance();
         auto right = parseMulExpr();
-        left = std::make_shared<BinaryExpr>(left, op, right);
+        left = node<BinaryExpr>(left, op, right);
     }
     return left;
 }
@@ -986,7 +1167,7 @@ ExprPtr DbParser::parseMulExpr() {
         else                                   op = "%";
         advance();
         auto right = parseUnaryExpr();
-        left = std::make_shared<BinaryExpr>(left, op, right);
+        left = node<BinaryExpr>(left, op, right);
     }
     return left;
 }
@@ -997,58 +1178,80 @@ ExprPtr DbParser::parseUnaryExpr() {
     if (check(DbTokenType::MINUS)) {
         advance();
         auto operand = parseUnaryExpr();
-        return std::make_shared<UnaryExpr>("-", operand);
+        return node<UnaryExpr>("-", operand);
     }
     return parsePrimaryExpr();
 }
 
 // ── Primary Expressions ──────────────────────────────────────────────
 
+ExprPtr DbParser::makeLiteral(const Value& value) {
+    auto lit = node<LiteralExpr>(value);
+    if (literalNodes_.size() < tokens_.size()) literalNodes_.resize(tokens_.size());
+    literalNodes_[pos_ - 1] = lit;
+    return lit;
+}
+
 ExprPtr DbParser::parsePrimaryExpr() {
     const auto& tok = peek();
 
     // Integer literal
     if (tok.type == DbTokenType::INT_LIT) {
         advance();
-        try { return std::make_shared<LiteralExpr>(Value(std::stoi(tok.value))); }
+        try { return makeLiteral(Value(std::stoi(tok.text()))); }
         catch (...) {
-            error("Invalid integer literal: " + tok.value);
-            return std::make_shared<LiteralExpr>(Value(0));
+            error("Invalid integer literal: " + tok.text());
+            return node<LiteralExpr>(Value(0));
         }
     }
 
     // Double literal
     if (tok.type == DbTokenType::DOUBLE_LIT) {
         advance();
-        try { return std::make_shared<LiteralExpr>(Value(std::stod(tok.value))); }
+        try { return makeLiteral(Value(std::stod(tok.text()))); }
         catch (...) {
-            error("Invalid double literal: " + tok.value);
-            return std::make_shared<LiteralExpr>(Value(0.0));
+            error("Invalid double literal: " + tok.text());
+            return node<LiteralExpr>(Value(0.0));
         }
     }
 
     // String literal
     if (tok.type == DbTokenType::STRING_LIT) {
         advance();
-        return std::make_shared<LiteralExpr>(Value(tok.value));
+        return makeLiteral(Value(tok.value));
     }
 
     // Bool literal
     if (tok.type == DbTokenType::BOOL_LIT) {
         advance();
-        return std::make_shared<LiteralExpr>(Value(tok.value == "true"));
+        return node<LiteralExpr>(Value(tok.value == "true"));
     }
 
     // Null literal
     if (tok.type == DbTokenType::NULL_LIT) {
         advance();
-        return std::make_shared<LiteralExpr>(Value::null());
+        return node<LiteralExpr>(Value::null());
+    }
+
+    // Bind parameter
+    if (tok.type == DbTokenType::PARAM) {
+        advance();
+        size_t index = 0;
+        try { index = std::stoul(tok.text()); } catch (...) {}
+        if (index == 0) {
+            error("Invalid parameter $" + tok.text());
+        } else if (!allowParams_) {
+            error("Parameter $" + tok.text() + " is only allowed in a prepared statement");
+        }
+        auto param = node<ParamExpr>(index);
+        params_.push_back(param);
+        return param;
     }
 
     // Star: *
     if (tok.type == DbTokenType::STAR) {
         advance();
-        return std::make_shared<StarExpr>();
+        return node<StarExpr>();
     }
 
     // Parenthesized expression
@@ -1087,7 +1290,7 @@ ExprPtr DbParser::parsePrimaryExpr() {
     // CASE WHEN ... THEN ... [ELSE ...] END
     if (tok.type == DbTokenType::CASE) {
         advance(); // consume CASE
-        auto caseExpr = std::make_shared<CaseExpr>();
+        auto caseExpr = node<CaseExpr>();
         while (check(DbTokenType::WHEN)) {
             advance(); // consume WHEN
             auto cond = parseExpression();
@@ -1115,17 +1318,17 @@ ExprPtr DbParser::parsePrimaryExpr() {
         return parseColumnOrFunction();
     }
 
-    error("Unexpected token in expression: '" + tok.value + "' at line " +
+    error("Unexpected token in expression: '" + tok.text() + "' at line " +
           std::to_string(tok.line));
     advance();
-    return std::make_shared<LiteralExpr>(Value::null());
+    return node<LiteralExpr>(Value::null());
 }
 
 // ── Column Reference or Function Call ────────────────────────────────
 
 ExprPtr DbParser::parseColumnOrFunction() {
     const auto& tok = peek();
-    std::string name = tok.value;
+    std::string name = tok.text();
     advance();
 
     // Function call: name(args) — works for identifiers and keyword-named functions
@@ -1135,7 +1338,7 @@ ExprPtr DbParser::parseColumnOrFunction() {
 
         // count(*) special case
         if (check(DbTokenType::STAR)) {
-            args.push_back(std::make_shared<StarExpr>());
+            args.push_back(node<StarExpr>());
             advance();
         } else if (!check(DbTokenType::RPAREN)) {
             do {
@@ -1144,18 +1347,18 @@ ExprPtr DbParser::parseColumnOrFunction() {
         }
 
         expect(DbTokenType::RPAREN, "Expected ')' after function arguments");
-        return std::make_shared<FunctionCallExpr>(name, std::move(args));
+        return node<FunctionCallExpr>(name, std::move(args));
     }
 
     // table.column: identifier DOT identifier
     if (tok.type == DbTokenType::IDENTIFIER && check(DbTokenType::DOT)) {
         advance(); // .
-        std::string col = expect(DbTokenType::IDENTIFIER, "Expected column name after '.'").value;
-        return std::make_shared<ColumnExpr>(name, col);
+        std::string col = expect(DbTokenType::IDENTIFIER, "Expected column name after '.'").text();
+        return node<ColumnExpr>(name, col);
     }
 
     // Simple column reference
-    return std::make_shared<ColumnExpr>(name);
+    return node<ColumnExpr>(name);
 }
 
 // ── CREATE INDEX ─────────────────────────────────────────────────────
@@ -1165,7 +1368,7 @@ StmtPtr DbParser::parseCreateIndex(bool unique) {
     if (unique) advance(); // UNIQUE
     advance(); // INDEX
 
-    auto stmt = std::make_shared<CreateIndexStmt>();
+    auto stmt = node<CreateIndexStmt>();
     stmt->unique = unique;
     stmt->indexName = expect(DbTokenType::IDENTIFIER, "Expected index name").value;
     expect(DbTokenType::ON, "Expected 'ON' after index name");
@@ -1181,7 +1384,7 @@ StmtPtr DbParser::parseDropIndex() {
     advance(); // DROP
     advance(); // INDEX
 
-    auto stmt = std::make_shared<DropIndexStmt>();
+    auto stmt = node<DropIndexStmt>();
     stmt->indexName = expect(DbTokenType::IDENTIFIER, "Expected index name").value;
     expect(DbTokenType::ON, "Expected 'ON' after index name");
     stmt->tableName = expect(DbTokenType::IDENTIFIER, "Expected table name").value;
@@ -1195,13 +1398,13 @@ StmtPtr DbParser::parseCreateUser() {
     advance(); // CREATE
     advance(); // USER
 
-    auto stmt = std::make_shared<CreateUserStmt>();
+    auto stmt = node<CreateUserStmt>();
     stmt->userName = expect(DbTokenType::IDENTIFIER, "Expected username").value;
     expect(DbTokenType::PASSWORD, "Expected 'PASSWORD' after username");
     stmt->password = expect(DbTokenType::STRING_LIT, "Expected password string").value;
     // Optional ADMIN keyword (check identifier)
     if (!isAtEnd() && peek().type == DbTokenType::IDENTIFIER) {
-        std::string val = peek().value;
+        std::string val = peek().text();
         std::transform(val.begin(), val.end(), val.begin(), ::tolower);
         if (val == "admin") {
             advance();
@@ -1216,7 +1419,7 @@ StmtPtr DbParser::parseDropUser() {
     advance(); // DROP
     advance(); // USER
 
-    auto stmt = std::make_shared<DropUserStmt>();
+    auto stmt = node<DropUserStmt>();
     stmt->userName = expect(DbTokenType::IDENTIFIER, "Expected username").value;
     expect(DbTokenType::SEMICOLON, "Expected ';'");
     return stmt;
@@ -1225,7 +1428,7 @@ StmtPtr DbParser::parseDropUser() {
 StmtPtr DbParser::parseGrant() {
     advance(); // GRANT
 
-    auto stmt = std::make_shared<GrantStmt>();
+    auto stmt = node<GrantStmt>();
     // Permission name -- it can be a keyword like SELECT, INSERT etc.
     stmt->permission = peek().value;
     advance();
@@ -1245,7 +1448,7 @@ StmtPtr DbParser::parseGrant() {
 StmtPtr DbParser::parseRevoke() {
     advance(); // REVOKE
 
-    auto stmt = std::make_shared<RevokeStmt>();
+    auto stmt = node<RevokeStmt>();
     stmt->permission = peek().value;
     advance();
 
@@ -1263,7 +1466,7 @@ StmtPtr DbParser::parseRevoke() {
 StmtPtr DbParser::parseLogin() {
     advance(); // LOGIN
 
-    auto stmt = std::make_shared<LoginStmt>();
+    auto stmt = node<LoginStmt>();
     stmt->userName = expect(DbTokenType::IDENTIFIER, "Expected username").value;
     stmt->password = expect(DbTokenType::STRING_LIT, "Expected password string").value;
     expect(DbTokenType::SEMICOLON, "Expected ';'");
@@ -1273,7 +1476,7 @@ StmtPtr DbParser::parseLogin() {
 StmtPtr DbParser::parseLogout() {
     advance(); // LOGOUT
     expect(DbTokenType::SEMICOLON, "Expected ';'");
-    return std::make_shared<LogoutStmt>();
+    return node<LogoutStmt>();
 }
 
 } // namespace epee
@@ -5,6 +5,9 @@
 */
 
 #include "../../include/database/executor.hpp"
+#include "../../include/database/parallel.hpp"
+#include "../../include/database/memory.hpp"
+#include "../../include/database/loader.hpp"
 
 #include <iostream>
 #include <algorithm>
@@ -15,31 +18,364 @@
 #include <set>
 #include <map>
 #include <ctime>
+#include <chrono>
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
 
 namespace epee {
 
-// Exception used internally to propagate return values out of function bodies
-struct ReturnException {
-    Value value;
-    explicit ReturnException(const Value& v) : value(v) {}
+// ---------------------------------------------------------------------------
+// Operator profiling (EXPLAIN ANALYZE)
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Measures one operator while EXPLAIN ANALYZE runs a statement, and
+// records it as a trace span while the session is traced; it does nothing
+// otherwise.  Operators are measured one after another, never nested.
+class OperatorScope {
+public:
+    OperatorScope(std::vector<OperatorProfile>* profile, std::string& access,
+                  const std::string& operation, const std::string& detail, size_t rowsIn)
+        : profile_(profile), access_(access), span_("operator", operation), rowsIn_(rowsIn),
+          allocations_(AllocationTracker::active()),
+          tracking_(profile ? &allocations_ : AllocationTracker::active()) {
+        if (span_.recording()) {
+            span_.arg("detail", detail);
+            access_.clear();
+        }
+        if (!profile_) return;
+        entry_.operation = operation;
+        entry_.detail = detail;
+        entry_.rowsIn = rowsIn;
+        access_.clear();
+        cpuStart_ = std::clock();
+        wallStart_ = std::chrono::steady_clock::now();
+    }
+
+    // `access` overrides what the operator reported through operatorAccess_
+    void finish(size_t rowsOut, const char* access = nullptr) {
+        if (span_.recording()) {
+            span_.count("rows_in", rowsIn_);
+            span_.count("rows_out", rowsOut);
+            const std::string method = access ? std::string(access) : access_;
+            if (!method.empty()) span_.arg("access", method);
+            span_.finish();
+        }
+        if (!profile_) return;
+        entry_.wallMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - wallStart_).count();
+        entry_.cpuMs = 1000.0 * static_cast<double>(std::clock() - cpuStart_) / CLOCKS_PER_SEC;
+        entry_.peakBytes = std::max<int64_t>(0, allocations_.peak());
+        entry_.rowsOut = rowsOut;
+        entry_.access = access ? std::string(access) : access_;
+        profile_->push_back(std::move(entry_));
+        profile_ = nullptr;
+    }
+
+private:
+    std::vector<OperatorProfile>* profile_;
+    std::string& access_;
+    OperatorProfile entry_;
+    std::clock_t cpuStart_ = 0;
+    std::chrono::steady_clock::time_point wallStart_;
+    TraceSpan span_;
+    size_t rowsIn_;
+    // While profiling, the operator's allocations, nested in the statement's
+    AllocationCounters allocations_;
+    AllocationTracker::Scope tracking_;
 };
 
+// Span name of a top-level statement: its kind, and the table it works on
+std::string statementName(const Statement& stmt) {
+    if (auto s = dynamic_cast<const SelectStmt*>(&stmt)) return "SELECT " + s->fromTable;
+    if (auto s = dynamic_cast<const PipelineStmt*>(&stmt)) return "PIPELINE " + s->tableName;
+    if (auto s = dynamic_cast<const InsertStmt*>(&stmt)) return "INSERT " + s->tableName;
+    if (auto s = dynamic_cast<const UpdateStmt*>(&stmt)) return "UPDATE " + s->tableName;
+    if (auto s = dynamic_cast<const DeleteStmt*>(&stmt)) return "DELETE " + s->tableName;
+    if (auto s = dynamic_cast<const CopyStmt*>(&stmt)) return "COPY " + s->tableName;
+    if (auto s = dynamic_cast<const CreateTableStmt*>(&stmt)) return "CREATE TABLE " + s->tableName;
+    if (auto s = dynamic_cast<const ExplainStmt*>(&stmt))
+        return "EXPLAIN " + (s->innerStmt ? statementName(*s->innerStmt) : std::string());
+    if (auto s = dynamic_cast<const ExecuteStmt*>(&stmt)) return "EXECUTE " + s->name;
+    if (auto s = dynamic_cast<const FuncCallStmt*>(&stmt)) return "CALL " + s->name;
+    if (auto s = dynamic_cast<const SetOptionStmt*>(&stmt)) return "SET " + s->option;
+    if (dynamic_cast<const IfStmt*>(&stmt)) return "IF";
+    if (dynamic_cast<const WhileStmt*>(&stmt)) return "WHILE";
+    if (dynamic_cast<const PrintStmt*>(&stmt)) return "PRINT";
+    return "statement";
+}
+
+} // namespace
+
 // ---------------------------------------------------------------------------
 // Constructors
 // ---------------------------------------------------------------------------
 
-Executor::Executor() : db_(&ownedDb_) {}
+Executor::Executor()
+    : db_(&ownedDb_), security_(&ownedSecurity_), out_(&std::cout),
+      lockOwner_(db_->locks().newOwner()) {}
+
+Executor::Executor(Database& db)
+    : db_(&db), security_(&ownedSecurity_), out_(&std::cout), lockOwner_(db.locks().newOwner()) {}
+
+Executor::Executor(Database& db, SecurityManager& security)
+    : db_(&db), security_(&security), out_(&std::cout), lockOwner_(db.locks().newOwner()) {}
+
+// A session that ends inside a transaction rolls it back
+Executor::~Executor() {
+    if (inTransaction_) rollbackTransaction();
+    db_->locks().releaseAll(lockOwner_);
+}
+
+// ---------------------------------------------------------------------------
+// Concurrency control
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Restores the nesting depth however the statement leaves
+struct DepthGuard {
+    int& depth;
+    explicit DepthGuard(int& d) : depth(d) { depth++; }
+    ~DepthGuard() { depth--; }
+};
+
+// Direct children of an expression
+void forEachSubExpr(const ExprPtr& expr, const std::function<void(const ExprPtr&)>& fn) {
+    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+        fn(bin->left);
+        fn(bin->right);
+    } else if (auto un = std::dynamic_pointer_cast<UnaryExpr>(expr)) {
+        fn(un->operand);
+    } else if (auto func = std::dynamic_pointer_cast<FunctionCallExpr>(expr)) {
+        for (const auto& arg : func->args) fn(arg);
+    } else if (auto alias = std::dynamic_pointer_cast<AliasExpr>(expr)) {
+        fn(alias->expr);
+    } else if (auto between = std::dynamic_pointer_cast<BetweenExpr>(expr)) {
+        fn(between->expr);
+        fn(between->low);
+        fn(between->high);
+    } else if (auto in = std::dynamic_pointer_cast<InExpr>(expr)) {
+        fn(in->expr);
+        for (const auto& v : in->values) fn(v);
+    } else if (auto like = std::dynamic_pointer_cast<LikeExpr>(expr)) {
+        fn(like->expr);
+    } else if (auto isNull = std::dynamic_pointer_cast<IsNullExpr>(expr)) {
+        fn(isNull->expr);
+    } else if (auto cs = std::dynamic_pointer_cast<CaseExpr>(expr)) {
+        for (const auto& when : cs->whenClauses) {
+            fn(when.condition);
+            fn(when.result);
+        }
+        if (cs->elseResult) fn(cs->elseResult);
+    }
+}
+
+// Expressions written directly in a statement (not in nested bodies)
+void forEachStmtExpr(const StmtPtr& stmt, const std::function<void(const ExprPtr&)>& fn) {
+    auto each = [&](const ExprPtr& e) {
+        if (e) fn(e);
+    };
+    if (auto s = std::dynamic_pointer_cast<SelectStmt>(stmt)) {
+        for (const auto& e : s->columns) each(e);
+        each(s->whereClause);
+        for (const auto& e : s->groupBy) each(e);
+        each(s->havingClause);
+        for (const auto& [e, asc] : s->orderBy) each(e);
+        for (const auto& join : s->joins) each(join.onCondition);
+    } else if (auto s = std::dynamic_pointer_cast<PipelineStmt>(stmt)) {
+        for (const auto& stage : s->stages) {
+            each(stage.condition);
+            for (const auto& e : stage.columns) each(e);
+            for (const auto& [e, asc] : stage.orderCols) each(e);
+            for (const auto& e : stage.groupCols) each(e);
+            each(stage.joinCondition);
+            for (const auto& [col, e] : stage.assignments) each(e);
+        }
+    } else if (auto s = std::dynamic_pointer_cast<InsertStmt>(stmt)) {
+        for (const auto& row : s->valueRows)
+            for (const auto& e : row) each(e);
+    } else if (auto s = std::dynamic_pointer_cast<UpdateStmt>(stmt)) {
+        for (const auto& [col, e] : s->assignments) each(e);
+        each(s->whereClause);
+    } else if (auto s = std::dynamic_pointer_cast<DeleteStmt>(stmt)) {
+        each(s->whereClause);
+    } else if (auto s = std::dynamic_pointer_cast<PrintStmt>(stmt)) {
+        each(s->expr);
+    } else if (auto s = std::dynamic_pointer_cast<AssignStmt>(stmt)) {
+        each(s->value);
+    } else if (auto s = std::dynamic_pointer_cast<ReturnStmt>(stmt)) {
+        each(s->value);
+    } else if (auto s = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+        each(s->condition);
+    } else if (auto s = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
+        each(s->condition);
+    } else if (auto s = std::dynamic_pointer_cast<FuncCallStmt>(stmt)) {
+        for (const auto& e : s->args) each(e);
+    } else if (auto s = std::dynamic_pointer_cast<ExecuteStmt>(stmt)) {
+        for (const auto& e : s->args) each(e);
+    }
+}
+
+} // namespace
+
+void Executor::collectLocks(const ExprPtr& expr, LockSet& locks,
+                            std::vector<const FuncDefStmt*>& visited) const {
+    if (!expr) return;
+    if (auto func = std::dynamic_pointer_cast<FunctionCallExpr>(expr)) {
+        auto it = functions_.find(func->name);
+        if (it != functions_.end() &&
+            std::find(visited.begin(), visited.end(), it->second->def.get()) == visited.end()) {
+            visited.push_back(it->second->def.get());
+            for (const auto& s : it->second->def->body) collectLocks(s, locks, visited, true);
+        }
+    }
+    forEachSubExpr(expr, [&](const ExprPtr& e) { collectLocks(e, locks, visited); });
+}
+
+// Tables a statement reads (S) and writes (X), including through the
+// user-defined functions it calls; catalog and account changes lock the
+// whole database.  `nested` statements sit in a function body or block.
+void Executor::collectLocks(const StmtPtr& stmt, LockSet& locks,
+                            std::vector<const FuncDefStmt*>& visited, bool nested) const {
+    // Only user-defined functions can reach tables from an expression
+    if (!functions_.empty())
+        forEachStmtExpr(stmt, [&](const ExprPtr& e) { collectLocks(e, locks, visited); });
+    auto body = [&](const std::vector<StmtPtr>& stmts) {
+        for (const auto& s : stmts) collectLocks(s, locks, visited, true);
+    };
+
+    if (auto s = std::dynamic_pointer_cast<SelectStmt>(stmt)) {
+        locks.lockTable(s->fromTable, LockMode::S);
+        for (const auto& join : s->joins) locks.lockTable(join.tableName, LockMode::S);
+    } else if (auto s = std::dynamic_pointer_cast<PipelineStmt>(stmt)) {
+        LockMode mode = LockMode::S;
+        for (const auto& stage : s->stages) {
+            if (stage.type == PipelineStage::Type::UPDATE || stage.type == PipelineStage::Type::DELETE_STAGE)
+                mode = LockMode::X;
+            if (stage.type == PipelineStage::Type::JOIN) locks.lockTable(stage.joinTable, LockMode::S);
+        }
+        locks.lockTable(s->tableName, mode);
+    } else if (auto s = std::dynamic_pointer_cast<InsertStmt>(stmt)) {
+        locks.lockTable(s->tableName, LockMode::X);
+    } else if (auto s = std::dynamic_pointer_cast<UpdateStmt>(stmt)) {
+        locks.lockTable(s->tableName, LockMode::X);
+    } else if (auto s = std::dynamic_pointer_cast<DeleteStmt>(stmt)) {
+        locks.lockTable(s->tableName, LockMode::X);
+    } else if (auto s = std::dynamic_pointer_cast<CopyStmt>(stmt)) {
+        locks.lockTable(s->tableName, LockMode::X);
+    } else if (auto s = std::dynamic_pointer_cast<DescribeStmt>(stmt)) {
+        locks.lockTable(s->tableName, LockMode::S);
+    } else if (auto s = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+        body(s->thenBody);
+        body(s->elseBody);
+    } else if (auto s = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
+        body(s->body);
+    } else if (auto s = std::dynamic_pointer_cast<FuncDefStmt>(stmt)) {
+        // A definition runs nothing, but one made inside a block may be
+        // called later in the same statement
+        if (nested) body(s->body);
+    } else if (auto s = std::dynamic_pointer_cast<FuncCallStmt>(stmt)) {
+        auto call = std::make_shared<FunctionCallExpr>(s->name, std::vector<ExprPtr>());
+        if (!functions_.empty()) collectLocks(call, locks, visited);
+    } else if (auto s = std::dynamic_pointer_cast<ExplainStmt>(stmt)) {
+        collectLocks(s->innerStmt, locks, visited, nested);
+    } else if (auto s = std::dynamic_pointer_cast<ExecuteStmt>(stmt)) {
+        auto it = prepared_.find(s->name);
+        if (it != prepared_.end()) collectLocks(it->second->statement, locks, visited, nested);
+    } else if (std::dynamic_pointer_cast<ShowTablesStmt>(stmt) ||
+               std::dynamic_pointer_cast<SaveDatabaseStmt>(stmt) ||
+               std::dynamic_pointer_cast<ShowStatsStmt>(stmt) ||
+               std::dynamic_pointer_cast<ShowUsersStmt>(stmt) ||
+               std::dynamic_pointer_cast<ShowGrantsStmt>(stmt)) {
+        locks.lockDatabase(LockMode::S);
+    } else if (std::dynamic_pointer_cast<LoginStmt>(stmt)) {
+        locks.lockDatabase(LockMode::IS);
+    } else if (std::dynamic_pointer_cast<BeginStmt>(stmt) || std::dynamic_pointer_cast<CommitStmt>(stmt) ||
+               std::dynamic_pointer_cast<RollbackStmt>(stmt) || std::dynamic_pointer_cast<LogoutStmt>(stmt) ||
+               std::dynamic_pointer_cast<PrepareStmt>(stmt) || std::dynamic_pointer_cast<DeallocateStmt>(stmt) ||
+               std::dynamic_pointer_cast<VarDeclStmt>(stmt) || std::dynamic_pointer_cast<PrintStmt>(stmt) ||
+               std::dynamic_pointer_cast<AssignStmt>(stmt) || std::dynamic_pointer_cast<ReturnStmt>(stmt) ||
+               std::dynamic_pointer_cast<SetOptionStmt>(stmt)) {
+        // Session state only
+    } else {
+        // Catalog changes (tables, indexes, statistics, users, LOAD)
+        locks.lockDatabase(LockMode::X);
+    }
+}
+
+void Executor::acquireLocks(const LockSet& locks) {
+    db_->locks().acquire(lockOwner_, locks);
+    if (!inTransaction_) return;
+    // A table's rows are saved the first time the transaction writes it
+    for (const auto& [name, mode] : locks.tables) {
+        if (mode != LockMode::X || snapshots_.count(name) || !db_->hasTable(name)) continue;
+        snapshots_[name] = db_->getTable(name).snapshot();
+    }
+}
 
-Executor::Executor(Database& db) : db_(&db) {}
+void Executor::rollbackTransaction() {
+    for (auto& [name, rows] : snapshots_) {
+        if (!db_->hasTable(name)) continue;
+        db_->getTable(name).restore(rows);
+        db_->refreshStatistics(name);
+    }
+    snapshots_.clear();
+    inTransaction_ = false;
+}
 
 // ---------------------------------------------------------------------------
 // Top-level dispatch
 // ---------------------------------------------------------------------------
 
+// Statements run from function bodies and blocks are covered by the locks
+// their top-level statement took
 QueryResult Executor::execute(const StmtPtr& stmt) {
     if (!stmt) return QueryResult("Null statement", false);
+    if (depth_ > 0) return executeStatement(stmt);
+
+    // One span per top-level statement; its operators nest inside
+    TraceActivation tracing(tracing_);
+    TraceSpan span("statement", TraceSpan::active() ? statementName(*stmt) : std::string());
+
+    try {
+        LockSet locks;
+        std::vector<const FuncDefStmt*> visited;
+        collectLocks(stmt, locks, visited, false);
+        acquireLocks(locks);
+    } catch (const DeadlockError& e) {
+        std::string message = std::string("Error: ") + e.what();
+        if (inTransaction_) {
+            rollbackTransaction();
+            message += "; transaction rolled back";
+        }
+        db_->locks().releaseAll(lockOwner_);
+        return QueryResult(message, false);
+    }
+
+    QueryResult result;
+    {
+        DepthGuard guard(depth_);
+        try {
+            result = executeStatement(stmt);
+        } catch (...) {
+            if (!inTransaction_) db_->locks().releaseAll(lockOwner_);
+            throw;
+        }
+    }
+    if (!inTransaction_) db_->locks().releaseAll(lockOwner_);
+    if (span.recording()) {
+        span.count("rows", result.columnNames.empty() ? result.affectedRows : result.rows.size());
+        if (!result.success) span.arg("error", result.message);
+    }
+    return result;
+}
 
+QueryResult Executor::executeStatement(const StmtPtr& stmt) {
     try {
         if (auto s = std::dynamic_pointer_cast<CreateTableStmt>(stmt))
             return executeCreateTable(*s);
@@ -107,10 +443,22 @@ QueryResult Executor::execute(const StmtPtr& stmt) {
             return executeShowGrants(*s);
         if (auto s = std::dynamic_pointer_cast<ExplainStmt>(stmt))
             return executeExplain(*s);
+        if (auto s = std::dynamic_pointer_cast<AnalyzeStmt>(stmt))
+            return executeAnalyze(*s);
+        if (auto s = std::dynamic_pointer_cast<ShowStatsStmt>(stmt))
+            return executeShowStats(*s);
+        if (auto s = std::dynamic_pointer_cast<PrepareStmt>(stmt))
+            return executePrepare(*s);
+        if (auto s = std::dynamic_pointer_cast<ExecuteStmt>(stmt))
+            return executeExecute(*s);
+        if (auto s = std::dynamic_pointer_cast<DeallocateStmt>(stmt))
+            return executeDeallocate(*s);
+        if (auto s = std::dynamic_pointer_cast<CopyStmt>(stmt))
+            return executeCopy(*s);
+        if (auto s = std::dynamic_pointer_cast<SetOptionStmt>(stmt))
+            return executeSetOption(*s);
 
         return QueryResult("Unknown statement type", false);
-    } catch (const ReturnException&) {
-        throw; // Let return exceptions propagate
     } catch (const std::exception& e) {
         return QueryResult(std::string("Error: ") + e.what(), false);
     }
@@ -120,7 +468,7 @@ QueryResult Executor::executeAll(const std::vector<StmtPtr>& stmts) {
     QueryResult last;
     for (const auto& stmt : stmts) {
         last = execute(stmt);
-        if (!last.success) return last;
+        if (!last.success || returning_) return last;
     }
     return last;
 }
@@ -137,6 +485,7 @@ QueryResult Executor::executeCreateTable(const CreateTableStmt& stmt) {
         Column col(cd.name, cd.type, cd.primaryKey);
         col.nullable = cd.nullable;
         col.unique = cd.unique;
+        col.dictionary = cd.dictionary;
         columns.push_back(col);
     }
     db_->createTable(stmt.tableName, columns);
@@ -161,8 +510,10 @@ QueryResult Executor::executeInsert(const InsertStmt& stmt) {
     checkPermission(Permission::INSERT, stmt.tableName);
     Table& table = db_->getTable(stmt.tableName);
     const auto& tableCols = table.getColumns();
-    int inserted = 0;
 
+    // Evaluate every row first, then store them as one batch
+    std::vector<Row> rows;
+    rows.reserve(stmt.valueRows.size());
     for (const auto& valueRow : stmt.valueRows) {
         Row row(tableCols.size());
 
@@ -188,15 +539,35 @@ QueryResult Executor::executeInsert(const InsertStmt& stmt) {
             }
         }
 
-        table.insertRow(row);
-        inserted++;
+        rows.push_back(std::move(row));
     }
+    const int inserted = static_cast<int>(rows.size());
+    table.insertRows(std::move(rows));
+    db_->refreshStatistics(stmt.tableName);
 
     QueryResult result("Inserted " + std::to_string(inserted) + " row(s).");
     result.affectedRows = inserted;
     return result;
 }
 
+// ---------------------------------------------------------------------------
+// COPY FROM
+// ---------------------------------------------------------------------------
+
+QueryResult Executor::executeCopy(const CopyStmt& stmt) {
+    checkPermission(Permission::INSERT, stmt.tableName);
+    Table& table = db_->getTable(stmt.tableName);
+    CopyOptions options;
+    options.delimiter = stmt.delimiter;
+    options.header = stmt.header;
+    size_t copied = BulkLoader::load(table, stmt.path, options);
+    db_->refreshStatistics(stmt.tableName);
+
+    QueryResult result("Copied " + std::to_string(copied) + " row(s).");
+    result.affectedRows = static_cast<int>(copied);
+    return result;
+}
+
 // ---------------------------------------------------------------------------
 // SELECT
 // ---------------------------------------------------------------------------
@@ -205,19 +576,40 @@ QueryResult Executor::executeSelect(const SelectStmt& stmt) {
     if (!stmt.fromTable.empty())
         checkPermission(Permission::SELECT, stmt.fromTable);
     // Start with the base table
-    QueryResult result;
     std::vector<std::string> colNames;
     std::vector<Row> rows;
 
-    if (!stmt.fromTable.empty()) {
+    // Leading inner/cross joins run as one chain the optimizer may reorder
+    std::vector<JoinInput> chain;
+    std::vector<ExprPtr> chainConditions;
+    std::vector<std::string> chainTypes;
+    size_t chained = selectJoinChain(stmt, chain, chainConditions, chainTypes);
+
+    if (chained > 0) {
+        QueryResult joined = joinChain(chain, chainConditions, chainTypes);
+        colNames = std::move(joined.columnNames);
+        rows = std::move(joined.rows);
+    } else if (!stmt.fromTable.empty()) {
         const Table& table = db_->getTable(stmt.fromTable);
-        result = table.selectAll();
-        colNames = result.columnNames;
-        rows = result.rows;
+        for (const auto& c : table.getColumns()) colNames.push_back(c.name);
+        IndexAccess access;
+        if (stmt.whereClause && stmt.joins.empty() &&
+            indexAccess(stmt.whereClause, table, colNames, access)) {
+            OperatorScope scope(profile_, operatorAccess_, "INDEX SCAN", access.describe(),
+                                table.rowCount());
+            rows = indexScan(table, access);
+            scope.finish(rows.size());
+        } else {
+            OperatorScope scope(profile_, operatorAccess_, "TABLE SCAN",
+                                "Scan table '" + stmt.fromTable + "'", table.rowCount());
+            rows = table.getRows();
+            scope.finish(rows.size());
+        }
     }
 
-    // Process JOINs
-    for (const auto& join : stmt.joins) {
+    // Process remaining (outer) JOINs in written order
+    for (size_t j = chained; j < stmt.joins.size(); j++) {
+        const auto& join = stmt.joins[j];
         const Table& rightTable = db_->getTable(join.tableName);
 
         // Build a temporary Table-like representation from current result for join
@@ -235,106 +627,49 @@ QueryResult Executor::executeSelect(const SelectStmt& stmt) {
             }
         }
 
-        std::vector<std::string> joinedCols;
-        joinedCols.insert(joinedCols.end(), leftCols.begin(), leftCols.end());
-        joinedCols.insert(joinedCols.end(), rightCols.begin(), rightCols.end());
-
-        std::vector<Row> joinedRows;
-        const auto& rightRows = rightTable.getRows();
-
-        if (join.joinType == "cross") {
-            for (const auto& lrow : rows) {
-                for (const auto& rrow : rightRows) {
-                    Row combined = lrow;
-                    combined.insert(combined.end(), rrow.begin(), rrow.end());
-                    joinedRows.push_back(combined);
-                }
-            }
-        } else if (join.joinType == "inner") {
-            for (const auto& lrow : rows) {
-                for (const auto& rrow : rightRows) {
-                    Row combined = lrow;
-                    combined.insert(combined.end(), rrow.begin(), rrow.end());
-                    Value cond = evaluate(join.onCondition, combined, joinedCols);
-                    if (cond.asBool())
-                        joinedRows.push_back(combined);
-                }
-            }
-        } else if (join.joinType == "left") {
-            for (const auto& lrow : rows) {
-                bool matched = false;
-                for (const auto& rrow : rightRows) {
-                    Row combined = lrow;
-                    combined.insert(combined.end(), rrow.begin(), rrow.end());
-                    Value cond = evaluate(join.onCondition, combined, joinedCols);
-                    if (cond.asBool()) {
-                        joinedRows.push_back(combined);
-                        matched = true;
-                    }
-                }
-                if (!matched) {
-                    Row combined = lrow;
-                    for (size_t i = 0; i < rightCols.size(); i++)
-                        combined.push_back(Value());
-                    joinedRows.push_back(combined);
-                }
-            }
-        } else if (join.joinType == "right") {
-            for (const auto& rrow : rightRows) {
-                bool matched = false;
-                for (const auto& lrow : rows) {
-                    Row combined = lrow;
-                    combined.insert(combined.end(), rrow.begin(), rrow.end());
-                    Value cond = evaluate(join.onCondition, combined, joinedCols);
-                    if (cond.asBool()) {
-                        joinedRows.push_back(combined);
-                        matched = true;
-                    }
-                }
-                if (!matched) {
-                    Row combined;
-                    for (size_t i = 0; i < leftCols.size(); i++)
-                        combined.push_back(Value());
-                    combined.insert(combined.end(), rrow.begin(), rrow.end());
-                    joinedRows.push_back(combined);
-                }
-            }
-        }
-
-        colNames = joinedCols;
-        rows = joinedRows;
+        OperatorScope scope(profile_, operatorAccess_, "JOIN",
+                            join.joinType + " join with '" + join.tableName + "'", rows.size());
+        QueryResult joined = joinRows(leftCols, rows, rightCols, rightTable.getRows(),
+                                      join.onCondition, join.joinType);
+        colNames = std::move(joined.columnNames);
+        rows = std::move(joined.rows);
+        scope.finish(rows.size());
     }
 
     // WHERE filter
     if (stmt.whereClause) {
+        OperatorScope scope(profile_, operatorAccess_, "FILTER", "Apply WHERE predicate", rows.size());
         auto pred = buildPredicate(stmt.whereClause, colNames);
         std::vector<Row> filtered;
         for (const auto& row : rows) {
             if (pred(row)) filtered.push_back(row);
         }
         rows = std::move(filtered);
+        scope.finish(rows.size());
     }
 
     // GROUP BY
     if (!stmt.groupBy.empty()) {
+        OperatorScope groupScope(profile_, operatorAccess_, "GROUP",
+            "Group by " + std::to_string(stmt.groupBy.size()) + " column(s)", rows.size());
         QueryResult grouped;
         grouped.columnNames = colNames;
-        grouped.rows = rows;
+        grouped.rows = std::move(rows);
         QueryResult groupedResult = groupAndAggregate(grouped, stmt.groupBy, stmt.columns, stmt.havingClause);
+        groupScope.finish(groupedResult.rows.size());
 
-        if (!stmt.orderBy.empty())
+        if (!stmt.orderBy.empty()) {
+            OperatorScope scope(profile_, operatorAccess_, "SORT", "Order by " +
+                std::to_string(stmt.orderBy.size()) + " column(s)", groupedResult.rows.size());
             sortResult(groupedResult, stmt.orderBy);
+            scope.finish(groupedResult.rows.size());
+        }
 
         if (stmt.distinct) {
-            std::vector<Row> unique;
-            std::set<std::vector<std::string>> seen;
-            for (const auto& row : groupedResult.rows) {
-                std::vector<std::string> key;
-                for (const auto& v : row) key.push_back(v.asString());
-                if (seen.insert(key).second)
-                    unique.push_back(row);
-            }
-            groupedResult.rows = std::move(unique);
+            OperatorScope scope(profile_, operatorAccess_, "DISTINCT", "Remove duplicate rows",
+                                groupedResult.rows.size());
+            distinctRows(groupedResult.rows);
+            scope.finish(groupedResult.rows.size(), "hash set");
         }
 
         if (stmt.offset > 0) {
@@ -375,6 +710,8 @@ QueryResult Executor::executeSelect(const SelectStmt& stmt) {
     }
 
     // Project columns
+    OperatorScope projectScope(profile_, operatorAccess_, hasAggregates ? "AGGREGATE" : "PROJECT",
+        "Select " + std::to_string(stmt.columns.size()) + " column(s)", rows.size());
     QueryResult projected;
     bool hasStar = false;
     for (const auto& col : stmt.columns) {
@@ -409,29 +746,31 @@ QueryResult Executor::executeSelect(const SelectStmt& stmt) {
         for (const auto& col : stmt.columns)
             projected.columnNames.push_back(getExprName(col));
 
+        const std::vector<ExprPtr> exprs = simplifyExprs(stmt.columns, colNames);
         for (const auto& row : rows) {
             Row projRow;
-            for (const auto& col : stmt.columns)
-                projRow.push_back(evaluate(col, row, colNames));
+            for (const auto& expr : exprs)
+                projRow.push_back(evaluate(expr, row, colNames));
             projected.rows.push_back(projRow);
         }
     }
 
+    projectScope.finish(projected.rows.size());
+
     // ORDER BY
-    if (!stmt.orderBy.empty())
+    if (!stmt.orderBy.empty()) {
+        OperatorScope scope(profile_, operatorAccess_, "SORT", "Order by " +
+            std::to_string(stmt.orderBy.size()) + " column(s)", projected.rows.size());
         sortResult(projected, stmt.orderBy);
+        scope.finish(projected.rows.size());
+    }
 
     // DISTINCT
     if (stmt.distinct) {
-        std::vector<Row> unique;
-        std::set<std::vector<std::string>> seen;
-        for (const auto& row : projected.rows) {
-            std::vector<std::string> key;
-            for (const auto& v : row) key.push_back(v.asString());
-            if (seen.insert(key).second)
-                unique.push_back(row);
-        }
-        projected.rows = std::move(unique);
+        OperatorScope scope(profile_, operatorAccess_, "DISTINCT", "Remove duplicate rows",
+                            projected.rows.size());
+        distinctRows(projected.rows);
+        scope.finish(projected.rows.size(), "hash set");
     }
 
     // OFFSET
@@ -452,6 +791,12 @@ QueryResult Executor::executeSelect(const SelectStmt& stmt) {
 // UPDATE
 // ---------------------------------------------------------------------------
 
+static size_t assignmentColumn(const Table& table, const std::string& column) {
+    int idx = table.getColumnIndex(column);
+    if (idx < 0) throw std::runtime_error("Unknown column '" + column + "'");
+    return static_cast<size_t>(idx);
+}
+
 QueryResult Executor::executeUpdate(const UpdateStmt& stmt) {
     checkPermission(Permission::UPDATE, stmt.tableName);
     Table& table = db_->getTable(stmt.tableName);
@@ -463,22 +808,16 @@ QueryResult Executor::executeUpdate(const UpdateStmt& stmt) {
         ? buildPredicate(stmt.whereClause, colNames)
         : [](const Row&) { return true; };
 
-    // Build update pairs
-    std::vector<std::pair<int, Value>> updates;
-    // We need to evaluate per-row, so use updateRows with a custom lambda
-    int count = 0;
-    auto& tableRows = const_cast<std::vector<Row>&>(table.getRows());
-    for (auto& row : tableRows) {
-        if (predicate(row)) {
-            for (const auto& [colName, expr] : stmt.assignments) {
-                int idx = table.getColumnIndex(colName);
-                if (idx < 0)
-                    throw std::runtime_error("Unknown column '" + colName + "'");
-                row[static_cast<size_t>(idx)] = evaluate(expr, row, colNames);
-            }
-            count++;
-        }
+    std::vector<size_t> targets;
+    std::vector<ExprPtr> values;
+    for (const auto& assignment : stmt.assignments) {
+        targets.push_back(assignmentColumn(table, assignment.first));
+        values.push_back(simplifyExpr(assignment.second, colNames));
     }
+    int count = table.updateRows(predicate, targets, [&](size_t a, const Row& row) {
+        return evaluate(values[a], row, colNames);
+    });
+    db_->refreshStatistics(stmt.tableName);
 
     QueryResult result("Updated " + std::to_string(count) + " row(s).");
     result.affectedRows = count;
@@ -501,6 +840,7 @@ QueryResult Executor::executeDelete(const DeleteStmt& stmt) {
         : [](const Row&) { return true; };
 
     int count = table.deleteRows(predicate);
+    db_->refreshStatistics(stmt.tableName);
     QueryResult result("Deleted " + std::to_string(count) + " row(s).");
     result.affectedRows = count;
     return result;
@@ -510,29 +850,159 @@ QueryResult Executor::executeDelete(const DeleteStmt& stmt) {
 // PIPELINE
 // ---------------------------------------------------------------------------
 
+static size_t countConjuncts(const ExprPtr& expr) {
+    auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr);
+    if (bin && bin->op == "and") return countConjuncts(bin->left) + countConjuncts(bin->right);
+    return expr ? 1 : 0;
+}
+
+static std::string conditionCount(const ExprPtr& condition) {
+    size_t n = countConjuncts(condition);
+    return n > 1 ? " (" + std::to_string(n) + " conditions)" : "";
+}
+
+static void describeStage(const PipelineStage& stage, std::string& op, std::string& detail) {
+    switch (stage.type) {
+        case PipelineStage::Type::WHERE: op = "FILTER"; detail = "Apply WHERE predicate" + conditionCount(stage.condition); break;
+        case PipelineStage::Type::SELECT:
+            op = "PROJECT";
+            if (stage.pruning) detail = "Prune to " + std::to_string(stage.columns.size()) + " column(s)";
+            else detail = "Select columns";
+            break;
+        case PipelineStage::Type::ORDERBY: op = "SORT"; detail = "Order by columns"; break;
+        case PipelineStage::Type::LIMIT:
+        case PipelineStage::Type::TAKE: op = "LIMIT"; detail = "Limit rows"; break;
+        case PipelineStage::Type::OFFSET:
+        case PipelineStage::Type::SKIP_STAGE: op = "OFFSET"; detail = "Skip rows"; break;
+        case PipelineStage::Type::GROUPBY: op = "GROUP"; detail = "Group by columns"; break;
+        case PipelineStage::Type::HAVING: op = "FILTER"; detail = "Apply HAVING predicate"; break;
+        case PipelineStage::Type::JOIN: op = "JOIN"; detail = stage.joinType + " join with '" + stage.joinTable + "'" + conditionCount(stage.joinCondition); break;
+        case PipelineStage::Type::DISTINCT: op = "DISTINCT"; detail = "Remove duplicates"; break;
+        case PipelineStage::Type::COUNT_STAGE: op = "AGGREGATE"; detail = "Count rows"; break;
+        case PipelineStage::Type::MAP: op = "MAP"; detail = "Add computed columns"; break;
+        case PipelineStage::Type::PRINT: op = "OUTPUT"; detail = "Print results"; break;
+        case PipelineStage::Type::EXPORT: op = "OUTPUT"; detail = "Export to '" + stage.exportPath + "'"; break;
+        default: op = "UNKNOWN"; detail = "Unknown stage"; break;
+    }
+}
+
 QueryResult Executor::executePipeline(const PipelineStmt& stmt) {
     Table& table = db_->getTable(stmt.tableName);
-    QueryResult current = table.selectAll();
+    TraceSpan planSpan("plan", "rewrite pipeline");
+    const auto plan = pipelinePlan(stmt);
+    planSpan.finish();
+    const std::vector<PipelineStage>& stages = *plan;
+
+    QueryResult streamed;
+    if (!profile_ && streamExport(stmt.tableName, stages, streamed)) return streamed;
+
+    // Until the first stage runs, rows are read from the table itself
+    QueryResult current;
+    for (const auto& c : table.getColumns()) current.columnNames.push_back(c.name);
+    bool fromTable = true;
+
+    for (size_t i = 0; i < stages.size(); i++) {
+        const auto& stage = stages[i];
+
+        if (fromTable && stage.type == PipelineStage::Type::WHERE) {
+            IndexAccess access;
+            if (indexAccess(stage.condition, table, current.columnNames, access)) {
+                OperatorScope scope(profile_, operatorAccess_, "INDEX SCAN",
+                                    access.describe() + " and apply WHERE predicate", table.rowCount());
+                current = filterRows(stage.condition, current.columnNames, indexScan(table, access));
+                fromTable = false;
+                scope.finish(current.rows.size());
+                continue;
+            }
+            OperatorScope scope(profile_, operatorAccess_, "FILTER",
+                                "Scan table '" + stmt.tableName + "' and apply WHERE predicate",
+                                table.rowCount());
+            current = filterRows(stage.condition, current.columnNames, table.getRows());
+            fromTable = false;
+            scope.finish(current.rows.size());
+            continue;
+        }
+        if (fromTable && stage.type == PipelineStage::Type::SELECT) {
+            OperatorScope scope(profile_, operatorAccess_, "PROJECT",
+                                "Scan table '" + stmt.tableName + "' and select columns",
+                                table.rowCount());
+            current = projectRows(stage, current.columnNames, table.getRows());
+            fromTable = false;
+            scope.finish(current.rows.size());
+            continue;
+        }
+
+        // Consecutive inner/cross joins run as one chain the optimizer may reorder
+        if (stage.type == PipelineStage::Type::JOIN &&
+            (stage.joinType == "inner" || stage.joinType == "cross")) {
+            std::vector<JoinInput> chain(1);
+            std::vector<ExprPtr> conditions;
+            std::vector<std::string> joinTypes;
+            chain[0].columns = current.columnNames;
+            chain[0].rows = &current.rows;
+            if (fromTable) {
+                // Nothing has run yet: join straight from the table
+                chain[0].rows = &table.getRows();
+                chain[0].table = &table;
+            }
+            size_t j = i;
+            for (; j < stages.size() && stages[j].type == PipelineStage::Type::JOIN &&
+                   (stages[j].joinType == "inner" || stages[j].joinType == "cross"); j++) {
+                const Table& rightTable = db_->getTable(stages[j].joinTable);
+                JoinInput input;
+                for (const auto& c : rightTable.getColumns())
+                    input.columns.push_back(stages[j].joinTable + "." + c.name);
+                input.rows = &rightTable.getRows();
+                input.table = &rightTable;
+                chain.push_back(std::move(input));
+                conditions.push_back(stages[j].joinCondition);
+                joinTypes.push_back(stages[j].joinType);
+            }
+            current = joinChain(chain, conditions, joinTypes);
+            fromTable = false;
+            i = j - 1;
+            continue;
+        }
 
-    for (size_t i = 0; i < stmt.stages.size(); i++) {
-        const auto& stage = stmt.stages[i];
+        if (fromTable) {
+            OperatorScope scope(profile_, operatorAccess_, "TABLE SCAN",
+                                "Scan table '" + stmt.tableName + "'", table.rowCount());
+            current.rows = table.getRows();
+            fromTable = false;
+            scope.finish(current.rows.size());
+        }
+
+        std::string operation, detail;
+        if (profile_ || TraceSpan::active()) describeStage(stage, operation, detail);
 
         // Combine GROUPBY + SELECT into a single groupAndAggregate call
         if (stage.type == PipelineStage::Type::GROUPBY &&
-            i + 1 < stmt.stages.size() &&
-            stmt.stages[i + 1].type == PipelineStage::Type::SELECT) {
-            const auto& selectStage = stmt.stages[i + 1];
+            i + 1 < stages.size() &&
+            stages[i + 1].type == PipelineStage::Type::SELECT) {
+            OperatorScope scope(profile_, operatorAccess_, operation,
+                                detail + " and aggregate", current.rows.size());
+            const auto& selectStage = stages[i + 1];
             current = groupAndAggregate(current, stage.groupCols,
                                         selectStage.columns, nullptr);
             if (!current.success) return current;
+            scope.finish(current.rows.size());
             i++; // skip the SELECT stage since we handled it
             continue;
         }
 
+        OperatorScope scope(profile_, operatorAccess_, operation, detail, current.rows.size());
         current = applyPipelineStage(stage, current, stmt.tableName);
         if (!current.success) return current;
+        scope.finish(current.rows.size(),
+                     stage.type == PipelineStage::Type::DISTINCT ? "hash set" : nullptr);
     }
 
+    if (fromTable) {
+        OperatorScope scope(profile_, operatorAccess_, "TABLE SCAN",
+                            "Scan table '" + stmt.tableName + "'", table.rowCount());
+        current.rows = table.getRows();
+        scope.finish(current.rows.size());
+    }
     return current;
 }
 
@@ -540,85 +1010,11 @@ QueryResult Executor::applyPipelineStage(const PipelineStage& stage,
                                           QueryResult& current,
                                           const std::string& originalTable) {
     switch (stage.type) {
-    case PipelineStage::Type::WHERE: {
-        auto pred = buildPredicate(stage.condition, current.columnNames);
-        std::vector<Row> filtered;
-        for (const auto& row : current.rows) {
-            if (pred(row)) filtered.push_back(row);
-        }
-        current.rows = std::move(filtered);
-        return current;
-    }
-
-    case PipelineStage::Type::SELECT: {
-        QueryResult projected;
-        bool hasStar = false;
-        for (const auto& col : stage.columns) {
-            if (std::dynamic_pointer_cast<StarExpr>(col)) {
-                hasStar = true;
-                break;
-            }
-        }
-
-        if (hasStar) {
-            projected = current;
-        } else {
-            // Check for aggregates
-            bool hasAgg = false;
-            for (const auto& col : stage.columns) {
-                ExprPtr inner = col;
-                if (auto alias = std::dynamic_pointer_cast<AliasExpr>(col))
-                    inner = alias->expr;
-                if (auto fc = std::dynamic_pointer_cast<FunctionCallExpr>(inner)) {
-                    std::string lower = fc->name;
-                    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-                    if (lower == "count" || lower == "sum" || lower == "avg" ||
-                        lower == "min" || lower == "max") {
-                        hasAgg = true;
-                        break;
-                    }
-                }
-            }
-
-            for (const auto& col : stage.columns)
-                projected.columnNames.push_back(getExprName(col));
-
-            if (hasAgg) {
-                Row aggRow;
-                for (const auto& col : stage.columns) {
-                    ExprPtr inner = col;
-                    if (auto alias = std::dynamic_pointer_cast<AliasExpr>(col))
-                        inner = alias->expr;
-                    if (auto fc = std::dynamic_pointer_cast<FunctionCallExpr>(inner))
-                        aggRow.push_back(evaluateAggregate(*fc, current.rows, current.columnNames));
-                    else
-                        aggRow.push_back(current.rows.empty() ? Value() : evaluate(col, current.rows[0], current.columnNames));
-                }
-                projected.rows.push_back(aggRow);
-            } else {
-                for (const auto& row : current.rows) {
-                    Row projRow;
-                    for (const auto& col : stage.columns)
-                        projRow.push_back(evaluate(col, row, current.columnNames));
-                    projected.rows.push_back(projRow);
-                }
-            }
-        }
-
-        if (stage.selectDistinct) {
-            std::vector<Row> unique;
-            std::set<std::vector<std::string>> seen;
-            for (const auto& row : projected.rows) {
-                std::vector<std::string> key;
-                for (const auto& v : row) key.push_back(v.asString());
-                if (seen.insert(key).second)
-                    unique.push_back(row);
-            }
-            projected.rows = std::move(unique);
-        }
+    case PipelineStage::Type::WHERE:
+        return filterRows(stage.condition, current.columnNames, current.rows);
 
-        return projected;
-    }
+    case PipelineStage::Type::SELECT:
+        return projectRows(stage, current.columnNames, current.rows);
 
     case PipelineStage::Type::ORDERBY: {
         sortResult(current, stage.orderCols);
@@ -657,76 +1053,12 @@ QueryResult Executor::applyPipelineStage(const PipelineStage& stage,
     case PipelineStage::Type::JOIN: {
         const Table& rightTable = db_->getTable(stage.joinTable);
 
-        QueryResult joinResult;
         std::vector<std::string> rightCols;
         for (const auto& c : rightTable.getColumns())
             rightCols.push_back(stage.joinTable + "." + c.name);
 
-        joinResult.columnNames = current.columnNames;
-        joinResult.columnNames.insert(joinResult.columnNames.end(), rightCols.begin(), rightCols.end());
-
-        const auto& rightRows = rightTable.getRows();
-
-        if (stage.joinType == "cross") {
-            for (const auto& lr : current.rows) {
-                for (const auto& rr : rightRows) {
-                    Row combined = lr;
-                    combined.insert(combined.end(), rr.begin(), rr.end());
-                    joinResult.rows.push_back(combined);
-                }
-            }
-        } else if (stage.joinType == "inner") {
-            for (const auto& lr : current.rows) {
-                for (const auto& rr : rightRows) {
-                    Row combined = lr;
-                    combined.insert(combined.end(), rr.begin(), rr.end());
-                    Value cond = evaluate(stage.joinCondition, combined, joinResult.columnNames);
-                    if (cond.asBool())
-                        joinResult.rows.push_back(combined);
-                }
-            }
-        } else if (stage.joinType == "left") {
-            for (const auto& lr : current.rows) {
-                bool matched = false;
-                for (const auto& rr : rightRows) {
-                    Row combined = lr;
-                    combined.insert(combined.end(), rr.begin(), rr.end());
-                    Value cond = evaluate(stage.joinCondition, combined, joinResult.columnNames);
-                    if (cond.asBool()) {
-                        joinResult.rows.push_back(combined);
-                        matched = true;
-                    }
-                }
-                if (!matched) {
-                    Row combined = lr;
-                    for (size_t i = 0; i < rightCols.size(); i++)
-                        combined.push_back(Value());
-                    joinResult.rows.push_back(combined);
-                }
-            }
-        } else if (stage.joinType == "right") {
-            for (const auto& rr : rightRows) {
-                bool matched = false;
-                for (const auto& lr : current.rows) {
-                    Row combined = lr;
-                    combined.insert(combined.end(), rr.begin(), rr.end());
-                    Value cond = evaluate(stage.joinCondition, combined, joinResult.columnNames);
-                    if (cond.asBool()) {
-                        joinResult.rows.push_back(combined);
-                        matched = true;
-                    }
-                }
-                if (!matched) {
-                    Row combined;
-                    for (size_t i = 0; i < current.columnNames.size(); i++)
-                        combined.push_back(Value());
-                    combined.insert(combined.end(), rr.begin(), rr.end());
-                    joinResult.rows.push_back(combined);
-                }
-            }
-        }
-
-        return joinResult;
+        return joinRows(current.columnNames, current.rows, rightCols, rightTable.getRows(),
+                        stage.joinCondition, stage.joinType);
     }
 
     case PipelineStage::Type::UPDATE: {
@@ -738,33 +1070,30 @@ QueryResult Executor::applyPipelineStage(const PipelineStage& stage,
         std::vector<std::string> tableColNames;
         for (const auto& c : tableCols) tableColNames.push_back(c.name);
 
-        // Build a set of row-signatures from the current (filtered) pipeline result
-        // to identify which rows to update
-        auto& tableRows = const_cast<std::vector<Row>&>(table.getRows());
-        int count = 0;
-
-        // Match rows by content
-        std::set<size_t> matchIndices;
-        for (size_t ti = 0; ti < tableRows.size(); ti++) {
+        // Table rows are matched by content against the current (filtered)
+        // pipeline result, each before it is updated
+        auto inResult = [&](const Row& row) {
             for (const auto& prow : current.rows) {
                 bool match = true;
-                size_t limit = std::min(tableRows[ti].size(), prow.size());
+                size_t limit = std::min(row.size(), prow.size());
                 for (size_t c = 0; c < limit; c++) {
-                    if (!(tableRows[ti][c] == prow[c])) { match = false; break; }
+                    if (!(row[c] == prow[c])) { match = false; break; }
                 }
-                if (match) { matchIndices.insert(ti); break; }
+                if (match) return true;
             }
-        }
+            return false;
+        };
 
-        for (size_t ti : matchIndices) {
-            for (const auto& [colName, expr] : stage.assignments) {
-                int idx = table.getColumnIndex(colName);
-                if (idx < 0)
-                    throw std::runtime_error("Unknown column '" + colName + "'");
-                tableRows[ti][static_cast<size_t>(idx)] = evaluate(expr, tableRows[ti], tableColNames);
-            }
-            count++;
+        std::vector<size_t> targets;
+        std::vector<ExprPtr> values;
+        for (const auto& assignment : stage.assignments) {
+            targets.push_back(assignmentColumn(table, assignment.first));
+            values.push_back(simplifyExpr(assignment.second, tableColNames));
         }
+        int count = table.updateRows(inResult, targets, [&](size_t a, const Row& row) {
+            return evaluate(values[a], row, tableColNames);
+        });
+        db_->refreshStatistics(originalTable);
 
         QueryResult result("Updated " + std::to_string(count) + " row(s).");
         result.affectedRows = count;
@@ -798,6 +1127,9 @@ QueryResult Executor::applyPipelineStage(const PipelineStage& stage,
                 ++it;
             }
         }
+        if (count > 0) table.rebuildAllIndexes();
+        table.noteModified(static_cast<size_t>(count));
+        db_->refreshStatistics(originalTable);
 
         QueryResult result("Deleted " + std::to_string(count) + " row(s).");
         result.affectedRows = count;
@@ -805,20 +1137,16 @@ QueryResult Executor::applyPipelineStage(const PipelineStage& stage,
     }
 
     case PipelineStage::Type::PRINT: {
-        std::cout << current.toPrettyTable();
+        // EXPLAIN ANALYZE runs the pipeline without showing its output
+        if (!profile_) writeResult(current, outputFormat_, *out_);
         return current;
     }
 
+    case PipelineStage::Type::EXPORT:
+        return exportRows(stage, current);
+
     case PipelineStage::Type::DISTINCT: {
-        std::vector<Row> unique;
-        std::set<std::vector<std::string>> seen;
-        for (const auto& row : current.rows) {
-            std::vector<std::string> key;
-            for (const auto& v : row) key.push_back(v.asString());
-            if (seen.insert(key).second)
-                unique.push_back(row);
-        }
-        current.rows = std::move(unique);
+        distinctRows(current.rows);
         return current;
     }
 
@@ -852,10 +1180,11 @@ QueryResult Executor::applyPipelineStage(const PipelineStage& stage,
         for (const auto& col : stage.columns)
             mapped.columnNames.push_back(getExprName(col));
 
+        const std::vector<ExprPtr> exprs = simplifyExprs(stage.columns, current.columnNames);
         for (const auto& row : current.rows) {
             Row newRow = row; // keep existing columns
-            for (const auto& col : stage.columns)
-                newRow.push_back(evaluate(col, row, current.columnNames));
+            for (const auto& expr : exprs)
+                newRow.push_back(evaluate(expr, row, current.columnNames));
             mapped.rows.push_back(newRow);
         }
         return mapped;
@@ -865,103 +1194,289 @@ QueryResult Executor::applyPipelineStage(const PipelineStage& stage,
     return current;
 }
 
-// ---------------------------------------------------------------------------
-// Transaction support
-// ---------------------------------------------------------------------------
-
-QueryResult Executor::executeBegin() {
-    db_->beginTransaction();
-    return QueryResult("Transaction started.");
-}
-
-QueryResult Executor::executeCommit() {
-    db_->commitTransaction();
-    return QueryResult("Transaction committed.");
-}
-
-QueryResult Executor::executeRollback() {
-    db_->rollbackTransaction();
-    return QueryResult("Transaction rolled back.");
-}
-
-// ---------------------------------------------------------------------------
-// SHOW TABLES / DESCRIBE
-// ---------------------------------------------------------------------------
-
-QueryResult Executor::executeShowTables() {
-    return db_->showTables();
+QueryResult Executor::filterRows(const ExprPtr& condition,
+                                 const std::vector<std::string>& colNames,
+                                 const std::vector<Row>& rows) const {
+    auto pred = buildPredicate(condition, colNames);
+    QueryResult filtered;
+    filtered.columnNames = colNames;
+    for (const auto& row : rows) {
+        if (pred(row)) filtered.rows.push_back(row);
+    }
+    return filtered;
 }
 
-QueryResult Executor::executeDescribe(const DescribeStmt& stmt) {
-    const Table& table = db_->getTable(stmt.tableName);
-    return table.describe();
+bool Executor::indexAccess(const ExprPtr& condition, const Table& table,
+                           const std::vector<std::string>& colNames, IndexAccess& access) const {
+    std::vector<ExprPtr> conjuncts;
+    splitConjuncts(simplifyExpr(condition, colNames), conjuncts);
+    auto indexOn = [&](const ExprPtr& expr) -> const BTreeIndex* {
+        auto col = std::dynamic_pointer_cast<ColumnExpr>(expr);
+        int ci = col ? resolveColumn(col->fullName(), colNames) : -1;
+        return ci < 0 ? nullptr : table.getIndexForColumn(colNames[static_cast<size_t>(ci)]);
+    };
+    // Key lookups first: they are at least as selective as a prefix
+    for (const auto& conjunct : conjuncts) {
+        if (auto in = std::dynamic_pointer_cast<InExpr>(conjunct);
+            in && !in->negated && in->constants) {
+            if (const BTreeIndex* index = indexOn(in->expr)) {
+                access.index = index;
+                access.keys = in->constants->values;
+                return true;
+            }
+        }
+        if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(conjunct);
+            bin && (bin->op == "==" || bin->op == "=")) {
+            auto lit = std::dynamic_pointer_cast<LiteralExpr>(bin->right);
+            const BTreeIndex* index = lit ? indexOn(bin->left) : nullptr;
+            if (index) {
+                access.index = index;
+                access.keys = {lit->value};
+                return true;
+            }
+        }
+    }
+    for (const auto& conjunct : conjuncts) {
+        auto like = std::dynamic_pointer_cast<LikeExpr>(conjunct);
+        if (!like || like->negated || like->matcher->literalPrefix().empty()) continue;
+        if (const BTreeIndex* index = indexOn(like->expr)) {
+            access.index = index;
+            access.prefix = like->matcher->literalPrefix();
+            return true;
+        }
+    }
+    return false;
 }
 
-// ---------------------------------------------------------------------------
-// PRINT
-// ---------------------------------------------------------------------------
-
-QueryResult Executor::executePrint(const PrintStmt& stmt) {
-    Value val = evaluate(stmt.expr);
-    std::cout << val.asString() << "\n";
-    QueryResult result(val.asString());
-    result.columnNames = {"output"};
-    result.rows.push_back({val});
-    return result;
+std::string Executor::IndexAccess::describe() const {
+    if (keys.empty()) return "Scan index '" + index->getName() + "' for prefix '" + prefix + "'";
+    return "Look up " + std::to_string(keys.size()) + " key(s) in index '" + index->getName() + "'";
 }
 
-// ---------------------------------------------------------------------------
-// Variable / assignment / control flow / functions
-// ---------------------------------------------------------------------------
+std::vector<Row> Executor::indexScan(const Table& table, const IndexAccess& access) const {
+    std::set<size_t> positions;
+    for (const auto& key : access.keys) {
+        std::set<size_t> found = access.index->find(key);
+        positions.insert(found.begin(), found.end());
+    }
 
-QueryResult Executor::executeVarDecl(const VarDeclStmt& stmt) {
-    for (const auto& name : stmt.names) {
-        switch (stmt.type) {
-            case ValueType::INT:    variables_[name] = Value(0); break;
-            case ValueType::DOUBLE: variables_[name] = Value(0.0); break;
-            case ValueType::STRING: variables_[name] = Value(std::string("")); break;
-            case ValueType::BOOL:   variables_[name] = Value(false); break;
-            default:                variables_[name] = Value(); break;
+    // The index orders keys by their bytes while LIKE ignores letter case,
+    // so every casing of the prefix is looked up.  Past a few letters the
+    // prefix is cut short, which only widens the candidate set.
+    if (access.keys.empty()) {
+        constexpr size_t maxCaseLetters = 6;
+        const std::string& prefix = access.prefix;
+        std::vector<size_t> letters;
+        size_t length = 0;
+        for (; length < prefix.size(); length++) {
+            if (prefix[length] < 'a' || prefix[length] > 'z') continue;
+            if (letters.size() == maxCaseLetters) break;
+            letters.push_back(length);
+        }
+        for (size_t mask = 0; mask < (size_t(1) << letters.size()); mask++) {
+            std::string variant = prefix.substr(0, length);
+            for (size_t bit = 0; bit < letters.size(); bit++)
+                if (mask & (size_t(1) << bit))
+                    variant[letters[bit]] = static_cast<char>(variant[letters[bit]] - 'a' + 'A');
+            std::set<size_t> found = access.index->findPrefix(variant);
+            positions.insert(found.begin(), found.end());
         }
     }
-    return QueryResult("Variable(s) declared.");
-}
 
-QueryResult Executor::executeAssign(const AssignStmt& stmt) {
-    Value val = evaluate(stmt.value);
-    variables_[stmt.varName] = val;
-    return QueryResult("Variable '" + stmt.varName + "' assigned.");
+    const auto& rows = table.getRows();
+    std::vector<Row> candidates;
+    candidates.reserve(positions.size());
+    for (size_t position : positions)
+        if (position < rows.size()) candidates.push_back(rows[position]);
+    operatorAccess_ = "index '" + access.index->getName() + "'";
+    return candidates;
 }
 
-QueryResult Executor::executeIf(const IfStmt& stmt) {
-    Value cond = evaluate(stmt.condition);
-    if (cond.asBool()) {
-        return executeAll(stmt.thenBody);
-    } else if (!stmt.elseBody.empty()) {
-        return executeAll(stmt.elseBody);
+QueryResult Executor::projectRows(const PipelineStage& stage,
+                                  const std::vector<std::string>& colNames,
+                                  const std::vector<Row>& rows) const {
+    QueryResult projected;
+    bool hasStar = false;
+    for (const auto& col : stage.columns) {
+        if (std::dynamic_pointer_cast<StarExpr>(col)) {
+            hasStar = true;
+            break;
+        }
+    }
+
+    if (hasStar) {
+        projected.columnNames = colNames;
+        projected.rows = rows;
+    } else {
+        // Check for aggregates
+        bool hasAgg = false;
+        for (const auto& col : stage.columns) {
+            ExprPtr inner = col;
+            if (auto alias = std::dynamic_pointer_cast<AliasExpr>(col))
+                inner = alias->expr;
+            if (auto fc = std::dynamic_pointer_cast<FunctionCallExpr>(inner)) {
+                std::string lower = fc->name;
+                std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+                if (lower == "count" || lower == "sum" || lower == "avg" ||
+                    lower == "min" || lower == "max") {
+                    hasAgg = true;
+                    break;
+                }
+            }
+        }
+
+        for (const auto& col : stage.columns)
+            projected.columnNames.push_back(getExprName(col));
+
+        if (hasAgg) {
+            Row aggRow;
+            for (const auto& col : stage.columns) {
+                ExprPtr inner = col;
+                if (auto alias = std::dynamic_pointer_cast<AliasExpr>(col))
+                    inner = alias->expr;
+                if (auto fc = std::dynamic_pointer_cast<FunctionCallExpr>(inner))
+                    aggRow.push_back(evaluateAggregate(*fc, rows, colNames));
+                else
+                    aggRow.push_back(rows.empty() ? Value() : evaluate(col, rows[0], colNames));
+            }
+            projected.rows.push_back(aggRow);
+        } else {
+            const std::vector<ExprPtr> exprs = simplifyExprs(stage.columns, colNames);
+            for (const auto& row : rows) {
+                Row projRow;
+                for (const auto& expr : exprs)
+                    projRow.push_back(evaluate(expr, row, colNames));
+                projected.rows.push_back(projRow);
+            }
+        }
     }
-    return QueryResult("OK");
+
+    if (stage.selectDistinct)
+        distinctRows(projected.rows);
+
+    return projected;
 }
 
-QueryResult Executor::executeWhile(const WhileStmt& stmt) {
-    QueryResult last("OK");
-    while (true) {
-        Value cond = evaluate(stmt.condition);
-        if (!cond.asBool()) break;
-        last = executeAll(stmt.body);
-        if (!last.success) return last;
+// ---------------------------------------------------------------------------
+// Transaction support
+// ---------------------------------------------------------------------------
+
+// Transactions belong to the session.  Their locks are held until COMMIT
+// or ROLLBACK, so other sessions never see uncommitted rows; a rollback
+// puts back the tables the transaction wrote.
+
+QueryResult Executor::executeBegin() {
+    if (inTransaction_)
+        throw std::runtime_error("Nested transactions not supported");
+    inTransaction_ = true;
+    snapshots_.clear();
+    return QueryResult("Transaction started.");
+}
+
+QueryResult Executor::executeCommit() {
+    if (!inTransaction_)
+        throw std::runtime_error("No active transaction");
+    inTransaction_ = false;
+    snapshots_.clear();
+    return QueryResult("Transaction committed.");
+}
+
+QueryResult Executor::executeRollback() {
+    if (!inTransaction_)
+        throw std::runtime_error("No active transaction");
+    rollbackTransaction();
+    return QueryResult("Transaction rolled back.");
+}
+
+// ---------------------------------------------------------------------------
+// SHOW TABLES / DESCRIBE
+// ---------------------------------------------------------------------------
+
+QueryResult Executor::executeShowTables() {
+    return db_->showTables();
+}
+
+QueryResult Executor::executeDescribe(const DescribeStmt& stmt) {
+    const Table& table = db_->getTable(stmt.tableName);
+    return table.describe();
+}
+
+// ---------------------------------------------------------------------------
+// PRINT
+// ---------------------------------------------------------------------------
+
+QueryResult Executor::executePrint(const PrintStmt& stmt) {
+    Value val = evaluate(stmt.expr);
+    *out_ << val.asString() << "\n";
+    QueryResult result(val.asString());
+    result.columnNames = {"output"};
+    result.rows.push_back({val});
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Variable / assignment / control flow / functions
+// ---------------------------------------------------------------------------
+
+QueryResult Executor::executeVarDecl(const VarDeclStmt& stmt) {
+    for (size_t i = 0; i < stmt.names.size(); i++) {
+        Value initial;
+        switch (stmt.type) {
+            case ValueType::INT:    initial = Value(0); break;
+            case ValueType::DOUBLE: initial = Value(0.0); break;
+            case ValueType::STRING: initial = Value(std::string("")); break;
+            case ValueType::BOOL:   initial = Value(false); break;
+            default:                break;
+        }
+        if (i < stmt.slots.size() && !frames_.empty()) {
+            const size_t slot = frames_.back().base + static_cast<size_t>(stmt.slots[i]);
+            locals_[slot] = std::move(initial);
+            assigned_[slot] = 1;
+        } else {
+            variables_[stmt.names[i]] = std::move(initial);
+        }
     }
-    return last;
+    return QueryResult("Variable(s) declared.");
+}
+
+QueryResult Executor::executeAssign(const AssignStmt& stmt) {
+    Value val = evaluate(stmt.value);
+    if (stmt.slot >= 0 && !frames_.empty()) {
+        const size_t slot = frames_.back().base + static_cast<size_t>(stmt.slot);
+        locals_[slot] = std::move(val);
+        assigned_[slot] = 1;
+    } else {
+        variables_[stmt.varName] = std::move(val);
+    }
+    return QueryResult("Variable '" + stmt.varName + "' assigned.");
+}
+
+// IF and WHILE compile to bytecode each time they run at the top level;
+// inside a function body they are part of the function's chunk
+QueryResult Executor::executeIf(const IfStmt& stmt) {
+    BytecodeCompiler compiler(!frames_.empty());
+    compiler.ifStatement(stmt);
+    return run(compiler.finish());
+}
+
+QueryResult Executor::executeWhile(const WhileStmt& stmt) {
+    BytecodeCompiler compiler(!frames_.empty());
+    compiler.whileStatement(stmt);
+    return run(compiler.finish());
 }
 
 QueryResult Executor::executeFuncDef(const FuncDefStmt& stmt) {
-    functions_[stmt.name] = std::make_shared<FuncDefStmt>(stmt);
+    functions_[stmt.name] = compileFunction(stmt);
+    functionDefinitions_++;
     return QueryResult("Function '" + stmt.name + "' defined.");
 }
 
 QueryResult Executor::executeReturn(const ReturnStmt& stmt) {
-    Value val = stmt.value ? evaluate(stmt.value) : Value();
-    throw ReturnException(val);
+    if (frames_.empty())
+        throw std::runtime_error("return outside of a function");
+    returnValue_ = stmt.value ? evaluate(stmt.value) : Value();
+    returning_ = true;
+    return QueryResult();
 }
 
 QueryResult Executor::executeFuncCall(const FuncCallStmt& stmt) {
@@ -969,27 +1484,358 @@ QueryResult Executor::executeFuncCall(const FuncCallStmt& stmt) {
     if (it == functions_.end())
         return QueryResult("Error: undefined function '" + stmt.name + "'", false);
 
-    const auto& funcDef = it->second;
+    std::shared_ptr<CompiledFunction> function = it->second;
+    std::vector<Value> args;
+    args.reserve(stmt.args.size());
+    for (const auto& arg : stmt.args) args.push_back(evaluate(arg));
+    QueryResult result;
+    callFunction(*function, args.data(), args.size(), &result);
+    return result;
+}
+
+std::shared_ptr<CompiledFunction> Executor::compileFunction(const FuncDefStmt& stmt) const {
+    auto function = std::make_shared<CompiledFunction>();
+    function->def = std::make_shared<FuncDefStmt>(stmt);
+    auto& slots = function->slots;
+    auto slotFor = [&slots](const std::string& name) {
+        return slots.emplace(name, static_cast<int>(slots.size())).first->second;
+    };
+    for (const auto& param : stmt.params) {
+        if (slots.count(param.second))
+            throw std::runtime_error("Duplicate parameter '" + param.second + "' in function '" +
+                                     stmt.name + "'");
+        slotFor(param.second);
+    }
+
+    // Every name the body declares or assigns is a local (functions defined
+    // inside the body get their own frames)...
+    std::function<void(const std::vector<StmtPtr>&)> declare = [&](const std::vector<StmtPtr>& body) {
+        for (const auto& s : body) {
+            if (auto decl = std::dynamic_pointer_cast<VarDeclStmt>(s)) {
+                decl->slots.clear();
+                for (const auto& name : decl->names) decl->slots.push_back(slotFor(name));
+            } else if (auto assign = std::dynamic_pointer_cast<AssignStmt>(s)) {
+                assign->slot = slotFor(assign->varName);
+            } else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(s)) {
+                declare(ifStmt->thenBody);
+                declare(ifStmt->elseBody);
+            } else if (auto loop = std::dynamic_pointer_cast<WhileStmt>(s)) {
+                declare(loop->body);
+            }
+        }
+    };
+    declare(function->def->body);
+
+    // ...and every plain name referring to one reads its slot
+    std::function<void(const ExprPtr&)> resolve = [&](const ExprPtr& e) {
+        if (auto col = std::dynamic_pointer_cast<ColumnExpr>(e)) {
+            auto it = col->tableName.empty() ? slots.find(col->columnName) : slots.end();
+            col->slot = it == slots.end() ? -1 : it->second;
+            return;
+        }
+        forEachSubExpr(e, resolve);
+    };
+    std::function<void(const std::vector<StmtPtr>&)> annotate = [&](const std::vector<StmtPtr>& body) {
+        for (const auto& s : body) {
+            forEachStmtExpr(s, resolve);
+            if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(s)) {
+                annotate(ifStmt->thenBody);
+                annotate(ifStmt->elseBody);
+            } else if (auto loop = std::dynamic_pointer_cast<WhileStmt>(s)) {
+                annotate(loop->body);
+            } else if (auto explain = std::dynamic_pointer_cast<ExplainStmt>(s)) {
+                annotate({explain->innerStmt});
+            }
+        }
+    };
+    annotate(function->def->body);
 
-    // Save current variables and set up params
-    auto savedVars = variables_;
+    function->slotCount = slots.size();
+    BytecodeCompiler compiler(true);
+    compiler.block(function->def->body);
+    function->code = compiler.finish();
+    return function;
+}
 
-    for (size_t i = 0; i < funcDef->params.size(); i++) {
-        Value argVal = (i < stmt.args.size()) ? evaluate(stmt.args[i]) : Value();
-        variables_[funcDef->params[i].second] = argVal;
+Value Executor::callFunction(const CompiledFunction& function, Value* args, size_t argCount,
+                             QueryResult* last) {
+    const FuncDefStmt& def = *function.def;
+    if (frames_.size() >= kMaxCallDepth)
+        throw std::runtime_error("Function '" + def.name + "' exceeded the maximum call depth of " +
+                                 std::to_string(kMaxCallDepth));
+
+    const size_t base = locals_.size();
+    locals_.resize(base + function.slotCount);
+    assigned_.resize(base + function.slotCount, 0);
+    for (size_t i = 0; i < def.params.size(); i++) {
+        if (i < argCount) locals_[base + i] = std::move(args[i]);
+        assigned_[base + i] = 1;
     }
+    frames_.push_back({&function, base});
+
+    // Pops the frame however the body leaves
+    struct FrameGuard {
+        Executor& executor;
+        size_t base;
+        ~FrameGuard() {
+            executor.frames_.pop_back();
+            executor.locals_.resize(base);
+            executor.assigned_.resize(base);
+            executor.returning_ = false;
+        }
+    } guard{*this, base};
 
-    QueryResult result("OK");
-    try {
-        result = executeAll(funcDef->body);
-    } catch (const ReturnException& ret) {
-        result = QueryResult(ret.value.asString());
-        result.columnNames = {"result"};
-        result.rows.push_back({ret.value});
+    QueryResult result = run(function.code, last != nullptr);
+    if (!result.success && !last) {
+        // A failing call inside an expression fails the expression
+        const std::string& message = result.message;
+        throw std::runtime_error(message.rfind("Error: ", 0) == 0 ? message.substr(7) : message);
+    }
+    if (!returning_) {
+        if (last) *last = std::move(result);
+        return Value();
+    }
+    Value value = std::move(returnValue_);
+    if (last) {
+        *last = QueryResult(value.asString());
+        last->columnNames = {"result"};
+        last->rows.push_back({value});
+    }
+    return value;
+}
+
+// ---------------------------------------------------------------------------
+// Bytecode VM
+// ---------------------------------------------------------------------------
+
+// GCC and Clang jump straight from one instruction's code to the next
+// through a table of label addresses; other compilers get a switch
+#if defined(__GNUC__)
+#define EPEE_VM_COMPUTED_GOTO 1
+#else
+#define EPEE_VM_COMPUTED_GOTO 0
+#endif
+
+QueryResult Executor::run(const Chunk& chunk, bool wantResult) {
+    const size_t stackBase = vmStack_.size();
+    vmStack_.resize(stackBase + chunk.maxStack);
+    // Drops this run's operands however it leaves
+    struct StackGuard {
+        std::vector<Value>& stack;
+        size_t base;
+        ~StackGuard() { stack.resize(base); }
+    } stackGuard{vmStack_, stackBase};
+
+    const size_t frameBase = frames_.empty() ? 0 : frames_.back().base;
+    Value* stack = vmStack_.data() + stackBase;
+    Value* sp = stack;
+    Value* locals = locals_.data() + frameBase;
+    uint8_t* assigned = assigned_.data() + frameBase;
+    const Instruction* const code = chunk.code.data();
+    const Instruction* ip = code;
+    const Instruction* in = nullptr;
+
+    BlockResult result = BlockResult::EMPTY;
+    int32_t resultName = 0;
+    Value printed;
+    QueryResult executed;
+
+    // Calls and statements run through the executor can grow the operand
+    // and local stacks under us; `height` operands stay on ours
+#define VM_RELOAD(height)                              \
+    do {                                               \
+        stack = vmStack_.data() + stackBase;           \
+        sp = stack + (height);                         \
+        locals = locals_.data() + frameBase;           \
+        assigned = assigned_.data() + frameBase;       \
+    } while (0)
+
+    auto global = [&](int32_t name) -> Value& {
+        Value*& cached = chunk.globals[static_cast<size_t>(name)];
+        if (!cached) {
+            auto it = variables_.find(chunk.names[static_cast<size_t>(name)]);
+            if (it == variables_.end())
+                throw std::runtime_error("Undefined variable '" + chunk.names[static_cast<size_t>(name)] + "'");
+            cached = &it->second;
+        }
+        return *cached;
+    };
+    auto defineGlobal = [&](int32_t name) -> Value& {
+        Value*& cached = chunk.globals[static_cast<size_t>(name)];
+        if (!cached) cached = &variables_[chunk.names[static_cast<size_t>(name)]];
+        return *cached;
+    };
+
+#if EPEE_VM_COMPUTED_GOTO
+#define EPEE_VM_LABEL(name) &&op_##name,
+    static void* const labels[] = {EPEE_OPCODES(EPEE_VM_LABEL)};
+#undef EPEE_VM_LABEL
+#define VM_OP(name) op_##name:
+#define VM_NEXT()                                             \
+    do {                                                      \
+        in = ip++;                                            \
+        goto *labels[static_cast<size_t>(in->op)];            \
+    } while (0)
+    VM_NEXT();
+#else
+#define VM_OP(name) case OpCode::name:
+#define VM_NEXT() continue
+    for (;;) {
+        in = ip++;
+        switch (in->op) {
+#endif
+
+    VM_OP(CONST) {
+        *sp++ = chunk.constants[static_cast<size_t>(in->a)];
+        VM_NEXT();
+    }
+    VM_OP(LOAD_LOCAL) {
+        // A local not assigned yet reads the global of the same name
+        if (assigned[in->a]) *sp++ = locals[in->a];
+        else *sp++ = global(in->b);
+        VM_NEXT();
+    }
+    VM_OP(LOAD_GLOBAL) {
+        *sp++ = global(in->a);
+        VM_NEXT();
+    }
+    VM_OP(STORE_LOCAL) {
+        locals[in->a] = std::move(*--sp);
+        assigned[in->a] = 1;
+        result = BlockResult::ASSIGNED;
+        resultName = in->b;
+        VM_NEXT();
+    }
+    VM_OP(STORE_GLOBAL) {
+        defineGlobal(in->a) = std::move(*--sp);
+        result = BlockResult::ASSIGNED;
+        resultName = in->a;
+        VM_NEXT();
+    }
+    VM_OP(DECLARE_LOCAL) {
+        locals[in->a] = std::move(*--sp);
+        assigned[in->a] = 1;
+        result = BlockResult::DECLARED;
+        VM_NEXT();
+    }
+    VM_OP(DECLARE_GLOBAL) {
+        defineGlobal(in->a) = std::move(*--sp);
+        result = BlockResult::DECLARED;
+        VM_NEXT();
+    }
+    VM_OP(ADD) { sp--; sp[-1] = sp[-1] + sp[0]; VM_NEXT(); }
+    VM_OP(SUB) { sp--; sp[-1] = sp[-1] - sp[0]; VM_NEXT(); }
+    VM_OP(MUL) { sp--; sp[-1] = sp[-1] * sp[0]; VM_NEXT(); }
+    VM_OP(DIV) { sp--; sp[-1] = sp[-1] / sp[0]; VM_NEXT(); }
+    VM_OP(MOD) { sp--; sp[-1] = sp[-1] % sp[0]; VM_NEXT(); }
+    VM_OP(EQ) { sp--; sp[-1] = Value(sp[-1] == sp[0]); VM_NEXT(); }
+    VM_OP(NE) { sp--; sp[-1] = Value(sp[-1] != sp[0]); VM_NEXT(); }
+    VM_OP(LT) { sp--; sp[-1] = Value(sp[-1] < sp[0]); VM_NEXT(); }
+    VM_OP(GT) { sp--; sp[-1] = Value(sp[-1] > sp[0]); VM_NEXT(); }
+    VM_OP(LE) { sp--; sp[-1] = Value(sp[-1] <= sp[0]); VM_NEXT(); }
+    VM_OP(GE) { sp--; sp[-1] = Value(sp[-1] >= sp[0]); VM_NEXT(); }
+    VM_OP(NEG) { sp[-1] = -sp[-1]; VM_NEXT(); }
+    VM_OP(NOT) { sp[-1] = Value(!sp[-1].asBool()); VM_NEXT(); }
+    VM_OP(TRUTH) { sp[-1] = Value(sp[-1].asBool()); VM_NEXT(); }
+    VM_OP(JUMP) {
+        ip = code + in->a;
+        VM_NEXT();
+    }
+    VM_OP(JUMP_IF_FALSE) {
+        if (!(--sp)->asBool()) ip = code + in->a;
+        VM_NEXT();
+    }
+    VM_OP(JUMP_IF_TRUE) {
+        if ((--sp)->asBool()) ip = code + in->a;
+        VM_NEXT();
+    }
+    VM_OP(CALL) {
+        CallSite& site = chunk.callSites[static_cast<size_t>(in->a)];
+        if (site.generation != functionDefinitions_) {
+            auto it = functions_.find(site.name);
+            site.function = it == functions_.end() ? nullptr : it->second;
+            site.generation = functionDefinitions_;
+        }
+        Value* args = sp - in->b;
+        const ptrdiff_t height = args - stack;
+        Value value;
+        if (site.function) {
+            std::shared_ptr<CompiledFunction> function = site.function;  // the body may redefine it
+            value = callFunction(*function, args, static_cast<size_t>(in->b));
+        } else {
+            std::vector<Value> argVals(std::make_move_iterator(args), std::make_move_iterator(sp));
+            value = evaluateStringFunc(site.lowerName, argVals);
+        }
+        VM_RELOAD(height);
+        *sp++ = std::move(value);
+        VM_NEXT();
+    }
+    VM_OP(EVAL) {
+        const ptrdiff_t height = sp - stack;
+        Value value = evaluate(chunk.exprs[static_cast<size_t>(in->a)]);
+        VM_RELOAD(height);
+        *sp++ = std::move(value);
+        VM_NEXT();
+    }
+    VM_OP(EXEC) {
+        const ptrdiff_t height = sp - stack;
+        QueryResult stmtResult = execute(chunk.stmts[static_cast<size_t>(in->a)]);
+        VM_RELOAD(height);
+        if (!stmtResult.success || returning_) return stmtResult;
+        if (wantResult) executed = std::move(stmtResult);
+        result = BlockResult::EXECUTED;
+        VM_NEXT();
+    }
+    VM_OP(PRINT) {
+        Value value = std::move(*--sp);
+        *out_ << value.asString() << "\n";
+        if (wantResult) printed = std::move(value);
+        result = BlockResult::PRINTED;
+        VM_NEXT();
+    }
+    VM_OP(RETURN) {
+        if (frames_.empty()) throw std::runtime_error("return outside of a function");
+        returnValue_ = std::move(*--sp);
+        returning_ = true;
+        return QueryResult();
+    }
+    VM_OP(RESULT) {
+        result = static_cast<BlockResult>(in->a);
+        VM_NEXT();
+    }
+    VM_OP(HALT) {
+        goto halt;
     }
 
-    variables_ = savedVars;
-    return result;
+#if !EPEE_VM_COMPUTED_GOTO
+        }
+    }
+#endif
+#undef VM_OP
+#undef VM_NEXT
+#undef VM_RELOAD
+
+halt:
+    if (!wantResult) return QueryResult();
+    switch (result) {
+        case BlockResult::EMPTY:
+            return QueryResult();
+        case BlockResult::OK:
+            return QueryResult("OK");
+        case BlockResult::DECLARED:
+            return QueryResult("Variable(s) declared.");
+        case BlockResult::ASSIGNED:
+            return QueryResult("Variable '" + chunk.names[static_cast<size_t>(resultName)] + "' assigned.");
+        case BlockResult::PRINTED: {
+            QueryResult printResult(printed.asString());
+            printResult.columnNames = {"output"};
+            printResult.rows.push_back({printed});
+            return printResult;
+        }
+        case BlockResult::EXECUTED:
+            return executed;
+    }
+    return QueryResult();
 }
 
 // ---------------------------------------------------------------------------
@@ -1011,7 +1857,11 @@ Value Executor::evaluate(const ExprPtr& expr, const Row& row,
         if (idx >= 0 && idx < static_cast<int>(row.size()))
             return row[static_cast<size_t>(idx)];
 
-        // Try variable lookup
+        // Locals of the running function, then globals
+        if (col->slot >= 0 && !frames_.empty()) {
+            const size_t slot = frames_.back().base + static_cast<size_t>(col->slot);
+            if (assigned_[slot]) return locals_[slot];
+        }
         auto vit = variables_.find(col->columnName);
         if (vit != variables_.end()) return vit->second;
         if (!col->tableName.empty()) {
@@ -1068,33 +1918,21 @@ Value Executor::evaluate(const ExprPtr& expr, const Row& row,
 
     // FunctionCallExpr
     if (auto fc = std::dynamic_pointer_cast<FunctionCallExpr>(expr)) {
-        std::string lowerName = fc->name;
-        std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), ::tolower);
-
-        // Check for user-defined function first
+        // User-defined functions first.  evaluate() is const, but a call
+        // runs the body in a frame of its own that is gone again when it
+        // returns, so the session's state is as it was.
         auto fit = functions_.find(fc->name);
         if (fit != functions_.end()) {
-            // User-defined function call within const evaluate():
-            // The header declares evaluate() as const, but calling user-defined
-            // functions requires modifying variables_ for parameter binding.
-            // We save/restore state to maintain logical const-ness.
-            const auto& funcDef = fit->second;
-            auto savedVars = variables_;
-            auto& mutVars = const_cast<std::unordered_map<std::string, Value>&>(variables_);
-            for (size_t i = 0; i < funcDef->params.size(); i++) {
-                Value argVal = (i < fc->args.size()) ? evaluate(fc->args[i], row, colNames) : Value();
-                mutVars[funcDef->params[i].second] = argVal;
-            }
-            Value result;
-            try {
-                const_cast<Executor*>(this)->executeAll(funcDef->body);
-            } catch (const ReturnException& ret) {
-                result = ret.value;
-            }
-            mutVars = savedVars;
-            return result;
+            std::shared_ptr<CompiledFunction> function = fit->second;  // the body may redefine it
+            std::vector<Value> args;
+            args.reserve(fc->args.size());
+            for (const auto& arg : fc->args) args.push_back(evaluate(arg, row, colNames));
+            return const_cast<Executor*>(this)->callFunction(*function, args.data(), args.size());
         }
 
+        std::string lowerName = fc->name;
+        std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), ::tolower);
+
         // Aggregate functions — when evaluated per-row, operate on single value
         if (lowerName == "count" || lowerName == "sum" || lowerName == "avg" ||
             lowerName == "min" || lowerName == "max") {
@@ -1133,6 +1971,10 @@ Value Executor::evaluate(const ExprPtr& expr, const Row& row,
     // InExpr
     if (auto in = std::dynamic_pointer_cast<InExpr>(expr)) {
         Value val = evaluate(in->expr, row, colNames);
+        if (in->constants) {
+            const bool found = in->constants->contains(val);
+            return Value(in->negated ? !found : found);
+        }
         bool found = false;
         for (const auto& v : in->values) {
             if (val == evaluate(v, row, colNames)) {
@@ -1146,7 +1988,7 @@ Value Executor::evaluate(const ExprPtr& expr, const Row& row,
     // LikeExpr
     if (auto lk = std::dynamic_pointer_cast<LikeExpr>(expr)) {
         Value val = evaluate(lk->expr, row, colNames);
-        bool result = val.like(lk->pattern);
+        bool result = val.isString() && lk->matcher->matches(val.stringView());
         return Value(lk->negated ? !result : result);
     }
 
@@ -1469,12 +2311,308 @@ Value Executor::evaluateStringFunc(const std::string& name,
     throw std::runtime_error("Unknown function: " + name);
 }
 
+// ---------------------------------------------------------------------------
+// Expression simplification
+// ---------------------------------------------------------------------------
+
+namespace {
+
+bool isComparisonOp(const std::string& op) {
+    return op == "==" || op == "=" || op == "!=" || op == "<>" ||
+           op == "<" || op == ">" || op == "<=" || op == ">=";
+}
+
+// a op b == b flipped(op) a, exactly as Value defines the operators
+std::string flippedComparison(const std::string& op) {
+    if (op == "<") return ">";
+    if (op == ">") return "<";
+    if (op == "<=") return ">=";
+    if (op == ">=") return "<=";
+    return op;
+}
+
+// not (a op b) == a negated(op) b
+std::string negatedComparison(const std::string& op) {
+    if (op == "==" || op == "=") return "!=";
+    if (op == "!=" || op == "<>") return "==";
+    if (op == "<") return ">=";
+    if (op == ">=") return "<";
+    if (op == ">") return "<=";
+    return ">";  // <=
+}
+
+bool literalValue(const ExprPtr& expr, Value& out) {
+    auto lit = std::dynamic_pointer_cast<LiteralExpr>(expr);
+    if (lit) out = lit->value;
+    return lit != nullptr;
+}
+
+// Whether the expression always evaluates to a bool
+bool isBooleanExpr(const ExprPtr& expr) {
+    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr))
+        return isComparisonOp(bin->op) || bin->op == "and" || bin->op == "or";
+    if (auto un = std::dynamic_pointer_cast<UnaryExpr>(expr))
+        return un->op == "not" || un->op == "!";
+    if (auto lit = std::dynamic_pointer_cast<LiteralExpr>(expr))
+        return lit->value.isBool();
+    return std::dynamic_pointer_cast<BetweenExpr>(expr) || std::dynamic_pointer_cast<InExpr>(expr) ||
+           std::dynamic_pointer_cast<LikeExpr>(expr) || std::dynamic_pointer_cast<IsNullExpr>(expr);
+}
+
+// Whether skipping the expression's evaluation is unobservable: it calls
+// nothing and cannot fail (ordering comparisons and arithmetic throw on
+// incompatible types)
+bool isInert(const ExprPtr& expr) {
+    if (std::dynamic_pointer_cast<LiteralExpr>(expr) || std::dynamic_pointer_cast<ColumnExpr>(expr))
+        return true;
+    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+        const bool inertOp = bin->op == "==" || bin->op == "=" || bin->op == "!=" || bin->op == "<>" ||
+                             bin->op == "and" || bin->op == "or";
+        return inertOp && isInert(bin->left) && isInert(bin->right);
+    }
+    if (auto un = std::dynamic_pointer_cast<UnaryExpr>(expr))
+        return (un->op == "not" || un->op == "!") && isInert(un->operand);
+    if (auto isNull = std::dynamic_pointer_cast<IsNullExpr>(expr)) return isInert(isNull->expr);
+    if (auto like = std::dynamic_pointer_cast<LikeExpr>(expr)) return isInert(like->expr);
+    return false;
+}
+
+} // namespace
+
+ExprPtr Executor::simplifyExpr(const ExprPtr& expr, const std::vector<std::string>& colNames) const {
+    if (!expr) return expr;
+    auto literal = [](const Value& v) -> ExprPtr { return std::make_shared<LiteralExpr>(v); };
+    // Evaluate a node whose operands are all literals.  One that fails is
+    // left alone, to fail when a row evaluates it (if any row does).
+    auto fold = [&](const ExprPtr& e) -> ExprPtr {
+        try {
+            return literal(evaluate(e));
+        } catch (const std::exception&) {
+            return e;
+        }
+    };
+    Value lv, rv;
+
+    if (std::dynamic_pointer_cast<LiteralExpr>(expr)) return expr;
+
+    // A name that is not a column is a variable, which cannot change while
+    // the statement runs (function bodies only assign their own locals)
+    if (auto col = std::dynamic_pointer_cast<ColumnExpr>(expr)) {
+        const std::string name = col->fullName();
+        if (resolveColumn(name, colNames) >= 0) return expr;
+        if (col->slot >= 0 && !frames_.empty()) {
+            const size_t slot = frames_.back().base + static_cast<size_t>(col->slot);
+            if (assigned_[slot]) return literal(locals_[slot]);
+        }
+        auto vit = variables_.find(col->columnName);
+        if (vit == variables_.end() && !col->tableName.empty()) vit = variables_.find(name);
+        return vit != variables_.end() ? literal(vit->second) : expr;
+    }
+
+    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+        ExprPtr left = simplifyExpr(bin->left, colNames);
+        ExprPtr right = simplifyExpr(bin->right, colNames);
+        const bool leftLit = literalValue(left, lv);
+        const bool rightLit = literalValue(right, rv);
+        if (bin->op == "and") {
+            if (leftLit && !lv.asBool()) return literal(Value(false));
+            if (leftLit && isBooleanExpr(right)) return right;
+            if (rightLit && rv.asBool() && isBooleanExpr(left)) return left;
+            if (rightLit && !rv.asBool() && isInert(left)) return literal(Value(false));
+        } else if (bin->op == "or") {
+            if (leftLit && lv.asBool()) return literal(Value(true));
+            if (leftLit && isBooleanExpr(right)) return right;
+            if (rightLit && !rv.asBool() && isBooleanExpr(left)) return left;
+            if (rightLit && rv.asBool() && isInert(left)) return literal(Value(true));
+        } else if (leftLit && !rightLit && isComparisonOp(bin->op)) {
+            // Column on the left: 5 < x becomes x > 5
+            return std::make_shared<BinaryExpr>(right, flippedComparison(bin->op), left);
+        }
+        ExprPtr rebuilt = left == bin->left && right == bin->right
+                              ? expr : std::make_shared<BinaryExpr>(left, bin->op, right);
+        return leftLit && rightLit ? fold(rebuilt) : rebuilt;
+    }
+
+    if (auto un = std::dynamic_pointer_cast<UnaryExpr>(expr)) {
+        ExprPtr operand = simplifyExpr(un->operand, colNames);
+        ExprPtr rebuilt = operand == un->operand ? expr : std::make_shared<UnaryExpr>(un->op, operand);
+        if (literalValue(operand, lv)) return fold(rebuilt);
+        if (un->op != "not" && un->op != "!") return rebuilt;
+        // Push NOT into what it negates
+        if (auto inner = std::dynamic_pointer_cast<UnaryExpr>(operand);
+            inner && (inner->op == "not" || inner->op == "!") && isBooleanExpr(inner->operand))
+            return inner->operand;
+        if (auto cmp = std::dynamic_pointer_cast<BinaryExpr>(operand); cmp && isComparisonOp(cmp->op))
+            return std::make_shared<BinaryExpr>(cmp->left, negatedComparison(cmp->op), cmp->right);
+        if (auto bet = std::dynamic_pointer_cast<BetweenExpr>(operand))
+            return std::make_shared<BetweenExpr>(bet->expr, bet->low, bet->high, !bet->negated);
+        if (auto in = std::dynamic_pointer_cast<InExpr>(operand)) {
+            auto negated = std::make_shared<InExpr>(in->expr, in->values, !in->negated);
+            negated->constants = in->constants;
+            return negated;
+        }
+        if (auto like = std::dynamic_pointer_cast<LikeExpr>(operand))
+            return std::make_shared<LikeExpr>(like->expr, *like, !like->negated);
+        if (auto isNull = std::dynamic_pointer_cast<IsNullExpr>(operand))
+            return std::make_shared<IsNullExpr>(isNull->expr, !isNull->isNot);
+        return rebuilt;
+    }
+
+    if (auto fc = std::dynamic_pointer_cast<FunctionCallExpr>(expr)) {
+        std::vector<ExprPtr> args;
+        bool changed = false, constant = true;
+        for (const auto& arg : fc->args) {
+            args.push_back(simplifyExpr(arg, colNames));
+            changed = changed || args.back() != arg;
+            constant = constant && std::dynamic_pointer_cast<LiteralExpr>(args.back());
+        }
+        ExprPtr rebuilt = changed ? std::make_shared<FunctionCallExpr>(fc->name, std::move(args)) : expr;
+        // User-defined functions may have side effects, and aggregates
+        // mean something else per row
+        std::string lower = fc->name;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        const bool deterministic = !functions_.count(fc->name) && lower != "random" && lower != "now" &&
+                                   lower != "count" && lower != "sum" && lower != "avg" &&
+                                   lower != "min" && lower != "max";
+        return constant && deterministic ? fold(rebuilt) : rebuilt;
+    }
+
+    if (auto alias = std::dynamic_pointer_cast<AliasExpr>(expr)) {
+        ExprPtr inner = simplifyExpr(alias->expr, colNames);
+        return inner == alias->expr ? expr : std::make_shared<AliasExpr>(inner, alias->alias);
+    }
+
+    if (auto bet = std::dynamic_pointer_cast<BetweenExpr>(expr)) {
+        ExprPtr value = simplifyExpr(bet->expr, colNames);
+        ExprPtr low = simplifyExpr(bet->low, colNames);
+        ExprPtr high = simplifyExpr(bet->high, colNames);
+        ExprPtr rebuilt = value == bet->expr && low == bet->low && high == bet->high
+                              ? expr : std::make_shared<BetweenExpr>(value, low, high, bet->negated);
+        const bool constant = literalValue(value, lv) && literalValue(low, lv) && literalValue(high, lv);
+        return constant ? fold(rebuilt) : rebuilt;
+    }
+
+    if (auto in = std::dynamic_pointer_cast<InExpr>(expr)) {
+        ExprPtr value = simplifyExpr(in->expr, colNames);
+        std::vector<ExprPtr> values;
+        std::vector<Value> constants;
+        bool listConstant = true;
+        for (const auto& v : in->values) {
+            values.push_back(simplifyExpr(v, colNames));
+            Value c;
+            listConstant = listConstant && literalValue(values.back(), c);
+            if (listConstant) constants.push_back(std::move(c));
+        }
+        // x in (v) is x == v, which predicates compare without evaluating
+        if (values.size() == 1)
+            return simplifyExpr(std::make_shared<BinaryExpr>(value, in->negated ? "!=" : "==", values[0]),
+                                colNames);
+        auto rebuilt = std::make_shared<InExpr>(value, std::move(values), in->negated);
+        // A constant list is evaluated here once instead of on every row.
+        // The copy keeps the cached statement's own node unchanged, since
+        // its literals are rebound between executions.
+        if (listConstant) rebuilt->constants = std::make_shared<const InValues>(std::move(constants));
+        return literalValue(value, lv) && listConstant ? fold(rebuilt) : rebuilt;
+    }
+
+    if (auto like = std::dynamic_pointer_cast<LikeExpr>(expr)) {
+        ExprPtr value = simplifyExpr(like->expr, colNames);
+        ExprPtr rebuilt = value == like->expr ? expr
+                                              : std::make_shared<LikeExpr>(value, *like, like->negated);
+        return literalValue(value, lv) ? fold(rebuilt) : rebuilt;
+    }
+
+    if (auto isNull = std::dynamic_pointer_cast<IsNullExpr>(expr)) {
+        ExprPtr value = simplifyExpr(isNull->expr, colNames);
+        ExprPtr rebuilt = value == isNull->expr ? expr : std::make_shared<IsNullExpr>(value, isNull->isNot);
+        return literalValue(value, lv) ? fold(rebuilt) : rebuilt;
+    }
+
+    // CASE: WHENs known to be false drop out, and one known to be true
+    // ends the list
+    if (auto cs = std::dynamic_pointer_cast<CaseExpr>(expr)) {
+        auto rebuilt = std::make_shared<CaseExpr>();
+        bool changed = false, decided = false;
+        for (const auto& when : cs->whenClauses) {
+            ExprPtr condition = simplifyExpr(when.condition, colNames);
+            ExprPtr result = simplifyExpr(when.result, colNames);
+            changed = changed || condition != when.condition || result != when.result;
+            if (literalValue(condition, lv)) {
+                changed = true;
+                if (!lv.asBool()) continue;
+                rebuilt->elseResult = result;  // later WHENs and the ELSE never run
+                decided = true;
+                break;
+            }
+            rebuilt->whenClauses.push_back({condition, result});
+        }
+        if (!decided && cs->elseResult) {
+            rebuilt->elseResult = simplifyExpr(cs->elseResult, colNames);
+            changed = changed || rebuilt->elseResult != cs->elseResult;
+        }
+        if (!changed) return expr;
+        if (rebuilt->whenClauses.empty()) return rebuilt->elseResult ? rebuilt->elseResult : literal(Value());
+        return rebuilt;
+    }
+
+    return expr;
+}
+
+std::vector<ExprPtr> Executor::simplifyExprs(const std::vector<ExprPtr>& exprs,
+                                             const std::vector<std::string>& colNames) const {
+    std::vector<ExprPtr> out;
+    out.reserve(exprs.size());
+    for (const auto& e : exprs) out.push_back(simplifyExpr(e, colNames));
+    return out;
+}
+
 // ---------------------------------------------------------------------------
 // Predicate builder
 // ---------------------------------------------------------------------------
 
 std::function<bool(const Row&)> Executor::buildPredicate(
-    const ExprPtr& expr, const std::vector<std::string>& colNames) const {
+    const ExprPtr& condition, const std::vector<std::string>& colNames) const {
+    ExprPtr expr = simplifyExpr(condition, colNames);
+    Value constant;
+    if (literalValue(expr, constant)) {
+        const bool keep = constant.asBool();
+        return [keep](const Row&) { return keep; };
+    }
+
+    // column == 'literal' (or !=): compare the cell directly, and on
+    // dictionary-encoded columns compare codes
+    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+        bool eq = bin->op == "==" || bin->op == "=";
+        bool ne = bin->op == "!=" || bin->op == "<>";
+        auto col = std::dynamic_pointer_cast<ColumnExpr>(bin->left);
+        auto lit = std::dynamic_pointer_cast<LiteralExpr>(bin->right);
+        if (!col || !lit) {
+            col = std::dynamic_pointer_cast<ColumnExpr>(bin->right);
+            lit = std::dynamic_pointer_cast<LiteralExpr>(bin->left);
+        }
+        int ci = col ? resolveColumn(col->fullName(), colNames) : -1;
+        if ((eq || ne) && lit && ci >= 0) {
+            struct Cached { const detail::StringDictionary* dict = nullptr; Value literal; };
+            auto cache = std::make_shared<Cached>();
+            cache->literal = lit->value;
+            return [this, expr, colNames, ci, ne, cache](const Row& row) -> bool {
+                if (static_cast<size_t>(ci) >= row.size())
+                    return evaluate(expr, row, colNames).asBool();
+                const Value& cell = row[ci];
+                const detail::StringDictionary* dict = cell.dictionary();
+                if (dict && dict != cache->dict && cache->literal.isString()) {
+                    // Re-express the literal in this dictionary (if present)
+                    // so later rows compare codes
+                    cache->dict = dict;
+                    int64_t code = dict->find(cache->literal.stringView());
+                    if (code >= 0)
+                        cache->literal = Value::encoded(dict, static_cast<uint32_t>(code));
+                }
+                return (cell == cache->literal) != ne;
+            };
+        }
+    }
+
     return [this, expr, colNames](const Row& row) -> bool {
         Value result = evaluate(expr, row, colNames);
         return result.asBool();
@@ -1558,7 +2696,9 @@ std::string Executor::getExprName(const ExprPtr& expr) const {
 void Executor::sortResult(QueryResult& result,
                           const std::vector<std::pair<ExprPtr, bool>>& orderCols) {
     const auto& colNames = result.columnNames;
-    std::sort(result.rows.begin(), result.rows.end(),
+    // Stable, so rows that tie keep their input order (and filtering before
+    // or after the sort gives the same result)
+    std::stable_sort(result.rows.begin(), result.rows.end(),
         [this, &orderCols, &colNames](const Row& a, const Row& b) -> bool {
             for (const auto& [expr, ascending] : orderCols) {
                 Value va = evaluate(expr, a, colNames);
@@ -1594,6 +2734,15 @@ QueryResult Executor::groupAndAggregate(QueryResult& input,
                                          const ExprPtr& havingClause) {
     const auto& colNames = input.columnNames;
 
+    if (!havingClause && !selectCols.empty()) {
+        QueryResult aggregated;
+        if (partialAggregate(input, groupCols, selectCols, aggregated)) {
+            operatorAccess_ = "hash table";
+            return aggregated;
+        }
+    }
+    operatorAccess_ = "ordered map";
+
     // Build groups: key -> rows
     std::map<std::vector<std::string>, std::vector<Row>> groups;
     std::vector<std::vector<std::string>> groupOrder; // preserve insertion order
@@ -1674,11 +2823,361 @@ QueryResult Executor::groupAndAggregate(QueryResult& input,
     return result;
 }
 
-// File-local helper implementation
-static Value evaluateGroupExprHelper(const ExprPtr& expr,
-                                      const std::vector<Row>& groupRows,
-                                      const std::vector<std::string>& colNames) {
-
+// ---------------------------------------------------------------------------
+// Parallel partial aggregation
+// ---------------------------------------------------------------------------
+
+// One output column of a partially aggregated select list
+struct PartialAggSpec {
+    enum class Kind { COUNT_STAR, COUNT, SUM, AVG, MIN, MAX, FIRST };
+    Kind kind;
+    ExprPtr expr;  // aggregate argument, or the whole column for FIRST
+};
+
+// Running state of one aggregate inside one group
+struct PartialAggState {
+    long long count = 0;
+    double sum = 0.0;
+    bool allInt = true;
+    bool hasExtreme = false;
+    Value extreme;
+};
+
+struct PartialGroup {
+    size_t firstRow = 0;  // input position of the group's first row
+    std::vector<PartialAggState> states;
+};
+
+// Thread-local hash table of partial groups
+struct PartialGroupTable {
+    std::unordered_map<std::string, size_t> index;
+    std::vector<std::string> keys;
+    std::vector<PartialGroup> groups;
+};
+
+// Group keys are the concatenated string forms of the key columns, each
+// length-prefixed so that ("ab","c") and ("a","bc") stay distinct.
+static void appendGroupKeyPart(std::string& key, const std::string& part) {
+    uint32_t len = static_cast<uint32_t>(part.size());
+    key.append(reinterpret_cast<const char*>(&len), sizeof(len));
+    key.append(part);
+}
+
+// Key part for a value of a dictionary-encoded column: the code (behind a
+// marker no string length can take) instead of the characters.  Values that
+// are not encoded against `dict` are looked up by text, so every form of the
+// same string still yields the same key.
+static void appendGroupKeyValue(std::string& key, const Value& v,
+                                const detail::StringDictionary* dict) {
+    if (!dict) {
+        appendGroupKeyPart(key, v.asString());
+        return;
+    }
+    int64_t code;
+    if (v.dictionary() == dict) {
+        code = v.dictionaryCode();
+    } else {
+        std::string text = v.asString();
+        code = dict->find(text);
+        if (code < 0) {
+            appendGroupKeyPart(key, text);
+            return;
+        }
+    }
+    uint32_t marker = UINT32_MAX;
+    uint32_t code32 = static_cast<uint32_t>(code);
+    key.append(reinterpret_cast<const char*>(&marker), sizeof(marker));
+    key.append(reinterpret_cast<const char*>(&code32), sizeof(code32));
+}
+
+// Dictionary of the first non-null value in column `col`, if it is encoded
+static const detail::StringDictionary* columnDictionary(const std::vector<Row>& rows, int col) {
+    if (col < 0) return nullptr;
+    for (const auto& row : rows) {
+        if (static_cast<size_t>(col) >= row.size() || row[col].isNull()) continue;
+        return row[col].dictionary();
+    }
+    return nullptr;
+}
+
+void Executor::distinctRows(std::vector<Row>& rows) {
+    if (rows.empty()) return;
+    const size_t width = rows[0].size();
+    std::vector<const detail::StringDictionary*> dicts(width);
+    for (size_t c = 0; c < width; c++)
+        dicts[c] = columnDictionary(rows, static_cast<int>(c));
+
+    std::unordered_set<std::string> seen;
+    std::vector<Row> unique;
+    std::string key;
+    for (auto& row : rows) {
+        key.clear();
+        for (size_t c = 0; c < row.size(); c++)
+            appendGroupKeyValue(key, row[c], c < width ? dicts[c] : nullptr);
+        if (seen.insert(key).second)
+            unique.push_back(std::move(row));
+    }
+    rows = std::move(unique);
+}
+
+static void accumulatePartial(PartialAggState& st, PartialAggSpec::Kind kind, const Value& v) {
+    switch (kind) {
+        case PartialAggSpec::Kind::COUNT_STAR:
+            st.count++;
+            break;
+        case PartialAggSpec::Kind::COUNT:
+            if (!v.isNull()) st.count++;
+            break;
+        case PartialAggSpec::Kind::SUM:
+            if (v.isNull()) break;
+            if (v.isDouble()) st.allInt = false;
+            st.sum += v.asDouble();
+            break;
+        case PartialAggSpec::Kind::AVG:
+            if (v.isNull()) break;
+            st.sum += v.asDouble();
+            st.count++;
+            break;
+        case PartialAggSpec::Kind::MIN:
+            if (v.isNull()) break;
+            if (!st.hasExtreme || v < st.extreme) { st.extreme = v; st.hasExtreme = true; }
+            break;
+        case PartialAggSpec::Kind::MAX:
+            if (v.isNull()) break;
+            if (!st.hasExtreme || v > st.extreme) { st.extreme = v; st.hasExtreme = true; }
+            break;
+        case PartialAggSpec::Kind::FIRST:
+            break;
+    }
+}
+
+static void mergePartial(PartialAggState& into, const PartialAggState& from,
+                         PartialAggSpec::Kind kind) {
+    into.count += from.count;
+    into.sum += from.sum;
+    into.allInt = into.allInt && from.allInt;
+    if (!from.hasExtreme) return;
+    bool take = !into.hasExtreme ||
+        (kind == PartialAggSpec::Kind::MIN && from.extreme < into.extreme) ||
+        (kind == PartialAggSpec::Kind::MAX && from.extreme > into.extreme);
+    if (take) { into.extreme = from.extreme; into.hasExtreme = true; }
+}
+
+static Value finalizePartial(const PartialAggState& st, PartialAggSpec::Kind kind) {
+    switch (kind) {
+        case PartialAggSpec::Kind::COUNT_STAR:
+        case PartialAggSpec::Kind::COUNT:
+            return Value(static_cast<int>(st.count));
+        case PartialAggSpec::Kind::SUM:
+            return st.allInt ? Value(static_cast<int>(st.sum)) : Value(st.sum);
+        case PartialAggSpec::Kind::AVG:
+            return st.count == 0 ? Value() : Value(st.sum / static_cast<double>(st.count));
+        case PartialAggSpec::Kind::MIN:
+        case PartialAggSpec::Kind::MAX:
+            return st.hasExtreme ? st.extreme : Value();
+        case PartialAggSpec::Kind::FIRST:
+            break;
+    }
+    return Value();
+}
+
+bool Executor::isParallelSafe(const ExprPtr& expr) const {
+    if (!expr) return true;
+    if (auto fc = std::dynamic_pointer_cast<FunctionCallExpr>(expr)) {
+        if (functions_.count(fc->name)) return false;
+        std::string lower = fc->name;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (lower == "random") return false;
+        for (const auto& a : fc->args)
+            if (!isParallelSafe(a)) return false;
+        return true;
+    }
+    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr))
+        return isParallelSafe(bin->left) && isParallelSafe(bin->right);
+    if (auto un = std::dynamic_pointer_cast<UnaryExpr>(expr))
+        return isParallelSafe(un->operand);
+    if (auto alias = std::dynamic_pointer_cast<AliasExpr>(expr))
+        return isParallelSafe(alias->expr);
+    if (auto bet = std::dynamic_pointer_cast<BetweenExpr>(expr))
+        return isParallelSafe(bet->expr) && isParallelSafe(bet->low) && isParallelSafe(bet->high);
+    if (auto in = std::dynamic_pointer_cast<InExpr>(expr)) {
+        if (!isParallelSafe(in->expr)) return false;
+        for (const auto& v : in->values)
+            if (!isParallelSafe(v)) return false;
+        return true;
+    }
+    if (auto lk = std::dynamic_pointer_cast<LikeExpr>(expr))
+        return isParallelSafe(lk->expr);
+    if (auto isn = std::dynamic_pointer_cast<IsNullExpr>(expr))
+        return isParallelSafe(isn->expr);
+    if (auto caseExpr = std::dynamic_pointer_cast<CaseExpr>(expr)) {
+        for (const auto& when : caseExpr->whenClauses)
+            if (!isParallelSafe(when.condition) || !isParallelSafe(when.result)) return false;
+        return isParallelSafe(caseExpr->elseResult);
+    }
+    return true;
+}
+
+bool Executor::partialAggregate(const QueryResult& input,
+                                const std::vector<ExprPtr>& groupCols,
+                                const std::vector<ExprPtr>& selectCols,
+                                QueryResult& out) const {
+    using Kind = PartialAggSpec::Kind;
+    const auto& colNames = input.columnNames;
+    const auto& rows = input.rows;
+
+    // Describe every output column as an aggregate or a first-row expression
+    std::vector<PartialAggSpec> specs;
+    for (const auto& oc : selectCols) {
+        if (std::dynamic_pointer_cast<StarExpr>(oc)) return false;
+        ExprPtr inner = oc;
+        if (auto alias = std::dynamic_pointer_cast<AliasExpr>(oc))
+            inner = alias->expr;
+
+        PartialAggSpec spec{Kind::FIRST, oc};
+        if (auto fc = std::dynamic_pointer_cast<FunctionCallExpr>(inner)) {
+            std::string lower = fc->name;
+            std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+            bool star = fc->args.empty() || std::dynamic_pointer_cast<StarExpr>(fc->args[0]);
+            if (lower == "count") {
+                spec = {star ? Kind::COUNT_STAR : Kind::COUNT, star ? nullptr : fc->args[0]};
+            } else if (lower == "sum" || lower == "avg" || lower == "min" || lower == "max") {
+                if (star) return false;
+                Kind k = lower == "sum" ? Kind::SUM : lower == "avg" ? Kind::AVG :
+                         lower == "min" ? Kind::MIN : Kind::MAX;
+                spec = {k, fc->args[0]};
+            }
+        }
+        if (!isParallelSafe(spec.expr)) return false;
+        specs.push_back(spec);
+    }
+    for (const auto& gc : groupCols)
+        if (!isParallelSafe(gc)) return false;
+
+    // Plain column keys are read directly; keys on dictionary-encoded
+    // columns group by code
+    std::vector<int> keyCols(groupCols.size(), -1);
+    std::vector<const detail::StringDictionary*> keyDicts(groupCols.size(), nullptr);
+    for (size_t k = 0; k < groupCols.size(); k++) {
+        if (auto col = std::dynamic_pointer_cast<ColumnExpr>(groupCols[k])) {
+            keyCols[k] = resolveColumn(col->fullName(), colNames);
+            keyDicts[k] = columnDictionary(rows, keyCols[k]);
+        }
+    }
+
+    // Phase 1: each worker folds its morsels into a thread-local table
+    size_t workers = workersFor(rows.size());
+    std::vector<PartialGroupTable> partials(workers);
+    parallelFor(rows.size(), kDefaultMorselSize, workers,
+        [&](size_t w, size_t begin, size_t end) {
+            PartialGroupTable& table = partials[w];
+            std::string key;
+            for (size_t r = begin; r < end; r++) {
+                const Row& row = rows[r];
+                key.clear();
+                for (size_t k = 0; k < groupCols.size(); k++) {
+                    if (keyCols[k] >= 0 && static_cast<size_t>(keyCols[k]) < row.size())
+                        appendGroupKeyValue(key, row[keyCols[k]], keyDicts[k]);
+                    else
+                        appendGroupKeyValue(key, evaluate(groupCols[k], row, colNames), keyDicts[k]);
+                }
+
+                auto found = table.index.find(key);
+                size_t gi;
+                if (found == table.index.end()) {
+                    gi = table.groups.size();
+                    table.index.emplace(key, gi);
+                    table.keys.push_back(key);
+                    table.groups.push_back({r, std::vector<PartialAggState>(specs.size())});
+                } else {
+                    gi = found->second;
+                }
+
+                PartialGroup& group = table.groups[gi];
+                for (size_t i = 0; i < specs.size(); i++) {
+                    Kind kind = specs[i].kind;
+                    if (kind == Kind::FIRST) continue;
+                    if (kind == Kind::COUNT_STAR)
+                        accumulatePartial(group.states[i], kind, Value());
+                    else
+                        accumulatePartial(group.states[i], kind, evaluate(specs[i].expr, row, colNames));
+                }
+            }
+        });
+
+    // Phase 2: merge partial tables one hash partition per task, so the
+    // final groups are built without a global lock
+    std::vector<PartialGroup> merged;
+    if (workers == 1) {
+        merged = std::move(partials[0].groups);
+    } else {
+        const size_t partitions = workers;
+        std::hash<std::string> hasher;
+        std::vector<std::vector<std::vector<size_t>>> buckets(
+            workers, std::vector<std::vector<size_t>>(partitions));
+        parallelTasks(workers, workers, [&](size_t w) {
+            const auto& keys = partials[w].keys;
+            for (size_t g = 0; g < keys.size(); g++) {
+                size_t h = hasher(keys[g]);
+                buckets[w][(h ^ (h >> 29)) % partitions].push_back(g);
+            }
+        });
+
+        std::vector<std::vector<PartialGroup>> mergedParts(partitions);
+        parallelTasks(partitions, workers, [&](size_t p) {
+            std::unordered_map<std::string, size_t> index;
+            auto& part = mergedParts[p];
+            for (size_t w = 0; w < workers; w++) {
+                for (size_t g : buckets[w][p]) {
+                    const std::string& key = partials[w].keys[g];
+                    PartialGroup& src = partials[w].groups[g];
+                    auto found = index.find(key);
+                    if (found == index.end()) {
+                        index.emplace(key, part.size());
+                        part.push_back(std::move(src));
+                        continue;
+                    }
+                    PartialGroup& dst = part[found->second];
+                    dst.firstRow = std::min(dst.firstRow, src.firstRow);
+                    for (size_t i = 0; i < specs.size(); i++)
+                        mergePartial(dst.states[i], src.states[i], specs[i].kind);
+                }
+            }
+        });
+
+        for (auto& part : mergedParts)
+            for (auto& group : part) merged.push_back(std::move(group));
+    }
+
+    // Groups are reported in order of first appearance, like the serial path
+    std::sort(merged.begin(), merged.end(),
+              [](const PartialGroup& a, const PartialGroup& b) { return a.firstRow < b.firstRow; });
+
+    out = QueryResult();
+    for (const auto& oc : selectCols)
+        out.columnNames.push_back(getExprName(oc));
+    out.rows.resize(merged.size());
+    parallelFor(merged.size(), kDefaultMorselSize, workersFor(merged.size()),
+        [&](size_t, size_t begin, size_t end) {
+            for (size_t g = begin; g < end; g++) {
+                Row& outRow = out.rows[g];
+                outRow.reserve(specs.size());
+                for (size_t i = 0; i < specs.size(); i++) {
+                    if (specs[i].kind == Kind::FIRST)
+                        outRow.push_back(evaluate(specs[i].expr, rows[merged[g].firstRow], colNames));
+                    else
+                        outRow.push_back(finalizePartial(merged[g].states[i], specs[i].kind));
+                }
+            }
+        });
+    return true;
+}
+
+// File-local helper implementation
+static Value evaluateGroupExprHelper(const ExprPtr& expr,
+                                      const std::vector<Row>& groupRows,
+                                      const std::vector<std::string>& colNames) {
+
     if (!expr) return Value();
 
     if (auto fc = std::dynamic_pointer_cast<FunctionCallExpr>(expr)) {
@@ -1816,14 +3315,11 @@ static Value evaluateGroupExprHelper(const ExprPtr& expr,
 // JOIN helper
 // ---------------------------------------------------------------------------
 
+// Marks the missing side of an outer-join row (in join sources and hash chains)
+static constexpr uint32_t kNoRow = UINT32_MAX;
+
 QueryResult Executor::performJoin(const Table& leftTable, const Table& rightTable,
                                   const ExprPtr& onCondition, const std::string& joinType) {
-    // For pipeline JOINs, leftTable is actually a QueryResult passed as reference.
-    // We overload by working with the QueryResult version in applyPipelineStage.
-    // This version works with two Table objects.
-    QueryResult result;
-
-    // Build column names
     std::vector<std::string> leftCols;
     for (const auto& c : leftTable.getColumns())
         leftCols.push_back(leftTable.getName() + "." + c.name);
@@ -1832,58 +3328,118 @@ QueryResult Executor::performJoin(const Table& leftTable, const Table& rightTabl
     for (const auto& c : rightTable.getColumns())
         rightCols.push_back(rightTable.getName() + "." + c.name);
 
-    result.columnNames.insert(result.columnNames.end(), leftCols.begin(), leftCols.end());
+    return joinRows(leftCols, leftTable.getRows(), rightCols, rightTable.getRows(),
+                    onCondition, joinType);
+}
+
+QueryResult Executor::joinRows(const std::vector<std::string>& leftCols,
+                               const std::vector<Row>& leftRows,
+                               const std::vector<std::string>& rightCols,
+                               const std::vector<Row>& rightRows,
+                               const ExprPtr& onCondition,
+                               const std::string& joinType,
+                               JoinSources* sources) const {
+    QueryResult result;
+    result.columnNames = leftCols;
     result.columnNames.insert(result.columnNames.end(), rightCols.begin(), rightCols.end());
+    const auto& joinedCols = result.columnNames;
+
+    // Split the ON condition into equi-join keys (one side per input) and a
+    // residual that is checked on each candidate pair
+    if (joinType != "cross" && onCondition) {
+        std::vector<ExprPtr> conjuncts;
+        splitConjuncts(onCondition, conjuncts);
+
+        std::vector<ExprPtr> leftKeys, rightKeys, residual;
+        for (const auto& c : conjuncts) {
+            auto bin = std::dynamic_pointer_cast<BinaryExpr>(c);
+            if (bin && (bin->op == "==" || bin->op == "=")) {
+                int ls = joinKeySide(bin->left, joinedCols, leftCols.size());
+                int rs = joinKeySide(bin->right, joinedCols, leftCols.size());
+                if (ls == 1 && rs == 2) {
+                    leftKeys.push_back(bin->left);
+                    rightKeys.push_back(bin->right);
+                    continue;
+                }
+                if (ls == 2 && rs == 1) {
+                    leftKeys.push_back(bin->right);
+                    rightKeys.push_back(bin->left);
+                    continue;
+                }
+            }
+            residual.push_back(c);
+        }
 
-    const auto& leftRows = leftTable.getRows();
-    const auto& rightRows = rightTable.getRows();
+        bool residualSafe = true;
+        for (const auto& r : residual)
+            if (!isParallelSafe(r)) { residualSafe = false; break; }
 
+        if (!leftKeys.empty() && residualSafe &&
+            leftRows.size() < UINT32_MAX && rightRows.size() < UINT32_MAX) {
+            hashJoin(leftCols, leftRows, rightCols, rightRows,
+                     leftKeys, rightKeys, residual, joinType, result, sources);
+            operatorAccess_ = "hash table";
+            return result;
+        }
+    }
+
+    // Nested-loop join for cross joins and non-equi conditions
+    operatorAccess_ = "nested loop";
+    auto source = [sources](size_t l, size_t r) {
+        if (sources) sources->emplace_back(static_cast<uint32_t>(l), static_cast<uint32_t>(r));
+    };
     if (joinType == "cross") {
-        for (const auto& lr : leftRows) {
-            for (const auto& rr : rightRows) {
-                Row combined = lr;
-                combined.insert(combined.end(), rr.begin(), rr.end());
+        for (size_t li = 0; li < leftRows.size(); li++) {
+            for (size_t ri = 0; ri < rightRows.size(); ri++) {
+                Row combined = leftRows[li];
+                combined.insert(combined.end(), rightRows[ri].begin(), rightRows[ri].end());
                 result.rows.push_back(combined);
+                source(li, ri);
             }
         }
     } else if (joinType == "inner") {
-        for (const auto& lr : leftRows) {
-            for (const auto& rr : rightRows) {
-                Row combined = lr;
-                combined.insert(combined.end(), rr.begin(), rr.end());
-                Value cond = evaluate(onCondition, combined, result.columnNames);
-                if (cond.asBool())
+        for (size_t li = 0; li < leftRows.size(); li++) {
+            for (size_t ri = 0; ri < rightRows.size(); ri++) {
+                Row combined = leftRows[li];
+                combined.insert(combined.end(), rightRows[ri].begin(), rightRows[ri].end());
+                Value cond = evaluate(onCondition, combined, joinedCols);
+                if (cond.asBool()) {
                     result.rows.push_back(combined);
+                    source(li, ri);
+                }
             }
         }
     } else if (joinType == "left") {
-        for (const auto& lr : leftRows) {
+        for (size_t li = 0; li < leftRows.size(); li++) {
             bool matched = false;
-            for (const auto& rr : rightRows) {
-                Row combined = lr;
-                combined.insert(combined.end(), rr.begin(), rr.end());
-                Value cond = evaluate(onCondition, combined, result.columnNames);
+            for (size_t ri = 0; ri < rightRows.size(); ri++) {
+                Row combined = leftRows[li];
+                combined.insert(combined.end(), rightRows[ri].begin(), rightRows[ri].end());
+                Value cond = evaluate(onCondition, combined, joinedCols);
                 if (cond.asBool()) {
                     result.rows.push_back(combined);
+                    source(li, ri);
                     matched = true;
                 }
             }
             if (!matched) {
-                Row combined = lr;
+                Row combined = leftRows[li];
                 for (size_t i = 0; i < rightCols.size(); i++)
                     combined.push_back(Value());
                 result.rows.push_back(combined);
+                source(li, kNoRow);
             }
         }
     } else if (joinType == "right") {
-        for (const auto& rr : rightRows) {
+        for (size_t ri = 0; ri < rightRows.size(); ri++) {
             bool matched = false;
-            for (const auto& lr : leftRows) {
-                Row combined = lr;
-                combined.insert(combined.end(), rr.begin(), rr.end());
-                Value cond = evaluate(onCondition, combined, result.columnNames);
+            for (size_t li = 0; li < leftRows.size(); li++) {
+                Row combined = leftRows[li];
+                combined.insert(combined.end(), rightRows[ri].begin(), rightRows[ri].end());
+                Value cond = evaluate(onCondition, combined, joinedCols);
                 if (cond.asBool()) {
                     result.rows.push_back(combined);
+                    source(li, ri);
                     matched = true;
                 }
             }
@@ -1891,15 +3447,1264 @@ QueryResult Executor::performJoin(const Table& leftTable, const Table& rightTabl
                 Row combined;
                 for (size_t i = 0; i < leftCols.size(); i++)
                     combined.push_back(Value());
-                combined.insert(combined.end(), rr.begin(), rr.end());
+                combined.insert(combined.end(), rightRows[ri].begin(), rightRows[ri].end());
                 result.rows.push_back(combined);
+                source(kNoRow, ri);
+            }
+        }
+    }
+
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Radix-partitioned hash join
+// ---------------------------------------------------------------------------
+
+// Target number of build rows per partition: keeps a partition's bucket
+// array, chain links and hashes (~16 bytes per row) inside a typical L2.
+static constexpr size_t kJoinPartitionRows = 8192;
+
+void Executor::splitConjuncts(const ExprPtr& expr, std::vector<ExprPtr>& out) {
+    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+        if (bin->op == "and") {
+            splitConjuncts(bin->left, out);
+            splitConjuncts(bin->right, out);
+            return;
+        }
+    }
+    out.push_back(expr);
+}
+
+// Collect every column reference in an expression tree
+static void collectColumnRefs(const ExprPtr& expr, std::vector<const ColumnExpr*>& out) {
+    if (!expr) return;
+    if (auto col = std::dynamic_pointer_cast<ColumnExpr>(expr)) { out.push_back(col.get()); return; }
+    if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+        collectColumnRefs(bin->left, out);
+        collectColumnRefs(bin->right, out);
+    } else if (auto un = std::dynamic_pointer_cast<UnaryExpr>(expr)) {
+        collectColumnRefs(un->operand, out);
+    } else if (auto fc = std::dynamic_pointer_cast<FunctionCallExpr>(expr)) {
+        for (const auto& a : fc->args) collectColumnRefs(a, out);
+    } else if (auto alias = std::dynamic_pointer_cast<AliasExpr>(expr)) {
+        collectColumnRefs(alias->expr, out);
+    } else if (auto bet = std::dynamic_pointer_cast<BetweenExpr>(expr)) {
+        collectColumnRefs(bet->expr, out);
+        collectColumnRefs(bet->low, out);
+        collectColumnRefs(bet->high, out);
+    } else if (auto in = std::dynamic_pointer_cast<InExpr>(expr)) {
+        collectColumnRefs(in->expr, out);
+        for (const auto& v : in->values) collectColumnRefs(v, out);
+    } else if (auto lk = std::dynamic_pointer_cast<LikeExpr>(expr)) {
+        collectColumnRefs(lk->expr, out);
+    } else if (auto isn = std::dynamic_pointer_cast<IsNullExpr>(expr)) {
+        collectColumnRefs(isn->expr, out);
+    } else if (auto caseExpr = std::dynamic_pointer_cast<CaseExpr>(expr)) {
+        for (const auto& when : caseExpr->whenClauses) {
+            collectColumnRefs(when.condition, out);
+            collectColumnRefs(when.result, out);
+        }
+        collectColumnRefs(caseExpr->elseResult, out);
+    }
+}
+
+int Executor::joinKeySide(const ExprPtr& expr, const std::vector<std::string>& joinedCols,
+                          size_t leftCount) const {
+    if (!isParallelSafe(expr)) return 0;
+    std::vector<const ColumnExpr*> refs;
+    collectColumnRefs(expr, refs);
+    int side = 0;
+    for (const ColumnExpr* col : refs) {
+        int idx = resolveColumn(col->fullName(), joinedCols);
+        if (idx < 0) return 0;
+        int colSide = static_cast<size_t>(idx) < leftCount ? 1 : 2;
+        if (side != 0 && side != colSide) return 0;
+        side = colSide;
+    }
+    return side;
+}
+
+void Executor::hashJoin(const std::vector<std::string>& leftCols,
+                        const std::vector<Row>& leftRows,
+                        const std::vector<std::string>& rightCols,
+                        const std::vector<Row>& rightRows,
+                        const std::vector<ExprPtr>& leftKeys,
+                        const std::vector<ExprPtr>& rightKeys,
+                        const std::vector<ExprPtr>& residual,
+                        const std::string& joinType,
+                        QueryResult& result,
+                        JoinSources* sources) const {
+    const auto& joinedCols = result.columnNames;
+    const bool rightOuter = joinType == "right";
+    const bool outer = rightOuter || joinType == "left";
+    if (!outer && joinType != "inner") return;
+
+    // The probe side drives output order: left rows for inner/left joins,
+    // right rows for right joins, exactly like the nested loop
+    const std::vector<Row>& probeRows = rightOuter ? rightRows : leftRows;
+    const std::vector<Row>& buildRows = rightOuter ? leftRows : rightRows;
+    const auto& probeCols = rightOuter ? rightCols : leftCols;
+    const auto& buildCols = rightOuter ? leftCols : rightCols;
+    const auto& probeKeyExprs = rightOuter ? rightKeys : leftKeys;
+    const auto& buildKeyExprs = rightOuter ? leftKeys : rightKeys;
+    const size_t nKeys = probeKeyExprs.size();
+    const size_t workers = workersFor(probeRows.size() + buildRows.size());
+
+    // Evaluate and hash join keys for both inputs
+    auto computeKeys = [&](const std::vector<Row>& rows, const std::vector<std::string>& cols,
+                           const std::vector<ExprPtr>& exprs,
+                           std::vector<Value>& keys, std::vector<uint64_t>& hashes) {
+        keys.resize(rows.size() * nKeys);
+        hashes.resize(rows.size());
+        parallelFor(rows.size(), kDefaultMorselSize, workers, [&](size_t, size_t begin, size_t end) {
+            for (size_t r = begin; r < end; r++) {
+                uint64_t h = 0;
+                for (size_t k = 0; k < nKeys; k++) {
+                    Value v = evaluate(exprs[k], rows[r], cols);
+                    h = mixHash(h * 31 + ValueHash::hash(v));
+                    keys[r * nKeys + k] = std::move(v);
+                }
+                hashes[r] = h;
+            }
+        });
+    };
+    std::vector<Value> probeKeys, buildKeys;
+    std::vector<uint64_t> probeHashes, buildHashes;
+    if (!probeRows.empty() && !buildRows.empty()) {
+        // Like the nested loop, ON expressions are never evaluated when one
+        // input is empty
+        computeKeys(probeRows, probeCols, probeKeyExprs, probeKeys, probeHashes);
+        computeKeys(buildRows, buildCols, buildKeyExprs, buildKeys, buildHashes);
+    }
+
+    // Radix-partition both inputs on the high hash bits.  Each contiguous
+    // chunk is histogrammed and scattered by one worker; chunks are laid out
+    // in input order, so row order is preserved within every partition.
+    size_t bits = 0;
+    while ((size_t(1) << bits) < workers ||
+           ((buildRows.size() >> bits) > kJoinPartitionRows && bits < 10))
+        bits++;
+    const size_t partitions = size_t(1) << bits;
+    auto partitionOf = [bits](uint64_t h) -> size_t {
+        return bits == 0 ? 0 : static_cast<size_t>(h >> (64 - bits));
+    };
+
+    auto radixPartition = [&](const std::vector<uint64_t>& hashes,
+                              std::vector<uint32_t>& order, std::vector<size_t>& bounds) {
+        const size_t n = hashes.size();
+        const size_t chunks = workers;
+        std::vector<std::vector<size_t>> hist(chunks, std::vector<size_t>(partitions, 0));
+        auto chunkBegin = [&](size_t c) { return n * c / chunks; };
+        parallelTasks(chunks, workers, [&](size_t c) {
+            for (size_t r = chunkBegin(c); r < chunkBegin(c + 1); r++)
+                hist[c][partitionOf(hashes[r])]++;
+        });
+        bounds.assign(partitions + 1, 0);
+        size_t offset = 0;
+        for (size_t p = 0; p < partitions; p++) {
+            bounds[p] = offset;
+            for (size_t c = 0; c < chunks; c++) {
+                size_t count = hist[c][p];
+                hist[c][p] = offset;
+                offset += count;
+            }
+        }
+        bounds[partitions] = offset;
+        order.resize(n);
+        parallelTasks(chunks, workers, [&](size_t c) {
+            for (size_t r = chunkBegin(c); r < chunkBegin(c + 1); r++)
+                order[hist[c][partitionOf(hashes[r])]++] = static_cast<uint32_t>(r);
+        });
+    };
+    std::vector<uint32_t> probeOrder, buildOrder;
+    std::vector<size_t> probeBounds, buildBounds;
+    radixPartition(probeHashes, probeOrder, probeBounds);
+    radixPartition(buildHashes, buildOrder, buildBounds);
+
+    // Join partition pairs independently.  Build rows are chained in input
+    // order so matches for a probe row come out in build order.
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> matches(partitions);
+    std::vector<uint32_t> matchCount(probeRows.size(), 0);
+    parallelTasks(partitions, workers, [&](size_t p) {
+        const size_t bBegin = buildBounds[p], bEnd = buildBounds[p + 1];
+        const size_t pBegin = probeBounds[p], pEnd = probeBounds[p + 1];
+        if (bBegin == bEnd || pBegin == pEnd) return;
+
+        size_t buckets = 1;
+        while (buckets < (bEnd - bBegin) * 2) buckets <<= 1;
+        const uint64_t mask = buckets - 1;
+        std::vector<uint32_t> heads(buckets, kNoRow);
+        std::vector<uint32_t> next(bEnd - bBegin, kNoRow);
+        for (size_t i = bEnd; i-- > bBegin;) {
+            size_t bucket = buildHashes[buildOrder[i]] & mask;
+            next[i - bBegin] = heads[bucket];
+            heads[bucket] = static_cast<uint32_t>(i - bBegin);
+        }
+
+        auto& out = matches[p];
+        for (size_t i = pBegin; i < pEnd; i++) {
+            const uint32_t pr = probeOrder[i];
+            const uint64_t h = probeHashes[pr];
+            for (uint32_t slot = heads[h & mask]; slot != kNoRow; slot = next[slot]) {
+                const uint32_t br = buildOrder[bBegin + slot];
+                if (buildHashes[br] != h) continue;
+                bool equal = true;
+                for (size_t k = 0; k < nKeys && equal; k++)
+                    equal = probeKeys[pr * nKeys + k] == buildKeys[br * nKeys + k];
+                if (!equal) continue;
+                if (!residual.empty()) {
+                    const Row& lr = rightOuter ? buildRows[br] : probeRows[pr];
+                    const Row& rr = rightOuter ? probeRows[pr] : buildRows[br];
+                    Row combined = lr;
+                    combined.insert(combined.end(), rr.begin(), rr.end());
+                    bool pass = true;
+                    for (const auto& cond : residual) {
+                        if (!evaluate(cond, combined, joinedCols).asBool()) { pass = false; break; }
+                    }
+                    if (!pass) continue;
+                }
+                out.emplace_back(pr, br);
+                matchCount[pr]++;
+            }
+        }
+    });
+
+    // Lay matches out per probe row (CSR), reserving one slot for unmatched
+    // outer rows, then materialize output in per-morsel batches
+    std::vector<size_t> matchStart(probeRows.size() + 1, 0);
+    std::vector<size_t> outStart(probeRows.size() + 1, 0);
+    for (size_t r = 0; r < probeRows.size(); r++) {
+        matchStart[r + 1] = matchStart[r] + matchCount[r];
+        size_t emitted = matchCount[r] == 0 && outer ? 1 : matchCount[r];
+        outStart[r + 1] = outStart[r] + emitted;
+    }
+    std::vector<uint32_t> matchedBuild(matchStart.back());
+    parallelTasks(partitions, workers, [&](size_t p) {
+        std::unordered_map<uint32_t, uint32_t> cursor;
+        for (const auto& [pr, br] : matches[p])
+            matchedBuild[matchStart[pr] + cursor[pr]++] = br;
+    });
+
+    result.rows.resize(outStart.back());
+    if (sources) sources->resize(outStart.back());
+    const size_t leftWidth = leftCols.size(), rightWidth = rightCols.size();
+    parallelFor(probeRows.size(), kDefaultMorselSize, workers, [&](size_t, size_t begin, size_t end) {
+        for (size_t pr = begin; pr < end; pr++) {
+            size_t slot = outStart[pr];
+            for (size_t m = matchStart[pr]; m < matchStart[pr + 1]; m++) {
+                const Row& lr = rightOuter ? buildRows[matchedBuild[m]] : probeRows[pr];
+                const Row& rr = rightOuter ? probeRows[pr] : buildRows[matchedBuild[m]];
+                if (sources)
+                    (*sources)[slot] = rightOuter
+                        ? std::make_pair(matchedBuild[m], static_cast<uint32_t>(pr))
+                        : std::make_pair(static_cast<uint32_t>(pr), matchedBuild[m]);
+                Row& combined = result.rows[slot++];
+                combined.reserve(lr.size() + rr.size());
+                combined.insert(combined.end(), lr.begin(), lr.end());
+                combined.insert(combined.end(), rr.begin(), rr.end());
+            }
+            if (matchStart[pr] == matchStart[pr + 1] && outer) {
+                if (sources)
+                    (*sources)[slot] = rightOuter
+                        ? std::make_pair(kNoRow, static_cast<uint32_t>(pr))
+                        : std::make_pair(static_cast<uint32_t>(pr), kNoRow);
+                Row& combined = result.rows[slot];
+                combined.reserve(leftWidth + rightWidth);
+                if (rightOuter) {
+                    combined.resize(leftWidth);
+                    combined.insert(combined.end(), probeRows[pr].begin(), probeRows[pr].end());
+                } else {
+                    combined = probeRows[pr];
+                    combined.resize(combined.size() + rightWidth);
+                }
+            }
+        }
+    });
+}
+
+// ---------------------------------------------------------------------------
+// Pipeline rewriting
+// ---------------------------------------------------------------------------
+
+static bool isAggregateColumn(const ExprPtr& col) {
+    ExprPtr inner = col;
+    if (auto alias = std::dynamic_pointer_cast<AliasExpr>(col))
+        inner = alias->expr;
+    auto fc = std::dynamic_pointer_cast<FunctionCallExpr>(inner);
+    if (!fc) return false;
+    std::string lower = fc->name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    return lower == "count" || lower == "sum" || lower == "avg" ||
+           lower == "min" || lower == "max";
+}
+
+static bool hasStarColumn(const std::vector<ExprPtr>& cols) {
+    for (const auto& col : cols)
+        if (std::dynamic_pointer_cast<StarExpr>(col)) return true;
+    return false;
+}
+
+static ExprPtr conjunction(const std::vector<ExprPtr>& conjuncts) {
+    ExprPtr result;
+    for (const auto& c : conjuncts)
+        result = result ? std::make_shared<BinaryExpr>(result, "and", c) : c;
+    return result;
+}
+
+static std::string stageName(PipelineStage::Type type) {
+    switch (type) {
+        case PipelineStage::Type::ORDERBY: return "orderby";
+        case PipelineStage::Type::DISTINCT: return "distinct";
+        case PipelineStage::Type::MAP: return "map";
+        default: return "stage";
+    }
+}
+
+size_t Executor::pipelineSchemas(const std::string& tableName,
+                                 const std::vector<PipelineStage>& stages,
+                                 std::vector<std::vector<std::string>>& schemas) const {
+    schemas.assign(1, {});
+    if (!db_->hasTable(tableName)) return 0;
+    for (const auto& c : db_->getTable(tableName).getColumns())
+        schemas[0].push_back(c.name);
+
+    for (size_t i = 0; i < stages.size(); i++) {
+        const auto& stage = stages[i];
+        std::vector<std::string> out = schemas[i];
+        switch (stage.type) {
+            case PipelineStage::Type::SELECT:
+                if (!hasStarColumn(stage.columns)) {
+                    out.clear();
+                    for (const auto& col : stage.columns) out.push_back(getExprName(col));
+                }
+                break;
+            case PipelineStage::Type::MAP:
+                for (const auto& col : stage.columns) out.push_back(getExprName(col));
+                break;
+            case PipelineStage::Type::JOIN:
+                if (!db_->hasTable(stage.joinTable)) return i;
+                for (const auto& c : db_->getTable(stage.joinTable).getColumns())
+                    out.push_back(stage.joinTable + "." + c.name);
+                break;
+            case PipelineStage::Type::COUNT_STAGE:
+                out = {"count"};
+                break;
+            case PipelineStage::Type::UPDATE:
+            case PipelineStage::Type::DELETE_STAGE:
+                return i;  // a status message, not rows
+            default:
+                break;
+        }
+        schemas.push_back(std::move(out));
+    }
+    return stages.size();
+}
+
+std::shared_ptr<const std::vector<PipelineStage>> Executor::pipelinePlan(const PipelineStmt& stmt) {
+    // Both counters only grow, so their sum changes whenever either does
+    const uint64_t version = db_->schemaVersion() + functionDefinitions_ + 1;
+    if (!stmt.plan || stmt.planVersion != version) {
+        stmt.plan = std::make_shared<const std::vector<PipelineStage>>(rewritePipeline(stmt));
+        stmt.planVersion = version;
+    }
+    return stmt.plan;
+}
+
+std::vector<PipelineStage> Executor::rewritePipeline(const PipelineStmt& stmt,
+                                                     std::vector<std::string>* notes) const {
+    using Type = PipelineStage::Type;
+    std::vector<PipelineStage> stages = stmt.stages;
+    std::vector<std::vector<std::string>> schemas;
+    auto note = [&](const std::string& text) {
+        if (notes && std::find(notes->begin(), notes->end(), text) == notes->end())
+            notes->push_back(text);
+    };
+    auto allSafe = [&](const std::vector<ExprPtr>& exprs) {
+        for (const auto& e : exprs)
+            if (!isParallelSafe(e)) return false;
+        return true;
+    };
+    // Columns of `schema` an expression reads; names matching no column
+    // read variables
+    auto markColumns = [&](const ExprPtr& expr, const std::vector<std::string>& schema,
+                           std::vector<bool>& marked) {
+        std::vector<const ColumnExpr*> refs;
+        collectColumnRefs(expr, refs);
+        for (const ColumnExpr* col : refs) {
+            int idx = resolveColumn(col->fullName(), schema);
+            if (idx >= 0) marked[static_cast<size_t>(idx)] = true;
+        }
+    };
+    auto readsBelow = [&](const ExprPtr& expr, const std::vector<std::string>& schema, size_t limit) {
+        std::vector<bool> marked(schema.size(), false);
+        markColumns(expr, schema, marked);
+        for (size_t k = limit; k < marked.size(); k++)
+            if (marked[k]) return false;
+        return true;
+    };
+    // A SELECT right after GROUPBY is its aggregate list, not a projection
+    auto groupSelect = [&](size_t i) { return i > 0 && stages[i - 1].type == Type::GROUPBY; };
+
+    // Predicate pushdown, one stage at a time until nothing moves.  Only
+    // WHEREs free of UDF calls and random() move, past stages that are
+    // equally free of them, so no call runs a different number of times.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        size_t known = pipelineSchemas(stmt.tableName, stages, schemas);
+        for (size_t i = 1; i < stages.size() && i <= known && !changed; i++) {
+            if (stages[i].type != Type::WHERE || !stages[i].condition) continue;
+            PipelineStage& below = stages[i - 1];
+
+            if (below.type == Type::WHERE && below.condition) {
+                below.condition = std::make_shared<BinaryExpr>(below.condition, "and",
+                                                               stages[i].condition);
+                stages.erase(stages.begin() + static_cast<std::ptrdiff_t>(i));
+                note("merged adjacent where stages");
+                changed = true;
+                break;
+            }
+
+            // Conjuncts may move below `below` if they read only the first
+            // `limit` columns of its output
+            size_t limit = 0;
+            bool passable = false;
+            switch (below.type) {
+                case Type::ORDERBY: {
+                    std::vector<ExprPtr> keys;
+                    for (const auto& [expr, asc] : below.orderCols) keys.push_back(expr);
+                    passable = allSafe(keys);
+                    limit = schemas[i].size();
+                    break;
+                }
+                case Type::DISTINCT:
+                    passable = true;
+                    limit = schemas[i].size();
+                    break;
+                case Type::MAP:
+                    passable = allSafe(below.columns);
+                    limit = schemas[i - 1].size();
+                    break;
+                case Type::JOIN:
+                    // The join stage is always an inner join
+                    passable = isParallelSafe(below.joinCondition);
+                    limit = schemas[i - 1].size();
+                    break;
+                default:
+                    break;
+            }
+            std::vector<ExprPtr> conjuncts;
+            splitConjuncts(stages[i].condition, conjuncts);
+            if (!passable || !allSafe(conjuncts)) continue;
+
+            // A join takes the rest into its ON condition
+            const bool absorbs = below.type == Type::JOIN;
+            std::vector<ExprPtr> pushed, absorbed, kept;
+            for (const auto& c : conjuncts) {
+                if (readsBelow(c, schemas[i], limit)) pushed.push_back(c);
+                else if (absorbs) absorbed.push_back(c);
+                else kept.push_back(c);
+            }
+            if (pushed.empty() && absorbed.empty()) continue;
+
+            const std::string what = below.type == Type::JOIN
+                ? "join with '" + below.joinTable + "'" : stageName(below.type);
+            if (!absorbed.empty()) {
+                if (below.joinCondition) absorbed.insert(absorbed.begin(), below.joinCondition);
+                below.joinCondition = conjunction(absorbed);
+                note("moved where into the on condition of " + what);
+            }
+            if (kept.empty())
+                stages.erase(stages.begin() + static_cast<std::ptrdiff_t>(i));
+            else
+                stages[i].condition = conjunction(kept);
+            if (!pushed.empty()) {
+                PipelineStage where;
+                where.type = Type::WHERE;
+                where.condition = conjunction(pushed);
+                stages.insert(stages.begin() + static_cast<std::ptrdiff_t>(i - 1), where);
+                note("pushed where below " + what);
+            }
+            changed = true;
+        }
+    }
+
+    // Redundant SELECTs: `select(*)` or one listing every column in order
+    // changes nothing; a SELECT that only picks columns of the SELECT before
+    // it is merged into that one
+    for (size_t i = 0; i < stages.size();) {
+        size_t known = pipelineSchemas(stmt.tableName, stages, schemas);
+        PipelineStage& stage = stages[i];
+        if (stage.type != Type::SELECT || groupSelect(i) || i > known) { i++; continue; }
+        const auto& in = schemas[i];
+
+        bool identity = hasStarColumn(stage.columns);
+        if (!identity && stage.columns.size() == in.size()) {
+            identity = true;
+            for (size_t k = 0; k < in.size() && identity; k++) {
+                auto col = std::dynamic_pointer_cast<ColumnExpr>(stage.columns[k]);
+                identity = col && col->fullName() == in[k] &&
+                           resolveColumn(in[k], in) == static_cast<int>(k);
+            }
+        }
+        if (identity) {
+            if (stage.selectDistinct) {
+                PipelineStage distinct;
+                distinct.type = Type::DISTINCT;
+                stage = distinct;
+            } else {
+                stages.erase(stages.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+            note("removed redundant select");
+            continue;
+        }
+
+        if (i + 1 < stages.size() && i + 1 <= known && stages[i + 1].type == Type::SELECT &&
+            !stage.selectDistinct && allSafe(stage.columns) &&
+            std::none_of(stage.columns.begin(), stage.columns.end(), isAggregateColumn) &&
+            !hasStarColumn(stages[i + 1].columns)) {
+            const auto& mid = schemas[i + 1];
+            std::vector<ExprPtr> composed;
+            for (const auto& outer : stages[i + 1].columns) {
+                ExprPtr inner = outer;
+                if (auto alias = std::dynamic_pointer_cast<AliasExpr>(outer)) inner = alias->expr;
+                auto col = std::dynamic_pointer_cast<ColumnExpr>(inner);
+                int k = col ? resolveColumn(col->fullName(), mid) : -1;
+                if (k < 0) break;
+                ExprPtr source = stage.columns[static_cast<size_t>(k)];
+                if (auto alias = std::dynamic_pointer_cast<AliasExpr>(source)) source = alias->expr;
+                const std::string name = getExprName(outer);
+                auto sourceCol = std::dynamic_pointer_cast<ColumnExpr>(source);
+                composed.push_back(sourceCol && sourceCol->fullName() == name
+                                   ? source : std::make_shared<AliasExpr>(source, name));
+            }
+            if (composed.size() == stages[i + 1].columns.size()) {
+                stages[i + 1].columns = composed;
+                stages.erase(stages.begin() + static_cast<std::ptrdiff_t>(i));
+                note("merged consecutive selects");
+                continue;
             }
         }
+        i++;
     }
 
+    // Column pruning, walking back from the result (which needs every
+    // column).  Stages that write to the table match rows by content and
+    // need them whole.
+    const size_t known = pipelineSchemas(stmt.tableName, stages, schemas);
+    const bool writes = std::any_of(stages.begin(), stages.end(), [](const PipelineStage& s) {
+        return s.type == Type::UPDATE || s.type == Type::DELETE_STAGE;
+    });
+    if (writes || known < stages.size()) return stages;
+
+    // Projection keeping `keep` of `schema`, or false if a kept column could
+    // not be named unambiguously
+    auto makePruning = [&](const std::vector<std::string>& schema, const std::vector<bool>& keep,
+                           PipelineStage& out) {
+        size_t count = static_cast<size_t>(std::count(keep.begin(), keep.end(), true));
+        if (count == 0 || count == schema.size()) return false;
+        out = PipelineStage();
+        out.type = Type::SELECT;
+        out.pruning = true;
+        for (size_t k = 0; k < schema.size(); k++) {
+            if (!keep[k]) continue;
+            if (resolveColumn(schema[k], schema) != static_cast<int>(k)) return false;
+            out.columns.push_back(std::make_shared<ColumnExpr>(schema[k]));
+        }
+        return true;
+    };
+
+    std::vector<bool> need(schemas.back().size(), true);
+    for (size_t i = stages.size(); i-- > 0;) {
+        PipelineStage& stage = stages[i];
+        const auto& in = schemas[i];
+        std::vector<bool> needIn(in.size(), false);
+        switch (stage.type) {
+            case Type::WHERE:
+            case Type::HAVING:
+                needIn = need;
+                markColumns(stage.condition, in, needIn);
+                break;
+            case Type::ORDERBY:
+                needIn = need;
+                for (const auto& [expr, asc] : stage.orderCols) markColumns(expr, in, needIn);
+                break;
+            case Type::GROUPBY:
+                needIn = need;
+                for (const auto& gc : stage.groupCols) markColumns(gc, in, needIn);
+                break;
+            case Type::LIMIT:
+            case Type::OFFSET:
+            case Type::TAKE:
+            case Type::SKIP_STAGE:
+                needIn = need;
+                break;
+            case Type::COUNT_STAGE:
+                break;
+            case Type::SELECT: {
+                if (hasStarColumn(stage.columns)) {
+                    needIn = need;
+                    break;
+                }
+                if (!groupSelect(i) && !stage.selectDistinct &&
+                    std::none_of(stage.columns.begin(), stage.columns.end(), isAggregateColumn)) {
+                    std::vector<ExprPtr> kept;
+                    for (size_t k = 0; k < stage.columns.size(); k++)
+                        if (need[k] || !isParallelSafe(stage.columns[k])) kept.push_back(stage.columns[k]);
+                    if (kept.empty()) kept.push_back(stage.columns[0]);
+                    if (kept.size() < stage.columns.size()) {
+                        note("pruned unused select columns");
+                        stage.columns = kept;
+                    }
+                }
+                for (const auto& col : stage.columns) markColumns(col, in, needIn);
+                break;
+            }
+            case Type::MAP: {
+                for (size_t k = 0; k < in.size(); k++) needIn[k] = need[k];
+                std::vector<ExprPtr> kept;
+                for (size_t k = 0; k < stage.columns.size(); k++)
+                    if (need[in.size() + k] || !isParallelSafe(stage.columns[k]))
+                        kept.push_back(stage.columns[k]);
+                for (const auto& col : kept) markColumns(col, in, needIn);
+                if (kept.size() < stage.columns.size()) {
+                    note("pruned unused map columns");
+                    if (kept.empty())
+                        stages.erase(stages.begin() + static_cast<std::ptrdiff_t>(i));
+                    else
+                        stage.columns = kept;
+                }
+                break;
+            }
+            case Type::JOIN: {
+                std::vector<bool> joined(schemas[i + 1].size(), false);
+                markColumns(stage.joinCondition, schemas[i + 1], joined);
+                for (size_t k = 0; k < in.size(); k++) needIn[k] = need[k] || joined[k];
+
+                // Narrow the left input ahead of the first join of a chain
+                // (a SELECT or MAP before it was trimmed instead)
+                PipelineStage prune;
+                const std::string table = stage.joinTable;
+                if (i > 0) {
+                    Type before = stages[i - 1].type;
+                    bool narrowable = before == Type::WHERE || before == Type::ORDERBY ||
+                                      before == Type::DISTINCT || before == Type::HAVING ||
+                                      before == Type::LIMIT || before == Type::OFFSET ||
+                                      before == Type::TAKE || before == Type::SKIP_STAGE;
+                    if (narrowable && makePruning(in, needIn, prune)) {
+                        stages.insert(stages.begin() + static_cast<std::ptrdiff_t>(i), prune);
+                        note("pruned unused columns before join with '" + table + "'");
+                    }
+                }
+                break;
+            }
+            default:
+                needIn.assign(in.size(), true);
+                break;
+        }
+        need = std::move(needIn);
+    }
+
+    // Narrow rows at the scan itself when the first stage copies or
+    // reorders them (the projection reads the table directly)
+    if (!stages.empty() && (stages[0].type == Type::ORDERBY || stages[0].type == Type::MAP)) {
+        PipelineStage prune;
+        if (makePruning(schemas[0], need, prune)) {
+            stages.insert(stages.begin(), prune);
+            note("pruned unused columns at the scan");
+        }
+    }
+    return stages;
+}
+
+// ---------------------------------------------------------------------------
+// Export
+// ---------------------------------------------------------------------------
+
+static OutputFormat exportFormat(const PipelineStage& stage) {
+    OutputFormat format = formatForPath(stage.exportPath);
+    if (!stage.exportFormat.empty() && !parseOutputFormat(stage.exportFormat, format))
+        throw std::runtime_error("Unknown export format '" + stage.exportFormat + "'");
+    return format;
+}
+
+static void openExport(const PipelineStage& stage, std::ofstream& file) {
+    file.open(stage.exportPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("Cannot open file '" + stage.exportPath + "' for writing");
+}
+
+static QueryResult exportResult(const PipelineStage& stage, std::ofstream& file, size_t rows) {
+    if (!file.good())
+        throw std::runtime_error("Error writing file '" + stage.exportPath + "'");
+    QueryResult result("Exported " + std::to_string(rows) + " row(s) to '" + stage.exportPath + "'.");
+    result.affectedRows = static_cast<int>(rows);
     return result;
 }
 
+QueryResult Executor::exportRows(const PipelineStage& stage, const QueryResult& current) const {
+    const OutputFormat format = exportFormat(stage);
+    std::ofstream file;
+    openExport(stage, file);
+    auto writer = makeResultWriter(format, file);
+    writer->begin(current.columnNames);
+    for (const auto& row : current.rows) writer->write(row);
+    writer->end();
+    return exportResult(stage, file, writer->rowsWritten());
+}
+
+// Stages that turn one input row into at most one output row on their own
+static bool isRowwiseStage(const PipelineStage& stage) {
+    switch (stage.type) {
+        case PipelineStage::Type::WHERE:
+        case PipelineStage::Type::MAP:
+        case PipelineStage::Type::LIMIT:
+        case PipelineStage::Type::TAKE:
+        case PipelineStage::Type::OFFSET:
+        case PipelineStage::Type::SKIP_STAGE:
+            return true;
+        case PipelineStage::Type::SELECT:
+            return !stage.selectDistinct &&
+                   std::none_of(stage.columns.begin(), stage.columns.end(), isAggregateColumn);
+        default:
+            return false;
+    }
+}
+
+bool Executor::streamExport(const std::string& tableName, const std::vector<PipelineStage>& stages,
+                            QueryResult& result) const {
+    if (stages.empty() || stages.back().type != PipelineStage::Type::EXPORT) return false;
+    const size_t last = stages.size() - 1;
+    for (size_t i = 0; i < last; i++)
+        if (!isRowwiseStage(stages[i])) return false;
+
+    // Per stage: its input columns, WHERE predicate and LIMIT/OFFSET counters
+    struct Step {
+        const PipelineStage* stage;
+        std::vector<std::string> columns;
+        std::function<bool(const Row&)> predicate;
+        std::vector<ExprPtr> exprs;  // SELECT and MAP columns, simplified
+        size_t skip = 0;
+        long remaining = -1;  // rows LIMIT still lets through, -1 for no limit
+    };
+    const Table& table = db_->getTable(tableName);
+    std::vector<std::string> columns;
+    for (const auto& c : table.getColumns()) columns.push_back(c.name);
+    std::vector<Step> steps;
+    for (size_t i = 0; i < last; i++) {
+        const auto& stage = stages[i];
+        Step step;
+        step.stage = &stage;
+        step.columns = columns;
+        switch (stage.type) {
+            case PipelineStage::Type::WHERE:
+                step.predicate = buildPredicate(stage.condition, columns);
+                break;
+            case PipelineStage::Type::SELECT:
+                if (hasStarColumn(stage.columns)) continue;  // passes rows through
+                step.exprs = simplifyExprs(stage.columns, columns);
+                columns.clear();
+                for (const auto& col : stage.columns) columns.push_back(getExprName(col));
+                break;
+            case PipelineStage::Type::MAP:
+                step.exprs = simplifyExprs(stage.columns, columns);
+                for (const auto& col : stage.columns) columns.push_back(getExprName(col));
+                break;
+            case PipelineStage::Type::LIMIT:
+            case PipelineStage::Type::TAKE:
+                step.remaining = stage.limitCount;
+                break;
+            default:  // OFFSET, SKIP
+                step.skip = static_cast<size_t>(std::max(stage.offsetCount, 0));
+                break;
+        }
+        steps.push_back(std::move(step));
+    }
+
+    const PipelineStage& exportStage = stages[last];
+    const OutputFormat format = exportFormat(exportStage);
+    std::ofstream file;
+    openExport(exportStage, file);
+    auto writer = makeResultWriter(format, file);
+    writer->begin(columns);
+
+    // Two scratch rows, alternated between stages that build new rows
+    Row scratch[2];
+    size_t next = 0;
+    bool done = false;
+    for (const auto& tableRow : table.getRows()) {
+        const Row* row = &tableRow;
+        bool keep = true;
+        for (auto& step : steps) {
+            switch (step.stage->type) {
+                case PipelineStage::Type::WHERE:
+                    keep = step.predicate(*row);
+                    break;
+                case PipelineStage::Type::SELECT:
+                case PipelineStage::Type::MAP: {
+                    Row& out = scratch[next];
+                    next ^= 1;
+                    if (step.stage->type == PipelineStage::Type::MAP) out = *row;
+                    else out.clear();
+                    for (const auto& expr : step.exprs)
+                        out.push_back(evaluate(expr, *row, step.columns));
+                    row = &out;
+                    break;
+                }
+                case PipelineStage::Type::LIMIT:
+                case PipelineStage::Type::TAKE:
+                    if (step.remaining == 0) {
+                        keep = false;
+                        done = true;
+                    } else if (step.remaining > 0) {
+                        step.remaining--;
+                    }
+                    break;
+                default:
+                    if (step.skip > 0) {
+                        step.skip--;
+                        keep = false;
+                    }
+                    break;
+            }
+            if (!keep) break;
+        }
+        if (done) break;
+        if (keep) writer->write(*row);
+    }
+    writer->end();
+    result = exportResult(exportStage, file, writer->rowsWritten());
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Join ordering
+// ---------------------------------------------------------------------------
+
+// Index usable for probing `input` on `column`: only for inputs that are a
+// base table's own rows
+static const BTreeIndex* inputIndex(const JoinInput& input, int column) {
+    if (!input.table || input.rows != &input.table->getRows() || column < 0) return nullptr;
+    const auto& cols = input.table->getColumns();
+    if (static_cast<size_t>(column) >= cols.size()) return nullptr;
+    return input.table->getIndexForColumn(cols[static_cast<size_t>(column)].name);
+}
+
+// How a column reference matches a column list, in resolveColumn's order of
+// precedence: 0 exact, 1 bare name against a qualified column, 2 qualified
+// name against a bare column; -1 no match
+static int columnMatchKind(const std::string& name, const std::vector<std::string>& cols) {
+    int kind = -1;
+    const size_t nameDot = name.find('.');
+    for (const auto& c : cols) {
+        if (c == name) return 0;
+        size_t dot = c.find('.');
+        if (dot != std::string::npos && c.compare(dot + 1, std::string::npos, name) == 0)
+            kind = 1;
+        else if (kind < 0 && nameDot != std::string::npos &&
+                 name.compare(nameDot + 1, std::string::npos, c) == 0)
+            kind = 2;
+    }
+    return kind;
+}
+
+// The join input a column reference resolves to whatever order the inputs
+// are combined in, or -1 if it matches none or is ambiguous
+static int inputOfColumn(const std::string& name, const std::vector<JoinInput>& inputs) {
+    int found = -1, bestKind = 3;
+    bool tie = false;
+    for (size_t k = 0; k < inputs.size(); k++) {
+        int kind = columnMatchKind(name, inputs[k].columns);
+        if (kind < 0) continue;
+        if (kind < bestKind) {
+            bestKind = kind;
+            found = static_cast<int>(k);
+            tie = false;
+        } else if (kind == bestKind) {
+            tie = true;
+        }
+    }
+    return tie ? -1 : found;
+}
+
+static const TableStats* inputStats(const Database& db, const JoinInput& input) {
+    if (!input.table || input.rows != &input.table->getRows()) return nullptr;
+    const TableStats* stats = db.getStatistics(input.table->getName());
+    return stats && stats->columns.size() == input.table->colCount() ? stats : nullptr;
+}
+
+double Executor::estimateDistinct(const JoinInput& input, int column) const {
+    const double rows = static_cast<double>(input.rows->size());
+    if (const TableStats* stats = inputStats(*db_, input))
+        return std::max(1.0, stats->columns[static_cast<size_t>(column)].distinctCount);
+    if (input.table && input.rows == &input.table->getRows()) {
+        const Column& col = input.table->getColumns()[static_cast<size_t>(column)];
+        if (col.unique || col.primaryKey) return std::max(1.0, rows);
+    }
+    // Unanalyzed, non-unique column
+    return std::max(1.0, std::min(rows, 200.0));
+}
+
+double Executor::estimateSelectivity(const ExprPtr& expr,
+                                     const std::vector<JoinInput>& inputs) const {
+    auto columnOf = [&](const ExprPtr& e, size_t& input, int& column) {
+        auto col = std::dynamic_pointer_cast<ColumnExpr>(e);
+        if (!col) return false;
+        int found = inputOfColumn(col->fullName(), inputs);
+        if (found < 0) return false;
+        input = static_cast<size_t>(found);
+        column = resolveColumn(col->fullName(), inputs[input].columns);
+        return true;
+    };
+    auto clamp = [](double s) { return std::min(1.0, std::max(0.0, s)); };
+
+    if (auto un = std::dynamic_pointer_cast<UnaryExpr>(expr)) {
+        if (un->op == "not") return clamp(1.0 - estimateSelectivity(un->operand, inputs));
+    }
+    auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr);
+    if (!bin) return 1.0 / 3.0;
+    if (bin->op == "and")
+        return estimateSelectivity(bin->left, inputs) * estimateSelectivity(bin->right, inputs);
+    if (bin->op == "or") {
+        double a = estimateSelectivity(bin->left, inputs), b = estimateSelectivity(bin->right, inputs);
+        return clamp(a + b - a * b);
+    }
+
+    const bool eq = bin->op == "==" || bin->op == "=";
+    const bool ne = bin->op == "!=" || bin->op == "<>";
+    size_t li = 0, ri = 0;
+    int lc = -1, rc = -1;
+    bool lcol = columnOf(bin->left, li, lc), rcol = columnOf(bin->right, ri, rc);
+
+    // Equi-join: matching pairs are 1 / max(distinct values on either side)
+    if (eq && lcol && rcol)
+        return 1.0 / std::max(estimateDistinct(inputs[li], lc), estimateDistinct(inputs[ri], rc));
+
+    // Column compared with a literal
+    auto lit = std::dynamic_pointer_cast<LiteralExpr>(lcol ? bin->right : bin->left);
+    if ((lcol || rcol) && lit) {
+        const size_t in = lcol ? li : ri;
+        const int col = lcol ? lc : rc;
+        std::string op = bin->op;
+        if (!lcol) {
+            if (op == "<") op = ">";
+            else if (op == ">") op = "<";
+            else if (op == "<=") op = ">=";
+            else if (op == ">=") op = "<=";
+        }
+        const Value& v = lit->value;
+        if (const TableStats* stats = inputStats(*db_, inputs[in])) {
+            const size_t c = static_cast<size_t>(col);
+            const double nonNull = 1.0 - stats->nullFraction(c);
+            if (eq) return Statistics::equalitySelectivity(*stats, c, v);
+            if (ne) return clamp(nonNull - Statistics::equalitySelectivity(*stats, c, v));
+            if (op == "<") return Statistics::lessThanSelectivity(*stats, c, v, false);
+            if (op == "<=") return Statistics::lessThanSelectivity(*stats, c, v, true);
+            if (op == ">") return clamp(nonNull - Statistics::lessThanSelectivity(*stats, c, v, true));
+            if (op == ">=") return clamp(nonNull - Statistics::lessThanSelectivity(*stats, c, v, false));
+        }
+        if (eq) return 1.0 / estimateDistinct(inputs[in], col);
+        if (ne) return 1.0 - 1.0 / estimateDistinct(inputs[in], col);
+    }
+    if (eq) return 0.1;
+    return 1.0 / 3.0;
+}
+
+bool Executor::planJoinChain(const std::vector<JoinInput>& inputs,
+                             const std::vector<ExprPtr>& conditions,
+                             const std::vector<std::string>& joinTypes,
+                             JoinChainPlan& out) const {
+    const size_t n = inputs.size();
+    if (n < 2 || n > JoinOptimizer::kMaxRelations) return false;
+    out = JoinChainPlan();
+    for (const auto& input : inputs)
+        out.graph.rows.push_back(static_cast<double>(input.rows->size()));
+
+    // Inputs an expression reads.  Every column must resolve to the same
+    // input in any order: a bare name several inputs share would not.
+    auto relationsOf = [&](const ExprPtr& e, uint64_t& mask) {
+        mask = 0;
+        if (!isParallelSafe(e)) return false;
+        std::vector<const ColumnExpr*> refs;
+        collectColumnRefs(e, refs);
+        for (const ColumnExpr* col : refs) {
+            int found = inputOfColumn(col->fullName(), inputs);
+            if (found < 0) return false;
+            mask |= uint64_t(1) << found;
+        }
+        return true;
+    };
+    auto singleRelation = [](uint64_t mask) {
+        if (mask == 0 || (mask & (mask - 1))) return -1;
+        int r = 0;
+        while (!((mask >> r) & 1)) r++;
+        return r;
+    };
+
+    for (size_t j = 0; j < conditions.size(); j++) {
+        if (joinTypes[j] == "cross" || !conditions[j]) continue;
+        if (joinTypes[j] != "inner") return false;
+
+        std::vector<ExprPtr> conjuncts;
+        splitConjuncts(conditions[j], conjuncts);
+        for (const auto& c : conjuncts) {
+            JoinGraph::Predicate p;
+            if (!relationsOf(c, p.relations)) return false;
+            // Written in the ON clause of inputs[j + 1], so it may only read
+            // inputs[0 .. j + 1]
+            if (j + 2 < 64 && (p.relations >> (j + 2))) return false;
+            p.selectivity = estimateSelectivity(c, inputs);
+
+            auto bin = std::dynamic_pointer_cast<BinaryExpr>(c);
+            if (bin && (bin->op == "==" || bin->op == "=")) {
+                uint64_t lm = 0, rm = 0;
+                relationsOf(bin->left, lm);
+                relationsOf(bin->right, rm);
+                int l = singleRelation(lm), r = singleRelation(rm);
+                if (l >= 0 && r >= 0 && l != r) {
+                    p.left = l;
+                    p.right = r;
+                    auto indexed = [&](const ExprPtr& side, int rel) {
+                        auto col = std::dynamic_pointer_cast<ColumnExpr>(side);
+                        const JoinInput& input = inputs[static_cast<size_t>(rel)];
+                        return col && inputIndex(input, resolveColumn(col->fullName(), input.columns));
+                    };
+                    p.leftIndexed = indexed(bin->left, l);
+                    p.rightIndexed = indexed(bin->right, r);
+                }
+            }
+            out.graph.predicates.push_back(p);
+            out.conjuncts.push_back(c);
+        }
+    }
+
+    out.plan = JoinOptimizer::plan(out.graph);
+    return true;
+}
+
+// How EXPLAIN ANALYZE and traces name a join's right side: its table, or
+// its position for a derived input
+static std::string joinInputName(const std::vector<JoinInput>& inputs, size_t i) {
+    if (inputs[i].table) return "'" + inputs[i].table->getName() + "'";
+    return "input " + std::to_string(i + 1);
+}
+
+QueryResult Executor::joinChain(const std::vector<JoinInput>& inputs,
+                                const std::vector<ExprPtr>& conditions,
+                                const std::vector<std::string>& joinTypes) const {
+    JoinChainPlan planned;
+    TraceSpan planSpan("plan", "order joins");
+    bool usePlan = planJoinChain(inputs, conditions, joinTypes, planned);
+    planSpan.count("inputs", inputs.size());
+    planSpan.finish();
+    if (usePlan && planned.plan.inWrittenOrder()) {
+        // Same order: only worth deviating from joinRows for an index join
+        usePlan = false;
+        for (const auto& step : planned.plan.steps)
+            if (step.method == JoinMethod::INDEX_NESTED_LOOP) usePlan = true;
+    }
+
+    QueryResult current;
+    current.columnNames = inputs[0].columns;
+    if (!usePlan) {
+        if (inputs.size() == 1) current.rows = *inputs[0].rows;
+        const std::vector<Row>* rows = inputs[0].rows;
+        for (size_t i = 1; i < inputs.size(); i++) {
+            OperatorScope scope(profile_, operatorAccess_, "JOIN",
+                                joinTypes[i - 1] + " join with " + joinInputName(inputs, i),
+                                rows->size());
+            QueryResult joined = joinRows(current.columnNames, *rows, inputs[i].columns,
+                                          *inputs[i].rows, conditions[i - 1], joinTypes[i - 1]);
+            scope.finish(joined.rows.size());
+            current = std::move(joined);
+            rows = &current.rows;
+        }
+        return current;
+    }
+
+    const size_t n = inputs.size();
+    const auto& steps = planned.plan.steps;
+    const auto& graph = planned.graph;
+
+    // Each conjunct runs at the first step where every input it reads is present
+    std::vector<std::vector<size_t>> stepConjuncts(n);
+    std::vector<bool> assigned(planned.conjuncts.size(), false);
+    uint64_t placed = 0;
+    for (size_t s = 0; s < n; s++) {
+        placed |= uint64_t(1) << steps[s].relation;
+        if (s == 0) continue;
+        for (size_t c = 0; c < planned.conjuncts.size(); c++) {
+            if (assigned[c] || (graph.predicates[c].relations & ~placed)) continue;
+            stepConjuncts[s].push_back(c);
+            assigned[c] = true;
+        }
+    }
+
+    // ids holds, for every intermediate row, the row it took from each input
+    // joined so far (in plan order)
+    const JoinInput& first = inputs[steps[0].relation];
+    current.columnNames = first.columns;
+    const std::vector<Row>* leftRows = first.rows;
+    std::vector<uint32_t> ids(leftRows->size());
+    std::iota(ids.begin(), ids.end(), 0u);
+
+    for (size_t s = 1; s < n; s++) {
+        const JoinInput& right = inputs[steps[s].relation];
+        QueryResult joined;
+        JoinSources sources;
+        OperatorScope scope(profile_, operatorAccess_, "JOIN",
+                            JoinOptimizer::methodName(steps[s].method) + " with " +
+                                joinInputName(inputs, steps[s].relation),
+                            leftRows->size());
+
+        if (steps[s].method == JoinMethod::INDEX_NESTED_LOOP) {
+            const size_t pi = static_cast<size_t>(steps[s].indexPredicate);
+            const auto& p = graph.predicates[pi];
+            auto bin = std::static_pointer_cast<BinaryExpr>(planned.conjuncts[pi]);
+            const bool rightOnLeft = static_cast<size_t>(p.left) == steps[s].relation;
+            const ExprPtr& rightKey = rightOnLeft ? bin->left : bin->right;
+            const ExprPtr& leftKey = rightOnLeft ? bin->right : bin->left;
+            auto keyCol = std::static_pointer_cast<ColumnExpr>(rightKey);
+            const BTreeIndex* index = inputIndex(right, resolveColumn(keyCol->fullName(), right.columns));
+
+            std::vector<ExprPtr> residual;
+            for (size_t c : stepConjuncts[s])
+                if (c != pi) residual.push_back(planned.conjuncts[c]);
+            indexJoin(current.columnNames, *leftRows, right.columns, *right.rows,
+                      *index, leftKey, residual, joined, &sources);
+            operatorAccess_ = "index '" + index->getName() + "'";
+        } else {
+            ExprPtr condition;
+            for (size_t c : stepConjuncts[s])
+                condition = condition
+                    ? std::make_shared<BinaryExpr>(condition, "and", planned.conjuncts[c])
+                    : planned.conjuncts[c];
+            joined = joinRows(current.columnNames, *leftRows, right.columns, *right.rows,
+                              condition, condition ? "inner" : "cross", &sources);
+        }
+        scope.finish(joined.rows.size());
+
+        std::vector<uint32_t> nextIds(sources.size() * (s + 1));
+        for (size_t o = 0; o < sources.size(); o++) {
+            const uint32_t* from = &ids[static_cast<size_t>(sources[o].first) * s];
+            std::copy(from, from + s, &nextIds[o * (s + 1)]);
+            nextIds[o * (s + 1) + s] = sources[o].second;
+        }
+        ids.swap(nextIds);
+        current = std::move(joined);
+        leftRows = &current.rows;
+    }
+    if (planned.plan.inWrittenOrder()) return current;
+
+    // Restore written order: rows sorted by the row taken from each input in
+    // written order, column blocks laid out in written order
+    std::vector<size_t> position(n), offset(n);
+    size_t width = 0;
+    for (size_t s = 0; s < n; s++) {
+        position[steps[s].relation] = s;
+        offset[steps[s].relation] = width;
+        width += inputs[steps[s].relation].columns.size();
+    }
+    OperatorScope scope(profile_, operatorAccess_, "SORT",
+                        "Restore written join order", current.rows.size());
+    std::vector<uint32_t> order(current.rows.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        for (size_t w = 0; w < n; w++) {
+            uint32_t ia = ids[a * n + position[w]], ib = ids[b * n + position[w]];
+            if (ia != ib) return ia < ib;
+        }
+        return false;
+    });
+
+    QueryResult result;
+    for (const auto& input : inputs)
+        result.columnNames.insert(result.columnNames.end(), input.columns.begin(), input.columns.end());
+    result.rows.resize(order.size());
+    parallelFor(order.size(), kDefaultMorselSize, workersFor(order.size()),
+                [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const Row& from = current.rows[order[i]];
+            Row& to = result.rows[i];
+            to.reserve(width);
+            for (size_t w = 0; w < n; w++) {
+                auto block = from.begin() + static_cast<std::ptrdiff_t>(offset[w]);
+                to.insert(to.end(), block, block + static_cast<std::ptrdiff_t>(inputs[w].columns.size()));
+            }
+        }
+    });
+    scope.finish(result.rows.size());
+    return result;
+}
+
+void Executor::indexJoin(const std::vector<std::string>& leftCols,
+                         const std::vector<Row>& leftRows,
+                         const std::vector<std::string>& rightCols,
+                         const std::vector<Row>& rightRows,
+                         const BTreeIndex& index,
+                         const ExprPtr& leftKey,
+                         const std::vector<ExprPtr>& residual,
+                         QueryResult& result,
+                         JoinSources* sources) const {
+    result.columnNames = leftCols;
+    result.columnNames.insert(result.columnNames.end(), rightCols.begin(), rightCols.end());
+    const auto& joinedCols = result.columnNames;
+    const size_t keyCol = static_cast<size_t>(index.getColumnIndex());
+
+    for (size_t li = 0; li < leftRows.size(); li++) {
+        Value key = evaluate(leftKey, leftRows[li], leftCols);
+        // Row ids come back ascending, so matches keep nested-loop order
+        for (size_t ri : index.find(key)) {
+            // The index orders mixed types loosely; confirm with ==
+            if (ri >= rightRows.size() || !(rightRows[ri][keyCol] == key)) continue;
+            Row combined = leftRows[li];
+            combined.insert(combined.end(), rightRows[ri].begin(), rightRows[ri].end());
+            bool pass = true;
+            for (const auto& cond : residual) {
+                if (!evaluate(cond, combined, joinedCols).asBool()) { pass = false; break; }
+            }
+            if (!pass) continue;
+            result.rows.push_back(std::move(combined));
+            if (sources) sources->emplace_back(static_cast<uint32_t>(li), static_cast<uint32_t>(ri));
+        }
+    }
+}
+
+size_t Executor::selectJoinChain(const SelectStmt& stmt, std::vector<JoinInput>& inputs,
+                                 std::vector<ExprPtr>& conditions,
+                                 std::vector<std::string>& joinTypes) const {
+    if (stmt.fromTable.empty()) return 0;
+    size_t count = 0;
+    while (count < stmt.joins.size() &&
+           (stmt.joins[count].joinType == "inner" || stmt.joins[count].joinType == "cross"))
+        count++;
+    if (count == 0) return 0;
+
+    const Table& base = db_->getTable(stmt.fromTable);
+    JoinInput first;
+    for (const auto& c : base.getColumns())
+        first.columns.push_back(c.name.find('.') == std::string::npos
+                                ? stmt.fromTable + "." + c.name : c.name);
+    first.rows = &base.getRows();
+    first.table = &base;
+    inputs.push_back(std::move(first));
+
+    for (size_t j = 0; j < count; j++) {
+        const auto& join = stmt.joins[j];
+        const Table& table = db_->getTable(join.tableName);
+        JoinInput input;
+        for (const auto& c : table.getColumns())
+            input.columns.push_back(join.tableName + "." + c.name);
+        input.rows = &table.getRows();
+        input.table = &table;
+        inputs.push_back(std::move(input));
+        conditions.push_back(join.onCondition);
+        joinTypes.push_back(join.joinType);
+    }
+    return count;
+}
+
 // ---------------------------------------------------------------------------
 // SAVE / LOAD DATABASE
 // ---------------------------------------------------------------------------
@@ -1929,6 +4734,7 @@ QueryResult Executor::executeLoadDatabase(const LoadDatabaseStmt& stmt) {
 QueryResult Executor::executeCreateIndex(const CreateIndexStmt& stmt) {
     Table& table = db_->getTable(stmt.tableName);
     table.createIndex(stmt.indexName, stmt.columnName, stmt.unique);
+    db_->noteSchemaChange();
     return QueryResult("Index '" + stmt.indexName + "' created on " +
                        stmt.tableName + "(" + stmt.columnName + ").");
 }
@@ -1936,6 +4742,7 @@ QueryResult Executor::executeCreateIndex(const CreateIndexStmt& stmt) {
 QueryResult Executor::executeDropIndex(const DropIndexStmt& stmt) {
     Table& table = db_->getTable(stmt.tableName);
     table.dropIndex(stmt.indexName);
+    db_->noteSchemaChange();
     return QueryResult("Index '" + stmt.indexName + "' dropped.");
 }
 
@@ -1944,72 +4751,118 @@ QueryResult Executor::executeDropIndex(const DropIndexStmt& stmt) {
 // ---------------------------------------------------------------------------
 
 void Executor::checkPermission(Permission perm, const std::string& tableName) const {
-    if (!security_.isEnabled()) return;
-    if (!security_.isLoggedIn())
+    if (!security_->isEnabled()) return;
+    if (currentUser_.empty() || !security_->userExists(currentUser_))
         throw std::runtime_error("Authentication required. Use LOGIN <user> <password>;");
-    if (!security_.hasPermission(security_.currentUser(), perm, tableName))
+    if (!security_->hasPermission(currentUser_, perm, tableName))
         throw std::runtime_error("Permission denied: " + permissionToString(perm) +
                                  " on " + tableName);
 }
 
 QueryResult Executor::executeCreateUser(const CreateUserStmt& stmt) {
-    security_.createUser(stmt.userName, stmt.password, stmt.isAdmin);
+    security_->createUser(stmt.userName, stmt.password, stmt.isAdmin);
     return QueryResult("User '" + stmt.userName + "' created.");
 }
 
 QueryResult Executor::executeDropUser(const DropUserStmt& stmt) {
-    security_.dropUser(stmt.userName);
+    security_->dropUser(stmt.userName);
     return QueryResult("User '" + stmt.userName + "' dropped.");
 }
 
 QueryResult Executor::executeGrant(const GrantStmt& stmt) {
     Permission perm = stringToPermission(stmt.permission);
-    security_.grant(stmt.userName, perm, stmt.tableName);
+    security_->grant(stmt.userName, perm, stmt.tableName);
     return QueryResult("Granted " + permissionToString(perm) + " to '" + stmt.userName + "'.");
 }
 
 QueryResult Executor::executeRevoke(const RevokeStmt& stmt) {
     Permission perm = stringToPermission(stmt.permission);
-    security_.revoke(stmt.userName, perm, stmt.tableName);
+    security_->revoke(stmt.userName, perm, stmt.tableName);
     return QueryResult("Revoked " + permissionToString(perm) + " from '" + stmt.userName + "'.");
 }
 
 QueryResult Executor::executeLogin(const LoginStmt& stmt) {
-    if (!security_.authenticate(stmt.userName, stmt.password))
+    if (!security_->authenticate(stmt.userName, stmt.password))
         return QueryResult("Authentication failed for user '" + stmt.userName + "'", false);
-    security_.login(stmt.userName);
+    currentUser_ = stmt.userName;
     return QueryResult("Logged in as '" + stmt.userName + "'.");
 }
 
 QueryResult Executor::executeLogout() {
-    security_.logout();
+    currentUser_.clear();
     return QueryResult("Logged out.");
 }
 
 QueryResult Executor::executeShowUsers() {
-    return security_.showUsers();
+    return security_->showUsers();
 }
 
 QueryResult Executor::executeShowGrants(const ShowGrantsStmt& stmt) {
-    return security_.showGrants(stmt.userName);
+    return security_->showGrants(stmt.userName);
 }
 
 // ---------------------------------------------------------------------------
 // EXPLAIN
 // ---------------------------------------------------------------------------
 
+static void describePipeline(const std::string& tableName, const std::vector<PipelineStage>& stages,
+                             const std::string& plan, QueryResult& result) {
+    int step = 1;
+    result.rows.push_back({Value(plan), Value(step++), Value(std::string("TABLE SCAN")),
+        Value(std::string("Scan table '" + tableName + "'"))});
+    for (const auto& stage : stages) {
+        std::string op, detail;
+        describeStage(stage, op, detail);
+        result.rows.push_back({Value(plan), Value(step++), Value(op), Value(detail)});
+    }
+}
+
 QueryResult Executor::executeExplain(const ExplainStmt& stmt) {
+    if (stmt.analyze) return executeExplainAnalyze(stmt);
+
     QueryResult result;
     result.columnNames = {"Step", "Operation", "Details"};
 
     if (auto s = std::dynamic_pointer_cast<SelectStmt>(stmt.innerStmt)) {
         int step = 1;
-        if (!s->fromTable.empty())
+        std::vector<JoinInput> chain;
+        std::vector<ExprPtr> conditions;
+        std::vector<std::string> joinTypes;
+        JoinChainPlan planned;
+        size_t chained = selectJoinChain(*s, chain, conditions, joinTypes);
+        if (chained > 0 && planJoinChain(chain, conditions, joinTypes, planned)) {
+            // Inner joins in the order the optimizer chose, with estimates
+            auto estimate = [](double rows) {
+                return " (est. " + std::to_string(static_cast<long long>(std::llround(rows))) + " rows)";
+            };
+            const auto& steps = planned.plan.steps;
             result.rows.push_back({Value(step++), Value(std::string("TABLE SCAN")),
-                Value(std::string("Scan table '" + s->fromTable + "'"))});
-        for (const auto& join : s->joins)
+                Value("Scan table '" + chain[steps[0].relation].table->getName() + "'" +
+                      estimate(steps[0].rows))});
+            for (size_t i = 1; i < steps.size(); i++)
+                result.rows.push_back({Value(step++), Value(std::string("JOIN")),
+                    Value(JoinOptimizer::methodName(steps[i].method) + " with '" +
+                          chain[steps[i].relation].table->getName() + "'" + estimate(steps[i].rows))});
+        } else {
+            chained = 0;
+            IndexAccess access;
+            bool indexed = false;
+            if (s->whereClause && s->joins.empty() && db_->hasTable(s->fromTable)) {
+                const Table& table = db_->getTable(s->fromTable);
+                std::vector<std::string> colNames;
+                for (const auto& c : table.getColumns()) colNames.push_back(c.name);
+                indexed = indexAccess(s->whereClause, table, colNames, access);
+            }
+            if (indexed)
+                result.rows.push_back({Value(step++), Value(std::string("INDEX SCAN")),
+                                       Value(access.describe())});
+            else if (!s->fromTable.empty())
+                result.rows.push_back({Value(step++), Value(std::string("TABLE SCAN")),
+                    Value(std::string("Scan table '" + s->fromTable + "'"))});
+        }
+        for (size_t j = chained; j < s->joins.size(); j++)
             result.rows.push_back({Value(step++), Value(std::string("JOIN")),
-                Value(std::string(join.joinType + " join with '" + join.tableName + "'"))});
+                Value(std::string(s->joins[j].joinType + " join with '" + s->joins[j].tableName + "'"))});
         if (s->whereClause)
             result.rows.push_back({Value(step++), Value(std::string("FILTER")),
                 Value(std::string("Apply WHERE predicate"))});
@@ -2031,30 +4884,16 @@ QueryResult Executor::executeExplain(const ExplainStmt& stmt) {
         result.rows.push_back({Value(step++), Value(std::string("PROJECT")),
             Value(std::string("Select " + std::to_string(s->columns.size()) + " column(s)"))});
     } else if (auto s = std::dynamic_pointer_cast<PipelineStmt>(stmt.innerStmt)) {
+        // The pipeline as written, then as it runs after rewriting
+        std::vector<std::string> notes;
+        std::vector<PipelineStage> rewritten = rewritePipeline(*s, &notes);
+        result.columnNames = {"Plan", "Step", "Operation", "Details"};
+        describePipeline(s->tableName, s->stages, "original", result);
+        describePipeline(s->tableName, rewritten, "rewritten", result);
         int step = 1;
-        result.rows.push_back({Value(step++), Value(std::string("TABLE SCAN")),
-            Value(std::string("Scan table '" + s->tableName + "'"))});
-        for (const auto& stage : s->stages) {
-            std::string op, detail;
-            switch (stage.type) {
-                case PipelineStage::Type::WHERE: op = "FILTER"; detail = "Apply WHERE predicate"; break;
-                case PipelineStage::Type::SELECT: op = "PROJECT"; detail = "Select columns"; break;
-                case PipelineStage::Type::ORDERBY: op = "SORT"; detail = "Order by columns"; break;
-                case PipelineStage::Type::LIMIT:
-                case PipelineStage::Type::TAKE: op = "LIMIT"; detail = "Limit rows"; break;
-                case PipelineStage::Type::OFFSET:
-                case PipelineStage::Type::SKIP_STAGE: op = "OFFSET"; detail = "Skip rows"; break;
-                case PipelineStage::Type::GROUPBY: op = "GROUP"; detail = "Group by columns"; break;
-                case PipelineStage::Type::HAVING: op = "FILTER"; detail = "Apply HAVING predicate"; break;
-                case PipelineStage::Type::JOIN: op = "JOIN"; detail = stage.joinType + " join with '" + stage.joinTable + "'"; break;
-                case PipelineStage::Type::DISTINCT: op = "DISTINCT"; detail = "Remove duplicates"; break;
-                case PipelineStage::Type::COUNT_STAGE: op = "AGGREGATE"; detail = "Count rows"; break;
-                case PipelineStage::Type::MAP: op = "MAP"; detail = "Add computed columns"; break;
-                case PipelineStage::Type::PRINT: op = "OUTPUT"; detail = "Print results"; break;
-                default: op = "UNKNOWN"; detail = "Unknown stage"; break;
-            }
-            result.rows.push_back({Value(step++), Value(op), Value(detail)});
-        }
+        for (const auto& text : notes)
+            result.rows.push_back({Value(std::string("rules")), Value(step++),
+                                   Value(std::string("REWRITE")), Value(text)});
     } else if (auto s = std::dynamic_pointer_cast<InsertStmt>(stmt.innerStmt)) {
         result.rows.push_back({Value(1), Value(std::string("INSERT")),
             Value(std::string("Insert " + std::to_string(s->valueRows.size()) + " row(s) into '" + s->tableName + "'"))});
@@ -2084,4 +4923,275 @@ QueryResult Executor::executeExplain(const ExplainStmt& stmt) {
     return result;
 }
 
+static double roundTo(double value, double unit) {
+    return std::round(value / unit) * unit;
+}
+
+static std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+static std::string jsonNumber(double value) {
+    std::ostringstream oss;
+    oss << roundTo(value, 0.001);
+    return oss.str();
+}
+
+QueryResult Executor::executeExplainAnalyze(const ExplainStmt& stmt) {
+    std::vector<OperatorProfile> profile;
+    profile_ = &profile;
+    // Counts this session's allocations only, including its parallel workers'
+    AllocationCounters allocations;
+    const std::clock_t cpuStart = std::clock();
+    const auto wallStart = std::chrono::steady_clock::now();
+
+    QueryResult inner;
+    try {
+        AllocationTracker::Scope tracking(&allocations);
+        inner = execute(stmt.innerStmt);
+    } catch (...) {
+        profile_ = nullptr;
+        throw;
+    }
+
+    const double wallMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - wallStart).count();
+    const double cpuMs = 1000.0 * static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    const int64_t peakBytes = std::max<int64_t>(0, allocations.peak());
+    profile_ = nullptr;
+    if (!inner.success) return inner;
+
+    const size_t rows = inner.columnNames.empty() ? inner.affectedRows : inner.rows.size();
+
+    if (stmt.json) {
+        std::ostringstream out;
+        out << "{\"total\": {\"wall_ms\": " << jsonNumber(wallMs)
+            << ", \"cpu_ms\": " << jsonNumber(cpuMs)
+            << ", \"rows\": " << rows
+            << ", \"peak_bytes\": " << peakBytes
+            << ", \"memory_tracked\": " << (AllocationTracker::supported() ? "true" : "false")
+            << "}, \"operators\": [";
+        for (size_t i = 0; i < profile.size(); i++) {
+            const auto& op = profile[i];
+            out << (i ? ", " : "")
+                << "{\"step\": " << i + 1
+                << ", \"operation\": " << jsonString(op.operation)
+                << ", \"detail\": " << jsonString(op.detail)
+                << ", \"access\": " << (op.access.empty() ? "null" : jsonString(op.access))
+                << ", \"rows_in\": " << op.rowsIn
+                << ", \"rows_out\": " << op.rowsOut
+                << ", \"wall_ms\": " << jsonNumber(op.wallMs)
+                << ", \"cpu_ms\": " << jsonNumber(op.cpuMs)
+                << ", \"peak_bytes\": " << op.peakBytes << "}";
+        }
+        out << "]}";
+        return QueryResult(out.str());
+    }
+
+    QueryResult result;
+    result.columnNames = {"Step", "Operation", "Details", "Access",
+                          "Rows In", "Rows Out", "Wall ms", "CPU ms", "Peak KB"};
+    auto addRow = [&](const Value& step, const std::string& operation, const std::string& detail,
+                      const std::string& access, const Value& rowsIn, size_t rowsOut,
+                      double wall, double cpu, int64_t bytes) {
+        result.rows.push_back({step, Value(operation), Value(detail), Value(access), rowsIn,
+                               Value(static_cast<int>(rowsOut)),
+                               Value(roundTo(wall, 0.001)), Value(roundTo(cpu, 0.001)),
+                               Value(roundTo(static_cast<double>(bytes) / 1024.0, 0.1))});
+    };
+    for (size_t i = 0; i < profile.size(); i++) {
+        const auto& op = profile[i];
+        addRow(Value(static_cast<int>(i + 1)), op.operation, op.detail,
+               op.access.empty() ? "-" : op.access, Value(static_cast<int>(op.rowsIn)),
+               op.rowsOut, op.wallMs, op.cpuMs, op.peakBytes);
+    }
+    addRow(Value(), "TOTAL", "Whole statement", "-", Value(), rows, wallMs, cpuMs, peakBytes);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// ANALYZE / SHOW STATS
+// ---------------------------------------------------------------------------
+
+QueryResult Executor::executeAnalyze(const AnalyzeStmt& stmt) {
+    std::vector<std::string> names;
+    if (!stmt.tableName.empty()) {
+        db_->getTable(stmt.tableName);  // throws if missing
+        names.push_back(stmt.tableName);
+    } else {
+        for (const auto& [name, table] : db_->getAllTables()) names.push_back(name);
+        std::sort(names.begin(), names.end());
+    }
+    for (const auto& name : names) checkPermission(Permission::SELECT, name);
+
+    for (const auto& name : names) db_->analyzeTable(name);
+    return QueryResult("Analyzed " + std::to_string(names.size()) + " table(s).");
+}
+
+static Value roundedFraction(double f) {
+    return Value(std::round(f * 1000.0) / 1000.0);
+}
+
+QueryResult Executor::executeShowStats(const ShowStatsStmt& stmt) {
+    std::vector<std::string> names;
+    if (!stmt.tableName.empty()) {
+        db_->getTable(stmt.tableName);
+        if (!db_->getStatistics(stmt.tableName))
+            throw std::runtime_error("No statistics for table '" + stmt.tableName +
+                "'; run ANALYZE first");
+        names.push_back(stmt.tableName);
+    } else {
+        for (const auto& [name, stats] : db_->getAllStatistics()) names.push_back(name);
+        std::sort(names.begin(), names.end());
+    }
+
+    QueryResult result;
+    result.columnNames = {"Table", "Column", "Rows", "Null Frac", "Distinct",
+                          "Min", "Max", "Most Common", "Histogram"};
+    for (const auto& name : names) {
+        const Table& table = db_->getTable(name);
+        const TableStats& stats = *db_->getStatistics(name);
+        const auto& cols = table.getColumns();
+        for (size_t c = 0; c < cols.size() && c < stats.columns.size(); c++) {
+            const ColumnStats& cs = stats.columns[c];
+
+            std::string common;
+            for (const auto& [v, frac] : cs.mostCommon) {
+                if (!common.empty()) common += ", ";
+                common += v.asString() + " (" + roundedFraction(frac).asString() + ")";
+            }
+            std::string histogram;
+            for (const auto& bound : cs.histogram) {
+                if (!histogram.empty()) histogram += " | ";
+                histogram += bound.asString();
+            }
+
+            Row row;
+            row.push_back(Value(name));
+            row.push_back(Value(cols[c].name));
+            row.push_back(Value(static_cast<int>(stats.rowCount)));
+            row.push_back(roundedFraction(stats.nullFraction(c)));
+            row.push_back(Value(static_cast<int>(std::llround(cs.distinctCount))));
+            row.push_back(cs.minValue);
+            row.push_back(cs.maxValue);
+            row.push_back(Value(common));
+            row.push_back(Value(histogram));
+            result.rows.push_back(row);
+        }
+    }
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// PREPARE / EXECUTE
+// ---------------------------------------------------------------------------
+
+static PreparedHandle makePrepared(const StmtPtr& statement,
+                                   const std::vector<std::shared_ptr<ParamExpr>>& params) {
+    if (!std::dynamic_pointer_cast<SelectStmt>(statement) &&
+        !std::dynamic_pointer_cast<PipelineStmt>(statement) &&
+        !std::dynamic_pointer_cast<InsertStmt>(statement) &&
+        !std::dynamic_pointer_cast<UpdateStmt>(statement) &&
+        !std::dynamic_pointer_cast<DeleteStmt>(statement))
+        throw std::runtime_error("Only select, insert, update, delete and pipeline statements can be prepared");
+
+    auto handle = std::make_shared<PreparedStatement>();
+    handle->statement = statement;
+    handle->params = params;
+    for (const auto& p : params) handle->paramCount = std::max(handle->paramCount, p->index);
+    return handle;
+}
+
+PreparedHandle Executor::prepare(const std::string& source) {
+    std::string text = source;
+    size_t end = text.find_last_not_of(" \t\r\n");
+    if (end == std::string::npos) throw std::runtime_error("Empty statement");
+    if (text[end] != ';') text += ';';
+
+    DbLexer lexer(text);
+    DbParser parser(lexer.tokenize());
+    parser.allowParameters(true);
+    auto statements = parser.parse();
+    if (parser.hasErrors()) throw std::runtime_error(parser.getErrors().front());
+    if (statements.size() != 1) throw std::runtime_error("Expected a single statement to prepare");
+    return makePrepared(statements[0], parser.parameters());
+}
+
+QueryResult Executor::execute(const PreparedHandle& handle, const std::vector<Value>& params) {
+    if (!handle) return QueryResult("Null prepared statement", false);
+    if (params.size() != handle->paramCount)
+        return QueryResult("Error: Expected " + std::to_string(handle->paramCount) +
+                           " parameter(s), got " + std::to_string(params.size()), false);
+    for (const auto& p : handle->params) p->value = params[p->index - 1];
+    return execute(handle->statement);
+}
+
+QueryResult Executor::executePrepare(const PrepareStmt& stmt) {
+    prepared_[stmt.name] = makePrepared(stmt.statement, stmt.params);
+    return QueryResult("Statement '" + stmt.name + "' prepared.");
+}
+
+QueryResult Executor::executeExecute(const ExecuteStmt& stmt) {
+    auto it = prepared_.find(stmt.name);
+    if (it == prepared_.end())
+        throw std::runtime_error("Prepared statement '" + stmt.name + "' does not exist");
+    std::vector<Value> params;
+    params.reserve(stmt.args.size());
+    for (const auto& arg : stmt.args) params.push_back(evaluate(arg));
+    return execute(it->second, params);
+}
+
+QueryResult Executor::executeDeallocate(const DeallocateStmt& stmt) {
+    if (!prepared_.erase(stmt.name))
+        throw std::runtime_error("Prepared statement '" + stmt.name + "' does not exist");
+    return QueryResult("Statement '" + stmt.name + "' deallocated.");
+}
+
+// ---------------------------------------------------------------------------
+// SET options
+// ---------------------------------------------------------------------------
+
+// SET trace = on | off | "<file>".  The trace file is shared by every
+// session; "on" keeps the one already open, or starts the default file.
+// Server sessions only get on and off.
+QueryResult Executor::executeSetOption(const SetOptionStmt& stmt) {
+    if (stmt.option != "trace")
+        throw std::runtime_error("Unknown option '" + stmt.option + "'");
+
+    Tracer& tracer = Tracer::global();
+    if (!stmt.quoted && (stmt.value == "off" || stmt.value == "false")) {
+        tracing_ = false;
+        return QueryResult("Tracing off.");
+    }
+    if (stmt.quoted) {
+        if (remote_)
+            throw std::runtime_error("Trace files are chosen by the server (--trace <file>); use set trace = on");
+        if (stmt.value.empty()) throw std::runtime_error("Trace file name is empty");
+        tracer.open(stmt.value);
+    } else if (stmt.value == "on" || stmt.value == "true") {
+        if (!tracer.isOpen()) tracer.open(Tracer::kDefaultPath);
+    } else {
+        throw std::runtime_error("Option 'trace' expects on, off or a file name");
+    }
+    tracing_ = true;
+    return QueryResult("Tracing to '" + tracer.path() + "'.");
+}
+
 } // namespace epee
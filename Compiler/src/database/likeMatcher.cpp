@@ -0,0 +1,155 @@
+/*
+ File: likeMatcher.cpp
+ Project: Épée Database Query Language
+ Description: LikeMatcher implementation
+*/
+
+#include "../../include/database/likeMatcher.hpp"
+
+#include <cstring>
+
+namespace epee {
+
+namespace {
+
+// ASCII lowercase, the same mapping std::tolower applies in the C locale
+struct FoldTable {
+    unsigned char map[256];
+    FoldTable() {
+        for (int c = 0; c < 256; c++)
+            map[c] = static_cast<unsigned char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+    }
+};
+
+const FoldTable foldTable;
+
+inline char fold(char c) {
+    return static_cast<char>(foldTable.map[static_cast<unsigned char>(c)]);
+}
+
+bool isLetter(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+} // namespace
+
+LikeMatcher::LikeMatcher(const std::string& pattern) {
+    anchoredStart_ = pattern.empty() || pattern.front() != '%';
+    anchoredEnd_ = pattern.empty() || pattern.back() != '%';
+
+    bool hasPercent = false;
+    Segment current;
+    auto flush = [&]() {
+        if (current.text.empty()) return;
+        current.firstLiteral = current.text.find_first_not_of('_');
+        if (current.firstLiteral == std::string::npos) current.firstLiteral = current.text.size();
+        minLength_ += current.text.size();
+        segments_.push_back(std::move(current));
+        current = Segment();
+    };
+    for (char c : pattern) {
+        if (c == '%') {
+            hasPercent = true;
+            flush();
+            continue;
+        }
+        if (c == '_') current.wildcards = true;
+        if (isLetter(c)) folds_ = true;
+        current.text += fold(c);
+    }
+    flush();
+
+    if (!hasPercent) kind_ = Kind::EXACT;
+    else if (segments_.empty()) kind_ = Kind::ANY;
+    else if (segments_.size() == 1 && anchoredStart_) kind_ = Kind::PREFIX;
+    else if (segments_.size() == 1 && anchoredEnd_) kind_ = Kind::SUFFIX;
+    else if (segments_.size() == 1) kind_ = Kind::CONTAINS;
+    else kind_ = Kind::GENERAL;
+
+    if (anchoredStart_ && !segments_.empty())
+        prefix_ = segments_.front().text.substr(0, segments_.front().text.find('_'));
+}
+
+bool LikeMatcher::matchAt(std::string_view text, size_t pos, const Segment& segment) {
+    if (!segment.wildcards)
+        return std::memcmp(text.data() + pos, segment.text.data(), segment.text.size()) == 0;
+    for (size_t i = 0; i < segment.text.size(); i++) {
+        const char p = segment.text[i];
+        if (p != '_' && p != text[pos + i]) return false;
+    }
+    return true;
+}
+
+size_t LikeMatcher::find(std::string_view text, size_t pos, const Segment& segment) {
+    const size_t length = segment.text.size();
+    if (pos > text.size() || text.size() - pos < length) return std::string_view::npos;
+    // Literal segments use the library search (memchr for the first
+    // character, then memcmp)
+    if (!segment.wildcards) return text.find(segment.text, pos);
+    // Otherwise jump between occurrences of the first literal character
+    const size_t offset = segment.firstLiteral;
+    if (offset == length) return pos;  // only `_`
+    const char first = segment.text[offset];
+    const size_t last = text.size() - length;
+    while (pos <= last) {
+        const void* hit = std::memchr(text.data() + pos + offset, first, last - pos + 1);
+        if (!hit) return std::string_view::npos;
+        const size_t start = static_cast<size_t>(static_cast<const char*>(hit) - text.data()) - offset;
+        if (matchAt(text, start, segment)) return start;
+        pos = start + 1;
+    }
+    return std::string_view::npos;
+}
+
+bool LikeMatcher::matches(std::string_view text) const {
+    if (text.size() < minLength_) return false;
+    if (kind_ == Kind::ANY) return true;
+
+    // Letters compare lowercased; the folded copy is reused per thread
+    thread_local std::string folded;
+    if (folds_) {
+        folded.resize(text.size());
+        for (size_t i = 0; i < text.size(); i++) folded[i] = fold(text[i]);
+        text = folded;
+    }
+
+    switch (kind_) {
+        case Kind::EXACT:
+            return segments_.empty() ? text.empty()
+                                     : text.size() == minLength_ && matchAt(text, 0, segments_[0]);
+        case Kind::PREFIX:
+            return matchAt(text, 0, segments_[0]);
+        case Kind::SUFFIX:
+            return matchAt(text, text.size() - minLength_, segments_[0]);
+        case Kind::CONTAINS:
+            return find(text, 0, segments_[0]) != std::string_view::npos;
+        default:
+            break;
+    }
+
+    // GENERAL: anchor the ends, then place the middle segments leftmost-first
+    size_t first = 0;
+    size_t last = segments_.size();
+    size_t pos = 0;
+    size_t end = text.size();
+    if (anchoredStart_) {
+        if (!matchAt(text, 0, segments_[0])) return false;
+        pos = segments_[0].text.size();
+        first = 1;
+    }
+    if (anchoredEnd_) {
+        const Segment& tail = segments_.back();
+        if (!matchAt(text, text.size() - tail.text.size(), tail)) return false;
+        end = text.size() - tail.text.size();
+        last--;
+    }
+    const std::string_view window = text.substr(0, end);
+    for (size_t i = first; i < last; i++) {
+        const size_t at = find(window, pos, segments_[i]);
+        if (at == std::string_view::npos) return false;
+        pos = at + segments_[i].text.size();
+    }
+    return pos <= end;
+}
+
+} // namespace epee
@@ -0,0 +1,415 @@
+/*
+ File: loader.cpp
+ Project: Épée Database Query Language
+ Description: COPY implementation: memory-mapped input, parallel chunked CSV
+              parsing, batch constraint checks and a single index rebuild
+*/
+
+#include "../../include/database/loader.hpp"
+#include "../../include/database/parallel.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define EPEE_HAVE_MMAP 1
+#endif
+
+namespace epee {
+
+namespace {
+
+// Chunks handed to one worker: big enough to amortize dispatch, small enough
+// that a few per worker keep them balanced
+constexpr size_t kChunkBytes = size_t(1) << 20;
+
+// Read-only view of a file's bytes, memory-mapped where the platform allows
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef EPEE_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open file '" + path + "'");
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot read file '" + path + "'");
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+                ::madvise(p, size_, MADV_SEQUENTIAL);
+#endif
+                data_ = static_cast<const char*>(p);
+                mapped_ = true;
+            }
+        }
+        ::close(fd);
+        if (mapped_ || size_ == 0) return;
+#endif
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) throw std::runtime_error("Cannot open file '" + path + "'");
+        buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+    }
+
+    ~MappedFile() {
+#ifdef EPEE_HAVE_MMAP
+        if (mapped_) ::munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::string buffer_;
+};
+
+struct LoadError {
+    size_t line;  // 1-based, relative to where the parse started
+    std::string message;
+};
+
+// One slice of the file, starting at a record boundary
+struct Chunk {
+    size_t begin = 0, end = 0;
+    std::vector<Row> rows;
+    std::vector<uint32_t> rowLines;  // line of each row, relative to the chunk
+    size_t lines = 0;                // newlines consumed
+    bool failed = false;
+    LoadError error{0, ""};
+};
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+bool parseInt(std::string_view s, Value& out) {
+    int64_t v = 0;
+    if (!s.empty() && s.front() == '+') s.remove_prefix(1);
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (ec != std::errc() || ptr != s.data() + s.size() || s.empty()) return false;
+    if (v >= std::numeric_limits<int>::min() && v <= std::numeric_limits<int>::max())
+        out = Value(static_cast<int>(v));
+    else
+        out = Value(static_cast<double>(v));  // wider than Value's int
+    return true;
+}
+
+bool parseDouble(std::string_view s, Value& out) {
+    double v = 0.0;
+    if (!s.empty() && s.front() == '+') s.remove_prefix(1);
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (ec != std::errc() || ptr != s.data() + s.size() || s.empty()) return false;
+    out = Value(v);
+    return true;
+}
+
+bool parseBool(std::string_view s, Value& out) {
+    std::string lower(s);
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "true" || lower == "t" || lower == "1" || lower == "yes") out = Value(true);
+    else if (lower == "false" || lower == "f" || lower == "0" || lower == "no") out = Value(false);
+    else return false;
+    return true;
+}
+
+// Convert one field to the column's type; returns false with `error` set
+bool convert(std::string_view text, bool quoted, const Column& col, Value& out,
+             std::string& error) {
+    if (!quoted && text.empty()) {
+        if (!col.nullable) {
+            error = "Column '" + col.name + "' cannot be null";
+            return false;
+        }
+        out = Value();
+        return true;
+    }
+    bool ok = true;
+    switch (col.type) {
+        case ValueType::STRING:
+            out = Value(text);
+            return true;
+        case ValueType::INT:
+            ok = parseInt(trim(text), out) || parseDouble(trim(text), out);
+            break;
+        case ValueType::DOUBLE:
+            ok = parseDouble(trim(text), out);
+            break;
+        case ValueType::BOOL:
+            ok = parseBool(trim(text), out);
+            break;
+        case ValueType::NULL_TYPE:
+            if (!quoted && (parseInt(trim(text), out) || parseDouble(trim(text), out))) return true;
+            out = Value(text);
+            return true;
+    }
+    if (!ok) {
+        error = "Invalid " + std::string(col.type == ValueType::INT ? "int" :
+                                         col.type == ValueType::DOUBLE ? "double" : "bool") +
+                " value '" + std::string(text) + "' for column '" + col.name + "'";
+    }
+    return ok;
+}
+
+// Offset just past the newline ending the record that starts at `pos`, or
+// `size` at the end of the file.  Quotes are read the way parseChunk reads
+// them: only a quote starting a field opens a quoted field, so a stray one
+// inside an unquoted field ("5\" screen") is plain text.
+size_t skipRecord(const char* data, size_t size, size_t pos, char delim) {
+    bool fieldStart = true;
+    for (; pos < size; pos++) {
+        const char c = data[pos];
+        if (c == '"' && fieldStart) {
+            // Skip to the closing quote, past any "" escapes
+            for (pos++; pos < size; pos++) {
+                if (data[pos] != '"') continue;
+                if (pos + 1 < size && data[pos + 1] == '"') pos++;
+                else break;
+            }
+            fieldStart = false;
+        } else if (c == '\n') {
+            return pos + 1;
+        } else {
+            fieldStart = c == delim;
+        }
+    }
+    return size;
+}
+
+// Record boundaries splitting [begin, size) into about `count` chunks
+std::vector<size_t> chunkStarts(const char* data, size_t size, size_t begin, size_t count, char delim) {
+    std::vector<size_t> starts = {begin};
+    const size_t length = size - begin;
+    if (count <= 1 || length == 0) return starts;
+
+    if (!std::memchr(data + begin, '"', length)) {
+        // No quoting: any newline is a record boundary
+        for (size_t k = 1; k < count; k++) {
+            size_t target = begin + length / count * k;
+            if (target < starts.back()) continue;
+            const void* nl = std::memchr(data + target, '\n', size - target);
+            if (!nl) break;
+            size_t next = static_cast<size_t>(static_cast<const char*>(nl) - data) + 1;
+            if (next < size && next > starts.back()) starts.push_back(next);
+        }
+        return starts;
+    }
+
+    // Quoted fields may hold newlines: walk the records from the start
+    size_t k = 1;
+    for (size_t pos = begin; k < count;) {
+        pos = skipRecord(data, size, pos, delim);
+        if (pos >= size) break;
+        if (pos >= begin + length / count * k) {
+            starts.push_back(pos);
+            k++;
+        }
+    }
+    return starts;
+}
+
+void parseChunk(const char* data, Chunk& chunk, const std::vector<Column>& columns, char delim) {
+    const size_t ncols = columns.size();
+    const char* p = data + chunk.begin;
+    const char* const end = data + chunk.end;
+    std::string quotedText;
+    std::string error;
+    size_t line = 1;
+
+    auto fail = [&](size_t at, std::string message) {
+        chunk.failed = true;
+        chunk.error = {at, std::move(message)};
+    };
+
+    while (p < end) {
+        // Blank lines are skipped, except with a single column: there a
+        // blank line is a record whose one unquoted empty field is NULL
+        if (ncols > 1 && (*p == '\n' || (*p == '\r' && p + 1 < end && p[1] == '\n'))) {
+            p += *p == '\r' ? 2 : 1;
+            line++;
+            continue;
+        }
+
+        const size_t recordLine = line;
+        Row row(ncols);
+        size_t field = 0;
+        for (;;) {
+            std::string_view text;
+            bool quoted = false;
+            if (p < end && *p == '"') {
+                quoted = true;
+                quotedText.clear();
+                p++;
+                for (;;) {
+                    const char* q = static_cast<const char*>(std::memchr(p, '"', static_cast<size_t>(end - p)));
+                    if (!q) {
+                        fail(recordLine, "Unterminated quoted field");
+                        return;
+                    }
+                    line += static_cast<size_t>(std::count(p, q, '\n'));
+                    quotedText.append(p, q);
+                    p = q + 1;
+                    if (p < end && *p == '"') {  // "" inside quotes
+                        quotedText += '"';
+                        p++;
+                        continue;
+                    }
+                    break;
+                }
+                if (p < end && *p != delim && *p != '\n' && *p != '\r') {
+                    fail(line, "Unexpected character after quoted field");
+                    return;
+                }
+                text = quotedText;
+            } else {
+                const char* start = p;
+                while (p < end && *p != delim && *p != '\n') p++;
+                const char* stop = p;
+                if (stop > start && stop[-1] == '\r' && (p == end || *p == '\n')) stop--;
+                text = std::string_view(start, static_cast<size_t>(stop - start));
+            }
+
+            if (field >= ncols) {
+                fail(recordLine, "Expected " + std::to_string(ncols) + " field(s), got more");
+                return;
+            }
+            if (!convert(text, quoted, columns[field], row[field], error)) {
+                fail(recordLine, error);
+                return;
+            }
+            field++;
+
+            if (p < end && *p == delim) {
+                p++;
+                continue;
+            }
+            if (p < end && *p == '\r') p++;
+            if (p < end && *p == '\n') {
+                p++;
+                line++;
+            }
+            break;
+        }
+        if (field != ncols) {
+            fail(recordLine, "Expected " + std::to_string(ncols) + " field(s), got " +
+                             std::to_string(field));
+            return;
+        }
+        chunk.rows.push_back(std::move(row));
+        chunk.rowLines.push_back(static_cast<uint32_t>(recordLine));
+    }
+    chunk.lines = line - 1;
+}
+
+} // namespace
+
+size_t BulkLoader::load(Table& table, const std::string& path, const CopyOptions& options) {
+    char delim = options.delimiter;
+    if (delim == '\0') {
+        auto endsWith = [&](const std::string& ext) {
+            return path.size() >= ext.size() &&
+                   std::equal(ext.rbegin(), ext.rend(), path.rbegin(),
+                              [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); });
+        };
+        delim = endsWith(".tsv") || endsWith(".tab") ? '\t' : ',';
+    }
+    if (delim == '"' || delim == '\n' || delim == '\r')
+        throw std::runtime_error("Invalid delimiter");
+
+    MappedFile file(path);
+    const char* data = file.data();
+    const size_t size = file.size();
+
+    size_t begin = 0, headerLines = 0;
+    if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) begin = 3;  // UTF-8 BOM
+    if (options.header && begin < size) {
+        size_t next = skipRecord(data, size, begin, delim);
+        headerLines = static_cast<size_t>(std::count(data + begin, data + next, '\n'));
+        begin = next;
+    }
+
+    // Parse chunks in parallel into rows of typed values
+    const size_t workers = workerCount();
+    const size_t wanted = std::min((size - begin) / kChunkBytes + 1, workers * 4);
+    std::vector<size_t> starts = chunkStarts(data, size, begin, wanted, delim);
+    std::vector<Chunk> chunks(starts.size());
+    for (size_t i = 0; i < chunks.size(); i++) {
+        chunks[i].begin = starts[i];
+        chunks[i].end = i + 1 < starts.size() ? starts[i + 1] : size;
+    }
+    const auto& columns = table.getColumns();
+    parallelTasks(chunks.size(), std::min(workers, chunks.size()), [&](size_t i) {
+        parseChunk(data, chunks[i], columns, delim);
+    });
+
+    // File line of a chunk-relative line, for error messages
+    std::vector<size_t> firstLine(chunks.size());
+    size_t total = 0;
+    for (size_t i = 0, line = headerLines; i < chunks.size(); i++) {
+        if (chunks[i].failed)
+            throw std::runtime_error("Line " + std::to_string(line + chunks[i].error.line) +
+                                     ": " + chunks[i].error.message);
+        firstLine[i] = line;
+        line += chunks[i].lines;
+        total += chunks[i].rows.size();
+    }
+
+    // Unique columns and unique indexes, checked over existing and new rows
+    std::vector<std::pair<size_t, bool>> uniqueCols;  // column, NULLs exempt
+    for (size_t c = 0; c < columns.size(); c++)
+        if (columns[c].unique || columns[c].primaryKey) uniqueCols.push_back({c, false});
+    for (const auto& [name, index] : table.getIndexes()) {
+        if (!index.isUnique() || index.getColumnIndex() < 0) continue;
+        size_t c = static_cast<size_t>(index.getColumnIndex());
+        if (std::none_of(uniqueCols.begin(), uniqueCols.end(),
+                         [&](const auto& u) { return u.first == c; }))
+            uniqueCols.push_back({c, true});
+    }
+    for (const auto& [c, skipNulls] : uniqueCols) {
+        ValueSet seen;
+        seen.reserve(table.rowCount() + total);
+        for (const auto& row : table.getRows())
+            if (!(skipNulls && row[c].isNull())) seen.insert(row[c]);
+        for (size_t i = 0; i < chunks.size(); i++) {
+            for (size_t r = 0; r < chunks[i].rows.size(); r++) {
+                const Value& v = chunks[i].rows[r][c];
+                if (skipNulls && v.isNull()) continue;
+                if (!seen.insert(v).second)
+                    throw std::runtime_error("Line " + std::to_string(firstLine[i] + chunks[i].rowLines[r]) +
+                                             ": Duplicate value for unique column '" + columns[c].name + "'");
+            }
+        }
+    }
+
+    std::vector<Row> rows;
+    rows.reserve(total);
+    for (auto& chunk : chunks)
+        std::move(chunk.rows.begin(), chunk.rows.end(), std::back_inserter(rows));
+    table.appendRows(std::move(rows));
+    return total;
+}
+
+} // namespace epee
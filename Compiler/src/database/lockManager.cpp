@@ -0,0 +1,196 @@
+/*
+ File: lockManager.cpp
+ Project: Épée Database Query Language
+ Description: Hierarchical reader-writer locks over the database and its
+              tables, with intention modes and deadlock detection
+*/
+
+#include "../../include/database/lockManager.hpp"
+
+#include <algorithm>
+
+namespace epee {
+
+const char* lockModeName(LockMode mode) {
+    switch (mode) {
+        case LockMode::IS: return "IS";
+        case LockMode::IX: return "IX";
+        case LockMode::S: return "S";
+        case LockMode::SIX: return "SIX";
+        case LockMode::X: return "X";
+    }
+    return "?";
+}
+
+bool lockModesCompatible(LockMode a, LockMode b) {
+    //                 IS     IX     S      SIX    X
+    static const bool table[5][5] = {
+        /* IS  */ {true,  true,  true,  true,  false},
+        /* IX  */ {true,  true,  false, false, false},
+        /* S   */ {true,  false, true,  false, false},
+        /* SIX */ {true,  false, false, false, false},
+        /* X   */ {false, false, false, false, false},
+    };
+    return table[static_cast<int>(a)][static_cast<int>(b)];
+}
+
+LockMode combineLockModes(LockMode a, LockMode b) {
+    if (a == b) return a;
+    if (a == LockMode::X || b == LockMode::X) return LockMode::X;
+    if (a == LockMode::SIX || b == LockMode::SIX) return LockMode::SIX;
+    if (a == LockMode::IS) return b;
+    if (b == LockMode::IS) return a;
+    return LockMode::SIX;  // IX and S
+}
+
+// ── LockSet ──────────────────────────────────────────────────────────
+
+void LockSet::lockDatabase(LockMode mode) {
+    databaseMode = database ? combineLockModes(databaseMode, mode) : mode;
+    database = true;
+}
+
+void LockSet::lockTable(const std::string& name, LockMode mode) {
+    auto [it, inserted] = tables.emplace(name, mode);
+    if (!inserted) it->second = combineLockModes(it->second, mode);
+    const bool write = it->second == LockMode::X || it->second == LockMode::IX || it->second == LockMode::SIX;
+    lockDatabase(write ? LockMode::IX : LockMode::IS);
+}
+
+// ── LockManager ──────────────────────────────────────────────────────
+
+LockManager::Owner LockManager::newOwner() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nextOwner_++;
+}
+
+// Owners `owner` would wait for to get `mode`: other holders it conflicts
+// with and, unless it is converting a lock it holds, conflicting requests
+// queued ahead of it
+void LockManager::blockers(const Resource& res, Owner owner, LockMode mode,
+                           std::vector<Owner>& out) const {
+    for (const auto& [holder, held] : res.holders)
+        if (holder != owner && !lockModesCompatible(mode, held)) out.push_back(holder);
+    if (res.holders.count(owner)) return;
+    for (const auto& waiter : res.queue) {
+        if (waiter.owner == owner) break;
+        if (!lockModesCompatible(mode, waiter.mode)) out.push_back(waiter.owner);
+    }
+}
+
+bool LockManager::grantable(const Resource& res, Owner owner, LockMode mode) const {
+    std::vector<Owner> blocking;
+    blockers(res, owner, mode, blocking);
+    return blocking.empty();
+}
+
+// Whether `from` is waiting, directly or through other waiters, on `target`
+bool LockManager::waitsOn(Owner from, Owner target, std::vector<Owner>& visited) const {
+    if (std::find(visited.begin(), visited.end(), from) != visited.end()) return false;
+    visited.push_back(from);
+    auto waiting = waitingFor_.find(from);
+    if (waiting == waitingFor_.end()) return false;
+    const Resource& res = resources_.at(waiting->second);
+    for (const auto& waiter : res.queue) {
+        if (waiter.owner != from) continue;
+        std::vector<Owner> next;
+        blockers(res, from, waiter.mode, next);
+        for (Owner b : next)
+            if (b == target || waitsOn(b, target, visited)) return true;
+        break;
+    }
+    return false;
+}
+
+void LockManager::acquire(Owner owner, const std::string& table, LockMode mode) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Elements of an unordered_map keep their address, and a resource is
+    // only erased once nobody holds or waits for it
+    Resource& res = resources_[table];
+    auto held = res.holders.find(owner);
+    const LockMode want = held == res.holders.end() ? mode : combineLockModes(held->second, mode);
+    if (held != res.holders.end() && held->second == want) return;
+
+    bool queued = false;
+    while (!grantable(res, owner, want)) {
+        std::vector<Owner> blocking;
+        blockers(res, owner, want, blocking);
+        for (Owner b : blocking) {
+            std::vector<Owner> visited;
+            if (!waitsOn(b, owner, visited)) continue;
+            if (queued) {
+                res.queue.erase(std::find_if(res.queue.begin(), res.queue.end(),
+                                             [owner](const Waiter& w) { return w.owner == owner; }));
+                waitingFor_.erase(owner);
+            } else if (res.holders.empty() && res.queue.empty()) {
+                resources_.erase(table);
+            }
+            deadlocks_++;
+            changed_.notify_all();
+            throw DeadlockError("Deadlock detected waiting for " + std::string(lockModeName(want)) +
+                                " lock on " + (table.empty() ? "the database" : "table '" + table + "'"));
+        }
+        if (!queued) {
+            res.queue.push_back({owner, want});
+            waitingFor_[owner] = table;
+            queued = true;
+            waits_++;
+        }
+        changed_.wait(lock);
+    }
+
+    if (queued) {
+        res.queue.erase(std::find_if(res.queue.begin(), res.queue.end(),
+                                     [owner](const Waiter& w) { return w.owner == owner; }));
+        waitingFor_.erase(owner);
+        changed_.notify_all();  // requests queued behind this one may now go
+    }
+    auto [it, inserted] = res.holders.emplace(owner, want);
+    if (inserted) held_[owner].push_back(table);
+    else it->second = want;
+}
+
+void LockManager::acquire(Owner owner, const LockSet& locks) {
+    if (!locks.database) return;
+    acquire(owner, std::string(), locks.databaseMode);
+    for (const auto& [name, mode] : locks.tables) acquire(owner, name, mode);
+}
+
+void LockManager::releaseAll(Owner owner) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto held = held_.find(owner);
+    if (held == held_.end()) return;
+    for (const auto& name : held->second) {
+        auto res = resources_.find(name);
+        if (res == resources_.end()) continue;
+        res->second.holders.erase(owner);
+        if (res->second.holders.empty() && res->second.queue.empty()) resources_.erase(res);
+    }
+    held_.erase(held);
+    changed_.notify_all();
+}
+
+bool LockManager::holds(Owner owner, const std::string& table, LockMode mode) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto res = resources_.find(table);
+    if (res == resources_.end()) return false;
+    auto held = res->second.holders.find(owner);
+    return held != res->second.holders.end() && combineLockModes(held->second, mode) == held->second;
+}
+
+bool LockManager::holdsAny(Owner owner) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return held_.count(owner) > 0;
+}
+
+uint64_t LockManager::waits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return waits_;
+}
+
+uint64_t LockManager::deadlocks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return deadlocks_;
+}
+
+} // namespace epee
@@ -0,0 +1,106 @@
+/*
+ File: memory.cpp
+ Project: Épée Database Query Language
+ Description: Replacement global operator new / delete that feed the
+              allocation tracker
+*/
+
+#include "../../include/database/memory.hpp"
+
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#define EPEE_BLOCK_SIZE(p) malloc_usable_size(p)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define EPEE_BLOCK_SIZE(p) malloc_size(p)
+#endif
+
+namespace epee {
+
+namespace {
+
+thread_local AllocationCounters* threadCounters = nullptr;
+
+} // namespace
+
+void AllocationCounters::allocated(int64_t bytes) {
+    for (AllocationCounters* c = this; c; c = c->parent_) {
+        int64_t now = c->current_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        int64_t seen = c->peak_.load(std::memory_order_relaxed);
+        while (now > seen && !c->peak_.compare_exchange_weak(seen, now, std::memory_order_relaxed)) {
+        }
+    }
+}
+
+void AllocationCounters::freed(int64_t bytes) {
+    for (AllocationCounters* c = this; c; c = c->parent_)
+        c->current_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+#ifdef EPEE_BLOCK_SIZE
+bool AllocationTracker::supported() { return true; }
+#else
+bool AllocationTracker::supported() { return false; }
+#endif
+
+AllocationCounters* AllocationTracker::active() { return threadCounters; }
+
+AllocationTracker::Scope::Scope(AllocationCounters* counters) : previous_(threadCounters) {
+    threadCounters = counters;
+}
+
+AllocationTracker::Scope::~Scope() { threadCounters = previous_; }
+
+} // namespace epee
+
+#ifdef EPEE_BLOCK_SIZE
+
+static void* trackedAlloc(std::size_t size) {
+    if (size == 0) size = 1;
+    void* p;
+    while (!(p = std::malloc(size))) {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) return nullptr;
+        handler();
+    }
+    if (epee::AllocationCounters* counters = epee::threadCounters)
+        counters->allocated(static_cast<int64_t>(EPEE_BLOCK_SIZE(p)));
+    return p;
+}
+
+static void trackedFree(void* p) noexcept {
+    if (!p) return;
+    if (epee::AllocationCounters* counters = epee::threadCounters)
+        counters->freed(static_cast<int64_t>(EPEE_BLOCK_SIZE(p)));
+    std::free(p);
+}
+
+void* operator new(std::size_t size) {
+    if (void* p = trackedAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* p = trackedAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return trackedAlloc(size); } catch (...) { return nullptr; }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return trackedAlloc(size); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { trackedFree(p); }
+void operator delete[](void* p) noexcept { trackedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { trackedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { trackedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { trackedFree(p); }
+
+#endif
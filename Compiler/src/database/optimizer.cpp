@@ -0,0 +1,217 @@
+/*
+ File: optimizer.cpp
+ Project: Épée Database Query Language
+ Description: Join ordering by dynamic programming over relation subsets
+              (greedy for large joins) with a simple row-count cost model
+*/
+
+#include "../../include/database/optimizer.hpp"
+
+#include <cmath>
+
+namespace epee {
+
+// Relative per-row costs: a nested loop compares every pair, a hash join
+// builds a table over the new relation and probes it once per left row, an
+// index join does one B-tree lookup per left row (copying a std::set of ids)
+static constexpr double kHashBuildCost = 2.0;
+static constexpr double kIndexProbeCost = 2.0;
+
+static size_t popCount(uint64_t bits) {
+    size_t n = 0;
+    for (; bits; bits &= bits - 1) n++;
+    return n;
+}
+
+std::string JoinOptimizer::methodName(JoinMethod method) {
+    switch (method) {
+        case JoinMethod::HASH: return "hash join";
+        case JoinMethod::INDEX_NESTED_LOOP: return "index nested-loop join";
+        case JoinMethod::NESTED_LOOP: return "nested-loop join";
+    }
+    return "join";
+}
+
+JoinStep JoinOptimizer::extend(const JoinGraph& graph, uint64_t placed, double leftRows,
+                               size_t relation, double& cost) {
+    JoinStep step;
+    step.relation = relation;
+    const uint64_t bit = uint64_t(1) << relation;
+    const uint64_t after = placed | bit;
+    const double rows = graph.rows[relation];
+
+    // Predicates that become evaluable once `relation` joins
+    double selectivity = 1.0;
+    bool hashable = false;
+    for (size_t i = 0; i < graph.predicates.size(); i++) {
+        const auto& p = graph.predicates[i];
+        if (p.relations == 0 || (p.relations & ~after) || !(p.relations & bit)) continue;
+        selectivity *= p.selectivity;
+        if (p.left < 0) continue;
+        bool newLeft = static_cast<size_t>(p.left) == relation && ((placed >> p.right) & 1);
+        bool newRight = static_cast<size_t>(p.right) == relation && ((placed >> p.left) & 1);
+        if (newLeft || newRight) hashable = true;
+        if (step.indexPredicate < 0 && ((newLeft && p.leftIndexed) || (newRight && p.rightIndexed)))
+            step.indexPredicate = static_cast<int>(i);
+    }
+
+    if (placed == 0) {
+        step.rows = rows * selectivity;
+        cost = rows;
+        return step;
+    }
+
+    step.rows = leftRows * rows * selectivity;
+    // joinRows hashes whenever there is an equality key, so a nested loop
+    // only remains for joins without one
+    double best = leftRows * rows;
+    if (hashable) {
+        best = leftRows + kHashBuildCost * rows;
+        step.method = JoinMethod::HASH;
+    }
+    if (step.indexPredicate >= 0) {
+        double probe = leftRows * kIndexProbeCost * (1.0 + std::log2(rows + 1.0));
+        if (probe < best) {
+            best = probe;
+            step.method = JoinMethod::INDEX_NESTED_LOOP;
+        }
+    }
+    if (step.method != JoinMethod::INDEX_NESTED_LOOP) step.indexPredicate = -1;
+    cost = best + step.rows;
+    return step;
+}
+
+JoinPlan JoinOptimizer::writtenOrder(const JoinGraph& graph) {
+    JoinPlan plan;
+    uint64_t placed = 0;
+    double rows = 0.0;
+    for (size_t r = 0; r < graph.rows.size(); r++) {
+        double cost;
+        plan.steps.push_back(extend(graph, placed, rows, r, cost));
+        plan.cost += cost;
+        rows = plan.steps.back().rows;
+        placed |= uint64_t(1) << r;
+    }
+    return plan;
+}
+
+JoinPlan JoinOptimizer::exhaustive(const JoinGraph& graph) {
+    const size_t n = graph.rows.size();
+    const uint64_t full = (uint64_t(1) << n) - 1;
+
+    std::vector<uint64_t> neighbors(n, 0);
+    for (const auto& p : graph.predicates) {
+        if (popCount(p.relations) < 2) continue;
+        for (size_t r = 0; r < n; r++)
+            if ((p.relations >> r) & 1) neighbors[r] |= p.relations & ~(uint64_t(1) << r);
+    }
+
+    // best[mask]: cheapest left-deep plan joining exactly the relations in mask
+    std::vector<JoinPlan> best(full + 1);
+    for (size_t r = 0; r < n; r++) {
+        double cost;
+        JoinPlan& single = best[uint64_t(1) << r];
+        single.steps.push_back(extend(graph, 0, 0.0, r, cost));
+        single.cost = cost;
+    }
+
+    for (uint64_t mask = 1; mask < full; mask++) {
+        if (best[mask].steps.empty()) continue;
+        const double rows = best[mask].steps.back().rows;
+
+        bool anyConnected = false;
+        for (size_t r = 0; r < n; r++)
+            if (!((mask >> r) & 1) && (neighbors[r] & mask)) anyConnected = true;
+
+        for (size_t r = 0; r < n; r++) {
+            if ((mask >> r) & 1) continue;
+            if (anyConnected && !(neighbors[r] & mask)) continue;
+            double cost;
+            JoinStep step = extend(graph, mask, rows, r, cost);
+            double total = best[mask].cost + cost;
+            JoinPlan& next = best[mask | (uint64_t(1) << r)];
+            // Ties keep the plan found first, which favours the written order
+            if (next.steps.empty() || total < next.cost * (1.0 - 1e-9)) {
+                next.steps = best[mask].steps;
+                next.steps.push_back(step);
+                next.cost = total;
+            }
+        }
+    }
+    return best[full];
+}
+
+JoinPlan JoinOptimizer::greedy(const JoinGraph& graph) {
+    const size_t n = graph.rows.size();
+    JoinPlan plan;
+
+    // Start from the smallest relation after its own filters
+    size_t start = 0;
+    double startCost = 0.0;
+    JoinStep first;
+    for (size_t r = 0; r < n; r++) {
+        double cost;
+        JoinStep step = extend(graph, 0, 0.0, r, cost);
+        if (r == 0 || step.rows < first.rows) {
+            first = step;
+            start = r;
+            startCost = cost;
+        }
+    }
+    plan.steps.push_back(first);
+    plan.cost = startCost;
+    uint64_t placed = uint64_t(1) << start;
+
+    // Then repeatedly add the relation whose join is cheapest, preferring
+    // relations connected to what is already joined
+    while (plan.steps.size() < n) {
+        const double rows = plan.steps.back().rows;
+        bool found = false, foundConnected = false;
+        JoinStep chosen;
+        double chosenCost = 0.0;
+        for (size_t r = 0; r < n; r++) {
+            if ((placed >> r) & 1) continue;
+            bool connected = false;
+            for (const auto& p : graph.predicates)
+                if (((p.relations >> r) & 1) && (p.relations & placed)) connected = true;
+            if (foundConnected && !connected) continue;
+            double cost;
+            JoinStep step = extend(graph, placed, rows, r, cost);
+            if (!found || (connected && !foundConnected) || cost < chosenCost) {
+                chosen = step;
+                chosenCost = cost;
+                found = true;
+                foundConnected = connected;
+            }
+        }
+        plan.steps.push_back(chosen);
+        plan.cost += chosenCost;
+        placed |= uint64_t(1) << chosen.relation;
+    }
+    return plan;
+}
+
+JoinPlan JoinOptimizer::plan(const JoinGraph& graph) {
+    const size_t n = graph.rows.size();
+    if (n > kMaxRelations) {
+        // Too many relations for the bitmask representation: keep the
+        // written order and let each join pick its own algorithm
+        JoinPlan plan;
+        plan.steps.resize(n);
+        for (size_t r = 0; r < n; r++) plan.steps[r].relation = r;
+        return plan;
+    }
+    JoinPlan written = writtenOrder(graph);
+    if (n <= 1) return written;
+
+    JoinPlan best = n <= kExhaustiveLimit ? exhaustive(graph) : greedy(graph);
+    if (best.inWrittenOrder()) return best;
+
+    // A reordered join has to sort its output back into written order
+    double out = best.steps.back().rows;
+    double restore = out * std::log2(out + 2.0);
+    if (written.cost <= best.cost + restore) return written;
+    return best;
+}
+
+} // namespace epee
@@ -0,0 +1,174 @@
+/*
+ File: parallel.cpp
+ Project: Épée Database Query Language
+ Description: Worker pool and morsel dispatch for parallel query operators
+*/
+
+#include "../../include/database/parallel.hpp"
+#include "../../include/database/memory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace epee {
+
+namespace {
+
+// Process-wide pool of helper threads.  Jobs are plain closures; a thread
+// waiting for its own jobs to finish keeps draining the queue, so nested
+// parallel sections cannot deadlock the pool.
+class WorkerPool {
+public:
+    static WorkerPool& instance() {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    // Run body(0) on the calling thread and body(1..helpers) on pool threads,
+    // returning once every invocation has finished.
+    void run(size_t helpers, const std::function<void(size_t)>& body) {
+        size_t remaining = helpers;
+        std::mutex doneMutex;
+        std::condition_variable done;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (threads_.size() < helpers)
+                threads_.emplace_back([this]() { loop(); });
+            // Helpers count their allocations where the caller does
+            AllocationCounters* allocations = AllocationTracker::active();
+            for (size_t i = 1; i <= helpers; i++) {
+                queue_.push_back([&, i, allocations]() {
+                    {
+                        AllocationTracker::Scope tracking(allocations);
+                        body(i);
+                    }
+                    std::lock_guard<std::mutex> g(doneMutex);
+                    if (--remaining == 0) done.notify_all();
+                });
+            }
+        }
+        wake_.notify_all();
+
+        body(0);
+
+        while (true) {
+            {
+                std::lock_guard<std::mutex> g(doneMutex);
+                if (remaining == 0) break;
+            }
+            std::function<void()> job;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!queue_.empty()) {
+                    job = std::move(queue_.front());
+                    queue_.pop_front();
+                }
+            }
+            if (job) { job(); continue; }
+            std::unique_lock<std::mutex> g(doneMutex);
+            done.wait_for(g, std::chrono::milliseconds(1),
+                          [&]() { return remaining == 0; });
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::function<void()>> queue_;
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+
+    void loop() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+                if (stopping_ && queue_.empty()) return;
+                job = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            job();
+        }
+    }
+};
+
+} // namespace
+
+size_t workerCount() {
+    static const size_t count = []() -> size_t {
+        if (const char* env = std::getenv("EPEE_THREADS")) {
+            long n = std::strtol(env, nullptr, 10);
+            if (n >= 1) return static_cast<size_t>(std::min(n, 256L));
+        }
+        unsigned hw = std::thread::hardware_concurrency();
+        return hw == 0 ? 1 : hw;
+    }();
+    return count;
+}
+
+size_t workersFor(size_t items, size_t morselSize) {
+    if (morselSize == 0) morselSize = 1;
+    size_t morsels = (items + morselSize - 1) / morselSize;
+    return std::max<size_t>(1, std::min(workerCount(), morsels));
+}
+
+void parallelFor(size_t items, size_t morselSize, size_t workers,
+                 const std::function<void(size_t, size_t, size_t)>& fn) {
+    if (items == 0) return;
+    if (morselSize == 0) morselSize = 1;
+    workers = std::max<size_t>(1, workers);
+
+    if (workers == 1) {
+        for (size_t begin = 0; begin < items; begin += morselSize)
+            fn(0, begin, std::min(items, begin + morselSize));
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    WorkerPool::instance().run(workers - 1, [&](size_t worker) {
+        while (!failed.load(std::memory_order_relaxed)) {
+            size_t begin = next.fetch_add(morselSize);
+            if (begin >= items) break;
+            try {
+                fn(worker, begin, std::min(items, begin + morselSize));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) error = std::current_exception();
+                failed.store(true);
+            }
+        }
+    });
+
+    if (error) std::rethrow_exception(error);
+}
+
+void parallelTasks(size_t tasks, size_t workers,
+                   const std::function<void(size_t)>& fn) {
+    parallelFor(tasks, 1, std::min(tasks, workers),
+                [&fn](size_t, size_t begin, size_t) { fn(begin); });
+}
+
+} // namespace epee
@@ -0,0 +1,94 @@
+/*
+ File: perfCounters.cpp
+ Project: Épée Database Query Language
+ Description: PerfCounters implementation (Linux perf_event_open; a no-op elsewhere)
+*/
+
+#include "../../include/database/perfCounters.hpp"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace epee {
+
+#ifdef __linux__
+
+namespace {
+
+int openEvent(uint64_t config, int group) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group < 0;  // the leader starts the whole group
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+} // namespace
+
+PerfCounters::PerfCounters() {
+    static const uint64_t events[kEvents] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    for (int& fd : fds_) fd = -1;
+    for (int i = 0; i < kEvents; i++) {
+        fds_[i] = openEvent(events[i], i == 0 ? -1 : fds_[0]);
+        if (fds_[i] < 0) {
+            // All or nothing, so a sample never mixes real and missing counts
+            for (int& fd : fds_) {
+                if (fd >= 0) close(fd);
+                fd = -1;
+            }
+            return;
+        }
+    }
+    ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds_)
+        if (fd >= 0) close(fd);
+}
+
+PerfSample PerfCounters::read() const {
+    PerfSample sample;
+    if (!available()) return sample;
+    // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, values[nr]
+    uint64_t data[3 + kEvents];
+    if (::read(fds_[0], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[0] != kEvents)
+        return sample;
+    const double scale = data[2] ? static_cast<double>(data[1]) / data[2] : 0.0;
+    auto value = [&](int i) { return static_cast<uint64_t>(static_cast<double>(data[3 + i]) * scale); };
+    sample.cycles = value(0);
+    sample.instructions = value(1);
+    sample.cacheMisses = value(2);
+    sample.branchMisses = value(3);
+    sample.valid = true;
+    return sample;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    for (int& fd : fds_) fd = -1;
+}
+
+PerfCounters::~PerfCounters() {}
+
+PerfSample PerfCounters::read() const { return PerfSample(); }
+
+#endif
+
+} // namespace epee
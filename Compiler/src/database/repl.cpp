@@ -73,7 +73,11 @@ bool Repl::isMutatingStatement(const std::string& input) const {
            lower.rfind("drop", 0) == 0 ||
            lower.rfind("insert", 0) == 0 ||
            lower.rfind("update", 0) == 0 ||
-           lower.rfind("delete", 0) == 0;
+           lower.rfind("delete", 0) == 0 ||
+           lower.rfind("prepare", 0) == 0 ||
+           lower.rfind("execute", 0) == 0 ||
+           lower.rfind("deallocate", 0) == 0 ||
+           lower.rfind("copy", 0) == 0;
 }
 
 void Repl::printBanner() {
@@ -124,6 +128,7 @@ void Repl::printHelp() {
             |> offset(<n>)
             |> count
             |> print;
+            |> export("<file>" [, csv|tsv|jsonl|binary]);
 
   Types: int, double, string, bool
   Operators: +, -, *, /, %, ==, <>, <, >, <=, >=, and, or, not
@@ -145,6 +150,7 @@ void Repl::printHelp() {
 
   Commands:
     help     - Show this help
+    .mode <pretty|csv|tsv|jsonl> - Set the result output format
     exit     - Exit the REPL
     quit     - Exit the REPL
 
@@ -230,10 +236,27 @@ void Repl::run() {
                 std::cout << "  Database file: " << dbPath_ << "\n";
             if (logger_ && logger_->isOpen())
                 std::cout << "  Log file: " << logger_->getFilepath() << "\n";
+            std::cout << "  Statement cache: " << cache_.size() << " entries, "
+                      << cache_.hits() << " hits, " << cache_.misses() << " misses\n";
             std::cout << std::endl;
             continue;
         }
 
+        if (lower.rfind(".mode", 0) == 0) {
+            std::string name = lower.substr(5);
+            name.erase(0, name.find_first_not_of(" \t"));
+            name.erase(name.find_last_not_of(" \t") + 1);
+            OutputFormat format;
+            if (name.empty())
+                std::cout << "Output format: " << formatName(executor_.getOutputFormat()) << std::endl;
+            else if (!parseOutputFormat(name, format) || format == OutputFormat::BINARY)
+                std::cerr << "Error: Unknown output format '" << name
+                          << "' (use pretty, csv, tsv or jsonl)" << std::endl;
+            else
+                executor_.setOutputFormat(format);
+            continue;
+        }
+
         // Check if statement is complete (ends with ;)
         std::string input = line;
         size_t end = input.find_last_not_of(" \t\n\r");
@@ -262,18 +285,39 @@ void Repl::executeFile(const std::string& filename) {
 }
 
 void Repl::executeString(const std::string& source) {
+    TraceActivation tracing(executor_.tracing());
     try {
-        lexer_.setSource(source);
-        auto tokens = lexer_.tokenize();
-
-        DbParser parser(tokens);
-        auto statements = parser.parse();
-
-        if (parser.hasErrors()) {
-            for (const auto& err : parser.getErrors())
-                std::cerr << "Parse Error: " << err << std::endl;
-            return;
+        // Repeated query shapes skip lexing and parsing: the cached
+        // statements are rebound to this text's literals
+        std::string key;
+        std::vector<Value> literals;
+        const bool normalized = StatementCache::normalize(source, key, literals);
+        const std::vector<StmtPtr>* cached =
+            normalized ? cache_.lookup(key, literals, db_.schemaVersion()) : nullptr;
+
+        std::vector<StmtPtr> parsed;
+        if (!cached) {
+            TraceSpan lexSpan("frontend", "lex");
+            lexer_.setSource(source);
+            auto tokens = lexer_.tokenize();
+            lexSpan.count("tokens", tokens.size());
+            lexSpan.finish();
+
+            TraceSpan parseSpan("frontend", "parse");
+            DbParser parser(tokens);
+            parsed = parser.parse();
+            parseSpan.count("statements", parsed.size());
+            parseSpan.finish();
+
+            if (parser.hasErrors()) {
+                for (const auto& err : parser.getErrors())
+                    std::cerr << "Parse Error: " << err << std::endl;
+                return;
+            }
+            if (normalized)
+                cache_.insert(key, literals, parsed, tokens, parser, db_.schemaVersion());
         }
+        const std::vector<StmtPtr>& statements = cached ? *cached : parsed;
 
         // Log mutating statements to WAL before executing
         if (wal_ && isMutatingStatement(source)) {
@@ -286,7 +330,7 @@ void Repl::executeString(const std::string& source) {
                 std::cerr << "Error: " << result.message << std::endl;
                 if (logger_) logger_->logQuery(source, false, result.message);
             } else if (!result.columnNames.empty() || !result.rows.empty()) {
-                std::cout << result.toPrettyTable();
+                writeResult(result, executor_.getOutputFormat(), std::cout);
                 if (logger_) logger_->logQuery(source, true);
             } else if (!result.message.empty()) {
                 std::cout << result.message << std::endl;
@@ -0,0 +1,366 @@
+/*
+ File: resultWriter.cpp
+ Project: Épée Database Query Language
+ Description: Pretty table, CSV/TSV, JSON lines and binary result writers
+*/
+
+#include "../../include/database/resultWriter.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace epee {
+
+namespace {
+
+void appendInt(std::string& out, int64_t v) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, res.ptr);
+}
+
+// Shortest text that reads back as the same double; whole numbers keep a
+// ".0" so they still read as doubles
+void appendDouble(std::string& out, double d) {
+    if (std::isfinite(d) && d == std::floor(d) && std::abs(d) < 1e15) {
+        appendInt(out, static_cast<int64_t>(d));
+        out += ".0";
+        return;
+    }
+    char buf[32];
+    auto res = std::to_chars(buf, buf + sizeof(buf), d);
+    out.append(buf, res.ptr);
+}
+
+void appendRaw(std::string& out, const void* data, size_t size) {
+    out.append(static_cast<const char*>(data), size);
+}
+
+void appendU32(std::string& out, uint32_t v) { appendRaw(out, &v, sizeof(v)); }
+
+// ── Pretty table ─────────────────────────────────────────────────────
+
+class PrettyWriter : public ResultWriter {
+public:
+    explicit PrettyWriter(std::ostream& out) : out_(out) {}
+
+    void begin(const std::vector<std::string>& columns) override {
+        columns_ = columns;
+        widths_.clear();
+        for (const auto& name : columns_) widths_.push_back(name.size());
+    }
+
+    // Each cell is formatted once; the text is kept until end() knows
+    // every column's width
+    void write(const Row& row) override {
+        for (size_t i = 0; i < columns_.size(); i++) {
+            if (i < row.size()) {
+                cells_.push_back(row[i].asString());
+                numeric_.push_back(row[i].isNumeric());
+                widths_[i] = std::max(widths_[i], cells_.back().size());
+            } else {
+                cells_.push_back("NULL");
+                numeric_.push_back(false);
+            }
+        }
+        rows_++;
+    }
+
+    void end() override {
+        std::string line;
+        separator(line);
+        line += '|';
+        for (size_t i = 0; i < columns_.size(); i++) cell(line, columns_[i], widths_[i], false);
+        line += '\n';
+        separator(line);
+        out_.write(line.data(), static_cast<std::streamsize>(line.size()));
+
+        for (size_t r = 0, k = 0; r < rows_; r++) {
+            line.assign(1, '|');
+            for (size_t i = 0; i < columns_.size(); i++, k++)
+                cell(line, cells_[k], widths_[i], numeric_[k]);
+            line += '\n';
+            out_.write(line.data(), static_cast<std::streamsize>(line.size()));
+        }
+
+        line.clear();
+        separator(line);
+        line += std::to_string(rows_) + " row(s)\n";
+        out_.write(line.data(), static_cast<std::streamsize>(line.size()));
+    }
+
+private:
+    std::ostream& out_;
+    std::vector<std::string> columns_;
+    std::vector<size_t> widths_;
+    std::vector<std::string> cells_;  // row-major
+    std::vector<bool> numeric_;       // numbers are right-aligned
+
+    void separator(std::string& line) const {
+        line += '+';
+        for (size_t w : widths_) {
+            line.append(w + 2, '-');
+            line += '+';
+        }
+        line += '\n';
+    }
+
+    static void cell(std::string& line, const std::string& text, size_t width, bool right) {
+        const size_t pad = width > text.size() ? width - text.size() : 0;
+        line += ' ';
+        if (right) line.append(pad, ' ');
+        line += text;
+        if (!right) line.append(pad, ' ');
+        line += " |";
+    }
+};
+
+// ── CSV / TSV ────────────────────────────────────────────────────────
+
+class DelimitedWriter : public ResultWriter {
+public:
+    DelimitedWriter(std::ostream& out, char delimiter) : out_(out), delim_(delimiter) {}
+
+    void begin(const std::vector<std::string>& columns) override {
+        line_.clear();
+        for (size_t i = 0; i < columns.size(); i++) {
+            if (i > 0) line_ += delim_;
+            text(columns[i]);
+        }
+        flushLine();
+    }
+
+    void write(const Row& row) override {
+        line_.clear();
+        for (size_t i = 0; i < row.size(); i++) {
+            if (i > 0) line_ += delim_;
+            const Value& v = row[i];
+            if (v.isNull()) continue;
+            if (v.isString()) text(v.stringView());
+            else if (v.isInt()) appendInt(line_, v.asInt());
+            else if (v.isDouble()) appendDouble(line_, v.asDouble());
+            else line_ += v.asBool() ? "true" : "false";
+        }
+        flushLine();
+        rows_++;
+    }
+
+    void end() override { out_.flush(); }
+
+private:
+    std::ostream& out_;
+    char delim_;
+    std::string line_;
+
+    // Quoted when it would otherwise read back differently
+    void text(std::string_view s) {
+        bool quote = s.empty();
+        for (char c : s) {
+            if (c == delim_ || c == '"' || c == '\n' || c == '\r') {
+                quote = true;
+                break;
+            }
+        }
+        if (!quote) {
+            line_ += s;
+            return;
+        }
+        line_ += '"';
+        for (char c : s) {
+            if (c == '"') line_ += '"';
+            line_ += c;
+        }
+        line_ += '"';
+    }
+
+    void flushLine() {
+        line_ += '\n';
+        out_.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+    }
+};
+
+// ── JSON lines ───────────────────────────────────────────────────────
+
+class JsonLinesWriter : public ResultWriter {
+public:
+    explicit JsonLinesWriter(std::ostream& out) : out_(out) {}
+
+    void begin(const std::vector<std::string>& columns) override {
+        keys_.clear();
+        for (const auto& name : columns) {
+            std::string key;
+            string(key, name);
+            key += ':';
+            keys_.push_back(std::move(key));
+        }
+    }
+
+    void write(const Row& row) override {
+        line_.assign(1, '{');
+        for (size_t i = 0; i < row.size() && i < keys_.size(); i++) {
+            if (i > 0) line_ += ',';
+            line_ += keys_[i];
+            const Value& v = row[i];
+            if (v.isString()) string(line_, v.stringView());
+            else if (v.isInt()) appendInt(line_, v.asInt());
+            else if (v.isDouble() && std::isfinite(v.asDouble())) appendDouble(line_, v.asDouble());
+            else if (v.isBool()) line_ += v.asBool() ? "true" : "false";
+            else line_ += "null";
+        }
+        line_ += "}\n";
+        out_.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+        rows_++;
+    }
+
+    void end() override { out_.flush(); }
+
+private:
+    std::ostream& out_;
+    std::vector<std::string> keys_;  // "name": per column
+    std::string line_;
+
+    static void string(std::string& out, std::string_view s) {
+        out += '"';
+        for (char c : s) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        static const char hex[] = "0123456789abcdef";
+                        out += "\\u00";
+                        out += hex[(c >> 4) & 0xF];
+                        out += hex[c & 0xF];
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        out += '"';
+    }
+};
+
+// ── Binary ───────────────────────────────────────────────────────────
+
+class BinaryWriter : public ResultWriter {
+public:
+    explicit BinaryWriter(std::ostream& out) : out_(out) {}
+
+    void begin(const std::vector<std::string>& columns) override {
+        buffer_.assign("EPEB");
+        appendU32(buffer_, 1);
+        appendU32(buffer_, static_cast<uint32_t>(columns.size()));
+        for (const auto& name : columns) {
+            appendU32(buffer_, static_cast<uint32_t>(name.size()));
+            buffer_ += name;
+        }
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    }
+
+    void write(const Row& row) override {
+        buffer_.assign(sizeof(uint32_t), '\0');  // payload length, filled in below
+        for (const auto& v : row) {
+            if (v.isNull()) {
+                buffer_ += '\0';
+            } else if (v.isInt()) {
+                buffer_ += '\1';
+                int32_t i = v.asInt();
+                appendRaw(buffer_, &i, sizeof(i));
+            } else if (v.isDouble()) {
+                buffer_ += '\2';
+                double d = v.asDouble();
+                appendRaw(buffer_, &d, sizeof(d));
+            } else if (v.isString()) {
+                buffer_ += '\3';
+                std::string_view s = v.stringView();
+                appendU32(buffer_, static_cast<uint32_t>(s.size()));
+                buffer_ += s;
+            } else {
+                buffer_ += '\4';
+                buffer_ += v.asBool() ? '\1' : '\0';
+            }
+        }
+        uint32_t length = static_cast<uint32_t>(buffer_.size() - sizeof(uint32_t));
+        std::memcpy(&buffer_[0], &length, sizeof(length));
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        rows_++;
+    }
+
+    void end() override {
+        buffer_.clear();
+        appendU32(buffer_, 0);
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        out_.flush();
+    }
+
+private:
+    std::ostream& out_;
+    std::string buffer_;
+};
+
+} // namespace
+
+bool parseOutputFormat(const std::string& name, OutputFormat& format) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "pretty" || lower == "table") format = OutputFormat::PRETTY;
+    else if (lower == "csv") format = OutputFormat::CSV;
+    else if (lower == "tsv") format = OutputFormat::TSV;
+    else if (lower == "jsonl" || lower == "json") format = OutputFormat::JSONL;
+    else if (lower == "binary" || lower == "bin") format = OutputFormat::BINARY;
+    else return false;
+    return true;
+}
+
+OutputFormat formatForPath(const std::string& path) {
+    const size_t dot = path.find_last_of('.');
+    const size_t slash = path.find_last_of("/\\");
+    OutputFormat format = OutputFormat::CSV;
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash) &&
+        parseOutputFormat(path.substr(dot + 1), format) && format != OutputFormat::PRETTY)
+        return format;
+    return OutputFormat::CSV;
+}
+
+const char* formatName(OutputFormat format) {
+    switch (format) {
+        case OutputFormat::PRETTY: return "pretty";
+        case OutputFormat::CSV: return "csv";
+        case OutputFormat::TSV: return "tsv";
+        case OutputFormat::JSONL: return "jsonl";
+        case OutputFormat::BINARY: return "binary";
+    }
+    return "unknown";
+}
+
+std::unique_ptr<ResultWriter> makeResultWriter(OutputFormat format, std::ostream& out) {
+    switch (format) {
+        case OutputFormat::PRETTY: return std::make_unique<PrettyWriter>(out);
+        case OutputFormat::CSV: return std::make_unique<DelimitedWriter>(out, ',');
+        case OutputFormat::TSV: return std::make_unique<DelimitedWriter>(out, '\t');
+        case OutputFormat::JSONL: return std::make_unique<JsonLinesWriter>(out);
+        case OutputFormat::BINARY: return std::make_unique<BinaryWriter>(out);
+    }
+    return nullptr;
+}
+
+void writeResult(const QueryResult& result, OutputFormat format, std::ostream& out) {
+    if (format == OutputFormat::PRETTY && result.columnNames.empty()) {
+        out << result.toPrettyTable();
+        return;
+    }
+    auto writer = makeResultWriter(format, out);
+    writer->begin(result.columnNames);
+    for (const auto& row : result.rows) writer->write(row);
+    writer->end();
+    if (format == OutputFormat::PRETTY && !result.message.empty())
+        out << result.message << "\n";
+}
+
+} // namespace epee
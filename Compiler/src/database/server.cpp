@@ -0,0 +1,564 @@
+/*
+ File: server.cpp
+ Project: Épée Database Query Language
+ Description: Server event loop, worker pool, per-connection sessions and the
+              blocking client
+*/
+
+#include "../../include/database/server.hpp"
+#include "../../include/database/dbLexer.hpp"
+#include "../../include/database/dbParser.hpp"
+#include "../../include/database/resultWriter.hpp"
+#include "../../include/database/statementCache.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define EPEE_HAVE_SOCKETS 1
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#define EPEE_HAVE_EPOLL 1
+#endif
+
+namespace epee {
+
+// ── Session ──────────────────────────────────────────────────────────
+
+// What one connection keeps between requests
+struct Server::Session {
+    Executor executor;
+    DbLexer lexer;
+    StatementCache cache;
+
+    Session(Database& db, SecurityManager& security) : executor(db, security) {
+        executor.setRemote(true);
+    }
+
+    // Run a request the way Repl::executeString does, collecting what the
+    // REPL would print.  Returns false if any statement failed.
+    bool run(Database& db, const std::string& source, std::string& output) {
+        std::ostringstream out;
+        executor.setOutput(out);
+        bool ok = true;
+        std::string command = source;
+        command.erase(0, command.find_first_not_of(" \t\r\n"));
+        command.erase(command.find_last_not_of(" \t\r\n;") + 1);
+        if (command.rfind(".mode", 0) == 0) {
+            ok = setMode(command.substr(5), out);
+            output = out.str();
+            return ok;
+        }
+        TraceActivation tracing(executor.tracing());
+        try {
+            std::string key;
+            std::vector<Value> literals;
+            const bool normalized = StatementCache::normalize(source, key, literals);
+            const std::vector<StmtPtr>* cached =
+                normalized ? cache.lookup(key, literals, db.schemaVersion()) : nullptr;
+
+            std::vector<StmtPtr> parsed;
+            if (!cached) {
+                TraceSpan lexSpan("frontend", "lex");
+                lexer.setSource(source);
+                auto tokens = lexer.tokenize();
+                lexSpan.count("tokens", tokens.size());
+                lexSpan.finish();
+                TraceSpan parseSpan("frontend", "parse");
+                DbParser parser(tokens);
+                parsed = parser.parse();
+                parseSpan.count("statements", parsed.size());
+                parseSpan.finish();
+                if (parser.hasErrors()) {
+                    for (const auto& err : parser.getErrors())
+                        out << "Parse Error: " << err << "\n";
+                    output = out.str();
+                    return false;
+                }
+                if (normalized) cache.insert(key, literals, parsed, tokens, parser, db.schemaVersion());
+            }
+
+            for (const auto& stmt : cached ? *cached : parsed) {
+                QueryResult result = executor.execute(stmt);
+                if (!result.success) {
+                    out << "Error: " << result.message << "\n";
+                    ok = false;
+                } else if (!result.columnNames.empty() || !result.rows.empty()) {
+                    writeResult(result, executor.getOutputFormat(), out);
+                } else if (!result.message.empty()) {
+                    out << result.message << "\n";
+                }
+            }
+        } catch (const std::exception& e) {
+            out << "Error: " << e.what() << "\n";
+            ok = false;
+        }
+        output = out.str();
+        return ok;
+    }
+
+    // The REPL's .mode command, for this session only
+    bool setMode(std::string name, std::ostream& out) {
+        name.erase(0, name.find_first_not_of(" \t"));
+        OutputFormat format;
+        if (name.empty()) {
+            out << "Output format: " << formatName(executor.getOutputFormat()) << "\n";
+        } else if (!parseOutputFormat(name, format) || format == OutputFormat::BINARY) {
+            out << "Error: Unknown output format '" << name << "' (use pretty, csv, tsv or jsonl)\n";
+            return false;
+        } else {
+            executor.setOutputFormat(format);
+        }
+        return true;
+    }
+};
+
+Server::Connection::Connection() = default;
+Server::Connection::~Connection() = default;
+
+#ifdef EPEE_HAVE_SOCKETS
+
+namespace {
+
+bool isPort(const std::string& address) {
+    return !address.empty() && address.size() <= 5 &&
+           std::all_of(address.begin(), address.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+}
+
+void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+std::string systemError(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+// Connected (client) or listening (server) socket for an address
+int openSocket(const std::string& address, bool listening) {
+    int fd;
+    if (isPort(address)) {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) throw std::runtime_error(systemError("socket"));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(std::stoi(address)));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int one = 1;
+        if (listening) ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        const int rc = listening ? ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))
+                                 : ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        if (rc != 0) {
+            int saved = errno;
+            ::close(fd);
+            errno = saved;
+            return -1;
+        }
+    } else {
+        sockaddr_un addr{};
+        if (address.size() >= sizeof(addr.sun_path))
+            throw std::runtime_error("Socket path too long: " + address);
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) throw std::runtime_error(systemError("socket"));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+        if (listening) ::unlink(address.c_str());  // left behind by an earlier server
+        const int rc = listening ? ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))
+                                 : ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        if (rc != 0) {
+            int saved = errno;
+            ::close(fd);
+            errno = saved;
+            return -1;
+        }
+    }
+    return fd;
+}
+
+void appendFrameHeader(std::string& out, size_t length) {
+    const uint32_t n = htonl(static_cast<uint32_t>(length));
+    out.append(reinterpret_cast<const char*>(&n), sizeof(n));
+}
+
+// Length of the frame at the start of `buffer`, or npos if incomplete
+size_t frameLength(const std::string& buffer) {
+    if (buffer.size() < 4) return std::string::npos;
+    uint32_t n;
+    std::memcpy(&n, buffer.data(), sizeof(n));
+    return ntohl(n);
+}
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool readAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::read(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Readiness notifications: epoll on Linux, poll() elsewhere
+struct PollEvent {
+    int fd;
+    bool readable;
+    bool writable;
+    bool hangup;
+};
+
+#ifdef EPEE_HAVE_EPOLL
+int pollerCreate() { return ::epoll_create1(EPOLL_CLOEXEC); }
+
+void pollerSet(int poller, int fd, bool write, bool add) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | (write ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    ev.data.fd = fd;
+    ::epoll_ctl(poller, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev);
+}
+
+void pollerRemove(int poller, int fd) { ::epoll_ctl(poller, EPOLL_CTL_DEL, fd, nullptr); }
+
+void pollerWait(int poller, std::vector<PollEvent>& events,
+                const std::unordered_map<int, bool>&) {
+    epoll_event ready[64];
+    int n = ::epoll_wait(poller, ready, 64, -1);
+    events.clear();
+    for (int i = 0; i < n; i++) {
+        const uint32_t e = ready[i].events;
+        events.push_back({ready[i].data.fd, (e & EPOLLIN) != 0, (e & EPOLLOUT) != 0,
+                          (e & (EPOLLHUP | EPOLLERR)) != 0});
+    }
+}
+#else
+int pollerCreate() { return 0; }
+void pollerSet(int, int, bool, bool) {}
+void pollerRemove(int, int) {}
+
+// `interest` maps every watched fd to whether it waits for writability
+void pollerWait(int, std::vector<PollEvent>& events, const std::unordered_map<int, bool>& interest) {
+    std::vector<pollfd> fds;
+    for (const auto& [fd, write] : interest)
+        fds.push_back({fd, static_cast<short>(POLLIN | (write ? POLLOUT : 0)), 0});
+    int n = ::poll(fds.data(), fds.size(), -1);
+    events.clear();
+    for (int i = 0; n > 0 && i < static_cast<int>(fds.size()); i++) {
+        if (!fds[i].revents) continue;
+        events.push_back({fds[i].fd, (fds[i].revents & POLLIN) != 0, (fds[i].revents & POLLOUT) != 0,
+                          (fds[i].revents & (POLLHUP | POLLERR)) != 0});
+    }
+}
+#endif
+
+} // namespace
+
+// ── Server ───────────────────────────────────────────────────────────
+
+Server::Server(const ServerOptions& options) : options_(options) {}
+
+Server::~Server() { shutdown(); }
+
+void Server::run() {
+    std::signal(SIGPIPE, SIG_IGN);  // a client leaving mid-write is handled via EPIPE
+
+    listenFd_ = openSocket(options_.address, true);
+    if (listenFd_ < 0 || ::listen(listenFd_, 128) != 0)
+        throw std::runtime_error(systemError("Cannot listen on '" + options_.address + "'"));
+    setNonBlocking(listenFd_);
+    if (::pipe(wakeFds_) != 0) throw std::runtime_error(systemError("pipe"));
+    setNonBlocking(wakeFds_[0]);
+    setNonBlocking(wakeFds_[1]);
+    pollFd_ = pollerCreate();
+    if (pollFd_ < 0) throw std::runtime_error(systemError("epoll"));
+
+    // Watched fds and whether each waits for writability (used by poll())
+    std::unordered_map<int, bool> interest = {{listenFd_, false}, {wakeFds_[0], false}};
+    pollerSet(pollFd_, listenFd_, false, true);
+    pollerSet(pollFd_, wakeFds_[0], false, true);
+
+    size_t threads = options_.workers ? options_.workers : std::thread::hardware_concurrency();
+    threads = std::max<size_t>(threads, 1);
+    for (size_t i = 0; i < threads; i++) workers_.emplace_back([this] { workerLoop(); });
+
+    std::vector<PollEvent> events;
+    while (!stopping_) {
+        for (const auto& [fd, conn] : connections_) interest[fd] = conn->wantWrite;
+        pollerWait(pollFd_, events, interest);
+        for (const auto& ev : events) {
+            if (ev.fd == listenFd_) {
+                acceptConnections();
+                for (const auto& [fd, conn] : connections_)
+                    if (!interest.count(fd)) interest[fd] = false;
+            } else if (ev.fd == wakeFds_[0]) {
+                char drain[256];
+                while (::read(wakeFds_[0], drain, sizeof(drain)) > 0) {}
+                collectResponses();
+            } else {
+                auto it = connections_.find(ev.fd);
+                if (it != connections_.end() && ev.writable) flushConnection(*it->second);
+                it = connections_.find(ev.fd);  // flushing may have closed it
+                if (it != connections_.end() && (ev.readable || ev.hangup)) readConnection(*it->second);
+            }
+        }
+        for (auto it = interest.begin(); it != interest.end();) {
+            if (it->first != listenFd_ && it->first != wakeFds_[0] && !connections_.count(it->first))
+                it = interest.erase(it);
+            else
+                ++it;
+        }
+    }
+    shutdown();
+}
+
+void Server::stop() {
+    stopping_ = true;
+    if (wakeFds_[1] >= 0) {
+        char byte = 0;
+        (void)!::write(wakeFds_[1], &byte, 1);
+    }
+}
+
+void Server::acceptConnections() {
+    for (;;) {
+        int fd = ::accept(listenFd_, nullptr, nullptr);
+        if (fd < 0) return;  // EAGAIN: no more pending
+        setNonBlocking(fd);
+        auto conn = std::make_unique<Connection>();
+        conn->fd = fd;
+        conn->session = std::make_unique<Session>(db_, security_);
+        pollerSet(pollFd_, fd, false, true);
+        connections_[fd] = std::move(conn);
+    }
+}
+
+void Server::readConnection(Connection& conn) {
+    char buffer[65536];
+    for (;;) {
+        ssize_t n = ::read(conn.fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            conn.input.append(buffer, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        closeConnection(conn.fd);  // EOF or error
+        return;
+    }
+    const size_t length = frameLength(conn.input);
+    if (length != std::string::npos && length > kMaxFrameBytes) {
+        closeConnection(conn.fd);
+        return;
+    }
+    dispatch(conn);
+}
+
+// Hand the next complete request to the workers, unless one is running
+void Server::dispatch(Connection& conn) {
+    if (conn.busy || conn.closed) return;
+    const size_t length = frameLength(conn.input);
+    if (length == std::string::npos || conn.input.size() < 4 + length) return;
+    std::string source = conn.input.substr(4, length);
+    conn.input.erase(0, 4 + length);
+    conn.busy = true;
+    bool grow;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        queue_.push_back({&conn, std::move(source)});
+        grow = queue_.size() > idleWorkers_ && workers_.size() < options_.maxWorkers;
+    }
+    if (grow) workers_.emplace_back([this] { workerLoop(); });
+    queueReady_.notify_one();
+}
+
+void Server::flushConnection(Connection& conn) {
+    while (conn.written < conn.output.size()) {
+        ssize_t n = ::write(conn.fd, conn.output.data() + conn.written, conn.output.size() - conn.written);
+        if (n > 0) {
+            conn.written += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        closeConnection(conn.fd);
+        return;
+    }
+    const bool pending = conn.written < conn.output.size();
+    if (!pending) {
+        conn.output.clear();
+        conn.written = 0;
+    }
+    if (pending != conn.wantWrite) {
+        conn.wantWrite = pending;
+        pollerSet(pollFd_, conn.fd, pending, false);
+    }
+}
+
+void Server::collectResponses() {
+    std::vector<std::pair<Connection*, std::string>> done;
+    {
+        std::lock_guard<std::mutex> lock(doneMutex_);
+        done.swap(done_);
+    }
+    for (auto& [conn, response] : done) {
+        conn->busy = false;
+        if (conn->closed) {
+            connections_.erase(conn->fd);
+            continue;
+        }
+        const int fd = conn->fd;
+        conn->output += response;
+        flushConnection(*conn);
+        auto it = connections_.find(fd);
+        if (it != connections_.end()) dispatch(*it->second);
+    }
+}
+
+void Server::closeConnection(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) return;
+    pollerRemove(pollFd_, fd);
+    ::close(fd);
+    std::unique_ptr<Connection> conn = std::move(it->second);
+    connections_.erase(it);
+    if (conn->busy) {
+        // A worker still holds the session: park it under a key no socket
+        // can have until collectResponses frees it
+        conn->closed = true;
+        conn->fd = -fd - 1;
+        connections_[conn->fd] = std::move(conn);
+    }
+}
+
+void Server::workerLoop() {
+    for (;;) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            idleWorkers_++;
+            queueReady_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            idleWorkers_--;
+            if (queue_.empty()) return;
+            request = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        std::string output;
+        const bool ok = request.connection->session->run(db_, request.source, output);
+        std::string frame;
+        appendFrameHeader(frame, output.size() + 1);
+        frame += ok ? 'O' : 'E';
+        frame += output;
+        {
+            std::lock_guard<std::mutex> lock(doneMutex_);
+            done_.push_back({request.connection, std::move(frame)});
+        }
+        char byte = 0;
+        (void)!::write(wakeFds_[1], &byte, 1);
+    }
+}
+
+void Server::shutdown() {
+    stopping_ = true;
+    queueReady_.notify_all();
+    for (auto& t : workers_) t.join();
+    workers_.clear();
+    for (auto& [fd, conn] : connections_)
+        if (fd >= 0) ::close(fd);
+    connections_.clear();
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+        listenFd_ = -1;
+        if (!isPort(options_.address)) ::unlink(options_.address.c_str());
+    }
+#ifdef EPEE_HAVE_EPOLL
+    if (pollFd_ >= 0) ::close(pollFd_);
+#endif
+    pollFd_ = -1;
+    for (int& fd : wakeFds_) {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+}
+
+// ── Client ───────────────────────────────────────────────────────────
+
+Client::Client(const std::string& address, int timeoutMs) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        fd_ = openSocket(address, false);
+        if (fd_ >= 0) return;
+        if (std::chrono::steady_clock::now() >= deadline)
+            throw std::runtime_error(systemError("Cannot connect to '" + address + "'"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+}
+
+Client::~Client() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool Client::query(const std::string& source, std::string& output) {
+    if (source.size() > kMaxFrameBytes) throw std::runtime_error("Request too large");
+    std::string frame;
+    appendFrameHeader(frame, source.size());
+    frame += source;
+    if (!writeAll(fd_, frame.data(), frame.size()))
+        throw std::runtime_error("Connection to server lost");
+
+    char header[4];
+    if (!readAll(fd_, header, sizeof(header)))
+        throw std::runtime_error("Connection to server lost");
+    const size_t length = frameLength(std::string(header, sizeof(header)));
+    if (length == 0 || length > kMaxFrameBytes) throw std::runtime_error("Malformed response");
+    std::string payload(length, '\0');
+    if (!readAll(fd_, &payload[0], length))
+        throw std::runtime_error("Connection to server lost");
+    output.assign(payload, 1, std::string::npos);
+    return payload[0] == 'O';
+}
+
+#else  // no sockets on this platform
+
+Server::Server(const ServerOptions& options) : options_(options) {}
+Server::~Server() = default;
+void Server::run() { throw std::runtime_error("Server mode is not supported on this platform"); }
+void Server::stop() { stopping_ = true; }
+
+Client::Client(const std::string&, int) {
+    throw std::runtime_error("Client mode is not supported on this platform");
+}
+Client::~Client() = default;
+bool Client::query(const std::string&, std::string&) { return false; }
+
+#endif
+
+} // namespace epee
@@ -0,0 +1,202 @@
+/*
+ File: statementCache.cpp
+ Project: Épée Database Query Language
+ Description: Statement cache normalization, lookup with literal rebinding and
+              LRU eviction
+*/
+
+#include "../../include/database/statementCache.hpp"
+
+#include <cctype>
+
+namespace epee {
+
+namespace {
+
+// Literal values compare equal only when they have the same type as well
+bool sameLiteral(const Value& a, const Value& b) {
+    return a.getType() == b.getType() && a == b;
+}
+
+bool isLiteralToken(const DbToken& tok) {
+    return tok.type == DbTokenType::INT_LIT || tok.type == DbTokenType::DOUBLE_LIT ||
+           tok.type == DbTokenType::STRING_LIT;
+}
+
+// Statements whose AST only lives for the duration of one execution
+bool isCacheable(const StmtPtr& stmt) {
+    return std::dynamic_pointer_cast<SelectStmt>(stmt) ||
+           std::dynamic_pointer_cast<PipelineStmt>(stmt) ||
+           std::dynamic_pointer_cast<InsertStmt>(stmt) ||
+           std::dynamic_pointer_cast<UpdateStmt>(stmt) ||
+           std::dynamic_pointer_cast<DeleteStmt>(stmt) ||
+           std::dynamic_pointer_cast<ExecuteStmt>(stmt);
+}
+
+} // namespace
+
+bool StatementCache::normalize(const std::string& source, std::string& key,
+                               std::vector<Value>& literals) {
+    key.clear();
+    literals.clear();
+    key.reserve(source.size());
+
+    // Mirrors DbLexer's rules for whitespace, comments, numbers and strings
+    const size_t n = source.size();
+    size_t i = 0;
+    bool space = false;
+    while (i < n) {
+        const unsigned char c = static_cast<unsigned char>(source[i]);
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            space = true;
+            i++;
+            continue;
+        }
+        if (c == '/' && i + 1 < n && source[i + 1] == '/') {
+            while (i < n && source[i] != '\n') i++;
+            space = true;
+            continue;
+        }
+        if (c == '/' && i + 1 < n && source[i + 1] == '*') {
+            i += 2;
+            while (i < n && !(source[i] == '*' && i + 1 < n && source[i + 1] == '/')) i++;
+            i = i < n ? i + 2 : n;
+            space = true;
+            continue;
+        }
+        if (space && !key.empty()) key += ' ';
+        space = false;
+
+        if (std::isdigit(c)) {
+            size_t start = i;
+            bool isDouble = false;
+            while (i < n && std::isdigit(static_cast<unsigned char>(source[i]))) i++;
+            if (i + 1 < n && source[i] == '.' && std::isdigit(static_cast<unsigned char>(source[i + 1]))) {
+                isDouble = true;
+                i++;
+                while (i < n && std::isdigit(static_cast<unsigned char>(source[i]))) i++;
+            }
+            if (i < n && (source[i] == 'e' || source[i] == 'E')) {
+                isDouble = true;
+                i++;
+                if (i < n && (source[i] == '+' || source[i] == '-')) i++;
+                while (i < n && std::isdigit(static_cast<unsigned char>(source[i]))) i++;
+            }
+            // Out-of-range literals are parse errors; leave them to the parser
+            try {
+                std::string text = source.substr(start, i - start);
+                if (isDouble) literals.push_back(Value(std::stod(text)));
+                else literals.push_back(Value(std::stoi(text)));
+            } catch (...) {
+                return false;
+            }
+            key += isDouble ? "?d" : "?i";
+        } else if (c == '"') {
+            std::string text;
+            i++;
+            while (i < n && source[i] != '"') {
+                if (source[i] == '\\') {
+                    if (++i >= n) break;
+                    switch (source[i]) {
+                        case 'n': text += '\n'; break;
+                        case 't': text += '\t'; break;
+                        default: text += source[i]; break;
+                    }
+                } else {
+                    text += source[i];
+                }
+                i++;
+            }
+            if (i < n) i++;  // closing "
+            literals.push_back(Value(text));
+            key += "?s";
+        } else if (c == '$' && i + 1 < n && std::isdigit(static_cast<unsigned char>(source[i + 1]))) {
+            // Bind parameter: part of the statement's shape, not a literal
+            size_t start = i++;
+            while (i < n && std::isdigit(static_cast<unsigned char>(source[i]))) i++;
+            key.append(source, start, i - start);
+        } else if (std::isalpha(c) || c == '_') {
+            size_t start = i;
+            while (i < n && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_')) i++;
+            key.append(source, start, i - start);
+        } else {
+            // A literal '?' would make keys ambiguous (and is not valid syntax)
+            if (c == '?') return false;
+            key += static_cast<char>(c);
+            i++;
+        }
+    }
+    return !key.empty();
+}
+
+const std::vector<StmtPtr>* StatementCache::lookup(const std::string& key,
+                                                   const std::vector<Value>& literals,
+                                                   uint64_t schemaVersion) {
+    auto found = index_.find(key);
+    if (found == index_.end()) {
+        misses_++;
+        return nullptr;
+    }
+    auto it = found->second;
+    if (it->schemaVersion != schemaVersion || it->literals.size() != literals.size()) {
+        erase(it);
+        misses_++;
+        return nullptr;
+    }
+    for (size_t i = 0; i < literals.size(); i++) {
+        if (!it->slots[i] && !sameLiteral(it->literals[i], literals[i])) {
+            misses_++;
+            return nullptr;
+        }
+    }
+
+    for (size_t i = 0; i < literals.size(); i++)
+        if (it->slots[i]) it->slots[i]->value = literals[i];
+    entries_.splice(entries_.begin(), entries_, it);
+    hits_++;
+    return &it->statements;
+}
+
+void StatementCache::insert(const std::string& key, const std::vector<Value>& literals,
+                            const std::vector<StmtPtr>& statements,
+                            const std::vector<DbToken>& tokens, const DbParser& parser,
+                            uint64_t schemaVersion) {
+    if (capacity_ == 0 || statements.empty()) return;
+    for (const auto& stmt : statements)
+        if (!isCacheable(stmt)) return;
+
+    Entry entry;
+    entry.key = key;
+    entry.statements = statements;
+    entry.literals = literals;
+    entry.schemaVersion = schemaVersion;
+    const auto& nodes = parser.literalNodes();
+    for (size_t t = 0; t < tokens.size(); t++) {
+        if (!isLiteralToken(tokens[t])) continue;
+        const size_t i = entry.slots.size();
+        if (i >= literals.size()) return;
+        std::shared_ptr<LiteralExpr> node = t < nodes.size() ? nodes[t] : nullptr;
+        // The node must still hold the value the normalizer read
+        if (node && !sameLiteral(node->value, literals[i])) return;
+        entry.slots.push_back(node);
+    }
+    if (entry.slots.size() != literals.size()) return;
+
+    auto existing = index_.find(key);
+    if (existing != index_.end()) erase(existing->second);
+    entries_.push_front(std::move(entry));
+    index_[key] = entries_.begin();
+    while (entries_.size() > capacity_) erase(std::prev(entries_.end()));
+}
+
+void StatementCache::clear() {
+    entries_.clear();
+    index_.clear();
+}
+
+void StatementCache::erase(std::list<Entry>::iterator it) {
+    index_.erase(it->key);
+    entries_.erase(it);
+}
+
+} // namespace epee
@@ -0,0 +1,225 @@
+/*
+ File: statistics.cpp
+ Project: Épée Database Query Language
+ Description: ANALYZE implementation, incremental statistics maintenance and
+              selectivity estimation
+*/
+
+#include "../../include/database/statistics.hpp"
+#include "../../include/database/table.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace epee {
+
+namespace {
+
+// HyperLogLog: the top kSketchBits of the hash pick a register, which keeps
+// the longest run of leading zeros seen in the remaining bits
+// Returns true if a register changed
+bool sketchAdd(std::vector<uint8_t>& registers, uint64_t h) {
+    const size_t bits = Statistics::kSketchBits;
+    size_t index = static_cast<size_t>(h >> (64 - bits));
+    uint64_t rest = h << bits;
+    uint8_t rank = 1;
+    while (rank <= 64 - bits && !(rest & (1ULL << 63))) {
+        rest <<= 1;
+        rank++;
+    }
+    if (rank <= registers[index]) return false;
+    registers[index] = rank;
+    return true;
+}
+
+double sketchEstimate(const std::vector<uint8_t>& registers) {
+    const double m = static_cast<double>(registers.size());
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (uint8_t r : registers) {
+        sum += 1.0 / static_cast<double>(1ULL << r);
+        if (r == 0) zeros++;
+    }
+    double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0)
+        estimate = m * std::log(m / static_cast<double>(zeros));  // linear counting
+    return estimate;
+}
+
+int typeRank(const Value& v) {
+    if (v.isNull()) return 0;
+    if (v.isNumeric()) return 1;
+    if (v.isString()) return 2;
+    return 3;
+}
+
+// Returns true if the distinct sketch changed
+bool foldValue(ColumnStats& cs, const Value& v) {
+    if (v.isNull()) {
+        cs.nullCount++;
+        return false;
+    }
+    if (cs.minValue.isNull() || Statistics::less(v, cs.minValue)) cs.minValue = v;
+    if (cs.maxValue.isNull() || Statistics::less(cs.maxValue, v)) cs.maxValue = v;
+    return sketchAdd(cs.sketch, ValueHash::hash(v));
+}
+
+} // namespace
+
+bool Statistics::less(const Value& a, const Value& b) {
+    int ra = typeRank(a), rb = typeRank(b);
+    if (ra != rb) return ra < rb;
+    if (ra == 0) return false;
+    if (ra == 3) return !a.asBool() && b.asBool();
+    return a < b;
+}
+
+TableStats Statistics::analyze(const Table& table) {
+    const auto& rows = table.getRows();
+    const size_t cols = table.colCount();
+
+    TableStats stats;
+    stats.rowCount = rows.size();
+    stats.columns.resize(cols);
+    for (auto& cs : stats.columns)
+        cs.sketch.assign(size_t(1) << kSketchBits, 0);
+
+    // Exact pass: nulls, min/max, distinct sketch
+    for (const auto& row : rows)
+        for (size_t c = 0; c < cols && c < row.size(); c++)
+            foldValue(stats.columns[c], row[c]);
+
+    // Systematic sample for the distribution-shaped statistics
+    const size_t step = rows.size() <= kSampleRows
+        ? 1 : (rows.size() + kSampleRows - 1) / kSampleRows;
+    std::vector<size_t> sample;
+    for (size_t r = 0; r < rows.size(); r += step) sample.push_back(r);
+    stats.sampledRows = sample.size();
+
+    for (size_t c = 0; c < cols; c++) {
+        ColumnStats& cs = stats.columns[c];
+
+        std::unordered_map<Value, size_t, ValueHash> counts;
+        std::vector<Value> values;
+        for (size_t r : sample) {
+            const Value& v = rows[r][c];
+            if (v.isNull()) continue;
+            counts[v]++;
+            values.push_back(v);
+        }
+
+        // Exact when every row was sampled, otherwise the sketch's estimate
+        cs.distinctCount = step == 1 ? static_cast<double>(counts.size())
+                                     : sketchEstimate(cs.sketch);
+        if (values.empty()) continue;
+
+        // Most common values: clearly more frequent than the average value
+        std::vector<std::pair<Value, size_t>> ranked(counts.begin(), counts.end());
+        std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+            if (a.second != b.second) return a.second > b.second;
+            return less(a.first, b.first);
+        });
+        double average = static_cast<double>(values.size()) / counts.size();
+        for (const auto& [v, n] : ranked) {
+            if (cs.mostCommon.size() >= kMostCommonValues) break;
+            if (n < 2 || static_cast<double>(n) <= 1.25 * average) break;
+            cs.mostCommon.push_back({v, static_cast<double>(n) / sample.size()});
+        }
+
+        // Equi-depth histogram: bucket bounds at evenly spaced ranks
+        std::sort(values.begin(), values.end(), less);
+        size_t buckets = std::min(kHistogramBuckets, values.size() - 1);
+        if (buckets == 0) {
+            cs.histogram.push_back(values[0]);
+        } else {
+            for (size_t b = 0; b <= buckets; b++)
+                cs.histogram.push_back(values[b * (values.size() - 1) / buckets]);
+        }
+    }
+
+    stats.modificationsSeen = table.modificationCount();
+    stats.insertsSeen = table.insertCount();
+    stats.modificationsAtAnalyze = stats.modificationsSeen;
+    return stats;
+}
+
+void Statistics::refresh(TableStats& stats, const Table& table) {
+    const uint64_t mods = table.modificationCount();
+    const uint64_t inserts = table.insertCount();
+    if (mods == stats.modificationsSeen) return;
+
+    const uint64_t changed = mods - stats.modificationsAtAnalyze;
+    if (changed > kAutoAnalyzeBase + kAutoAnalyzeFraction * static_cast<double>(stats.rowCount)) {
+        stats = analyze(table);
+        return;
+    }
+
+    // Pure appends since the last refresh: fold the new rows in
+    const auto& rows = table.getRows();
+    const uint64_t appended = inserts - stats.insertsSeen;
+    if (mods - stats.modificationsSeen == appended &&
+        rows.size() == stats.rowCount + appended) {
+        for (size_t c = 0; c < stats.columns.size(); c++) {
+            ColumnStats& cs = stats.columns[c];
+            bool changed = false;
+            for (size_t r = stats.rowCount; r < rows.size(); r++)
+                if (c < rows[r].size()) changed |= foldValue(cs, rows[r][c]);
+            if (changed) cs.distinctCount = sketchEstimate(cs.sketch);
+        }
+    }
+    stats.rowCount = rows.size();
+    stats.modificationsSeen = mods;
+    stats.insertsSeen = inserts;
+}
+
+double Statistics::equalitySelectivity(const TableStats& stats, size_t col, const Value& v) {
+    if (stats.rowCount == 0 || col >= stats.columns.size()) return 0.0;
+    const ColumnStats& cs = stats.columns[col];
+    const double nullFrac = stats.nullFraction(col);
+    if (v.isNull()) return nullFrac;  // NULL == NULL holds in this engine
+
+    double mcvTotal = 0.0;
+    for (const auto& [value, frac] : cs.mostCommon) {
+        if (value == v) return frac;
+        mcvTotal += frac;
+    }
+    if (cs.minValue.isNull() || less(v, cs.minValue) || less(cs.maxValue, v)) return 0.0;
+
+    double others = cs.distinctCount - static_cast<double>(cs.mostCommon.size());
+    if (others < 1.0) others = 1.0;
+    return std::max(0.0, 1.0 - nullFrac - mcvTotal) / others;
+}
+
+double Statistics::lessThanSelectivity(const TableStats& stats, size_t col,
+                                       const Value& v, bool inclusive) {
+    if (stats.rowCount == 0 || col >= stats.columns.size()) return 0.0;
+    const ColumnStats& cs = stats.columns[col];
+    const double nonNull = 1.0 - stats.nullFraction(col);
+    const auto& h = cs.histogram;
+    if (v.isNull()) return 0.0;
+    if (h.empty()) return nonNull / 3.0;
+
+    // Fraction of non-null values below v, interpolating inside the bucket
+    double below;
+    if (less(v, h.front())) {
+        below = 0.0;
+    } else if (!less(v, h.back())) {
+        below = 1.0;
+    } else {
+        size_t i = static_cast<size_t>(
+            std::upper_bound(h.begin(), h.end(), v, less) - h.begin()) - 1;
+        double within = 0.5;
+        if (v.isNumeric() && h[i].isNumeric() && h[i + 1].isNumeric()) {
+            double lo = h[i].asDouble(), hi = h[i + 1].asDouble();
+            if (hi > lo) within = (v.asDouble() - lo) / (hi - lo);
+        }
+        below = (static_cast<double>(i) + within) / static_cast<double>(h.size() - 1);
+    }
+
+    double result = below * nonNull;
+    if (inclusive) result += equalitySelectivity(stats, col, v);
+    return std::min(1.0, std::max(0.0, result));
+}
+
+} // namespace epee
@@ -8,6 +8,7 @@
 
 #include <stdexcept>
 #include <cstring>
+#include <algorithm>
 
 namespace epee {
 
@@ -70,7 +71,7 @@ void Storage::writeValue(std::ofstream& out, const Value& v) {
     }
 }
 
-Value Storage::readValue(std::ifstream& in) {
+Value Storage::readValue(std::ifstream& in, const DictionaryRef& dict) {
     uint8_t tag = 0;
     in.read(reinterpret_cast<char*>(&tag), sizeof(tag));
     if (!in.good()) throw std::runtime_error("Unexpected end of file reading value tag");
@@ -98,11 +99,105 @@ Value Storage::readValue(std::ifstream& in) {
             if (!in.good()) throw std::runtime_error("Unexpected end of file reading bool value");
             return Value(val != 0);
         }
+        case 5: {
+            uint32_t code = 0;
+            in.read(reinterpret_cast<char*>(&code), sizeof(code));
+            if (!in.good()) throw std::runtime_error("Unexpected end of file reading dictionary code");
+            if (!dict || code >= dict->size())
+                throw std::runtime_error("Invalid dictionary code: " + std::to_string(code));
+            return Value::encoded(dict.get(), code);
+        }
         default:
             throw std::runtime_error("Unknown value type tag: " + std::to_string(tag));
     }
 }
 
+void Storage::writeStats(std::ofstream& out, const TableStats& stats, const Table& table) {
+    auto writeU64 = [&](uint64_t v) { out.write(reinterpret_cast<const char*>(&v), sizeof(v)); };
+    auto writeU32 = [&](uint32_t v) { out.write(reinterpret_cast<const char*>(&v), sizeof(v)); };
+    auto writeDouble = [&](double v) { out.write(reinterpret_cast<const char*>(&v), sizeof(v)); };
+
+    writeU64(stats.rowCount);
+    writeU64(stats.sampledRows);
+    // Changes since the last ANALYZE, so the reload knows when to re-analyze
+    writeU64(table.modificationCount() - stats.modificationsAtAnalyze);
+    writeU32(static_cast<uint32_t>(stats.columns.size()));
+    for (const auto& cs : stats.columns) {
+        writeU64(cs.nullCount);
+        writeDouble(cs.distinctCount);
+        writeValue(out, cs.minValue);
+        writeValue(out, cs.maxValue);
+        writeU32(static_cast<uint32_t>(cs.histogram.size()));
+        for (const auto& bound : cs.histogram) writeValue(out, bound);
+        writeU32(static_cast<uint32_t>(cs.mostCommon.size()));
+        for (const auto& [v, frac] : cs.mostCommon) {
+            writeValue(out, v);
+            writeDouble(frac);
+        }
+        writeU32(static_cast<uint32_t>(cs.sketch.size()));
+        if (!cs.sketch.empty())
+            out.write(reinterpret_cast<const char*>(cs.sketch.data()),
+                      static_cast<std::streamsize>(cs.sketch.size()));
+    }
+}
+
+TableStats Storage::readStats(std::ifstream& in, const Table& table) {
+    auto readU64 = [&]() {
+        uint64_t v = 0;
+        in.read(reinterpret_cast<char*>(&v), sizeof(v));
+        if (!in.good()) throw std::runtime_error("Unexpected end of file reading statistics");
+        return v;
+    };
+    auto readU32 = [&](uint32_t limit) {
+        uint32_t v = 0;
+        in.read(reinterpret_cast<char*>(&v), sizeof(v));
+        if (!in.good()) throw std::runtime_error("Unexpected end of file reading statistics");
+        if (v > limit) throw std::runtime_error("Statistics size exceeds safety limit");
+        return v;
+    };
+    auto readDouble = [&]() {
+        double v = 0.0;
+        in.read(reinterpret_cast<char*>(&v), sizeof(v));
+        if (!in.good()) throw std::runtime_error("Unexpected end of file reading statistics");
+        return v;
+    };
+
+    TableStats stats;
+    stats.rowCount = readU64();
+    stats.sampledRows = readU64();
+    uint64_t changedSinceAnalyze = readU64();
+    uint32_t colCount = readU32(10000);
+    if (colCount != table.colCount())
+        throw std::runtime_error("Statistics column count does not match table");
+    stats.columns.resize(colCount);
+    for (auto& cs : stats.columns) {
+        cs.nullCount = readU64();
+        cs.distinctCount = readDouble();
+        cs.minValue = readValue(in);
+        cs.maxValue = readValue(in);
+        uint32_t bounds = readU32(100000);
+        for (uint32_t b = 0; b < bounds; b++) cs.histogram.push_back(readValue(in));
+        uint32_t common = readU32(100000);
+        for (uint32_t m = 0; m < common; m++) {
+            Value v = readValue(in);
+            cs.mostCommon.push_back({v, readDouble()});
+        }
+        uint32_t registers = readU32(1u << 20);
+        cs.sketch.resize(registers);
+        if (registers > 0) {
+            in.read(reinterpret_cast<char*>(cs.sketch.data()), registers);
+            if (!in.good()) throw std::runtime_error("Unexpected end of file reading statistics");
+        }
+    }
+
+    // Rebase onto the freshly loaded table's change counters
+    stats.modificationsSeen = table.modificationCount();
+    stats.insertsSeen = table.insertCount();
+    stats.modificationsAtAnalyze = stats.modificationsSeen -
+        std::min(changedSinceAnalyze, stats.modificationsSeen);
+    return stats;
+}
+
 bool Storage::saveDatabase(const Database& db, const std::string& filepath) {
     if (!validatePath(filepath)) {
         throw std::runtime_error("Invalid file path: " + filepath);
@@ -144,6 +239,18 @@ bool Storage::saveDatabase(const Database& db, const std::string& filepath) {
             out.write(reinterpret_cast<const char*>(&unique), sizeof(unique));
             uint8_t pk = col.primaryKey ? 1 : 0;
             out.write(reinterpret_cast<const char*>(&pk), sizeof(pk));
+            uint8_t dictionary = col.dictionary ? 1 : 0;
+            out.write(reinterpret_cast<const char*>(&dictionary), sizeof(dictionary));
+        }
+
+        // Dictionaries: each distinct string once, in code order
+        for (size_t c = 0; c < cols.size(); c++) {
+            const DictionaryRef& dict = table.getDictionary(c);
+            if (!dict) continue;
+            uint32_t entryCount = static_cast<uint32_t>(dict->size());
+            out.write(reinterpret_cast<const char*>(&entryCount), sizeof(entryCount));
+            for (uint32_t e = 0; e < entryCount; e++)
+                writeString(out, std::string(dict->text(e)));
         }
 
         // Rows
@@ -152,10 +259,25 @@ bool Storage::saveDatabase(const Database& db, const std::string& filepath) {
         out.write(reinterpret_cast<const char*>(&rowCount), sizeof(rowCount));
 
         for (const auto& row : rows) {
-            for (const auto& val : row) {
-                writeValue(out, val);
+            for (size_t c = 0; c < row.size(); c++) {
+                const Value& val = row[c];
+                const DictionaryRef& dict = table.getDictionary(c);
+                if (dict && val.dictionary() == dict.get()) {
+                    uint8_t tag = 5;
+                    out.write(reinterpret_cast<const char*>(&tag), sizeof(tag));
+                    uint32_t code = val.dictionaryCode();
+                    out.write(reinterpret_cast<const char*>(&code), sizeof(code));
+                } else {
+                    writeValue(out, val);
+                }
             }
         }
+
+        // Statistics, if the table has been analyzed
+        const TableStats* stats = db.getStatistics(name);
+        uint8_t hasStats = stats ? 1 : 0;
+        out.write(reinterpret_cast<const char*>(&hasStats), sizeof(hasStats));
+        if (stats) writeStats(out, *stats, table);
     }
 
     out.flush();
@@ -186,7 +308,7 @@ bool Storage::loadDatabase(Database& db, const std::string& filepath) {
     // Validate version
     uint32_t ver = 0;
     in.read(reinterpret_cast<char*>(&ver), sizeof(ver));
-    if (!in.good() || ver != VERSION) {
+    if (!in.good() || ver < MIN_VERSION || ver > VERSION) {
         throw std::runtime_error("Unsupported file version: " + std::to_string(ver));
     }
 
@@ -223,6 +345,13 @@ bool Storage::loadDatabase(Database& db, const std::string& filepath) {
             uint8_t pkVal = 0;
             in.read(reinterpret_cast<char*>(&pkVal), sizeof(pkVal));
             col.primaryKey = (pkVal != 0);
+            if (ver >= 2) {
+                uint8_t dictVal = 0;
+                in.read(reinterpret_cast<char*>(&dictVal), sizeof(dictVal));
+                col.dictionary = (dictVal != 0);
+                if (col.dictionary && col.type != ValueType::STRING)
+                    throw std::runtime_error("Dictionary on non-string column");
+            }
             if (!in.good()) throw std::runtime_error("Error reading column definition");
             columns.push_back(col);
         }
@@ -234,19 +363,44 @@ bool Storage::loadDatabase(Database& db, const std::string& filepath) {
         db.createTable(tableName, columns);
         Table& tbl = db.getTable(tableName);
 
+        // Dictionaries, rebuilt in code order so stored codes stay valid
+        for (uint32_t c = 0; c < colCount; c++) {
+            if (!columns[c].dictionary) continue;
+            uint32_t entryCount = 0;
+            in.read(reinterpret_cast<char*>(&entryCount), sizeof(entryCount));
+            if (!in.good()) throw std::runtime_error("Error reading dictionary size");
+            if (entryCount > 10000000) throw std::runtime_error("Dictionary size exceeds safety limit");
+            DictionaryRef dict = DictionaryRef::create();
+            for (uint32_t e = 0; e < entryCount; e++) {
+                if (dict->encode(readString(in)) != e)
+                    throw std::runtime_error("Duplicate dictionary entry");
+            }
+            tbl.encodeColumn(c, dict);
+        }
+
         // Rows
         uint32_t rowCount = 0;
         in.read(reinterpret_cast<char*>(&rowCount), sizeof(rowCount));
         if (!in.good()) throw std::runtime_error("Error reading row count");
         if (rowCount > 10000000) throw std::runtime_error("Row count exceeds safety limit");
 
+        std::vector<Row> rows;
+        rows.reserve(rowCount);
         for (uint32_t r = 0; r < rowCount; r++) {
             Row row;
             row.reserve(colCount);
             for (uint32_t c = 0; c < colCount; c++) {
-                row.push_back(readValue(in));
+                row.push_back(readValue(in, tbl.getDictionary(c)));
             }
-            tbl.insertRow(row);
+            rows.push_back(std::move(row));
+        }
+        tbl.insertRows(std::move(rows));
+
+        if (ver >= 3) {
+            uint8_t hasStats = 0;
+            in.read(reinterpret_cast<char*>(&hasStats), sizeof(hasStats));
+            if (!in.good()) throw std::runtime_error("Error reading statistics flag");
+            if (hasStats) db.setStatistics(tableName, readStats(in, tbl));
         }
     }
 
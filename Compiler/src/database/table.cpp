@@ -5,10 +5,22 @@
 */
 
 #include "../../include/database/table.hpp"
+#include "../../include/database/resultWriter.hpp"
 
 // Table and Database classes are primarily implemented in the header.
 // This file ensures proper compilation unit linkage.
 
 namespace epee {
-    // Explicit implementations if needed in the future
+
+std::string QueryResult::toPrettyTable() const {
+    if (rows.empty() && columnNames.empty()) {
+        return message.empty() ? "(empty result)" : message;
+    }
+    if (columnNames.empty()) return message;
+
+    std::ostringstream oss;
+    writeResult(*this, OutputFormat::PRETTY, oss);
+    return oss.str();
+}
+
 }
@@ -0,0 +1,189 @@
+/*
+ File: tracer.cpp
+ Project: Épée Database Query Language
+ Description: Tracer, TraceActivation and TraceSpan implementation
+*/
+
+#include "../../include/database/tracer.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace epee {
+
+namespace {
+
+thread_local bool threadTracing = false;
+// The thread's track in the trace, numbered in order of first use, and the
+// trace file its name was last written to
+thread_local int threadTrack = 0;
+thread_local uint64_t threadNamedIn = 0;
+thread_local std::unique_ptr<PerfCounters> threadCounters;
+
+std::atomic<int> nextTrack{1};
+uint64_t traceGeneration = 0;  // guarded by the tracer's mutex
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': out += "\\r"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    out += buffer;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Tracer
+// ---------------------------------------------------------------------------
+
+Tracer::Tracer() : epoch_(std::chrono::steady_clock::now()) {}
+
+Tracer::~Tracer() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closeLocked();
+}
+
+Tracer& Tracer::global() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ && path == path_) return;
+    closeLocked();
+    file_ = std::fopen(path.c_str(), "w");
+    if (!file_) throw std::runtime_error("Cannot open trace file '" + path + "'");
+    std::fputs("[", file_);
+    empty_ = true;
+    path_ = path;
+    traceGeneration++;
+    open_.store(true, std::memory_order_release);
+}
+
+void Tracer::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closeLocked();
+}
+
+void Tracer::closeLocked() {
+    if (!file_) return;
+    open_.store(false, std::memory_order_release);
+    std::fputs("\n]\n", file_);
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+std::string Tracer::path() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return path_;
+}
+
+double Tracer::now() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch_).count();
+}
+
+void Tracer::record(const std::string& name, const char* category, double startUs,
+                    double durationUs, const std::string& args) {
+    if (threadTrack == 0) threadTrack = nextTrack.fetch_add(1);
+    const int pid = static_cast<int>(getpid());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_) return;
+    // Name the thread's track the first time it appears in this file
+    if (threadNamedIn != traceGeneration) {
+        threadNamedIn = traceGeneration;
+        std::fprintf(file_, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                     "\"args\":{\"name\":\"thread %d\"}}",
+                     empty_ ? "" : ",", pid, threadTrack, threadTrack);
+        empty_ = false;
+    }
+    std::fprintf(file_, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                 "\"pid\":%d,\"tid\":%d,\"args\":{%s}}",
+                 jsonEscape(name).c_str(), category, startUs, durationUs, pid, threadTrack, args.c_str());
+}
+
+// ---------------------------------------------------------------------------
+// TraceActivation
+// ---------------------------------------------------------------------------
+
+TraceActivation::TraceActivation(bool on) : previous_(threadTracing) {
+    threadTracing = on;
+}
+
+TraceActivation::~TraceActivation() {
+    threadTracing = previous_;
+}
+
+// ---------------------------------------------------------------------------
+// TraceSpan
+// ---------------------------------------------------------------------------
+
+bool TraceSpan::active() {
+    return threadTracing && Tracer::global().isOpen();
+}
+
+TraceSpan::TraceSpan(const char* category, const std::string& name) {
+    if (!active()) return;
+    recording_ = true;
+    category_ = category;
+    name_ = name;
+    if (!threadCounters) threadCounters.reset(new PerfCounters());
+    counters_ = threadCounters->read();
+    startUs_ = Tracer::global().now();
+}
+
+void TraceSpan::arg(const char* key, const std::string& value) {
+    if (!recording_) return;
+    if (!args_.empty()) args_ += ',';
+    args_ += '"';
+    args_ += key;
+    args_ += "\":\"" + jsonEscape(value) + '"';
+}
+
+void TraceSpan::count(const char* key, uint64_t value) {
+    if (!recording_) return;
+    if (!args_.empty()) args_ += ',';
+    args_ += '"';
+    args_ += key;
+    args_ += "\":" + std::to_string(value);
+}
+
+void TraceSpan::finish() {
+    if (!recording_) return;
+    recording_ = false;
+    Tracer& tracer = Tracer::global();
+    const double endUs = tracer.now();
+    const PerfSample delta = threadCounters->read() - counters_;
+    if (delta.valid) {
+        char buffer[160];
+        std::snprintf(buffer, sizeof(buffer),
+                      "%s\"cycles\":%llu,\"instructions\":%llu,\"llc_misses\":%llu,"
+                      "\"branch_misses\":%llu,\"ipc\":%.3f",
+                      args_.empty() ? "" : ",", static_cast<unsigned long long>(delta.cycles),
+                      static_cast<unsigned long long>(delta.instructions),
+                      static_cast<unsigned long long>(delta.cacheMisses),
+                      static_cast<unsigned long long>(delta.branchMisses), delta.ipc());
+        args_ += buffer;
+    }
+    tracer.record(name_, category_, startUs_, endUs - startUs_, args_);
+}
+
+} // namespace epee
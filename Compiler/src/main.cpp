@@ -8,15 +8,24 @@
    ./epee                  - Start interactive REPL
    ./epee <file.ep>        - Execute database query file
    ./epee --compile <file> - Use legacy compiler pipeline (lexer/parser/semantic/TAC)
+   ./epee --serve <addr>   - Serve client sessions on a socket path or localhost port
+   ./epee --client <addr> [file] - Send queries (a file, or interactive input) to a server
    ./epee --help           - Show usage information
+
+ Any mode may be preceded by --trace <file.json> to record a Chrome
+ trace of every statement.
 */
 
 #include <iostream>
+#include <fstream>
 #include <string>
 #include <cstring>
+#include <csignal>
 
 // Database engine
 #include "../include/database/repl.hpp"
+#include "../include/database/server.hpp"
+#include "../include/database/tracer.hpp"
 
 // Legacy compiler pipeline
 #include "../include/lexicalAnalysis/lexer.hpp"
@@ -36,16 +45,84 @@ void printUsage(const char* programName) {
     cout << "  " << programName << "                    Start interactive REPL" << endl;
     cout << "  " << programName << " <file.ep>          Execute a query file" << endl;
     cout << "  " << programName << " --db <file.epd>    Start REPL with persistence" << endl;
+    cout << "  " << programName << " --serve <addr>     Serve sessions on a socket path or port" << endl;
+    cout << "  " << programName << " --client <addr> [file]  Query a running server" << endl;
     cout << "  " << programName << " --compile <file>   Legacy compiler mode" << endl;
     cout << "  " << programName << " --help             Show this help" << endl;
+    cout << "  " << programName << " --trace <file.json> ...  Trace statements (any mode)" << endl;
     cout << endl;
     cout << "Examples:" << endl;
     cout << "  " << programName << " queries.ep" << endl;
     cout << "  " << programName << " --db mydata.epd" << endl;
+    cout << "  " << programName << " --serve /tmp/epee.sock" << endl;
+    cout << "  " << programName << " --client 5433 queries.ep" << endl;
     cout << "  " << programName << " --compile program.ep" << endl;
+    cout << "  " << programName << " --trace trace.json queries.ep" << endl;
     cout << endl;
 }
 
+static epee::Server* activeServer = nullptr;
+
+void stopServer(int) {
+    if (activeServer) activeServer->stop();
+}
+
+int runServer(const string& address) {
+    epee::ServerOptions options;
+    options.address = address;
+    epee::Server server(options);
+    activeServer = &server;
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    try {
+        server.run();
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Send a whole file as one request, or each complete statement typed at the
+// prompt (a line ending in ';') as it is entered
+int runClient(const string& address, const string& filename) {
+    try {
+        epee::Client client(address);
+        string output;
+        if (!filename.empty()) {
+            ifstream file(filename);
+            if (!file.is_open()) {
+                cerr << "Error: Cannot open file '" << filename << "'" << endl;
+                return 1;
+            }
+            string source((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+            client.query(source, output);
+            cout << output;
+            return 0;
+        }
+
+        string line, input;
+        cout << "épée@" << address << "> " << flush;
+        while (getline(cin, line)) {
+            if (input.empty() && (line == "exit" || line == "quit" || line == "\\q")) break;
+            input += line + "\n";
+            size_t end = input.find_last_not_of(" \t\n\r");
+            if (end == string::npos) {
+                input.clear();
+            } else if (input[end] == ';' || input.rfind(".mode", 0) == 0) {
+                client.query(input, output);
+                cout << output;
+                input.clear();
+            }
+            cout << (input.empty() ? "épée@" + address + "> " : string("  ... > ")) << flush;
+        }
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
+
 void runLegacyCompiler(const string& filename) {
     FileReader fileReader(filename);
 
@@ -78,6 +155,20 @@ void runLegacyCompiler(const string& filename) {
 }
 
 int main(int argc, char* argv[]) {
+    // --trace <file.json> applies to whichever mode follows it
+    if (argc >= 3 && string(argv[1]) == "--trace") {
+        try {
+            epee::Tracer::global().open(argv[2]);
+            epee::Tracer::global().setTraceAllSessions(true);
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << endl;
+            return 1;
+        }
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+
     if (argc == 1) {
         // No arguments - start REPL
         epee::Repl repl;
@@ -99,10 +190,16 @@ int main(int argc, char* argv[]) {
         } else if (flag == "--db") {
             epee::Repl repl(filename);
             repl.run();
+        } else if (flag == "--serve") {
+            return runServer(argv[2]);
+        } else if (flag == "--client") {
+            return runClient(argv[2], "");
         } else {
             printUsage(argv[0]);
             return 1;
         }
+    } else if (argc == 4 && string(argv[1]) == "--client") {
+        return runClient(argv[2], argv[3]);
     } else {
         printUsage(argv[0]);
         return 1;